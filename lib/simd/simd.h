@@ -50,6 +50,14 @@
 #define AVX2
 #endif
 
+// AVX512BW is used only by dedicated 512-bit kernels, simd_int stays 256-bit wide
+#if defined(SIMDE_X86_AVX512F_NATIVE) && defined(SIMDE_X86_AVX512BW_NATIVE)
+#define AVX512BW
+#if defined(SIMDE_X86_AVX512VBMI_NATIVE)
+#define AVX512VBMI
+#endif
+#endif
+
 #ifdef AVX512
 #include <simde/x86/avx512f.h>
 #include <simde/x86/avx512bw.h>
@@ -158,6 +166,9 @@ typedef __m512i simd_int;
 
 #ifdef AVX2
 #include <simde/x86/avx2.h>
+#ifdef AVX512BW
+#include <simde/x86/avx512.h>
+#endif
 // integer support  (usable with AVX2)
 #ifndef SIMD_INT
 #define SIMD_INT
@@ -225,6 +236,8 @@ typedef __m256i simd_int;
 #define simdi16_add(x,y)    _mm256_add_epi16(x,y)
 #define simdi16_adds(x,y)   _mm256_adds_epi16(x,y)
 #define simdi16_sub(x,y)    _mm256_sub_epi16(x,y)
+#define simdi8_add(x,y)     _mm256_add_epi8(x,y)
+#define simdi8_sub(x,y)     _mm256_sub_epi8(x,y)
 #define simdui8_adds(x,y)   _mm256_adds_epu8(x,y)
 #define simdi32_sub(x,y)    _mm256_sub_epi32(x,y)
 #define simdui16_subs(x,y)  _mm256_subs_epu16(x,y)
@@ -232,6 +245,8 @@ typedef __m256i simd_int;
 #define simdi32_mul(x,y)    _mm256_mullo_epi32(x,y)
 #define simdi32_max(x,y)    _mm256_max_epi32(x,y)
 #define simdi16_max(x,y)    _mm256_max_epi16(x,y)
+#define simdi8_max(x,y)     _mm256_max_epi8(x,y)
+#define simdui8_min(x,y)    _mm256_min_epu8(x,y)
 #define simdi32_insert(x,y,z) _mm256_insert_epi32(x,y,z)
 #define simdi32_extract(x,y) _mm256_extract_epi32(x,y)
 #define simdi16_hmax(x)     simd_hmax16_avx(x)
@@ -429,6 +444,8 @@ typedef __m128i simd_int;
 #define simdi32_add(x,y)    _mm_add_epi32(x,y)
 #define simdi16_add(x,y)    _mm_add_epi16(x,y)
 #define simdi16_sub(x,y)    _mm_sub_epi16(x,y)
+#define simdi8_add(x,y)     _mm_add_epi8(x,y)
+#define simdi8_sub(x,y)     _mm_sub_epi8(x,y)
 
 #define simdi16_adds(x,y)   _mm_adds_epi16(x,y)
 #define simdui8_adds(x,y)   _mm_adds_epu8(x,y)
@@ -438,6 +455,8 @@ typedef __m128i simd_int;
 #define simdi32_mul(x,y)    _mm_mullo_epi32(x,y) // SSE4.1
 #define simdi32_max(x,y)    _mm_max_epi32(x,y) // SSE4.1
 #define simdi16_max(x,y)    _mm_max_epi16(x,y)
+#define simdi8_max(x,y)     _mm_max_epi8(x,y) // SSE4.1
+#define simdui8_min(x,y)    _mm_min_epu8(x,y)
 #define simdi32_insert(x,y,z) _mm_insert_epi32(x,y,z)
 #define simdi32_extract(x,y) _mm_extract_epi32(x,y)
 #define simdi16_hmax(x)     simd_hmax16_sse(x)
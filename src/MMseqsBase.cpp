@@ -154,6 +154,21 @@ std::vector<Command> baseCommands = {
                 "<i:sequenceDB> <tmpDir>",
                 CITATION_SERVER | CITATION_MMSEQS2, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA|DbType::NEED_HEADER, &DbValidator::sequenceDb },
                                                            {"tmpDir", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::directory }}},
+        {"appendindex",          appendindex,          &par.appendindex,          COMMAND_DATABASE_CREATION | COMMAND_EXPERT,
+                "Add new sequences of a sequence DB to its precomputed index",
+                "# Index only the sequences that were appended to sequenceDB since createindex\n"
+                "mmseqs appendindex sequenceDB\n\n"
+                "# Fold all appended sequences into a single split\n"
+                "mmseqs mergeindex sequenceDB\n",
+                "Martin Steinegger <martin.steinegger@snu.ac.kr>",
+                "<i:sequenceDB>",
+                CITATION_MMSEQS2, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA|DbType::NEED_HEADER, &DbValidator::sequenceDb }}},
+        {"mergeindex",           mergeindex,           &par.onlythreads,          COMMAND_DATABASE_CREATION | COMMAND_EXPERT,
+                "Merge the splits added by appendindex into a single split",
+                NULL,
+                "Martin Steinegger <martin.steinegger@snu.ac.kr>",
+                "<i:sequenceDB>",
+                CITATION_MMSEQS2, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb }}},
         {"convertmsa",           convertmsa,           &par.convertmsa,           COMMAND_DATABASE_CREATION,
                 "Convert Stockholm/PFAM MSA file to a MSA DB",
                 NULL,
@@ -559,6 +574,14 @@ std::vector<Command> baseCommands = {
                                                            {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
                                                            {"prefilterDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::prefilterDb }}},
 
+        {"prefilteralign",       prefilteralign,       &par.prefilteralign,       COMMAND_PREFILTER | COMMAND_EXPERT,
+                "Prefilter and align each query in one pass without writing the prefilter DB",
+                NULL,
+                "Martin Steinegger <martin.steinegger@snu.ac.kr>",
+                "<i:queryDB> <i:targetDB> <o:alignmentDB>",
+                CITATION_MMSEQS2, {{"queryDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                                           {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                                           {"alignmentDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::alignmentDb }}},
         {"ungappedprefilter",    ungappedprefilter,    &par.ungappedprefilter,    COMMAND_PREFILTER,
                 "Optimal diagonal score search",
                 NULL,
@@ -1215,6 +1238,17 @@ std::vector<Command> baseCommands = {
                 "Martin Steinegger <martin.steinegger@snu.ac.kr>",
                 "<i:sequenceDB> ",
                 CITATION_MMSEQS2, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb }}},
+        {"server",              server,                &par.server,               COMMAND_SPECIAL,
+                "Answer searches against a resident index over a UNIX socket",
+                "# Load the index of targetDB once and wait for queries\n"
+                "mmseqs createindex targetDB tmp\n"
+                "mmseqs server targetDB mmseqs.sock\n\n"
+                "# Each connection sends FASTA queries and receives BLAST-tab results once it closes its write side\n"
+                "socat -t 3600 - UNIX-CONNECT:mmseqs.sock < query.fasta > result.m8\n",
+                "Martin Steinegger <martin.steinegger@snu.ac.kr>",
+                "<i:targetDB> <socketFile>",
+                CITATION_MMSEQS2, {{"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                   {"socketFile", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::flatfile }}},
 
 
 
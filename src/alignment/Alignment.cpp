@@ -55,7 +55,8 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeq
         }
     }
 
-    uint16_t extended = DBReader<unsigned int>::getExtendedDbtype(FileUtil::parseDbType(prefDB.c_str()));
+    // without a prefilter DB the hits are passed in by the caller through alignQuery
+    uint16_t extended = prefDB.empty() ? 0 : DBReader<unsigned int>::getExtendedDbtype(FileUtil::parseDbType(prefDB.c_str()));
     bool touch = (par.preloadMode != Parameters::PRELOAD_MODE_MMAP);
     tDbrIdx = new IndexReader(targetSeqDB, par.threads,
                               extended & Parameters::DBTYPE_EXTENDED_INDEX_NEED_SRC ? IndexReader::SRC_SEQUENCES : IndexReader::SEQUENCES,
@@ -136,9 +137,13 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeq
     Debug(Debug::INFO) << "Query database size: "  << qdbr->getSize() << " type: " << Parameters::getDbTypeName(querySeqType) << "\n";
     Debug(Debug::INFO) << "Target database size: " << tdbr->getSize() << " type: " << Parameters::getDbTypeName(targetSeqType) << "\n";
 
-    prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
-    prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
-    reversePrefilterResult = Parameters::isEqualDbtype(prefdbr->getDbtype(), Parameters::DBTYPE_PREFILTER_REV_RES);
+    prefdbr = NULL;
+    reversePrefilterResult = false;
+    if (prefDB.empty() == false) {
+        prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+        prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
+        reversePrefilterResult = Parameters::isEqualDbtype(prefdbr->getDbtype(), Parameters::DBTYPE_PREFILTER_REV_RES);
+    }
 
     correlationScoreWeight = par.correlationScoreWeight;
     if (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) {
@@ -162,6 +167,8 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &targetSeq
             realign_m = new SubstitutionMatrix(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0, scoreBias + realignScoreBias);
         }
     }
+
+    evaluer = new EvalueComputation(tdbr->getAminoAcidDBSize(), m, gapOpen, gapExtend);
 }
 
 unsigned int Alignment::initSWMode(unsigned int alignmentMode, float covThr, float seqIdThr) {
@@ -191,6 +198,7 @@ unsigned int Alignment::initSWMode(unsigned int alignmentMode, float covThr, flo
 }
 
 Alignment::~Alignment() {
+    delete evaluer;
     if (realign_m != NULL) {
         delete realign_m;
     }
@@ -212,8 +220,10 @@ Alignment::~Alignment() {
         }
     }
 
-    prefdbr->close();
-    delete prefdbr;
+    if (prefdbr != NULL) {
+        prefdbr->close();
+        delete prefdbr;
+    }
 }
 
 void Alignment::run(const unsigned int mpiRank, const unsigned int mpiNumProc) {
@@ -245,13 +255,23 @@ void Alignment::run() {
     run(outDB, outDBIndex, 0, prefdbr->getSize(), false);
 }
 
-void Alignment::run(const std::string &outDB, const std::string &outDBIndex, const size_t dbFrom, const size_t dbSize, bool merge) {
+int Alignment::getOutputDbtype() const {
     int dbtype = Parameters::DBTYPE_ALIGNMENT_RES;
     if (alignmentOutputMode == Parameters::ALIGNMENT_OUTPUT_CLUSTER) {
         dbtype = Parameters::DBTYPE_CLUSTER_RES;
     }
-    dbtype = DBReader<unsigned int>::setExtendedDbtype(dbtype, DBReader<unsigned int>::getExtendedDbtype(prefdbr->getDbtype()));
-    DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads, compressed, dbtype);
+    uint16_t extended = 0;
+    if (prefdbr != NULL) {
+        extended = DBReader<unsigned int>::getExtendedDbtype(prefdbr->getDbtype()) & ~Parameters::DBTYPE_EXTENDED_BINARY;
+    }
+    if (alignmentOutputMode == Parameters::ALIGNMENT_OUTPUT_BINARY) {
+        extended |= Parameters::DBTYPE_EXTENDED_BINARY;
+    }
+    return DBReader<unsigned int>::setExtendedDbtype(dbtype, extended);
+}
+
+void Alignment::run(const std::string &outDB, const std::string &outDBIndex, const size_t dbFrom, const size_t dbSize, bool merge) {
+    DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads, compressed, getOutputDbtype());
     dbw.open();
 
     // handle no alignment case early, below would divide by 0 otherwise
@@ -260,8 +280,6 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
         return;
     }
 
-    EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), this->m, gapOpen, gapExtend);
-
     size_t totalMemory = Util::getTotalSystemMemory();
     size_t flushSize = 1000000;
     if (totalMemory > prefdbr->getTotalDataSize()) {
@@ -284,28 +302,11 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
 #endif
             std::string alnResultsOutString;
             alnResultsOutString.reserve(1024*1024);
-            char buffer[1024 + 32768*4];
-            Sequence qSeq(maxSeqLen, querySeqType, m, 0, false, compBiasCorrection);
-            Sequence dbSeq(maxSeqLen, targetSeqType, m, 0, false, compBiasCorrection);
-            const size_t maxMatcherSeqLen = Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)
-                                            ? maxSeqLen : std::max(tdbr->getMaxSeqLen(), qdbr->getMaxSeqLen());
-
-            std::vector<Matcher::result_t> swResults;
-            swResults.reserve(300);
-            Matcher matcher(querySeqType, targetSeqType, maxMatcherSeqLen, m, &evaluer, compBiasCorrection, gapOpen, gapExtend, correlationScoreWeight, zdrop);
-
-            std::vector<Matcher::result_t> swRealignResults;
-            Matcher *realigner = NULL;
-            if (realign == true) {
-                swRealignResults.reserve(300);
-                realigner = &matcher;
-                if (realign_m != NULL) {
-                    realigner = new Matcher(querySeqType, targetSeqType, maxMatcherSeqLen, realign_m, &evaluer, compBiasCorrection, gapOpen, gapExtend, 0.0, zdrop);
-                }
-            }
+            ThreadData threadData(*this);
+            char *buffer = threadData.buffer;
 
-            std::string queryToWrap;
-            queryToWrap.reserve(maxSeqLen * 2);
+            std::vector<hit_t> prefHits;
+            prefHits.reserve(300);
 
             const char* words[10];
 
@@ -314,231 +315,338 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex, con
                 progress.updateProgress();
 
                 // get the prefiltering list
-                char *data, *origData;
-                data = origData = prefdbr->getData(id, thread_idx);
+                char *data = prefdbr->getData(id, thread_idx);
                 unsigned int queryDbKey = prefdbr->getDbKey(id);
-                size_t origQueryLen = 0;
-                // only load query data if data != \0
-                if (*data != '\0') {
-                    size_t qId = qdbr->getId(queryDbKey);
-                    char *querySeqData = qdbr->getData(qId, thread_idx);
-                    if (querySeqData == NULL) {
-                        Debug(Debug::ERROR) << "Query sequence " << queryDbKey
-                                            << " is required in the prefiltering, but is not contained in the query sequence database.\nPlease check your database.\n";
-                        EXIT(EXIT_FAILURE);
+
+                // binary prefilter and alignment results are read directly from their arrays
+                prefHits.clear();
+                if (Matcher::isBinaryResult(data)) {
+                    const Matcher::binary_header_t *header = Matcher::getBinaryHeader(data);
+                    const Matcher::binary_result_t *records = Matcher::getBinaryResults(data);
+                    for (unsigned int i = 0; i < header->count; i++) {
+                        hit_t hit;
+                        hit.seqId = records[i].dbKey;
+                        hit.prefScore = 0;
+                        hit.diagonal = 0;
+                        prefHits.push_back(hit);
                     }
-                    size_t queryLen = qdbr->getSeqLen(qId);
-                    origQueryLen = queryLen;
-                    if (wrappedScoring) {
-                        queryToWrap = std::string(querySeqData, queryLen);
-                        queryToWrap = queryToWrap + queryToWrap;
-                        querySeqData = (char*)(queryToWrap).c_str();
-                        queryLen = origQueryLen*2;
+                } else if (QueryMatcher::isBinaryHits(data)) {
+                    QueryMatcher::parsePrefilterHits(data, prefHits);
+                } else {
+                    while (*data != '\0') {
+                        hit_t hit;
+                        size_t elements = Util::getWordsOfLine(data, words, 10);
+                        // Prefilter result (need to make this better)
+                        if (elements == 3) {
+                            hit = QueryMatcher::parsePrefilterHit(data);
+                        } else {
+                            Util::parseKey(data, buffer);
+                            hit.seqId = (unsigned int) strtoul(buffer, NULL, 10);
+                            hit.prefScore = 0;
+                            hit.diagonal = 0;
+                        }
+                        prefHits.push_back(hit);
+                        data = Util::skipLine(data);
                     }
+                }
 
-                    qSeq.mapSequence(qId, queryDbKey, querySeqData, queryLen);
-                    matcher.initQuery(&qSeq);
+                alignQuery(threadData, queryDbKey, prefHits, alnResultsOutString, thread_idx, alignmentsNum, totalPassedNum);
+                dbw.writeData(alnResultsOutString.c_str(), alnResultsOutString.length(), queryDbKey, thread_idx);
+                alnResultsOutString.clear();
+            }
+            // only remap if we have more than one iteration and we are not at the last iteration
+            if (i != (iterations - 1)) {
+#pragma omp barrier
+                if (thread_idx == 0) {
+                    prefdbr->remapData();
                 }
+#pragma omp barrier
+            }
+        }
+    }
+    dbw.close(merge);
 
-                // parse the prefiltering list and calculate a Smith-Waterman alignment for each sequence in the list
-                size_t passedNum = 0;
-                unsigned int rejected = 0;
-                while (*data != '\0' && passedNum < maxAccept && rejected < maxReject) {
-                    Util::parseKey(data, buffer);
-                    const unsigned int dbKey = (unsigned int) strtoul(buffer, NULL, 10);
-                    size_t elements = Util::getWordsOfLine(data, words, 10);
-
-                    short diagonal = 0;
-                    bool isReverse = false;
-                    // Prefilter result (need to make this better)
-                    if (elements == 3) {
-                        hit_t hit = QueryMatcher::parsePrefilterHit(data);
-                        isReverse = reversePrefilterResult && (hit.prefScore < 0);
-                        diagonal = static_cast<short>(hit.diagonal);
-                    }
-                    data = Util::skipLine(data);
+    printStatistics(alignmentsNum, totalPassedNum, dbSize);
+}
 
-                    size_t dbId = tdbr->getId(dbKey);
-                    char *dbSeqData = tdbr->getData(dbId, thread_idx);
-                    if (dbSeqData == NULL) {
-                        Debug(Debug::ERROR) << "Sequence " << dbKey << " is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
-                        EXIT(EXIT_FAILURE);
-                    }
-                    dbSeq.mapSequence(dbId, dbKey, dbSeqData, tdbr->getSeqLen(dbId));
+void Alignment::printStatistics(size_t alignmentsNum, size_t totalPassedNum, size_t querySize) {
+    Debug(Debug::INFO) << alignmentsNum << " alignments calculated\n";
+    Debug(Debug::INFO) << totalPassedNum << " sequence pairs passed the thresholds";
+    if (alignmentsNum > 0) {
+        Debug(Debug::INFO) << " (" << ((float) totalPassedNum / (float) alignmentsNum) << " of overall calculated)";
+    }
+    Debug(Debug::INFO) << "\n";
+    if (querySize > 0) {
+        size_t hits = totalPassedNum / querySize;
+        size_t hits_rest = totalPassedNum % querySize;
+        float hits_f = ((float) hits) + ((float) hits_rest) / (float) querySize;
+        Debug(Debug::INFO) << hits_f << " hits per query sequence\n";
+    }
+}
 
-                    // check if the sequences could pass the coverage threshold
-                    if (Util::canBeCovered(canCovThr, covMode, static_cast<float>(origQueryLen), static_cast<float>(dbSeq.L)) == false) {
-                        rejected++;
-                        continue;
-                    }
+Alignment::ThreadData::ThreadData(const Alignment &aln) :
+        qSeq(aln.maxSeqLen, aln.querySeqType, aln.m, 0, false, aln.compBiasCorrection),
+        dbSeq(aln.maxSeqLen, aln.targetSeqType, aln.m, 0, false, aln.compBiasCorrection),
+        matcher(aln.querySeqType, aln.targetSeqType,
+                Parameters::isEqualDbtype(aln.querySeqType, Parameters::DBTYPE_NUCLEOTIDES)
+                ? aln.maxSeqLen : std::max(aln.tdbr->getMaxSeqLen(), aln.qdbr->getMaxSeqLen()),
+                aln.m, aln.evaluer, aln.compBiasCorrection, aln.gapOpen, aln.gapExtend, aln.correlationScoreWeight, aln.zdrop),
+        realigner(NULL) {
+    swResults.reserve(300);
+    if (aln.realign == true) {
+        swRealignResults.reserve(300);
+        realigner = &matcher;
+        if (aln.realign_m != NULL) {
+            const size_t maxMatcherSeqLen = Parameters::isEqualDbtype(aln.querySeqType, Parameters::DBTYPE_NUCLEOTIDES)
+                                            ? aln.maxSeqLen : std::max(aln.tdbr->getMaxSeqLen(), aln.qdbr->getMaxSeqLen());
+            realigner = new Matcher(aln.querySeqType, aln.targetSeqType, maxMatcherSeqLen, aln.realign_m, aln.evaluer, aln.compBiasCorrection, aln.gapOpen, aln.gapExtend, 0.0, aln.zdrop);
+        }
+    }
+    queryToWrap.reserve(aln.maxSeqLen * 2);
 
-                    const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB)) ? true : false;
+    // short targets are pre-scored in batches and only aligned if they can pass the e-value threshold
+    batchScoring = matcher.canScoreBatch() && aln.wrappedScoring == false && aln.correlationScoreWeight == 0.0f;
+    if (batchScoring) {
+        for (size_t i = 0; i < SmithWaterman::INTER_SEQ_LANES; i++) {
+            batchSeqs[i] = new Sequence(BATCH_MAX_TARGET_LEN, aln.targetSeqType, aln.m, 0, false, aln.compBiasCorrection);
+        }
+    }
 
-                    // calculate Smith-Waterman alignment
+    // nucleotide hits are aligned in batches of pairs, one pair per SIMD lane
+    nucleotideBatch = matcher.canAlignNucleotideBatch() && Parameters::isEqualDbtype(aln.targetSeqType, Parameters::DBTYPE_NUCLEOTIDES);
+    if (nucleotideBatch) {
+        for (size_t i = 0; i < matcher.getNucleotideBatchLanes(); i++) {
+            nuclBatchSeqs[i] = new Sequence(aln.maxSeqLen, aln.targetSeqType, aln.m, 0, false, aln.compBiasCorrection);
+        }
+    }
+    nuclBatchEnd = 0;
+}
 
-                    Matcher::result_t res = matcher.getSWResult(&dbSeq, static_cast<int>(diagonal), isReverse, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity, wrappedScoring);
-                    alignmentsNum++;
+Alignment::ThreadData::~ThreadData() {
+    if (realigner != NULL && realigner != &matcher) {
+        delete realigner;
+    }
+    if (batchScoring) {
+        for (size_t i = 0; i < SmithWaterman::INTER_SEQ_LANES; i++) {
+            delete batchSeqs[i];
+        }
+    }
+    if (nucleotideBatch) {
+        for (size_t i = 0; i < matcher.getNucleotideBatchLanes(); i++) {
+            delete nuclBatchSeqs[i];
+        }
+    }
+}
 
-                    if (isIdentity) {
-                        // set coverage and seqid of identity
-                        res.qcov = 1.0f;
-                        res.dbcov = 1.0f;
-                        res.seqId = 1.0f;
-                    }
+void Alignment::alignQuery(ThreadData &threadData, unsigned int queryDbKey, const std::vector<hit_t> &prefHits, std::string &out,
+                           unsigned int thread_idx, size_t &alignmentsNum, size_t &totalPassedNum) {
+    Sequence &qSeq = threadData.qSeq;
+    Sequence &dbSeq = threadData.dbSeq;
+    Matcher &matcher = threadData.matcher;
+    Matcher *realigner = threadData.realigner;
+    std::vector<Matcher::result_t> &swResults = threadData.swResults;
+    std::vector<Matcher::result_t> &swRealignResults = threadData.swRealignResults;
+    std::vector<int32_t> &batchScores = threadData.batchScores;
+    char *buffer = threadData.buffer;
+
+    size_t origQueryLen = 0;
+    // only load query data if there are hits
+    if (prefHits.empty() == false) {
+        size_t qId = qdbr->getId(queryDbKey);
+        char *querySeqData = qdbr->getData(qId, thread_idx);
+        if (querySeqData == NULL) {
+            Debug(Debug::ERROR) << "Query sequence " << queryDbKey
+                                << " is required in the prefiltering, but is not contained in the query sequence database.\nPlease check your database.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        size_t queryLen = qdbr->getSeqLen(qId);
+        origQueryLen = queryLen;
+        if (wrappedScoring) {
+            threadData.queryToWrap = std::string(querySeqData, queryLen);
+            threadData.queryToWrap = threadData.queryToWrap + threadData.queryToWrap;
+            querySeqData = (char*)(threadData.queryToWrap).c_str();
+            queryLen = origQueryLen*2;
+        }
 
-                    if (checkCriteria(res, isIdentity, evalThr, seqIdThr, alnLenThr, covMode, covThr)) {
-                        swResults.emplace_back(res);
-                        passedNum++;
-                        totalPassedNum++;
-                        rejected = 0;
-                    } else {
-                        rejected++;
-                    }
-                }
+        qSeq.mapSequence(qId, queryDbKey, querySeqData, queryLen);
+        matcher.initQuery(&qSeq);
+    }
 
-                if (altAlignment > 0 && realign == false && wrappedScoring == false) {
-                    computeAlternativeAlignment(queryDbKey, dbSeq, swResults, matcher, covThr, evalThr, swMode, thread_idx);
-                }
+    batchScores.clear();
+    if (threadData.batchScoring) {
+        scoreShortTargets(matcher, prefHits, queryDbKey, static_cast<float>(origQueryLen), threadData.batchSeqs, threadData.batchCandidates, batchScores, thread_idx);
+    }
+    if (threadData.nucleotideBatch) {
+        threadData.nuclBatchLane.assign(prefHits.size(), -1);
+        threadData.nuclBatchEnd = 0;
+    }
 
-                if (swResults.size() > 1) {
-                    SORT_SERIAL(swResults.begin(), swResults.end(), Matcher::compareHits);
-                }
+    // parse the prefiltering list and calculate a Smith-Waterman alignment for each sequence in the list
+    size_t passedNum = 0;
+    unsigned int rejected = 0;
+    for (size_t hitIdx = 0; hitIdx < prefHits.size() && passedNum < maxAccept && rejected < maxReject; hitIdx++) {
+        const unsigned int dbKey = prefHits[hitIdx].seqId;
+        const bool isReverse = reversePrefilterResult && (prefHits[hitIdx].prefScore < 0);
+        const short diagonal = static_cast<short>(prefHits[hitIdx].diagonal);
 
-                std::vector<Matcher::result_t> *returnRes = &swResults;
-                if (realign == true) {
-                    realigner->initQuery(&qSeq);
-                    int realignAccepted = 0;
-                    for (size_t result = 0; result < swResults.size() && realignAccepted < realignMaxSeqs; result++) {
-                        size_t dbId = tdbr->getId(swResults[result].dbKey);
-                        char *dbSeqData = tdbr->getData(dbId, thread_idx);
-                        if (dbSeqData == NULL) {
-                            Debug(Debug::ERROR) << "Sequence " << swResults[result].dbKey <<" is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
-                            EXIT(EXIT_FAILURE);
-                        }
-                        dbSeq.mapSequence(dbId, swResults[result].dbKey, dbSeqData, tdbr->getSeqLen(dbId));
-
-                        // recompute alignment boundaries (without changing evalue)
-                        const bool isIdentity = (queryDbKey == swResults[result].dbKey && (includeIdentity || sameQTDB)) ? true : false;
-                        Matcher::result_t res = realigner->getSWResult(&dbSeq, INT_MAX, false, realignCov, covThr, FLT_MAX, realignSwMode, seqIdMode, isIdentity);
-
-                        const bool covOK = Util::hasCoverage(realignCov, covMode, res.qcov, res.dbcov);
-                        if (covOK == true || isIdentity) {
-                            res.score = swResults[result].score;
-                            res.eval  = swResults[result].eval;
-                            swRealignResults.emplace_back(res);
-                            realignAccepted++;
-                        }
-                    }
+        size_t dbId = tdbr->getId(dbKey);
+        char *dbSeqData = tdbr->getData(dbId, thread_idx);
+        if (dbSeqData == NULL) {
+            Debug(Debug::ERROR) << "Sequence " << dbKey << " is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        dbSeq.mapSequence(dbId, dbKey, dbSeqData, tdbr->getSeqLen(dbId));
 
-                    if (altAlignment > 0) {
-                        computeAlternativeAlignment(queryDbKey, dbSeq, swRealignResults, *realigner, realignCov, FLT_MAX, realignSwMode, thread_idx);
-                    }
+        // check if the sequences could pass the coverage threshold
+        if (Util::canBeCovered(canCovThr, covMode, static_cast<float>(origQueryLen), static_cast<float>(dbSeq.L)) == false) {
+            rejected++;
+            continue;
+        }
 
-                    if (swRealignResults.size() > 1) {
-                        SORT_SERIAL(swRealignResults.begin(), swRealignResults.end(), Matcher::compareHits);
-                    }
+        const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB)) ? true : false;
 
-                    returnRes = &swRealignResults;
-                }
+        // the batch score already shows that the target cannot pass the e-value threshold
+        if (batchScores.empty() == false && batchScores[hitIdx] >= 0
+            && evaluer->computeEvalue(batchScores[hitIdx], qSeq.L) > evalThr) {
+            alignmentsNum++;
+            rejected++;
+            continue;
+        }
 
-                if (lcaAlign == true && swRealignResults.size() > 0) {
-                    Matcher::result_t& topHit = swRealignResults[0];
-                    const unsigned int topHitKey = topHit.dbKey;
-                    size_t dbId = tdbr->getId(topHitKey);
-                    char *qSeqData = tdbr->getData(dbId, thread_idx);
-                    if (qSeqData == NULL) {
-                        Debug(Debug::ERROR) << "Sequence " << topHitKey << " is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
-                        EXIT(EXIT_FAILURE);
-                    }
-                    qSeq.mapSequence(dbId, topHitKey, qSeqData + topHit.dbStartPos, topHit.dbEndPos - topHit.dbStartPos + 1);
-                    realigner->initQuery(&qSeq);
-
-                    const double topHitEval = topHit.eval;
-                    swRealignResults.clear();
-
-                    data = origData;
-                    unsigned int rejected = 0;
-                    while (*data != '\0' && rejected < maxReject) {
-                        Util::parseKey(data, buffer);
-                        const unsigned int dbKey = (unsigned int) strtoul(buffer, NULL, 10);
-//                        size_t elements = Util::getWordsOfLine(data, words, 10);
-//                        short diagonal = 0;
-//                        bool isReverse = false;
-//                        // Prefilter result (need to make this better)
-//                        if (elements == 3) {
-//                            hit_t hit = QueryMatcher::parsePrefilterHit(data);
-//                            isReverse = reversePrefilterResult && (hit.prefScore < 0);
-//                            diagonal = static_cast<short>(hit.diagonal);
-//                        }
-                        data = Util::skipLine(data);
+        // every remaining hit is either accepted or rejected, so at least this many hits are still processed
+        if (threadData.nucleotideBatch && hitIdx >= threadData.nuclBatchEnd) {
+            alignNucleotideBatch(threadData, prefHits, hitIdx, std::min(maxAccept - passedNum, static_cast<size_t>(maxReject - rejected)),
+                                 static_cast<float>(origQueryLen), thread_idx);
+        }
 
-                        dbId = tdbr->getId(dbKey);
-                        char* dbSeqData = tdbr->getData(dbId, thread_idx);
-                        if (dbSeqData == NULL) {
-                            Debug(Debug::ERROR) << "Sequence " << dbKey << " is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
-                            EXIT(EXIT_FAILURE);
-                        }
-                        dbSeq.mapSequence(dbId, dbKey, dbSeqData, tdbr->getSeqLen(dbId));
+        // calculate Smith-Waterman alignment
+        Matcher::result_t res;
+        if (threadData.nucleotideBatch && threadData.nuclBatchLane[hitIdx] >= 0) {
+            res = threadData.nuclBatchResults[threadData.nuclBatchLane[hitIdx]];
+        } else {
+            res = matcher.getSWResult(&dbSeq, static_cast<int>(diagonal), isReverse, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity, wrappedScoring);
+        }
+        alignmentsNum++;
 
-                        Matcher::result_t res = realigner->getSWResult(&dbSeq, INT_MAX, false, covMode, realignCov, topHitEval, lcaSwMode, seqIdMode, false);
+        if (isIdentity) {
+            // set coverage and seqid of identity
+            res.qcov = 1.0f;
+            res.dbcov = 1.0f;
+            res.seqId = 1.0f;
+        }
 
-                        if (checkCriteria(res, false, topHitEval, seqIdThr, alnLenThr, covMode, realignCov)) {
-                            swRealignResults.emplace_back(res);
-                            rejected = 0;
-                        } else {
-                            rejected++;
-                        }
-                    }
+        if (checkCriteria(res, isIdentity, evalThr, seqIdThr, alnLenThr, covMode, covThr)) {
+            swResults.emplace_back(res);
+            passedNum++;
+            totalPassedNum++;
+            rejected = 0;
+        } else {
+            rejected++;
+        }
+    }
 
-                    if (swRealignResults.size() > 1) {
-                        SORT_SERIAL(swRealignResults.begin(), swRealignResults.end(), Matcher::compareHits);
-                    }
+    if (altAlignment > 0 && realign == false && wrappedScoring == false) {
+        computeAlternativeAlignment(queryDbKey, dbSeq, swResults, matcher, covThr, evalThr, swMode, thread_idx);
+    }
 
-                    returnRes = &swRealignResults;
-                }
-                if(alignmentOutputMode == Parameters::ALIGNMENT_OUTPUT_CLUSTER) {
-                    for (size_t result = 0; result < returnRes->size(); result++) {
-                        alnResultsOutString.append(SSTR((*returnRes)[result].dbKey));
-                        alnResultsOutString.push_back('\n');
-                    }
-                }else{
-                    for (size_t result = 0; result < returnRes->size(); result++) {
-                        size_t len = Matcher::resultToBuffer(buffer, (*returnRes)[result], addBacktrace);
-                        alnResultsOutString.append(buffer, len);
-                    }
-                }
-                dbw.writeData(alnResultsOutString.c_str(), alnResultsOutString.length(), queryDbKey, thread_idx);
-                alnResultsOutString.clear();
-                swResults.clear();
-                swRealignResults.clear();
-            }
-            if (realigner != NULL && realigner != &matcher) {
-                delete realigner;
+    if (swResults.size() > 1) {
+        SORT_SERIAL(swResults.begin(), swResults.end(), Matcher::compareHits);
+    }
+
+    std::vector<Matcher::result_t> *returnRes = &swResults;
+    if (realign == true) {
+        realigner->initQuery(&qSeq);
+        int realignAccepted = 0;
+        for (size_t result = 0; result < swResults.size() && realignAccepted < realignMaxSeqs; result++) {
+            size_t dbId = tdbr->getId(swResults[result].dbKey);
+            char *dbSeqData = tdbr->getData(dbId, thread_idx);
+            if (dbSeqData == NULL) {
+                Debug(Debug::ERROR) << "Sequence " << swResults[result].dbKey <<" is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
+                EXIT(EXIT_FAILURE);
             }
-            // only remap if we have more than one iteration and we are not at the last iteration
-            if (i != (iterations - 1)) {
-#pragma omp barrier
-                if (thread_idx == 0) {
-                    prefdbr->remapData();
-                }
-#pragma omp barrier
+            dbSeq.mapSequence(dbId, swResults[result].dbKey, dbSeqData, tdbr->getSeqLen(dbId));
+
+            // recompute alignment boundaries (without changing evalue)
+            const bool isIdentity = (queryDbKey == swResults[result].dbKey && (includeIdentity || sameQTDB)) ? true : false;
+            Matcher::result_t res = realigner->getSWResult(&dbSeq, INT_MAX, false, realignCov, covThr, FLT_MAX, realignSwMode, seqIdMode, isIdentity);
+
+            const bool covOK = Util::hasCoverage(realignCov, covMode, res.qcov, res.dbcov);
+            if (covOK == true || isIdentity) {
+                res.score = swResults[result].score;
+                res.eval  = swResults[result].eval;
+                swRealignResults.emplace_back(res);
+                realignAccepted++;
             }
         }
+
+        if (altAlignment > 0) {
+            computeAlternativeAlignment(queryDbKey, dbSeq, swRealignResults, *realigner, realignCov, FLT_MAX, realignSwMode, thread_idx);
+        }
+
+        if (swRealignResults.size() > 1) {
+            SORT_SERIAL(swRealignResults.begin(), swRealignResults.end(), Matcher::compareHits);
+        }
+
+        returnRes = &swRealignResults;
     }
-    dbw.close(merge);
 
-    Debug(Debug::INFO) << alignmentsNum << " alignments calculated\n";
-    Debug(Debug::INFO) << totalPassedNum << " sequence pairs passed the thresholds";
-    if (alignmentsNum > 0) {
-        Debug(Debug::INFO) << " (" << ((float) totalPassedNum / (float) alignmentsNum) << " of overall calculated)";
+    if (lcaAlign == true && swRealignResults.size() > 0) {
+        Matcher::result_t& topHit = swRealignResults[0];
+        const unsigned int topHitKey = topHit.dbKey;
+        size_t dbId = tdbr->getId(topHitKey);
+        char *qSeqData = tdbr->getData(dbId, thread_idx);
+        if (qSeqData == NULL) {
+            Debug(Debug::ERROR) << "Sequence " << topHitKey << " is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
+            EXIT(EXIT_FAILURE);
+        }
+        qSeq.mapSequence(dbId, topHitKey, qSeqData + topHit.dbStartPos, topHit.dbEndPos - topHit.dbStartPos + 1);
+        realigner->initQuery(&qSeq);
+
+        const double topHitEval = topHit.eval;
+        swRealignResults.clear();
+
+        unsigned int rejected = 0;
+        for (size_t hitIdx = 0; hitIdx < prefHits.size() && rejected < maxReject; hitIdx++) {
+            const unsigned int dbKey = prefHits[hitIdx].seqId;
+            dbId = tdbr->getId(dbKey);
+            char* dbSeqData = tdbr->getData(dbId, thread_idx);
+            if (dbSeqData == NULL) {
+                Debug(Debug::ERROR) << "Sequence " << dbKey << " is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
+                EXIT(EXIT_FAILURE);
+            }
+            dbSeq.mapSequence(dbId, dbKey, dbSeqData, tdbr->getSeqLen(dbId));
+
+            Matcher::result_t res = realigner->getSWResult(&dbSeq, INT_MAX, false, covMode, realignCov, topHitEval, lcaSwMode, seqIdMode, false);
+
+            if (checkCriteria(res, false, topHitEval, seqIdThr, alnLenThr, covMode, realignCov)) {
+                swRealignResults.emplace_back(res);
+                rejected = 0;
+            } else {
+                rejected++;
+            }
+        }
+
+        if (swRealignResults.size() > 1) {
+            SORT_SERIAL(swRealignResults.begin(), swRealignResults.end(), Matcher::compareHits);
+        }
+
+        returnRes = &swRealignResults;
     }
-    Debug(Debug::INFO) << "\n";
-    if (dbSize > 0) {
-        size_t hits = totalPassedNum / dbSize;
-        size_t hits_rest = totalPassedNum % dbSize;
-        float hits_f = ((float) hits) + ((float) hits_rest) / (float) dbSize;
-        Debug(Debug::INFO) << hits_f << " hits per query sequence\n";
+    if(alignmentOutputMode == Parameters::ALIGNMENT_OUTPUT_CLUSTER) {
+        for (size_t result = 0; result < returnRes->size(); result++) {
+            out.append(SSTR((*returnRes)[result].dbKey));
+            out.push_back('\n');
+        }
+    }else if(alignmentOutputMode == Parameters::ALIGNMENT_OUTPUT_BINARY) {
+        Matcher::resultsToBinaryBuffer(out, *returnRes, addBacktrace);
+    }else{
+        for (size_t result = 0; result < returnRes->size(); result++) {
+            size_t len = Matcher::resultToBuffer(buffer, (*returnRes)[result], addBacktrace);
+            out.append(buffer, len);
+        }
     }
+    swResults.clear();
+    swRealignResults.clear();
 }
 
 size_t Alignment::estimateHDDMemoryConsumption(int dbSize, int maxSeqs) {
@@ -566,6 +674,84 @@ bool Alignment::checkCriteria(Matcher::result_t &res, bool isIdentity, double ev
     }
 }
 
+void Alignment::scoreShortTargets(Matcher &matcher, const std::vector<hit_t> &hits, unsigned int queryDbKey, float queryLen,
+                                  Sequence **batchSeqs, std::vector<size_t> &candidates, std::vector<int32_t> &scores, int thread_idx) {
+    candidates.clear();
+    for (size_t i = 0; i < hits.size(); i++) {
+        const unsigned int dbKey = hits[i].seqId;
+        const size_t dbId = tdbr->getId(dbKey);
+        if (dbId == UINT_MAX || (queryDbKey == dbKey && (includeIdentity || sameQTDB))) {
+            continue;
+        }
+        const unsigned int dbLen = tdbr->getSeqLen(dbId);
+        if (dbLen <= BATCH_MAX_TARGET_LEN && Util::canBeCovered(canCovThr, covMode, queryLen, static_cast<float>(dbLen))) {
+            candidates.push_back(i);
+        }
+    }
+    // a partially filled batch wastes lanes, only worth it if there are enough short targets
+    if (candidates.size() < matcher.getBatchLanes() / 2) {
+        return;
+    }
+
+    scores.assign(hits.size(), -1);
+    int32_t laneScores[SmithWaterman::INTER_SEQ_LANES];
+    for (size_t start = 0; start < candidates.size(); start += SmithWaterman::INTER_SEQ_LANES) {
+        size_t count = candidates.size() - start;
+        if (count > SmithWaterman::INTER_SEQ_LANES) {
+            count = SmithWaterman::INTER_SEQ_LANES;
+        }
+        for (size_t lane = 0; lane < count; lane++) {
+            const unsigned int dbKey = hits[candidates[start + lane]].seqId;
+            const size_t dbId = tdbr->getId(dbKey);
+            batchSeqs[lane]->mapSequence(dbId, dbKey, tdbr->getData(dbId, thread_idx), tdbr->getSeqLen(dbId));
+        }
+        matcher.getSWScoreBatch(batchSeqs, count, laneScores);
+        for (size_t lane = 0; lane < count; lane++) {
+            scores[candidates[start + lane]] = laneScores[lane];
+        }
+    }
+}
+
+void Alignment::alignNucleotideBatch(ThreadData &threadData, const std::vector<hit_t> &hits, size_t start, size_t maxHits,
+                                     float queryLen, int thread_idx) {
+    int diagonals[BandedNucleotideAligner::BATCH_LANES];
+    bool isReverse[BandedNucleotideAligner::BATCH_LANES];
+    size_t hitIdx[BandedNucleotideAligner::BATCH_LANES];
+    const size_t lanes = threadData.matcher.getNucleotideBatchLanes();
+    size_t count = 0;
+    size_t end = start;
+    for (; end < hits.size() && end - start < maxHits && count < lanes; end++) {
+        const unsigned int dbKey = hits[end].seqId;
+        const size_t dbId = tdbr->getId(dbKey);
+        if (dbId == UINT_MAX) {
+            // reported by the hit loop
+            break;
+        }
+        const unsigned int dbLen = tdbr->getSeqLen(dbId);
+        if (Util::canBeCovered(canCovThr, covMode, queryLen, static_cast<float>(dbLen)) == false) {
+            continue;
+        }
+        char *dbSeqData = tdbr->getData(dbId, thread_idx);
+        if (dbSeqData == NULL) {
+            break;
+        }
+        threadData.nuclBatchData[count].assign(dbSeqData, dbLen);
+        threadData.nuclBatchSeqs[count]->mapSequence(dbId, dbKey, threadData.nuclBatchData[count].c_str(), dbLen);
+        diagonals[count] = static_cast<short>(hits[end].diagonal);
+        isReverse[count] = reversePrefilterResult && (hits[end].prefScore < 0);
+        hitIdx[count] = end;
+        count++;
+    }
+    threadData.nuclBatchEnd = end;
+    if (count == 0) {
+        return;
+    }
+    threadData.matcher.getSWResultBatch(threadData.nuclBatchSeqs, diagonals, isReverse, count, seqIdMode, wrappedScoring, threadData.nuclBatchResults);
+    for (size_t lane = 0; lane < count; lane++) {
+        threadData.nuclBatchLane[hitIdx[lane]] = static_cast<int>(lane);
+    }
+}
+
 void Alignment::computeAlternativeAlignment(unsigned int queryDbKey, Sequence &dbSeq, std::vector<Matcher::result_t> &swResults,
                                             Matcher &matcher, float covThr, float evalThr, int swMode, int thread_idx) {
     const unsigned char xIndex = m->aa2num[static_cast<int>('X')];
@@ -6,6 +6,10 @@
 #include "Parameters.h"
 #include "BaseMatrix.h"
 #include "Matcher.h"
+#include "QueryMatcher.h"
+#include "Sequence.h"
+#include "EvalueComputation.h"
+#include "StripedSmithWaterman.h"
 
 class Alignment {
 public:
@@ -29,6 +33,46 @@ public:
 
     static unsigned int initSWMode(unsigned int alignmentMode, float covThr, float seqIdThr);
 
+    static void printStatistics(size_t alignmentsNum, size_t totalPassedNum, size_t querySize);
+
+    // dbtype of the written alignment result
+    int getOutputDbtype() const;
+
+    // per thread alignment state, allocated once and reused for every query
+    struct ThreadData {
+        ThreadData(const Alignment &aln);
+        ~ThreadData();
+
+        Sequence qSeq;
+        Sequence dbSeq;
+        Matcher matcher;
+        Matcher *realigner;
+        std::vector<Matcher::result_t> swResults;
+        std::vector<Matcher::result_t> swRealignResults;
+        std::string queryToWrap;
+
+        bool batchScoring;
+        Sequence *batchSeqs[SmithWaterman::INTER_SEQ_LANES];
+        std::vector<size_t> batchCandidates;
+        std::vector<int32_t> batchScores;
+
+        bool nucleotideBatch;
+        Sequence *nuclBatchSeqs[BandedNucleotideAligner::BATCH_LANES];
+        // the targets stay mapped after the next getData call on a compressed database
+        std::string nuclBatchData[BandedNucleotideAligner::BATCH_LANES];
+        Matcher::result_t nuclBatchResults[BandedNucleotideAligner::BATCH_LANES];
+        // lane in nuclBatchResults per prefilter hit, -1 if the hit is aligned on its own
+        std::vector<int> nuclBatchLane;
+        size_t nuclBatchEnd;
+
+        char buffer[1024 + 32768*4];
+    };
+
+    // aligns the query against the prefilter hits and appends the formatted results to out
+    // can be called without a prefilter DB, e.g. directly from the prefilter
+    void alignQuery(ThreadData &threadData, unsigned int queryDbKey, const std::vector<hit_t> &prefHits, std::string &out,
+                    unsigned int thread_idx, size_t &alignmentsNum, size_t &totalPassedNum);
+
 private:
     // sequence coverage threshold
     double covThr;
@@ -119,11 +163,26 @@ private:
 
     bool reversePrefilterResult;
 
+    EvalueComputation *evaluer;
+
     static size_t estimateHDDMemoryConsumption(int dbSize, int maxSeqs);
 
     void computeAlternativeAlignment(unsigned int queryDbKey, Sequence &dbSeq,
                                      std::vector<Matcher::result_t> &vector, Matcher &matcher,
                                      float covThr, float evalThr, int swMode, int thread_idx);
+
+    // targets up to this length are scored first with the inter-sequence SIMD kernel
+    static const unsigned int BATCH_MAX_TARGET_LEN = 100;
+
+    // computes the score of all short targets of a prefilter list, one target per SIMD lane
+    // scores are -1 for targets that were not scored
+    void scoreShortTargets(Matcher &matcher, const std::vector<hit_t> &hits, unsigned int queryDbKey, float queryLen,
+                           Sequence **batchSeqs, std::vector<size_t> &candidates, std::vector<int32_t> &scores, int thread_idx);
+
+    // aligns the nucleotide hits from start on in one batch, but not more than maxHits hits
+    // so that no hit is aligned that the hit loop would not reach anymore
+    void alignNucleotideBatch(ThreadData &threadData, const std::vector<hit_t> &hits, size_t start, size_t maxHits,
+                              float queryLen, int thread_idx);
 };
 
 #endif
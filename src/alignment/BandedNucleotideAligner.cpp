@@ -14,6 +14,9 @@
 #include "Debug.h"
 #include "StripedSmithWaterman.h"
 
+#include <climits>
+#include <algorithm>
+
 
 BandedNucleotideAligner::BandedNucleotideAligner(BaseMatrix * subMat, size_t maxSequenceLength, int gapo, int gape, int zdrop) :
         fastMatrix(SubstitutionMatrix::createAsciiSubMat(*subMat))
@@ -35,6 +38,15 @@ BandedNucleotideAligner::BandedNucleotideAligner(BaseMatrix * subMat, size_t max
     this->gape = gape;
     this->gapo = gapo;
     this->zdrop = zdrop;
+    batchLanes = SimdDispatch::getKernels().lanes;
+    batchTargetSeqRevDataLen = maxSequenceLength;
+    for (size_t i = 0; i < batchLanes; i++) {
+        batchTargetSeqRev[i] = static_cast<uint8_t*>(malloc(batchTargetSeqRevDataLen + 1));
+    }
+    batchMem = NULL;
+    batchMemSize = 0;
+    batchTrace = NULL;
+    batchTraceSize = 0;
 }
 
 BandedNucleotideAligner::~BandedNucleotideAligner(){
@@ -43,6 +55,11 @@ BandedNucleotideAligner::~BandedNucleotideAligner(){
     free(queryRevCompSeq);
     free(queryRevCompSeqRev);
     free(queryRevCompCharSeq);
+    for (size_t i = 0; i < batchLanes; i++) {
+        free(batchTargetSeqRev[i]);
+    }
+    free(batchMem);
+    free(batchTrace);
     delete [] fastMatrix.matrixData;
     delete [] fastMatrix.matrix;
     delete [] mat;
@@ -75,6 +92,76 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
                                        std::string & backtrace,
                                        EvalueComputation * evaluer, bool wrappedScoring)
 {
+    if(targetSeqObj->L >= targetSeqRevDataLen){
+        targetSeqRev = static_cast<uint8_t *>(realloc(targetSeqRev, targetSeqObj->L+1));
+        targetSeqRevDataLen=targetSeqObj->L;
+    }
+    s_align result;
+    PendingAlignment pending;
+    if (ungappedAlignment(targetSeqObj, diagonal, reverse, targetSeqRev, backtrace, evaluer, wrappedScoring, result, pending)) {
+        return result;
+    }
+
+    ksw_extz_t ez;
+    extend(reverseExtension(pending), KSW_EZ_SCORE_ONLY | KSW_EZ_EXTZ_ONLY, &ez);
+
+    int qStartPos, tStartPos;
+    ksw_extz_t ezAlign;
+    memset(&ezAlign, 0, sizeof(ksw_extz_t));
+    extend(forwardExtension(pending, ez, wrappedScoring, qStartPos, tStartPos), KSW_EZ_EXTZ_ONLY, &ezAlign);
+
+    return finishAlignment(pending, ez, ezAlign, qStartPos, tStartPos, backtrace, evaluer, wrappedScoring);
+}
+
+void BandedNucleotideAligner::alignBatch(Sequence ** targetSeqObjs, const int * diagonals, const bool * reverse, size_t count,
+                                         std::string * backtraces, s_align * results, EvalueComputation * evaluer, bool wrappedScoring) {
+    PendingAlignment pending[BATCH_LANES];
+    size_t pendingIdx[BATCH_LANES];
+    size_t pendingCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (targetSeqObjs[i]->L >= batchTargetSeqRevDataLen) {
+            for (size_t j = 0; j < batchLanes; j++) {
+                batchTargetSeqRev[j] = static_cast<uint8_t *>(realloc(batchTargetSeqRev[j], targetSeqObjs[i]->L + 1));
+            }
+            batchTargetSeqRevDataLen = targetSeqObjs[i]->L;
+        }
+        if (ungappedAlignment(targetSeqObjs[i], diagonals[i], reverse[i], batchTargetSeqRev[i], backtraces[i],
+                              evaluer, wrappedScoring, results[i], pending[pendingCount]) == false) {
+            pendingIdx[pendingCount] = i;
+            pendingCount++;
+        }
+    }
+    if (pendingCount == 0) {
+        return;
+    }
+
+    Extension extensions[BATCH_LANES];
+    ksw_extz_t ez[BATCH_LANES];
+    ksw_extz_t ezAlign[BATCH_LANES];
+    memset(ez, 0, sizeof(ez));
+    memset(ezAlign, 0, sizeof(ezAlign));
+    for (size_t i = 0; i < pendingCount; i++) {
+        extensions[i] = reverseExtension(pending[i]);
+    }
+    extendBatch(extensions, pendingCount, KSW_EZ_SCORE_ONLY | KSW_EZ_EXTZ_ONLY, ez);
+
+    int qStartPos[BATCH_LANES];
+    int tStartPos[BATCH_LANES];
+    for (size_t i = 0; i < pendingCount; i++) {
+        extensions[i] = forwardExtension(pending[i], ez[i], wrappedScoring, qStartPos[i], tStartPos[i]);
+    }
+    extendBatch(extensions, pendingCount, KSW_EZ_EXTZ_ONLY, ezAlign);
+
+    for (size_t i = 0; i < pendingCount; i++) {
+        const size_t idx = pendingIdx[i];
+        results[idx] = finishAlignment(pending[i], ez[i], ezAlign[i], qStartPos[i], tStartPos[i],
+                                       backtraces[idx], evaluer, wrappedScoring);
+    }
+}
+
+bool BandedNucleotideAligner::ungappedAlignment(Sequence * targetSeqObj, int diagonal, bool reverse, uint8_t * targetSeqRev,
+                                                std::string & backtrace, EvalueComputation * evaluer, bool wrappedScoring,
+                                                s_align & result, PendingAlignment & pending) {
     char * queryCharSeqAlign = (char*) querySeqObj->getSeqData();
     uint8_t * querySeqRevAlign = querySeqRev;
     uint8_t * querySeqAlign = querySeq;
@@ -86,10 +173,6 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
 
 
     const unsigned char * targetSeq = targetSeqObj->numSequence;
-    if(targetSeqObj->L >= targetSeqRevDataLen){
-        targetSeqRev = static_cast<uint8_t *>(realloc(targetSeqRev, targetSeqObj->L+1));
-        targetSeqRevDataLen=targetSeqObj->L;
-    }
     SmithWaterman::seq_reverse((int8_t *)targetSeqRev, (int8_t *)targetSeq, targetSeqObj->L);
 
     int qUngappedStartPos, qUngappedEndPos, dbUngappedStartPos, dbUngappedEndPos;
@@ -126,7 +209,6 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
     }
     if(qUngappedEndPos-qUngappedStartPos == origQueryLen - 1
        && dbUngappedStartPos == 0 && dbUngappedEndPos == targetSeqObj->L - 1){
-        s_align result;
         uint32_t * retCigar = new uint32_t[1];
         retCigar[0] = 0;
         retCigar[0] = origQueryLen << 4;
@@ -150,50 +232,66 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
             backtrace.append("M");
         }
         result.identicalAACnt = aaIds;
-        return result;
+        return true;
     }
 //    printf("%d\t%d\t%d\n", alignment.score,  alignment.startPos, alignment.endPos);
 
     // get middle position of ungapped alignment
-    int qStartRev = (querySeqObj->L  - qUngappedEndPos) - 1;
-    int tStartRev = (targetSeqObj->L - dbUngappedEndPos) - 1;
+    pending.targetSeqObj = targetSeqObj;
+    pending.targetSeqRev = targetSeqRev;
+    pending.querySeqAlign = querySeqAlign;
+    pending.querySeqRevAlign = querySeqRevAlign;
+    pending.qStartRev = (querySeqObj->L  - qUngappedEndPos) - 1;
+    pending.tStartRev = (targetSeqObj->L - dbUngappedEndPos) - 1;
+    pending.origQueryLen = origQueryLen;
 
-    ksw_extz_t ez;
-    int flag = 0;
-    flag |= KSW_EZ_SCORE_ONLY;
-    flag |= KSW_EZ_EXTZ_ONLY;
-
-    int queryRevLenToAlign = querySeqObj->L - qStartRev;
-    if (wrappedScoring && queryRevLenToAlign > origQueryLen){
-        queryRevLenToAlign = origQueryLen;
+    pending.queryRevLenToAlign = querySeqObj->L - pending.qStartRev;
+    if (wrappedScoring && pending.queryRevLenToAlign > origQueryLen){
+        pending.queryRevLenToAlign = origQueryLen;
     }
+    return false;
+}
 
-    ksw_extz2_sse(0, queryRevLenToAlign, querySeqRevAlign + qStartRev, targetSeqObj->L - tStartRev, targetSeqRev + tStartRev, 5, mat, gapo, gape, 64, zdrop, flag, &ez);
-
-    int qStartPos = querySeqObj->L  - ( qStartRev + ez.max_q ) -1;
-    int tStartPos = targetSeqObj->L - ( tStartRev + ez.max_t ) -1;
-
-    int alignFlag = 0;
-    alignFlag |= KSW_EZ_EXTZ_ONLY;
+BandedNucleotideAligner::Extension BandedNucleotideAligner::reverseExtension(const PendingAlignment & pending) {
+    Extension extension;
+    extension.query = pending.querySeqRevAlign + pending.qStartRev;
+    extension.qlen = pending.queryRevLenToAlign;
+    extension.target = pending.targetSeqRev + pending.tStartRev;
+    extension.tlen = pending.targetSeqObj->L - pending.tStartRev;
+    return extension;
+}
 
-    ksw_extz_t ezAlign;
-//    ezAlign.cigar = cigar;
+BandedNucleotideAligner::Extension BandedNucleotideAligner::forwardExtension(const PendingAlignment & pending, const ksw_extz_t & ez,
+                                                                             bool wrappedScoring, int & qStartPos, int & tStartPos) {
+    qStartPos = querySeqObj->L  - ( pending.qStartRev + ez.max_q ) -1;
+    tStartPos = pending.targetSeqObj->L - ( pending.tStartRev + ez.max_t ) -1;
 //    printf("%d %d\n", qStartPos, tStartPos);
-    memset(&ezAlign, 0, sizeof(ksw_extz_t));
 
     int queryLenToAlign = querySeqObj->L-qStartPos;
-    if (wrappedScoring && queryLenToAlign > origQueryLen)
-        queryLenToAlign = origQueryLen;
-    ksw_extz2_sse(0, queryLenToAlign, querySeqAlign+qStartPos, targetSeqObj->L-tStartPos, targetSeq+tStartPos, 5,
-                  mat, gapo, gape, 64, zdrop, alignFlag, &ezAlign);
+    if (wrappedScoring && queryLenToAlign > pending.origQueryLen)
+        queryLenToAlign = pending.origQueryLen;
+
+    Extension extension;
+    extension.query = pending.querySeqAlign + qStartPos;
+    extension.qlen = queryLenToAlign;
+    extension.target = pending.targetSeqObj->numSequence + tStartPos;
+    extension.tlen = pending.targetSeqObj->L - tStartPos;
+    return extension;
+}
+
+s_align BandedNucleotideAligner::finishAlignment(const PendingAlignment & pending, const ksw_extz_t & ez, ksw_extz_t & ezAlign,
+                                                 int qStartPos, int tStartPos, std::string & backtrace,
+                                                 EvalueComputation * evaluer, bool wrappedScoring) {
+    Sequence * targetSeqObj = pending.targetSeqObj;
+    const unsigned char * targetSeq = targetSeqObj->numSequence;
+    const uint8_t * querySeqAlign = pending.querySeqAlign;
 
     std::string letterCode = "MID";
     uint32_t * retCigar;
 
     if (ez.max_q > ezAlign.max_q && ez.max_t > ezAlign.max_t){
 
-        ksw_extz2_sse(0, queryRevLenToAlign, querySeqRevAlign + qStartRev, targetSeqObj->L - tStartRev,
-                      targetSeqRev + tStartRev, 5, mat, gapo, gape, 64, zdrop, alignFlag, &ezAlign);
+        extend(reverseExtension(pending), KSW_EZ_EXTZ_ONLY, &ezAlign);
 
         retCigar = new uint32_t[ezAlign.n_cigar];
         for(int i = 0; i < ezAlign.n_cigar; i++){
@@ -220,7 +318,7 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
         result.qCov = std::min(1.0f, result.qCov*2);
     }
     result.tCov = SmithWaterman::computeCov(result.dbStartPos1, result.dbEndPos1, targetSeqObj->L);
-    result.evalue = evaluer->computeEvalue(result.score1, origQueryLen);
+    result.evalue = evaluer->computeEvalue(result.score1, pending.origQueryLen);
     int aaIds = 0;
     if(result.cigar){
         int32_t targetPos = result.dbStartPos1, queryPos = result.qStartPos1;
@@ -256,3 +354,272 @@ s_align BandedNucleotideAligner::align(Sequence * targetSeqObj,
 //        std::cout << static_cast<float>(aaIds)/ static_cast<float>(alignment.len) << std::endl;
 
 }
+
+void BandedNucleotideAligner::extend(const Extension & extension, int flag, ksw_extz_t * ez) {
+    ksw_extz2_sse(0, extension.qlen, extension.query, extension.tlen, extension.target, 5,
+                  mat, gapo, gape, 64, zdrop, flag, ez);
+}
+
+// The batch runs the ksw2 recurrence (8 bit score differences on anti-diagonals, exact 32 bit maxima) of up
+// to batchLanes pairs side by side, one pair per byte lane of the dispatched SimdKernels::bandedRound. Every
+// lane has to end up bit identical to ksw_extz2_sse, so it keeps ksw2's band rounding, its stale scores and
+// zeros outside of the sequences and its tie breaking of the maximum. The kernel skips the per lane masking in
+// rounds where all lanes have the same band, which is only needed when the pairs have different lengths or some
+// lanes have already finished.
+namespace {
+const int BATCH_BAND = 64;
+}
+
+void BandedNucleotideAligner::extendBatch(const Extension * extensions, size_t count, int flag, ksw_extz_t * ez) {
+    const size_t L = batchLanes;
+    const int8_t m = 5;
+    const int8_t q = gapo;
+    const int8_t e = gape;
+    const int qe = q + e;
+    const bool withCigar = !(flag & KSW_EZ_SCORE_ONLY);
+    int minSc = mat[1];
+    for (int i = 1; i < m * m; ++i) {
+        minSc = std::min(minSc, static_cast<int>(mat[i]));
+    }
+    // the 8 bit differences stay within [0, mat[0] + 2 * qe], the maxima are tracked in 16 bit
+    const int maxDiff = mat[0] + 2 * qe;
+    const bool batchable = -minSc <= 2 * qe && maxDiff <= INT8_MAX;
+
+    bool inBatch[BATCH_LANES];
+    size_t batchCount = 0;
+    int maxQlen = 0, maxTlen = 0, maxRounds = 0;
+    for (size_t l = 0; l < L; l++) {
+        inBatch[l] = false;
+        if (l >= count) {
+            continue;
+        }
+        const Extension & ext = extensions[l];
+        if (batchable && ext.qlen > 0 && ext.tlen > 0 && ext.tlen < SimdDispatch::BANDED_MAX_TLEN
+            && (ext.qlen + ext.tlen + 1) * maxDiff < INT16_MAX) {
+            inBatch[l] = true;
+            batchCount++;
+            maxQlen = std::max(maxQlen, ext.qlen);
+            maxTlen = std::max(maxTlen, ext.tlen);
+            maxRounds = std::max(maxRounds, ext.qlen + ext.tlen - 1);
+        }
+    }
+    // a few lanes are not worth the batch
+    if (batchCount < L / 4) {
+        for (size_t l = 0; l < count; l++) {
+            extend(extensions[l], flag, &ez[l]);
+        }
+        return;
+    }
+
+    // u, v, x, y, s and the target residues per target position, the query residues per query position
+    // (shifted by 16 since ksw2 reads up to 15 zeros before the query), and the 16 bit H per target position
+    const size_t tCols = (maxTlen + 15) / 16 * 16 + 16;
+    const size_t qRows = maxQlen + 32;
+    const size_t memSize = (tCols * 6 + qRows + tCols * 2) * L;
+    if (memSize > batchMemSize) {
+        free(batchMem);
+        batchMem = static_cast<uint8_t *>(mem_align(SimdDispatch::MAX_LANES, memSize));
+        batchMemSize = memSize;
+    }
+    memset(batchMem, 0, memSize);
+    BandedRoundInput in;
+    in.u = batchMem;
+    in.v = in.u + tCols * L;
+    in.x = in.v + tCols * L;
+    in.y = in.x + tCols * L;
+    in.s = in.y + tCols * L;
+    uint8_t * t8 = in.s + tCols * L;
+    uint8_t * q8 = t8 + tCols * L;
+    in.target = t8;
+    in.query = q8;
+    in.H = reinterpret_cast<int16_t *>(q8 + qRows * L);
+    in.gapOpen = q;
+    in.gapExtend = e;
+    in.match = mat[0];
+    in.mismatch = mat[1];
+    in.wildcard = m - 1;
+    in.maxDiff = maxDiff;
+
+    int qlen[BATCH_LANES], tlen[BATCH_LANES], lastSt[BATCH_LANES], lastEn[BATCH_LANES];
+    bool running[BATCH_LANES];
+    for (size_t l = 0; l < L; l++) {
+        running[l] = inBatch[l];
+        if (inBatch[l] == false) {
+            if (l < count) {
+                extend(extensions[l], flag, &ez[l]);
+            }
+            continue;
+        }
+        ksw_reset_extz(&ez[l]);
+        const Extension & ext = extensions[l];
+        qlen[l] = ext.qlen;
+        tlen[l] = ext.tlen;
+        lastSt[l] = lastEn[l] = -1;
+        for (int t = 0; t < ext.tlen; t++) {
+            t8[t * L + l] = ext.target[t];
+        }
+        for (int j = 0; j < ext.qlen; j++) {
+            q8[(j + 16) * L + l] = ext.query[j];
+        }
+    }
+
+    std::vector<int> off, offEnd;
+    std::vector<size_t> rowStart;
+    std::vector<int> rowBase;
+    size_t traceSize = 0;
+    if (withCigar) {
+        off.resize(maxRounds * L);
+        offEnd.resize(maxRounds * L);
+        rowStart.resize(maxRounds);
+        rowBase.resize(maxRounds);
+    }
+
+    const SimdKernels & kernels = SimdDispatch::getKernels();
+    alignas(64) int16_t st[BATCH_LANES], en[BATCH_LANES], st0[BATCH_LANES], en0[BATCH_LANES];
+    alignas(64) int16_t sEnd[BATCH_LANES], en1[BATCH_LANES];
+    alignas(64) uint8_t x1[BATCH_LANES];
+    alignas(64) uint8_t v1[BATCH_LANES];
+    alignas(64) int16_t maxH[BATCH_LANES];
+    alignas(64) int16_t maxT[BATCH_LANES];
+    in.st = st;
+    in.en = en;
+    in.st0 = st0;
+    in.en0 = en0;
+    in.sEnd = sEnd;
+    in.en1 = en1;
+    in.x1 = x1;
+    in.v1 = v1;
+    for (int r = 0; r < maxRounds; ++r) {
+        memset(x1, 0, L);
+        memset(v1, 0, L);
+        in.r = r;
+        in.tBase = in.hStart = INT_MAX;
+        in.tTop = in.hEnd = in.sEndMax = -1;
+        in.uniform = true;
+        int first = -1;
+        for (size_t l = 0; l < L; l++) {
+            st[l] = st0[l] = INT16_MAX;
+            en[l] = en0[l] = sEnd[l] = -1;
+            en1[l] = 0;
+            if (running[l] == false) {
+                continue;
+            }
+            if (r >= qlen[l] + tlen[l] - 1) {
+                running[l] = false;
+                continue;
+            }
+            int bandSt = 0, bandEn = tlen[l] - 1;
+            if (bandSt < r - qlen[l] + 1) bandSt = r - qlen[l] + 1;
+            if (bandEn > r) bandEn = r;
+            if (bandSt < (r - BATCH_BAND + 1) >> 1) bandSt = (r - BATCH_BAND + 1) >> 1;
+            if (bandEn > (r + BATCH_BAND) >> 1) bandEn = (r + BATCH_BAND) >> 1;
+            if (bandSt > bandEn) {
+                ez[l].zdropped = 1;
+                running[l] = false;
+                continue;
+            }
+            st0[l] = bandSt;
+            en0[l] = bandEn;
+            st[l] = bandSt / 16 * 16;
+            en[l] = (bandEn + 16) / 16 * 16 - 1;
+            // ksw2 writes the scores in blocks of 16 starting at st0
+            sEnd[l] = bandSt + (bandEn - bandSt + 16) / 16 * 16 - 1;
+            en1[l] = bandSt + (bandEn - bandSt) / 4 * 4;
+            if (st[l] > 0) {
+                if (st[l] - 1 >= lastSt[l] && st[l] - 1 <= lastEn[l]) {
+                    x1[l] = in.x[(st[l] - 1) * L + l];
+                    v1[l] = in.v[(st[l] - 1) * L + l];
+                }
+            } else {
+                v1[l] = r ? q : 0;
+            }
+            if (en[l] >= r) {
+                in.y[r * L + l] = 0;
+                in.u[r * L + l] = r ? q : 0;
+            }
+            in.tBase = std::min(in.tBase, static_cast<int>(st[l]));
+            in.hStart = std::min(in.hStart, static_cast<int>(st0[l]));
+            in.tTop = std::max(in.tTop, static_cast<int>(en[l]));
+            in.hEnd = std::max(in.hEnd, static_cast<int>(en0[l]));
+            in.sEndMax = std::max(in.sEndMax, static_cast<int>(sEnd[l]));
+            if (first < 0) {
+                first = static_cast<int>(l);
+            } else if (st0[l] != st0[first] || en0[l] != en0[first]) {
+                in.uniform = false;
+            }
+        }
+        if (first < 0) {
+            break;
+        }
+        in.trace = NULL;
+        if (withCigar) {
+            rowStart[r] = traceSize;
+            rowBase[r] = in.tBase;
+            traceSize += (in.tTop - in.tBase + 1) * L;
+            if (traceSize > batchTraceSize) {
+                batchTraceSize = std::max(traceSize, batchTraceSize * 2);
+                batchTrace = static_cast<uint8_t *>(realloc(batchTrace, batchTraceSize));
+            }
+            in.trace = batchTrace + rowStart[r];
+            for (size_t l = 0; l < L; l++) {
+                if (running[l]) {
+                    off[r * L + l] = st[l];
+                    offEnd[r * L + l] = en[l];
+                }
+            }
+        }
+        kernels.bandedRound(in, maxH, maxT);
+
+        for (size_t l = 0; l < L; l++) {
+            if (running[l] == false) {
+                continue;
+            }
+            if (ksw_apply_zdrop(&ez[l], 1, maxH[l], r, maxT[l], zdrop, e)) {
+                running[l] = false;
+                continue;
+            }
+            lastSt[l] = st[l];
+            lastEn[l] = en[l];
+        }
+    }
+
+    if (withCigar == false) {
+        return;
+    }
+    // ksw_backtrack on the rows of a single lane
+    for (size_t l = 0; l < L; l++) {
+        if (inBatch[l] == false || ez[l].max_t < 0 || ez[l].max_q < 0) {
+            continue;
+        }
+        int nCigar = 0, mCigar = ez[l].m_cigar, i = ez[l].max_t, j = ez[l].max_q, state = 0;
+        uint32_t * cigar = ez[l].cigar;
+        while (i >= 0 && j >= 0) {
+            int forceState = -1;
+            const int r = i + j;
+            if (i < off[r * L + l]) forceState = 2;
+            if (i > offEnd[r * L + l]) forceState = 1;
+            const uint32_t tmp = forceState < 0 ? batchTrace[rowStart[r] + (i - rowBase[r]) * L + l] : 0;
+            if (state == 0) state = tmp & 7;
+            else if (!(tmp >> (state + 2) & 1)) state = 0;
+            if (state == 0) state = tmp & 7;
+            if (forceState >= 0) state = forceState;
+            if (state == 0) {
+                cigar = ksw_push_cigar(NULL, &nCigar, &mCigar, cigar, 0, 1);
+                --i;
+                --j;
+            } else if (state == 1 || state == 3) {
+                cigar = ksw_push_cigar(NULL, &nCigar, &mCigar, cigar, 2, 1);
+                --i;
+            } else {
+                cigar = ksw_push_cigar(NULL, &nCigar, &mCigar, cigar, 1, 1);
+                --j;
+            }
+        }
+        if (i >= 0) cigar = ksw_push_cigar(NULL, &nCigar, &mCigar, cigar, 2, i + 1);
+        if (j >= 0) cigar = ksw_push_cigar(NULL, &nCigar, &mCigar, cigar, 1, j + 1);
+        std::reverse(cigar, cigar + nCigar);
+        ez[l].m_cigar = mCigar;
+        ez[l].n_cigar = nCigar;
+        ez[l].cigar = cigar;
+    }
+}
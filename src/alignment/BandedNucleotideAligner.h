@@ -7,10 +7,12 @@
 #include <Parameters.h>
 #include <NucleotideMatrix.h>
 #include "StripedSmithWaterman.h"
+#include "ksw2.h"
 
 #include "Util.h"
 #include "SubstitutionMatrix.h"
 #include "Debug.h"
+#include "SimdDispatch.h"
 
 
 class BandedNucleotideAligner {
@@ -26,7 +28,70 @@ public:
     s_align align(Sequence * targetSeqObj, int diagonal, bool reverse,
                   std::string & backtrace, EvalueComputation * evaluer, bool wrappedScoring=false);
 
+    // upper bound of getBatchLanes, use for buffer sizes
+    static const size_t BATCH_LANES = SimdDispatch::MAX_LANES;
+
+    // pairs extended together by alignBatch, one per byte lane of the dispatched SIMD kernels
+    size_t getBatchLanes() const {
+        return batchLanes;
+    }
+
+    // aligns up to getBatchLanes() targets against the query, the results are identical to calling align for each
+    void alignBatch(Sequence ** targetSeqObjs, const int * diagonals, const bool * reverse, size_t count,
+                    std::string * backtraces, s_align * results, EvalueComputation * evaluer, bool wrappedScoring=false);
+
+    struct Extension {
+        const uint8_t * query;
+        int qlen;
+        const uint8_t * target;
+        int tlen;
+    };
+
+    // same as ksw_extz2_sse with KSW_EZ_EXTZ_ONLY (and optionally KSW_EZ_SCORE_ONLY) on up to getBatchLanes() pairs,
+    // ez has to be zero initialized, mte/mqe/score are not filled in
+    void extendBatch(const Extension * extensions, size_t count, int flag, ksw_extz_t * ez);
+
 private:
+    // state of a pair between the ungapped and the gapped alignment
+    struct PendingAlignment {
+        Sequence * targetSeqObj;
+        const uint8_t * targetSeqRev;
+        const uint8_t * querySeqAlign;
+        const uint8_t * querySeqRevAlign;
+        int qStartRev;
+        int tStartRev;
+        int queryRevLenToAlign;
+        int origQueryLen;
+    };
+
+    // returns true if the ungapped alignment already covers both sequences, result and backtrace are filled in then
+    bool ungappedAlignment(Sequence * targetSeqObj, int diagonal, bool reverse, uint8_t * targetSeqRev,
+                           std::string & backtrace, EvalueComputation * evaluer, bool wrappedScoring,
+                           s_align & result, PendingAlignment & pending);
+
+    Extension reverseExtension(const PendingAlignment & pending);
+    Extension forwardExtension(const PendingAlignment & pending, const ksw_extz_t & ez, bool wrappedScoring,
+                               int & qStartPos, int & tStartPos);
+
+    s_align finishAlignment(const PendingAlignment & pending, const ksw_extz_t & ez, ksw_extz_t & ezAlign,
+                            int qStartPos, int tStartPos, std::string & backtrace,
+                            EvalueComputation * evaluer, bool wrappedScoring);
+
+    // extends a single pair with the same semantics as extendBatch
+    void extend(const Extension & extension, int flag, ksw_extz_t * ez);
+
+    size_t batchLanes;
+    // reversed targets of alignBatch
+    uint8_t * batchTargetSeqRev[BATCH_LANES];
+    int batchTargetSeqRevDataLen;
+
+    // interleaved DP state of extendBatch, byte (t * batchLanes + lane) belongs to target position t of a lane
+    uint8_t * batchMem;
+    size_t batchMemSize;
+    // traceback of extendBatch, one interleaved row per anti-diagonal
+    uint8_t * batchTrace;
+    size_t batchTraceSize;
+
     SubstitutionMatrix::FastMatrix fastMatrix;
     uint8_t * targetSeqRev;
     int targetSeqRevDataLen;
@@ -3,8 +3,13 @@
 #include "Matcher.h"
 #include "Util.h"
 #include "Parameters.h"
+#include "DBReader.h"
 #include "StripedSmithWaterman.h"
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 
 Matcher::Matcher(int querySeqType, int targetSeqType, int maxSeqLen, BaseMatrix *m, EvalueComputation * evaluer,
                  bool aaBiasCorrection, int gapOpen, int gapExtend, float correlationScoreWeight, int zdrop)
@@ -55,6 +60,16 @@ void Matcher::initQuery(Sequence* query){
     }
 }
 
+void Matcher::getSWScoreBatch(Sequence **dbSeqs, size_t count, int32_t *scores) {
+    const unsigned char *sequences[SmithWaterman::INTER_SEQ_LANES];
+    int32_t lengths[SmithWaterman::INTER_SEQ_LANES];
+    for (size_t i = 0; i < count; i++) {
+        sequences[i] = dbSeqs[i]->numSequence;
+        lengths[i] = dbSeqs[i]->L;
+    }
+    aligner->ssw_score_batch(sequences, lengths, count, gapOpen, gapExtend, scores);
+}
+
 Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, bool isReverse, const int covMode, const float covThr,
                                        const double evalThr, unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentity,
                                        bool wrappedScoring){
@@ -84,6 +99,28 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, bool
         }
     }
 
+    return alignmentToResult(alignment, dbSeq, isReverse, alignmentMode, seqIdMode, origQueryLen, backtrace);
+}
+
+void Matcher::getSWResultBatch(Sequence **dbSeqs, const int *diagonals, const bool *isReverse, size_t count,
+                               unsigned int seqIdMode, bool wrappedScoring, result_t *results) {
+    int origQueryLen = wrappedScoring? currentQuery->L / 2 : currentQuery->L ;
+    for (size_t i = 0; i < count; i++) {
+        if (diagonals[i] == INT_MAX) {
+            Debug(Debug::ERROR) << "Query sequence " << currentQuery->getDbKey() << " has a result with no diagonal information. Please check your database.\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+    s_align alignments[BandedNucleotideAligner::BATCH_LANES];
+    std::string backtraces[BandedNucleotideAligner::BATCH_LANES];
+    nuclaligner->alignBatch(dbSeqs, diagonals, isReverse, count, backtraces, alignments, evaluer, wrappedScoring);
+    for (size_t i = 0; i < count; i++) {
+        results[i] = alignmentToResult(alignments[i], dbSeqs[i], isReverse[i], Matcher::SCORE_COV_SEQID, seqIdMode, origQueryLen, backtraces[i]);
+    }
+}
+
+Matcher::result_t Matcher::alignmentToResult(s_align &alignment, Sequence *dbSeq, bool isReverse, unsigned int alignmentMode,
+                                             unsigned int seqIdMode, int origQueryLen, std::string &backtrace) {
     // calculation of the coverage and e-value
     float qcov = 0.0;
     float dbcov = 0.0;
@@ -145,12 +182,155 @@ void Matcher::readAlignmentResults(std::vector<result_t> &result, char *data, bo
         return;
     }
 
+    if (isBinaryResult(data)) {
+        const binary_header_t *header = getBinaryHeader(data);
+        const binary_result_t *records = getBinaryResults(data);
+        result.reserve(result.size() + header->count);
+        for (unsigned int i = 0; i < header->count; i++) {
+            result.emplace_back(binaryRecordToResult(data, records[i], readCompressed));
+        }
+        return;
+    }
+
     while(*data != '\0'){
         result.emplace_back(parseAlignmentRecord(data, readCompressed));
         data = Util::skipLine(data);
     }
 }
 
+size_t Matcher::countAlignmentResults(const char *data, size_t dataSize) {
+    if (data == NULL || *data == '\0') {
+        return 0;
+    }
+    if (isBinaryResult(data)) {
+        return getBinaryHeader(data)->count;
+    }
+    return Util::countLines(data, dataSize);
+}
+
+size_t Matcher::maxAlignmentResultCount(DBReader<unsigned int> &reader, int threads) {
+    if ((DBReader<unsigned int>::getExtendedDbtype(reader.getDbtype()) & Parameters::DBTYPE_EXTENDED_BINARY) == 0) {
+        return reader.maxCount('\n');
+    }
+
+    size_t max = 0;
+#pragma omp parallel num_threads(threads)
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+#pragma omp for schedule(dynamic, 10) reduction(max:max)
+        for (size_t id = 0; id < reader.getSize(); id++) {
+            const char *data = reader.getData(id, thread_idx);
+            max = std::max(max, countAlignmentResults(data, reader.getEntryLen(id)));
+        }
+    }
+    return max;
+}
+
+static bool compareResultCountDesc(const std::pair<size_t, size_t> &first, const std::pair<size_t, size_t> &second) {
+    if (first.first != second.first) {
+        return first.first > second.first;
+    }
+    return first.second < second.second;
+}
+
+std::vector<std::pair<size_t, size_t>> Matcher::sortByAlignmentResultCount(DBReader<unsigned int> &reader, size_t from, size_t size, int threads) {
+    std::vector<std::pair<size_t, size_t>> counts(size);
+#pragma omp parallel num_threads(threads)
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+#pragma omp for schedule(dynamic, 10)
+        for (size_t i = 0; i < size; i++) {
+            const size_t id = from + i;
+            counts[i] = std::make_pair(countAlignmentResults(reader.getData(id, thread_idx), reader.getEntryLen(id)), id);
+        }
+    }
+    std::sort(counts.begin(), counts.end(), compareResultCountDesc);
+    return counts;
+}
+
+Matcher::result_t Matcher::binaryRecordToResult(const char *data, const binary_result_t &record, bool readCompressed) {
+    int adjustQstart = (record.qStartPos == -1) ? 0 : record.qStartPos;
+    int adjustDBstart = (record.dbStartPos == -1) ? 0 : record.dbStartPos;
+    float qCov = SmithWaterman::computeCov(adjustQstart, record.qEndPos, record.qLen);
+    float dbCov = SmithWaterman::computeCov(adjustDBstart, record.dbEndPos, record.dbLen);
+    unsigned int alnLength = Matcher::computeAlnLength(adjustQstart, record.qEndPos, adjustDBstart, record.dbEndPos);
+
+    std::string backtrace;
+    if (record.backtraceLen > 0) {
+        const char *cigar = getBinaryBacktrace(data, record);
+        if (readCompressed) {
+            backtrace.assign(cigar, record.backtraceLen);
+        } else {
+            backtrace = uncompressAlignment(std::string(cigar, record.backtraceLen));
+        }
+    }
+    return result_t(record.dbKey, record.score, qCov, dbCov, record.seqId, record.eval, alnLength,
+                    record.qStartPos, record.qEndPos, record.qLen, record.dbStartPos, record.dbEndPos, record.dbLen,
+                    record.queryOrfStartPos, record.queryOrfEndPos, record.dbOrfStartPos, record.dbOrfEndPos, backtrace);
+}
+
+void Matcher::resultsToBinaryBuffer(std::string &buffer, const std::vector<result_t> &results, bool addBacktrace, bool compress, bool addOrfPosition) {
+    // empty result lists are written as empty entries, same as in the text format
+    if (results.empty()) {
+        return;
+    }
+    binary_header_t header;
+    header.magic = BINARY_RESULT_MAGIC;
+    header.flags = (addBacktrace ? BINARY_RESULT_HAS_BACKTRACE : 0) | (addOrfPosition ? BINARY_RESULT_HAS_ORF_POSITION : 0);
+    header.reserved = 0;
+    header.count = static_cast<unsigned int>(results.size());
+
+    std::string cigars;
+    const size_t recordStart = buffer.size() + sizeof(binary_header_t);
+    buffer.append(reinterpret_cast<const char *>(&header), sizeof(binary_header_t));
+    buffer.resize(recordStart + results.size() * sizeof(binary_result_t));
+    for (size_t i = 0; i < results.size(); i++) {
+        const result_t &res = results[i];
+        binary_result_t record;
+        record.dbKey = res.dbKey;
+        record.score = res.score;
+        record.seqId = res.seqId;
+        record.eval = res.eval;
+        record.qStartPos = res.qStartPos;
+        record.qEndPos = res.qEndPos;
+        record.qLen = res.qLen;
+        record.dbStartPos = res.dbStartPos;
+        record.dbEndPos = res.dbEndPos;
+        record.dbLen = res.dbLen;
+        record.queryOrfStartPos = addOrfPosition ? res.queryOrfStartPos : -1;
+        record.queryOrfEndPos = addOrfPosition ? res.queryOrfEndPos : -1;
+        record.dbOrfStartPos = addOrfPosition ? res.dbOrfStartPos : -1;
+        record.dbOrfEndPos = addOrfPosition ? res.dbOrfEndPos : -1;
+        record.backtraceOffset = static_cast<unsigned int>(cigars.size());
+        record.backtraceLen = 0;
+        if (addBacktrace) {
+            cigars.append(compress ? compressAlignment(res.backtrace) : res.backtrace);
+            record.backtraceLen = static_cast<unsigned int>(cigars.size() - record.backtraceOffset);
+        }
+        memcpy(&buffer[recordStart + i * sizeof(binary_result_t)], &record, sizeof(binary_result_t));
+    }
+    buffer.append(cigars);
+}
+
+void Matcher::binaryResultsToText(const char *data, std::string &buffer) {
+    const binary_header_t *header = getBinaryHeader(data);
+    const binary_result_t *records = getBinaryResults(data);
+    const bool hasBacktrace = header->flags & BINARY_RESULT_HAS_BACKTRACE;
+    const bool hasOrfPosition = header->flags & BINARY_RESULT_HAS_ORF_POSITION;
+    char lineBuffer[1024 + 32768 * 4];
+    for (unsigned int i = 0; i < header->count; i++) {
+        result_t res = binaryRecordToResult(data, records[i], true);
+        size_t len = resultToBuffer(lineBuffer, res, hasBacktrace, false, hasOrfPosition);
+        buffer.append(lineBuffer, len);
+    }
+}
+
 int Matcher::computeAlnLength(int qStart, int qEnd, int dbStart, int dbEnd) {
     return std::max(abs(qEnd - qStart), abs(dbEnd - dbStart)) + 1;
 }
@@ -18,6 +18,8 @@
 #include "EvalueComputation.h"
 #include "BandedNucleotideAligner.h"
 
+template <typename T> class DBReader;
+
 class Matcher{
 
 public:
@@ -29,6 +31,39 @@ public:
     const static int ALN_RES_WITH_ORF_POS_WITHOUT_BT_COL_CNT = 14;
     const static int ALN_RES_WITH_ORF_AND_BT_COL_CNT = 15;
 
+    // first byte of a binary alignment result entry, text entries always start with a digit
+    const static char BINARY_RESULT_MAGIC = '\x01';
+    const static unsigned char BINARY_RESULT_HAS_BACKTRACE = 1;
+    const static unsigned char BINARY_RESULT_HAS_ORF_POSITION = 2;
+
+    // binary alignment result entry layout:
+    // binary_header_t | count * binary_result_t | backtrace blob (compressed cigars, not null terminated)
+    struct __attribute__((__packed__)) binary_header_t {
+        char magic;
+        unsigned char flags;
+        unsigned short reserved;
+        unsigned int count;
+    };
+
+    struct __attribute__((__packed__)) binary_result_t {
+        unsigned int dbKey;
+        int score;
+        float seqId;
+        double eval;
+        int qStartPos;
+        int qEndPos;
+        unsigned int qLen;
+        int dbStartPos;
+        int dbEndPos;
+        unsigned int dbLen;
+        int queryOrfStartPos;
+        int queryOrfEndPos;
+        int dbOrfStartPos;
+        int dbOrfEndPos;
+        unsigned int backtraceOffset;
+        unsigned int backtraceLen;
+    };
+
     struct result_t {
         unsigned int dbKey;
         int score;
@@ -153,6 +188,33 @@ public:
     result_t getSWResult(Sequence* dbSeq, const int diagonal, bool isReverse, const int covMode, const float covThr, const double evalThr,
                          unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentical, bool wrappedScoring=false);
 
+    // score-only alignment of up to SmithWaterman::INTER_SEQ_LANES short targets at once, one target per SIMD lane
+    // scores are raw alignment scores, -1 marks targets that need a regular alignment
+    void getSWScoreBatch(Sequence **dbSeqs, size_t count, int32_t *scores);
+
+    bool canScoreBatch() const {
+        return aligner != NULL && aligner->canScoreBatch();
+    }
+
+    // number of targets that are scored in parallel by getSWScoreBatch
+    size_t getBatchLanes() const {
+        return aligner->getBatchLanes();
+    }
+
+    // nucleotide alignment of up to getNucleotideBatchLanes() targets at once,
+    // the results are identical to calling getSWResult for each target
+    void getSWResultBatch(Sequence **dbSeqs, const int *diagonals, const bool *isReverse, size_t count,
+                          unsigned int seqIdMode, bool wrappedScoring, result_t *results);
+
+    // with 16 lanes (sse) the batch is slower than aligning the pairs one by one
+    bool canAlignNucleotideBatch() const {
+        return nuclaligner != NULL && nuclaligner->getBatchLanes() >= 32;
+    }
+
+    size_t getNucleotideBatchLanes() const {
+        return nuclaligner->getBatchLanes();
+    }
+
     // need for sorting the results
     static bool compareHits(const result_t &first, const result_t &second) {
         if (first.eval != second.eval) {
@@ -209,6 +271,40 @@ public:
 
     static void readAlignmentResults(std::vector<result_t> &result, char *data, bool readCompressed = false);
 
+    static bool isBinaryResult(const char *data) {
+        return data != NULL && *data == BINARY_RESULT_MAGIC;
+    }
+
+    // zero-copy access to the records of a binary alignment result entry
+    static const binary_header_t *getBinaryHeader(const char *data) {
+        return reinterpret_cast<const binary_header_t *>(data);
+    }
+
+    static const binary_result_t *getBinaryResults(const char *data) {
+        return reinterpret_cast<const binary_result_t *>(data + sizeof(binary_header_t));
+    }
+
+    static const char *getBinaryBacktrace(const char *data, const binary_result_t &record) {
+        const binary_header_t *header = getBinaryHeader(data);
+        return data + sizeof(binary_header_t) + header->count * sizeof(binary_result_t) + record.backtraceOffset;
+    }
+
+    static result_t binaryRecordToResult(const char *data, const binary_result_t &record, bool readCompressed = false);
+
+    // number of results in a text or binary alignment result entry
+    static size_t countAlignmentResults(const char *data, size_t dataSize);
+
+    // maximum number of results over all entries of an alignment result database
+    static size_t maxAlignmentResultCount(DBReader<unsigned int> &reader, int threads);
+
+    // (result count, id) of the entries [from, from + size), largest entries first
+    static std::vector<std::pair<size_t, size_t>> sortByAlignmentResultCount(DBReader<unsigned int> &reader, size_t from, size_t size, int threads);
+
+    static void resultsToBinaryBuffer(std::string &buffer, const std::vector<result_t> &results, bool addBacktrace, bool compress = true, bool addOrfPosition = false);
+
+    // appends the text representation of a binary alignment result entry
+    static void binaryResultsToText(const char *data, std::string &buffer);
+
     static float estimateSeqIdByScorePerCol(uint16_t score, unsigned int qLen, unsigned int tLen);
 
     static std::string compressAlignment(const std::string &bt);
@@ -248,6 +344,10 @@ private:
     int8_t * tinySubMat;
     // set substituion matrix
     void setSubstitutionMatrix(BaseMatrix *m);
+
+    // coverage, sequence identity and bit score of an alignment, frees its cigar
+    result_t alignmentToResult(s_align &alignment, Sequence *dbSeq, bool isReverse, unsigned int alignmentMode,
+                               unsigned int seqIdMode, int origQueryLen, std::string &backtrace);
 };
 
 #endif
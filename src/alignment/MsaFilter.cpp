@@ -5,13 +5,16 @@
 #include <Debug.h>
 #include <Util.h>
 #include "MsaFilter.h"
-#include "simd.h"
 #include "MathUtil.h"
 #include "MultipleAlignment.h"
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 MsaFilter::MsaFilter(int maxSeqLen, int maxSetSize, SubstitutionMatrix *m, int gapOpen, int gapExtend) :
     // TODO allow changing these?
-    PLTY_GAPOPEN(6.0f), PLTY_GAPEXTD(1.0f), gapOpen(gapOpen), gapExtend(gapExtend) {
+    PLTY_GAPOPEN(6.0f), PLTY_GAPEXTD(1.0f), gapOpen(gapOpen), gapExtend(gapExtend), kernels(SimdDispatch::getKernels()) {
     this->m = m;
     this->maxSeqLen = maxSeqLen;
     this->maxSetSize = maxSetSize;
@@ -157,12 +160,6 @@ size_t MsaFilter::filter(const int N_in_total, const int L, const int coverage,
 
         float diff_min_frac;  // minimum fraction of differing positions between sequence j and k needed to accept sequence k
         float qdiff_max_frac = 0.9999 - 0.01 * qid;  // maximum allowable number of residues different from query sequence
-        int diff = 0;  // number of differing positions between sequences j and k (counted so far)
-        int diff_suff;  // number of differing positions between sequences j and k that would be sufficient
-        int qdiff_max;  // maximum number of residues required to be different from query
-        int cov_kj;  // upper limit of number of positions where both sequence k and j have a residue
-        int first_kj;             // first non-gap position in sequence j AND k
-        int last_kj;              // last  non-gap position in sequence j AND k
         int kk, jj;               // indices for sequence from 1 to N_in
         int k, j;                 // kk=ksort[k], jj=ksort[j]
         int i;                    // counts residues
@@ -182,9 +179,12 @@ size_t MsaFilter::filter(const int N_in_total, const int L, const int coverage,
                 in[k] = 0;
             }
         }
+        const bool parallelSet = static_cast<size_t>(N_in) >= MultipleAlignment::PARALLEL_SET_SIZE;
         // Determine first[k], last[k]?
-        for (k = 0; k < N_in; ++k)  // do this for ALL sequences, not only those with in[k]==1 (since in[k] may be display[k])
+#pragma omp parallel for schedule(static) if(parallelSet)
+        for (int k = 0; k < N_in; ++k)  // do this for ALL sequences, not only those with in[k]==1 (since in[k] may be display[k])
         {
+            int i;
             for (i = 0; i < L; ++i)
                 if (X[k][i] < MultipleAlignment::NAA)
                     break;
@@ -196,11 +196,12 @@ size_t MsaFilter::filter(const int N_in_total, const int L, const int coverage,
         }
 
         // Determine number of residues nres[k]?
-        for (k = 0;
+#pragma omp parallel for schedule(static) if(parallelSet)
+        for (int k = 0;
              k < N_in; ++k)  // do this for ALL sequences, not only those with in[k]==1 (since in[k] may be display[k])
         {
             int nr = 0;
-            for (i = first[k]; i <= last[k]; ++i)
+            for (int i = first[k]; i <= last[k]; ++i)
                 if (X[k][i] < MultipleAlignment::NAA)
                     nr++;
             this->nres[k] = nr;
@@ -251,7 +252,8 @@ size_t MsaFilter::filter(const int N_in_total, const int L, const int coverage,
         }
 
         // Check coverage and sim-to-query criteria for each sequence k
-        for (k = 0; k < N_in; ++k) {
+#pragma omp parallel for schedule(dynamic, 64) if(parallelSet)
+        for (int k = 0; k < N_in; ++k) {
             if (*keep_local[k] == 0 || *keep_local[k] == 2)
                 continue;  // seq k not regular sequence OR is marked sequence
             if (100 * nres[k] < coverage * L) {
@@ -300,9 +302,9 @@ size_t MsaFilter::filter(const int N_in_total, const int L, const int coverage,
             //Check if sequence similarity with query at least qid?
             if (qdiff_max_frac < 0.999) {
 
-                qdiff_max = int(qdiff_max_frac * nres[k] + 0.9999);
+                const int qdiff_max = int(qdiff_max_frac * nres[k] + 0.9999);
 //                  printf("k=%-4i  nres=%-4i  qdiff_max=%-4i first=%-4i last=%-4i",k,nres[k],qdiff_max,first[k],last[k]);
-                diff = 0;
+                int diff = 0;
                 for (int i = first[k]; i <= last[k]; ++i)
                     // enough different residues to reject based on minimum qid with query? => break
                     if (X[k][i] < MultipleAlignment::NAA
@@ -423,77 +425,32 @@ size_t MsaFilter::filter(const int N_in_total, const int L, const int coverage,
                 diff_min_frac = 0.9999 - 0.01 *
                                          seqidk;  // min fraction of differing positions between sequence j and k needed to accept sequence k
                 // Loop over already accepted sequences
-                for (jj = 0; jj < kk; ++jj) {
-                    if (!inkk[jj])
-                        continue;
-                    j = ksort[jj];
-//                for (int i = first[k]; i <= last[k]; ++i) {
-//                    printf("%02d", (int)X[k][i]);
-//                }
-//                std::cout << std::endl;
-//                for (int i = first[j]; i <= last[j]; ++i) {
-//                    printf("%02d", (int)X[j][i]);
-//                }
-//                std::cout << std::endl;
-
-                    first_kj = std::max(first[k], first[j]);
-                    last_kj = std::min(last[k], last[j]);
-                    cov_kj = last_kj - first_kj + 1;
-                    diff_suff = int(diff_min_frac * std::min(nres[k], cov_kj) +
-                                    0.999);  // nres[j]>nres[k] anyway because of sorting
-                    diff = 0;
-                    const simd_int *XK = (simd_int *) X[k];
-                    const simd_int *XJ = (simd_int *) X[j];
-                    const int first_kj_simd = first_kj / (VECSIZE_INT * 4);
-                    const int last_kj_simd = last_kj / (VECSIZE_INT * 4) + 1;
-                    // coverage correction for simd
-                    // because we do not always hit the right start with simd.
-                    // This works because all sequence vector are initialized with GAPs so the sequnces is surrounded by GAPs
-                    const int first_diff_simd_scalar = std::abs(
-                            first_kj_simd * (VECSIZE_INT * 4) - first_kj);
-                    const int last_diff_simd_scalar = std::abs(
-                            last_kj_simd * (VECSIZE_INT * 4) - (last_kj + 1));
-
-                    cov_kj += (first_diff_simd_scalar + last_diff_simd_scalar);
-
-                    // _mm_set1_epi8 pseudo-instruction is slow!
-                    const simd_int NAAx16 = simdi8_set(MultipleAlignment::NAA - 1);
-                    for (int i = first_kj_simd; i < last_kj_simd && diff < diff_suff; ++i) {
-                        // None SIMD function
-                        // enough different residues to accept? => break
-                        // if (X[k][i] >= NAA || X[j][i] >= NAA)
-                        //    cov_kj--;
-                        // else if (X[k][i] != X[j][i] && ++diff >= diff_suff)
-                        //    break; // accept (k,j)
-
-                        const simd_int NO_AA_K = simdi8_gt(XK[i], NAAx16);  // pos without amino acid in seq k
-                        const simd_int NO_AA_J = simdi8_gt(XJ[i], NAAx16);  // pos without amino acid in seq j
-
-                        // Compute 16 bits indicating positions with GAP, ANY or ENDGAP in seq k or j
-                        // int _mm_movemask_epi8(__m128i a) creates 16-bit mask from most significant bits of
-                        // the 16 signed or unsigned 8-bit integers in a and zero-extends the upper bits.
-                        int res = simdi8_movemask(simdi_or(NO_AA_K, NO_AA_J));
-//                    for (int u = 0; u < 32; ++u) {
-//                        printf("%02d:%02d ", (int) ((char*)&XK[i])[u], (int) ((char*)&XK[i])[u]);
-//                    }
-//                    std::cout << std::endl;
-                        cov_kj -= __builtin_popcount(res);  // subtract positions that should not contribute to coverage
-
-                        // Compute 16 bit mask that indicates positions where k and j have identical residues
-                        int c = simdi8_movemask(simdi8_eq(XK[i], XJ[i]));
-
-                        // Count positions where  k and j have different amino acids, which is equal to 16 minus the
-                        //  number of positions for which either j and k are equal or which contain ANY, GAP, or ENDGAP
-                        diff += (VECSIZE_INT * 4) - __builtin_popcount(c | res);
+                bool similar = false;
+                if (parallelSet && kk >= PARALLEL_SCAN_SIZE) {
+                    // every accepted sequence has to be checked, only the first hit ends the scan early in the serial case
+#pragma omp parallel for schedule(dynamic, 256)
+                    for (int jj = 0; jj < kk; ++jj) {
+                        bool found;
+#pragma omp atomic read
+                        found = similar;
+                        if (found || !inkk[jj])
+                            continue;
+                        if (isSimilar(k, ksort[jj], diff_min_frac)) {
+#pragma omp atomic write
+                            similar = true;
+                        }
+                    }
+                } else {
+                    for (jj = 0; jj < kk; ++jj) {
+                        if (!inkk[jj])
+                            continue;
+                        if (isSimilar(k, ksort[jj], diff_min_frac)) {
+                            similar = true;
+                            break;  //dissimilarity < acceptace threshold? Reject!
+                        }
                     }
-//            // DEBUG
-//            printf("%20.20s with %20.20s:  diff=%i  diff_min_frac*cov_kj=%f  diff_suff=%i  nres=%i  cov_kj=%i\n",sname[k],sname[j],diff,diff_min_frac*cov_kj,diff_suff,nres[k],cov_kj);
-//            printf("%s\n%s\n\n",seq[k],seq[j]);
-                    if (diff < diff_suff && float(diff) <= diff_min_frac * cov_kj && cov_kj > 0)
-                        break;  //dissimilarity < acceptace threshold? Reject!
-
                 }
-                if (jj >= kk)  // did loop reach end? => accept k. Otherwise reject k (the shorter of the two)
+                if (similar == false)  // did loop reach end? => accept k. Otherwise reject k (the shorter of the two)
                 {
                     in[k] = inkk[kk] = 1;
                     n++;
@@ -554,6 +511,21 @@ size_t MsaFilter::filter(const int N_in_total, const int L, const int coverage,
     return N_keep_total + 1;
 }
 
+bool MsaFilter::isSimilar(int k, int j, float diff_min_frac) const {
+    const int first_kj = std::max(first[k], first[j]);  // first non-gap position in sequence j AND k
+    const int last_kj = std::min(last[k], last[j]);     // last  non-gap position in sequence j AND k
+    // upper limit of number of positions where both sequence k and j have a residue
+    const int cov_max = last_kj - first_kj + 1;
+    const int diff_suff = int(diff_min_frac * std::min(nres[k], cov_max) +
+                              0.999);  // nres[j]>nres[k] anyway because of sorting
+    // outside of [first_kj, last_kj] one of both sequences has no residue, so the counts are exact unless the
+    // comparison stopped early at diff_suff, in which case k is accepted regardless of the coverage
+    int cov_kj = 0;
+    const int diff = kernels.msaRowDiff(X[k], X[j], first_kj, last_kj + 1, diff_suff, &cov_kj);
+    //dissimilarity < acceptace threshold?
+    return diff < diff_suff && float(diff) <= diff_min_frac * cov_kj && cov_kj > 0;
+}
+
 void MsaFilter::shuffleSequences(const char ** X, size_t setSize) {
     for (size_t i = 0, j = 0; j < setSize; j++) {
         if (keep[j] != 0) {
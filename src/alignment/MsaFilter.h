@@ -8,6 +8,7 @@
 
 #include <SubstitutionMatrix.h>
 #include "MultipleAlignment.h"
+#include "SimdDispatch.h"
 
 class MsaFilter {
 
@@ -51,6 +52,12 @@ private:
     // shuffles the filtered sequences to the back of the array, the unfiltered ones remain in the front
     void shuffleSequences(const char ** X, size_t setSize);
 
+    // true if sequence k is too similar to the already accepted sequence j
+    bool isSimilar(int k, int j, float diff_min_frac) const;
+
+    // candidates with at least this many preceding sequences are compared by all threads
+    static const int PARALLEL_SCAN_SIZE = 1024;
+
     // prune sequence based on score
     int prune(int start, int end, float b, char * query, char *target);
 
@@ -63,6 +70,8 @@ private:
     int gapOpen;
     int gapExtend;
 
+    const SimdKernels &kernels;
+
     // position-dependent maximum-sequence-identity threshold for filtering? (variable used in former version was idmax)
     int *Nmax;
     // minimum value of idmax[i-WFIL,i+WFIL]
@@ -5,6 +5,10 @@
 #include "SubstitutionMatrix.h"
 #include "Util.h"
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 MultipleAlignment::MultipleAlignment(size_t maxSeqLen, SubstitutionMatrix *subMat)
     : subMat(subMat), maxSeqLen(maxSeqLen), maxMsaSeqLen(maxSeqLen * 2) {
     queryGaps = new unsigned int[maxMsaSeqLen];
@@ -41,37 +45,60 @@ void MultipleAlignment::print(MSAResult msaResult, SubstitutionMatrix * subMat){
     }
 }
 
+void MultipleAlignment::addQueryGaps(unsigned int *queryGaps, const Matcher::result_t &alignment) {
+    const std::string& bt = alignment.backtrace;
+    size_t queryPos = 0;
+    size_t targetPos = 0;
+    size_t currentQueryGapSize = 0;
+    queryPos = alignment.qStartPos;
+    targetPos = alignment.dbStartPos;
+    // compute query gaps (deletions)
+    for (size_t pos = 0; pos < bt.size(); ++pos) {
+        char bt_letter = bt.at(pos);
+        if (bt_letter == 'M') { // match state
+            ++queryPos;
+            ++targetPos;
+            currentQueryGapSize = 0;
+        } else {
+            if (bt_letter == 'I') { // insertion
+                ++queryPos;
+                currentQueryGapSize = 0;
+            }
+            else { // deletion
+                ++targetPos;
+                currentQueryGapSize += 1;
+                size_t gapCount = queryGaps[queryPos];
+                queryGaps[queryPos] = std::max(gapCount, currentQueryGapSize);
+            }
+        }
+    }
+}
+
 void MultipleAlignment::computeQueryGaps(unsigned int *queryGaps, Sequence *centerSeq, const std::vector<Matcher::result_t> &alignmentResults) {
     // init query gaps
     memset(queryGaps, 0, sizeof(unsigned int) * centerSeq->L);
-    for(size_t i = 0; i < alignmentResults.size(); i++) {
-        const Matcher::result_t& alignment = alignmentResults[i];
-        const std::string& bt = alignment.backtrace;
-        size_t queryPos = 0;
-        size_t targetPos = 0;
-        size_t currentQueryGapSize = 0;
-        queryPos = alignment.qStartPos;
-        targetPos = alignment.dbStartPos;
-        // compute query gaps (deletions)
-        for (size_t pos = 0; pos < bt.size(); ++pos) {
-            char bt_letter = bt.at(pos);
-            if (bt_letter == 'M') { // match state
-                ++queryPos;
-                ++targetPos;
-                currentQueryGapSize = 0;
-            } else {
-                if (bt_letter == 'I') { // insertion
-                    ++queryPos;
-                    currentQueryGapSize = 0;
-                }
-                else { // deletion
-                    ++targetPos;
-                    currentQueryGapSize += 1;
-                    size_t gapCount = queryGaps[queryPos];
-                    queryGaps[queryPos] = std::max(gapCount, currentQueryGapSize);
-                }
+    if (alignmentResults.size() < PARALLEL_SET_SIZE) {
+        for (size_t i = 0; i < alignmentResults.size(); i++) {
+            addQueryGaps(queryGaps, alignmentResults[i]);
+        }
+        return;
+    }
+    // the gap counts are a maximum over all alignments, merge the per thread maxima
+#pragma omp parallel
+    {
+        unsigned int *localGaps = new unsigned int[maxMsaSeqLen];
+        memset(localGaps, 0, sizeof(unsigned int) * maxMsaSeqLen);
+#pragma omp for schedule(static)
+        for (size_t i = 0; i < alignmentResults.size(); i++) {
+            addQueryGaps(localGaps, alignmentResults[i]);
+        }
+#pragma omp critical
+        {
+            for (size_t pos = 0; pos < maxMsaSeqLen; pos++) {
+                queryGaps[pos] = std::max(queryGaps[pos], localGaps[pos]);
             }
         }
+        delete[] localGaps;
     }
 }
 
@@ -97,6 +124,7 @@ size_t MultipleAlignment::updateGapsInCenterSequence(char **msaSequence, Sequenc
 void MultipleAlignment::updateGapsInSequenceSet(char **msaSequence, size_t centerSeqSize, const std::vector<std::vector<unsigned char>> &seqs,
                                                 const std::vector<Matcher::result_t> &alignmentResults, unsigned int *queryGaps,
                                                 bool noDeletionMSA) {
+#pragma omp parallel for schedule(static) if(seqs.size() >= PARALLEL_SET_SIZE)
     for(size_t i = 0; i < seqs.size(); i++) {
         const Matcher::result_t& result = alignmentResults[i];
         const std::string& bt = result.backtrace;
@@ -202,6 +230,7 @@ MultipleAlignment::MSAResult MultipleAlignment::computeMSA(Sequence *centerSeq,
     // clean vector
     //alignmentResults.clear();
     // map to int
+#pragma omp parallel for schedule(static) if(edgeSeqs.size() >= PARALLEL_SET_SIZE)
     for (size_t k = 0; k < edgeSeqs.size() + 1; ++k) {
         for (size_t pos = 0; pos < centerSeqSize; ++pos) {
             msaSequence[k][pos] = (msaSequence[k][pos] == '-') ?
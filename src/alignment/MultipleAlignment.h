@@ -18,6 +18,9 @@ public:
         ENDGAP=22 //number representing a ignored gaps (for some calculations like gap percentage)
     };
 
+    // sets with at least this many sequences are processed by all threads together
+    static const size_t PARALLEL_SET_SIZE = 4096;
+
     struct MSAResult {
         size_t msaSequenceLength;
         size_t centerLength;
@@ -50,6 +53,8 @@ private:
 
     void computeQueryGaps(unsigned int *queryGaps, Sequence *centerSeq, const std::vector<Matcher::result_t> &alignmentResults);
 
+    static void addQueryGaps(unsigned int *queryGaps, const Matcher::result_t &alignment);
+
     size_t updateGapsInCenterSequence(char **msaSequence, Sequence *centerSeq, bool noDeletionMSA);
 
     void updateGapsInSequenceSet(char **msaSequence, size_t centerSeqSize, const std::vector<std::vector<unsigned char>> &seqs,
@@ -10,6 +10,22 @@
 #include "Debug.h"
 #include "MultipleAlignment.h"
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+// range of [start, start + length) worked on by the calling thread, the whole range outside of a parallel region
+static inline void threadRange(size_t start, size_t length, size_t &from, size_t &to) {
+    size_t threads = 1;
+    size_t thread = 0;
+#ifdef OPENMP
+    threads = static_cast<size_t>(omp_get_num_threads());
+    thread = static_cast<size_t>(omp_get_thread_num());
+#endif
+    from = start + (length * thread) / threads;
+    to = start + (length * (thread + 1)) / threads;
+}
+
 
 PSSMCalculator::PSSMCalculator(SubstitutionMatrix *subMat, size_t maxSeqLength, size_t maxSetSize, int pcmode,
                                MultiParam<PseudoCounts> pca, MultiParam<PseudoCounts> pcb, int gapOpen, int gapPseudoCount)
@@ -51,6 +67,9 @@ PSSMCalculator::PSSMCalculator(SubstitutionMatrix *subMat, size_t maxSeqLength,
     gDel = new uint8_t[(maxSeqLength + 1)];
     gIns = new uint8_t[(maxSeqLength + 1)];
     gapWeightsIns.reserve(maxSeqLength + 1);
+    msaColumns = NULL;
+    columnStride = 0;
+    msaColumnsCapacity = 0;
 }
 
 PSSMCalculator::~PSSMCalculator() {
@@ -75,6 +94,7 @@ PSSMCalculator::~PSSMCalculator() {
     free(f);
     delete[] gDel;
     delete[] gIns;
+    free(msaColumns);
 }
 
 //    PSSMCalculator::Profile PSSMCalculator::computePSSMFromMSA(size_t setSize,
@@ -131,6 +151,7 @@ PSSMCalculator::Profile PSSMCalculator::computePSSMFromMSA(size_t setSize, size_
 PSSMCalculator::Profile PSSMCalculator::computePSSMFromMSA(size_t setSize, size_t queryLength, const char **msaSeqs,
                                                            const std::vector<Matcher::result_t> &alnResults, bool wg) {
     increaseSetSize(setSize);
+    transposeMsa(queryLength, setSize, msaSeqs);
     // Quick and dirty calculation of the weight per sequence wg[k]
     computeSequenceWeights(seqWeight, queryLength, setSize, msaSeqs);
     seqWeightTotal = 0.0; // TODO: MathUtil::NormalizeTo1 computes the same sum again, could be optimized?
@@ -143,9 +164,9 @@ PSSMCalculator::Profile PSSMCalculator::computePSSMFromMSA(size_t setSize, size_
         computeContextSpecificWeights(matchWeight, seqWeight, Neff_M, queryLength, setSize, msaSeqs);
     } else {
         // compute matchWeight based on sequence weight
-        computeMatchWeights(matchWeight, seqWeight, setSize, queryLength, msaSeqs);
+        computeMatchWeights(matchWeight, seqWeight, Neff_M, setSize, queryLength);
         // compute NEFF_M
-        computeNeff_M(matchWeight, seqWeight, Neff_M, queryLength, setSize, msaSeqs);
+        computeNeff_M(matchWeight, Neff_M, queryLength);
     }
     // compute consensus sequence
     computeConsensusSequence(consensusSequence, matchWeight, queryLength, subMat->pBack, subMat->num2aa);
@@ -175,13 +196,43 @@ PSSMCalculator::Profile PSSMCalculator::computePSSMFromMSA(size_t setSize, size_
 
     // create final Matrix
     computeLogPSSM(subMat, pssm, profile, 8.0, queryLength, 0.0);
-    computeGapPenalties(queryLength, setSize, msaSeqs, alnResults);
+    computeGapPenalties(queryLength, setSize, alnResults);
 //    PSSMCalculator::printProfile(queryLength);
 
 //    PSSMCalculator::printPSSM(queryLength);
     return Profile(pssm, profile, Neff_M, gDel, gIns, consensusSequence);
 }
 
+void PSSMCalculator::transposeMsa(size_t queryLength, size_t setSize, const char **msaSeqs) {
+    // full vectors per column, so that column scans do not need a remainder loop
+    const size_t vecSize = VECSIZE_INT * 4;
+    columnStride = ((setSize + vecSize - 1) / vecSize) * vecSize;
+    const size_t size = columnStride * queryLength;
+    if (size > msaColumnsCapacity) {
+        free(msaColumns);
+        msaColumnsCapacity = size * 1.5;
+        msaColumns = (char *) mem_align(ALIGN_INT, msaColumnsCapacity);
+    }
+    // blocks of rows and columns that stay in cache while reading rows and writing columns
+    const size_t BLOCK_SIZE = 64;
+#pragma omp parallel for schedule(static) if(setSize >= MultipleAlignment::PARALLEL_SET_SIZE)
+    for (size_t posStart = 0; posStart < queryLength; posStart += BLOCK_SIZE) {
+        const size_t posEnd = std::min(posStart + BLOCK_SIZE, queryLength);
+        for (size_t kStart = 0; kStart < setSize; kStart += BLOCK_SIZE) {
+            const size_t kEnd = std::min(kStart + BLOCK_SIZE, setSize);
+            for (size_t k = kStart; k < kEnd; ++k) {
+                const char *row = msaSeqs[k];
+                for (size_t pos = posStart; pos < posEnd; ++pos) {
+                    msaColumns[pos * columnStride + k] = row[pos];
+                }
+            }
+        }
+        for (size_t pos = posStart; pos < posEnd; ++pos) {
+            memset(msaColumns + pos * columnStride + setSize, MultipleAlignment::GAP, columnStride - setSize);
+        }
+    }
+}
+
 void PSSMCalculator::printProfile(size_t queryLength) {
     printf("Pos");
     for (size_t aa = 0; aa < Sequence::PROFILE_AA_SIZE; aa++) {
@@ -239,8 +290,7 @@ void PSSMCalculator::preparePseudoCounts(float *frequency, float *frequency_with
         }
     }
 }
-void PSSMCalculator::computeNeff_M(float *frequency, float *seqWeight, float *Neff_M,
-                                   size_t queryLength, size_t setSize, char const **msaSeqs) {
+void PSSMCalculator::computeNeff_M(float *frequency, float *Neff_M, size_t queryLength) {
     float Neff_HMM = 0.0f;
     for (size_t pos = 0; pos < queryLength; pos++) {
         float sum = 0.0f;
@@ -256,12 +306,7 @@ void PSSMCalculator::computeNeff_M(float *frequency, float *seqWeight, float *Ne
     float Nlim = fmax(10.0, Neff_HMM + 1.0);    // limiting Neff
     float scale = MathUtil::flog2((Nlim - Neff_HMM) / (Nlim - 1.0));  // for calculating Neff for those seqs with inserts at specific pos
     for (size_t pos = 0; pos < queryLength; pos++) {
-        float w_M = -1.0 / setSize;
-        for (size_t k = 0; k < setSize; ++k){
-            if ( msaSeqs[k][pos] != MultipleAlignment::GAP) {
-                w_M += seqWeight[k];
-            }
-        }
+        const float w_M = Neff_M[pos];
         Neff_M[pos] = (w_M < 0) ? 1.0 : Nlim - (Nlim - 1.0) * MathUtil::fpow2(scale * w_M);
 //        fprintf(stderr,"M  i=%3i  ncol=---  Neff_M=%5.2f  Nlim=%5.2f  w_M=%5.3f  Neff_M=%5.2f\n",pos,Neff_HMM,Nlim,w_M,Neff_M[pos]);
     }
@@ -269,66 +314,64 @@ void PSSMCalculator::computeNeff_M(float *frequency, float *seqWeight, float *Ne
 
 void PSSMCalculator::computeSequenceWeights(float *seqWeight, size_t queryLength,
                                             size_t setSize, const char **msaSeqs) {
-    unsigned int *number_res = new unsigned int[setSize];
-    // initialized wg[k] with tiny pseudo counts
-    std::fill(seqWeight, seqWeight + setSize,  1e-6);
-    // count number of residues per sequence
-    for (size_t k = 0; k < setSize; ++k)
+    // count the residues per column first, so that each weight can be summed up over the columns independently
+    int *nl = new int[queryLength * Sequence::PROFILE_AA_SIZE];  //nl[a] = number of seq's with amino acid a at position l
+    int *distinct_aa_count = new int[queryLength];  //number of different amino acids (ignore X)
+    const bool parallelSet = setSize >= MultipleAlignment::PARALLEL_SET_SIZE;
+#pragma omp parallel if(parallelSet)
     {
-        unsigned int nr = 0;
-        for (size_t pos = 0; pos < queryLength; pos++) {
-            if (msaSeqs[k][pos] != MultipleAlignment::GAP) {
-                nr++;
-            }
-        }
-        number_res[k] = nr;
-    }
-    for (size_t pos = 0; pos < queryLength; pos++) {
-        int nl[ Sequence::PROFILE_AA_SIZE ];  //nl[a] = number of seq's with amino acid a at position l
-        //number of different amino acids (ignore X)
-        std::fill(nl, nl + Sequence::PROFILE_AA_SIZE,  0);
+        size_t from, to;
+        threadRange(0, queryLength, from, to);
+        std::fill(nl + from * Sequence::PROFILE_AA_SIZE, nl + to * Sequence::PROFILE_AA_SIZE, 0);
         for (size_t k = 0; k < setSize; ++k) {
-            if (msaSeqs[k][pos] != MultipleAlignment::GAP) {
-                const unsigned int aa_pos = msaSeqs[k][pos];
-                if(aa_pos < Sequence::PROFILE_AA_SIZE){
-                    nl[aa_pos]++;
+            for (size_t pos = from; pos < to; pos++) {
+                if (msaSeqs[k][pos] != MultipleAlignment::GAP) {
+                    const unsigned int aa_pos = msaSeqs[k][pos];
+                    if (aa_pos < Sequence::PROFILE_AA_SIZE) {
+                        nl[pos * Sequence::PROFILE_AA_SIZE + aa_pos]++;
+                    }
                 }
             }
         }
         //count distinct amino acids (ignore X)
-        int distinct_aa_count = 0;
-        for (size_t aa = 0; aa < Sequence::PROFILE_AA_SIZE; ++aa) {
-            if (nl[aa]) {
-                ++distinct_aa_count;
+        for (size_t pos = from; pos < to; pos++) {
+            int distinct = 0;
+            for (size_t aa = 0; aa < Sequence::PROFILE_AA_SIZE; ++aa) {
+                if (nl[pos * Sequence::PROFILE_AA_SIZE + aa]) {
+                    ++distinct;
+                }
+            }
+            distinct_aa_count[pos] = distinct;
+        }
+    }
+
+#pragma omp parallel for schedule(static) if(parallelSet)
+    for (size_t k = 0; k < setSize; ++k) {
+        // initialized wg[k] with tiny pseudo counts
+        float weight = 1e-6;
+        // count number of residues per sequence
+        unsigned int number_res = 0;
+        for (size_t pos = 0; pos < queryLength; pos++) {
+            if (msaSeqs[k][pos] != MultipleAlignment::GAP) {
+                number_res++;
             }
         }
-//        if(distinct_aa_count == 0){
-//            Debug(Debug::ERROR) << "Error in computeSequenceWeights. Distinct amino acid count is 0.\n";
-//            EXIT(EXIT_FAILURE);
-//        }
         // Compute sequence Weight
         // "Position-based Sequence Weights", Henikoff (1994)
-        for (size_t k = 0; k < setSize; ++k) {
-            if (msaSeqs[k][pos] != MultipleAlignment::GAP) {
-                if (distinct_aa_count != 0) {
-                    const unsigned int aa_pos = msaSeqs[k][pos];
-//                    std::cout << "k="<< k << "\t";
-                    if(aa_pos < Sequence::PROFILE_AA_SIZE){ // Treat score of X with other amino acid as 0.0
-                        seqWeight[k] += 1.0f / (float(nl[aa_pos]) * float(distinct_aa_count) * (float(number_res[k]) + 30.0f));
-//                        std::cout << number_res[k] << "\t" << distinct_aa_count << "\t" <<  nl[aa_pos] << "\t";
-                    }
+        for (size_t pos = 0; pos < queryLength; pos++) {
+            if (msaSeqs[k][pos] != MultipleAlignment::GAP && distinct_aa_count[pos] != 0) {
+                const unsigned int aa_pos = msaSeqs[k][pos];
+                if (aa_pos < Sequence::PROFILE_AA_SIZE) { // Treat score of X with other amino acid as 0.0
+                    // ensure that each residue of a short sequence contributes as much as a residue of a long sequence:
+                    // contribution is proportional to one over sequence length nres[k] plus 30.
+                    weight += 1.0f / (float(nl[pos * Sequence::PROFILE_AA_SIZE + aa_pos]) * float(distinct_aa_count[pos]) * (float(number_res) + 30.0f));
                 }
-                // ensure that each residue of a short sequence contributes as much as a residue of a long sequence:
-                // contribution is proportional to one over sequence length nres[k] plus 30.
             }
         }
+        seqWeight[k] = weight;
     }
-//    std::cout << setSize << std::endl;
-//    std::cout << " Seq. Weight: " << std::endl;
-//    for (size_t k = 0; k < setSize; ++k) {
-//        std::cout << " k="<< k << "\t" << seqWeight[k] << std::endl;
-//    }
-    delete [] number_res;
+    delete[] distinct_aa_count;
+    delete[] nl;
 }
 
 void PSSMCalculator::computePseudoCounts(float *profile, float *frequency,
@@ -352,18 +395,23 @@ void PSSMCalculator::computePseudoCounts(float *profile, float *frequency,
     }
 }
 
-void PSSMCalculator::computeMatchWeights(float * matchWeight, float * seqWeight, size_t setSize, size_t queryLength, const char **msaSeqs) {
+void PSSMCalculator::computeMatchWeights(float * matchWeight, float * seqWeight, float * Neff_M, size_t setSize, size_t queryLength) {
+#pragma omp parallel for schedule(static) if(setSize >= MultipleAlignment::PARALLEL_SET_SIZE)
     for (size_t pos = 0; pos < queryLength; pos++) {
         memset(matchWeight + pos * Sequence::PROFILE_AA_SIZE, 0,
                Sequence::PROFILE_AA_SIZE * sizeof(float));
+        const char *column = msaColumns + pos * columnStride;
+        float w_M = -1.0 / setSize;
         for (size_t k = 0; k < setSize; ++k){
-            if(msaSeqs[k][pos] != MultipleAlignment::GAP){
-                unsigned int aa_pos = msaSeqs[k][pos];
+            if(column[k] != MultipleAlignment::GAP){
+                w_M += seqWeight[k];
+                unsigned int aa_pos = column[k];
                 if(aa_pos < Sequence::PROFILE_AA_SIZE) { // Treat score of X with other amino acid as 0.0
                     matchWeight[pos * Sequence::PROFILE_AA_SIZE + aa_pos] += seqWeight[k];
                 }
             }
         }
+        Neff_M[pos] = w_M;
         MathUtil::NormalizeTo1(&matchWeight[pos * Sequence::PROFILE_AA_SIZE], Sequence::PROFILE_AA_SIZE, subMat->pBack);
     }
 }
@@ -385,12 +433,21 @@ void PSSMCalculator::computeContextSpecificWeights(float * matchWeight, float *w
     NAA_ALIGNSIZE = ((NAA_ALIGNSIZE + ALIGN_FLOAT - 1) / ALIGN_FLOAT) * ALIGN_FLOAT;
     memset(n_backing, 0, NAA_ALIGNSIZE * queryLength);
     memset(w_contrib_backing, 0, NAA_ALIGNSIZE * queryLength);
+    const bool parallelSet = setSize >= MultipleAlignment::PARALLEL_SET_SIZE;
+    // sequences entering or leaving the subalignment of the current column
+    std::vector<size_t> addedSeqs;
+    std::vector<size_t> removedSeqs;
     // insert endgaps
+#pragma omp parallel for schedule(static) if(parallelSet)
     for (size_t k = 0; k < setSize; ++k) {
-        for (size_t i = 0; i < queryLength && X[k][i] == MultipleAlignment::GAP; ++i)
+        for (size_t i = 0; i < queryLength && X[k][i] == MultipleAlignment::GAP; ++i) {
             ((char**)X)[k][i] = ENDGAP;
-        for (int i = queryLength - 1; i >= 0 && X[k][i] == MultipleAlignment::GAP; i--)
+            msaColumns[i * columnStride + k] = ENDGAP;
+        }
+        for (int i = queryLength - 1; i >= 0 && X[k][i] == MultipleAlignment::GAP; i--) {
             ((char**)X)[k][i] = ENDGAP;
+            msaColumns[i * columnStride + k] = ENDGAP;
+        }
     }
     //////////////////////////////////////////////////////////////////////////////////////////////
     // Main loop through alignment columns
@@ -398,25 +455,46 @@ void PSSMCalculator::computeContextSpecificWeights(float * matchWeight, float *w
     {
         bool change = false;
         // Check all sequences k and update n[j][a] and ri[j] if necessary
-        for (size_t k = 0; k < setSize; ++k) {
-            // Update amino acid and GAP / ENDGAP counts for sequences with AA in i-1 and GAP/ENDGAP in i or vice versa
-//            printf("%d %d %d\n", k, i, (int) X[k][i - 1]);
-            if ((i == 0  && X[k][i] < MultipleAlignment::ANY) ||
-                (i != 0  && X[k][i - 1] >= MultipleAlignment::ANY && X[k][i] < MultipleAlignment::ANY)) {  // ... if sequence k was NOT included in i-1 and has to be included for column i
-                change = true;
-                nseqi++;
-                for (size_t j = 0; j < queryLength; ++j){
-                    n[j][(int) X[k][j]]++;
-                }
-            } else if ( i != 0 && X[k][i - 1] < MultipleAlignment::ANY && X[k][i] >= MultipleAlignment::ANY) {  // ... if sequence k WAS included in i-1 and has to be thrown out for column i
-                change = true;
-                nseqi--;
-                for (size_t j = 0; j < queryLength; ++j)
-                    n[j][(int) X[k][j]]--;
+        addedSeqs.clear();
+        removedSeqs.clear();
+        // Update amino acid and GAP / ENDGAP counts for sequences with AA in i-1 and GAP/ENDGAP in i or vice versa
+        // compares a vector of sequences at once in columns i-1 and i, the gap padding is never included
+        const simd_int *column = (const simd_int *) (msaColumns + i * columnStride);
+        const simd_int *prevColumn = (i == 0) ? column : (const simd_int *) (msaColumns + (i - 1) * columnStride);
+        for (size_t vec = 0; vec < columnStride / (VECSIZE_INT * 4); ++vec) {
+            const simd_int any = simdi8_set(MultipleAlignment::ANY);
+            const unsigned int included = simdi8_movemask(simdi8_gt(any, simdi_load(column + vec)));
+            const unsigned int prevIncluded = (i == 0) ? 0 : simdi8_movemask(simdi8_gt(any, simdi_load(prevColumn + vec)));
+            // ... if sequence k was NOT included in i-1 and has to be included for column i
+            for (unsigned int added = included & ~prevIncluded; added != 0; added &= added - 1) {
+                addedSeqs.push_back(vec * (VECSIZE_INT * 4) + __builtin_ctz(added));
             }
-
-        }  //end for (k)
+            // ... if sequence k WAS included in i-1 and has to be thrown out for column i
+            for (unsigned int removed = prevIncluded & ~included; removed != 0; removed &= removed - 1) {
+                removedSeqs.push_back(vec * (VECSIZE_INT * 4) + __builtin_ctz(removed));
+            }
+        }
+        nseqi += static_cast<int>(addedSeqs.size()) - static_cast<int>(removedSeqs.size());
+        change = addedSeqs.empty() == false || removedSeqs.empty() == false;
         nseqs[i] = nseqi;
+        if (change) {
+            // every thread updates the counts of its own columns
+#pragma omp parallel if(parallelSet)
+            {
+                size_t from, to;
+                threadRange(0, queryLength, from, to);
+                for (size_t idx = 0; idx < addedSeqs.size(); ++idx) {
+                    const char *Xk = X[addedSeqs[idx]];
+                    for (size_t j = from; j < to; ++j)
+                        n[j][(int) Xk[j]]++;
+                }
+                for (size_t idx = 0; idx < removedSeqs.size(); ++idx) {
+                    const char *Xk = X[removedSeqs[idx]];
+                    for (size_t j = from; j < to; ++j)
+                        n[j][(int) Xk[j]]--;
+                }
+            }
+        }
 
 //        printf("%d\n", nseqi);
         // Only if subalignment changed we need to update weights wi[k] and Neff[i]
@@ -480,6 +558,7 @@ void PSSMCalculator::computeContextSpecificWeights(float * matchWeight, float *w
                 }
 
                 // Compute pos-specific weights wi[k]
+#pragma omp parallel for schedule(static) if(parallelSet)
                 for (size_t k = 0; k < setSize; ++k) {
                     if (X[k][i] >= MultipleAlignment::ANY)
                         continue;
@@ -492,16 +571,22 @@ void PSSMCalculator::computeContextSpecificWeights(float * matchWeight, float *w
             // Calculate Neff[i]
             Neff_M[i] = 0.0;
 
-            // Allocate and reset amino acid frequencies
-            for (int j = jmin; j <= jmax; ++j)
-                memset(f[j], 0, MultipleAlignment::ANY * sizeof(float));
+            // every thread sums up the frequencies of its own columns in the order of the sequences
+#pragma omp parallel if(parallelSet)
+            {
+                size_t from, to;
+                threadRange(jmin, std::max(jmax - jmin + 1, 0), from, to);
+                // Allocate and reset amino acid frequencies
+                for (size_t j = from; j < to; ++j)
+                    memset(f[j], 0, MultipleAlignment::ANY * sizeof(float));
 
-            // Update f[j][a]
-            for (size_t k = 0; k < setSize; ++k) {
-                if (X[k][i] >= MultipleAlignment::ANY)
-                    continue;
-                for (int j = jmin; j <= jmax; ++j)  // innermost loop; O(L*setSize*L)
-                    f[j][(int) X[k][j]] += wi[k];
+                // Update f[j][a]
+                for (size_t k = 0; k < setSize; ++k) {
+                    if (X[k][i] >= MultipleAlignment::ANY)
+                        continue;
+                    for (size_t j = from; j < to; ++j)  // innermost loop; O(L*setSize*L)
+                        f[j][(int) X[k][j]] += wi[k];
+                }
             }
 
             // Add contributions to Neff[i]
@@ -533,11 +618,13 @@ void PSSMCalculator::computeContextSpecificWeights(float * matchWeight, float *w
         // Calculate amino acid frequencies q->f[i][a] from weights wi[k]
         for (int a = 0; a < 20; ++a)
             matchWeight[i * Sequence::PROFILE_AA_SIZE + a] = 0.0;
+        const char *columnI = msaColumns + i * columnStride;
         for (size_t k = 0; k < setSize; ++k)
-            matchWeight[i * Sequence::PROFILE_AA_SIZE + (int) X[k][i]] += wi[k];
+            matchWeight[i * Sequence::PROFILE_AA_SIZE + (int) columnI[k]] += wi[k];
         MathUtil::NormalizeTo1((matchWeight+ i * Sequence::PROFILE_AA_SIZE), MultipleAlignment::NAA, subMat->pBack);
     }
     // remove end gaps
+#pragma omp parallel for schedule(static) if(parallelSet)
     for (size_t k = 0; k < setSize; ++k) {
         for (size_t i = 0; i < queryLength && X[k][i] == ENDGAP; ++i)
             ((char**)X)[k][i] = MultipleAlignment::GAP;
@@ -546,7 +633,7 @@ void PSSMCalculator::computeContextSpecificWeights(float * matchWeight, float *w
     }
 }
 
-void PSSMCalculator::computeGapPenalties(size_t queryLength, size_t setSize, const char **msaSeqs, const std::vector<Matcher::result_t> &alnResults) {
+void PSSMCalculator::computeGapPenalties(size_t queryLength, size_t setSize, const std::vector<Matcher::result_t> &alnResults) {
     gapWeightsIns.clear();
     const float pseudoCounts = gapPseudoCount / seqWeightTotal;
     const float gapWeightStart = pseudoCounts * MathUtil::fpow2(-gapOpen);
@@ -568,10 +655,11 @@ void PSSMCalculator::computeGapPenalties(size_t queryLength, size_t setSize, con
         }
     }
     // compute penalties for deletions
+    // end gaps of the context specific weights are still marked in msaColumns, count them as gaps
     // we need the seqWeigthSum of two consecutive columns, precalculate for the first column
     float seqWeightSumPrev = 0.0;
     for (size_t i = 0; i < setSize; ++i) {
-        if (msaSeqs[i][0] != MultipleAlignment::GAP) {
+        if (msaColumns[i] < MultipleAlignment::GAP) {
             seqWeightSumPrev += seqWeight[i];
         }
     }
@@ -582,14 +670,16 @@ void PSSMCalculator::computeGapPenalties(size_t queryLength, size_t setSize, con
         float gapWeightDelOpen = gapWeightStart;
         float gapWeightDelClose = gapWeightStart;
         float seqWeightSum = 0.0;
+        const char *column = msaColumns + pos * columnStride;
+        const char *prevColumn = msaColumns + (pos - 1) * columnStride;
         for (size_t i = 0; i < setSize; ++i) {
-            if (msaSeqs[i][pos] == MultipleAlignment::GAP) {
-                if (msaSeqs[i][pos - 1] != MultipleAlignment::GAP) {
+            if (column[i] >= MultipleAlignment::GAP) {
+                if (prevColumn[i] < MultipleAlignment::GAP) {
                     gapWeightDelOpen += seqWeight[i];
                 }
             } else {
                 seqWeightSum += seqWeight[i];
-                if (msaSeqs[i][pos - 1] == MultipleAlignment::GAP) {
+                if (prevColumn[i] >= MultipleAlignment::GAP) {
                     gapWeightDelClose += seqWeight[i];
                 }
             }
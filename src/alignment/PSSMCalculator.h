@@ -124,6 +124,11 @@ private:
     // backing aligned memory
     unsigned char *n_backing;
 
+    // column-major copy of the MSA, column pos starts at msaColumns + pos * columnStride
+    char *msaColumns;
+    size_t columnStride;
+    size_t msaColumnsCapacity;
+
     size_t maxSeqLength;
     size_t maxSetSize;
 
@@ -133,10 +138,14 @@ private:
     // pseudo count for calculation of gap opening penalties
     int gapPseudoCount;
 
-    // compute the Neff_M per column -p log(p)
-    void computeNeff_M(float *frequency, float *seqWeight, float *Neff_M, size_t queryLength, size_t setSize, char const **msaSeqs);
+    // transposes the MSA into msaColumns, rows beyond setSize are padded with gaps
+    void transposeMsa(size_t queryLength, size_t setSize, const char **msaSeqs);
+
+    // compute the Neff_M per column -p log(p), expects the matched sequence weight per column in Neff_M
+    void computeNeff_M(float *frequency, float *Neff_M, size_t queryLength);
 
-    void computeMatchWeights(float * matchWeight, float * seqWeight, size_t setSize, size_t queryLength, const char **msaSeqs);
+    // also writes the weight of all sequences matching a column to Neff_M
+    void computeMatchWeights(float * matchWeight, float * seqWeight, float * Neff_M, size_t setSize, size_t queryLength);
 
     void computeContextSpecificWeights(float * matchWeight, float *seqWeight, float * Neff_M, size_t queryLength, size_t setSize, const char **msaSeqs);
 
@@ -149,7 +158,7 @@ private:
     void increaseSetSize(size_t newSetSize);
 
     // compute position-specific gap penalties for both deletions and insertions
-    void computeGapPenalties(size_t queryLength, size_t setSize, const char **msaSeqs, const std::vector<Matcher::result_t> &alnResults);
+    void computeGapPenalties(size_t queryLength, size_t setSize, const std::vector<Matcher::result_t> &alnResults);
 
     void fillCounteProfile(float *counts, float *matchWeight, float *Neff_M, size_t queryLength);
 };
@@ -32,7 +32,8 @@
 #include "Debug.h"
 #include <iostream>
 
-SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCorrection, int targetSeqType) {
+SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCorrection, int targetSeqType)
+        : batchKernels(SimdDispatch::getKernels()) {
 	maxSequenceLength += 1;
 	this->aaBiasCorrection = aaBiasCorrection;
 
@@ -42,6 +43,12 @@ SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCo
 	vHLoad  = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
 	vE      = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
 	vHmax   = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
+	vBatchH = (uint8_t*) mem_align(SimdDispatch::MAX_LANES, maxSequenceLength * batchKernels.lanes * sizeof(uint8_t));
+	vBatchE = (uint8_t*) mem_align(SimdDispatch::MAX_LANES, maxSequenceLength * batchKernels.lanes * sizeof(uint8_t));
+	vBatchProfile = (uint8_t*) mem_align(SimdDispatch::MAX_LANES, aaSize * batchKernels.lanes * sizeof(uint8_t));
+	vBatchRowBias = (uint8_t*) malloc(maxSequenceLength * sizeof(uint8_t));
+	vUngappedProfile = (uint8_t*) mem_align(SimdDispatch::MAX_LANES, maxSequenceLength * SimdDispatch::PROFILE_SIZE * sizeof(uint8_t));
+	ungappedProfileValid = false;
 
 	// setting up target
 	target_profile_byte = (simd_int*) mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
@@ -109,6 +116,11 @@ SmithWaterman::~SmithWaterman(){
 	free(vHLoad);
 	free(vE);
 	free(vHmax);
+	free(vBatchH);
+	free(vBatchE);
+	free(vBatchProfile);
+	free(vBatchRowBias);
+	free(vUngappedProfile);
 	free(target_profile_byte);
 	free(profile->profile_byte);
 	free(profile->profile_word);
@@ -1160,6 +1172,7 @@ void SmithWaterman::ssw_init(const Sequence* q,
 
     query_id = q->getId();
 	profile->bias = 0;
+	ungappedProfileValid = false;
     profile->query_length = q->L;
 	profile->sequence_type = q->getSequenceType();
 	isQueryProfile = (Parameters::isEqualDbtype(profile->sequence_type, Parameters::DBTYPE_HMM_PROFILE));
@@ -1699,3 +1712,80 @@ int SmithWaterman::ungapped_alignment(const unsigned char *db_sequence, int32_t
     return score;
 #undef SWAP
 }
+
+void SmithWaterman::ungapped_alignment_batch(const unsigned char *db_sequences, int32_t db_length, uint8_t *scores) {
+    const int32_t query_length = profile->query_length;
+    if (ungappedProfileValid == false) {
+        // same scores as profile_byte, residues past the alphabet score 0
+        memset(vUngappedProfile, 0, query_length * SimdDispatch::PROFILE_SIZE * sizeof(uint8_t));
+        for (int32_t i = 0; i < query_length; i++) {
+            uint8_t *row = vUngappedProfile + i * SimdDispatch::PROFILE_SIZE;
+            for (int32_t aa = 0; aa < profile->alphabetSize; aa++) {
+                if (isQueryProfile) {
+                    row[aa] = profile->mat[aa * query_length + i] + profile->bias;
+                } else {
+                    row[aa] = profile->mat[aa * profile->alphabetSize + profile->query_sequence[i]]
+                              + profile->composition_bias[i] + profile->bias;
+                }
+            }
+        }
+        ungappedProfileValid = true;
+    }
+    batchKernels.ungappedScoring((const char *) vUngappedProfile, profile->bias, query_length,
+                                 db_sequences, db_length, scores);
+}
+
+void SmithWaterman::ssw_score_batch(const unsigned char **db_sequences, const int32_t *db_lengths, size_t count,
+                                    const uint8_t gap_open, const uint8_t gap_extend, int32_t *scores) {
+    const int32_t query_length = profile->query_length;
+    const int32_t alphabetSize = profile->alphabetSize;
+    // same biased unsigned byte arithmetic as sw_sse2_byte: scores are stored as mat + bias and
+    // bias - composition_bias[i] is subtracted in row i, so the composition bias must not exceed the bias
+    const uint8_t bias = profile->bias;
+    int32_t maxGain = 0;
+    for (int32_t i = 0; i < alphabetSize * alphabetSize; i++) {
+        maxGain = std::max(maxGain, profile->mat[i] + bias);
+    }
+    int32_t maxCompositionBias = 0;
+    for (int32_t i = 0; i < query_length; i++) {
+        maxCompositionBias = std::max(maxCompositionBias, static_cast<int32_t>(profile->composition_bias[i]));
+        vBatchRowBias[i] = bias - profile->composition_bias[i];
+    }
+    if (maxCompositionBias > bias) {
+        for (size_t lane = 0; lane < count; lane++) {
+            scores[lane] = -1;
+        }
+        return;
+    }
+    maxGain += maxCompositionBias;
+
+    BatchScoringInput in;
+    in.querySequence = profile->query_sequence;
+    in.queryLength = query_length;
+    in.mat = profile->mat;
+    in.alphabetSize = alphabetSize;
+    in.bias = bias;
+    in.rowBias = vBatchRowBias;
+    in.gapOpen = gap_open;
+    in.gapExtend = gap_extend;
+    in.H = vBatchH;
+    in.E = vBatchE;
+    in.profile = vBatchProfile;
+    // the runtime selected kernel might have fewer lanes than INTER_SEQ_LANES
+    const size_t lanes = batchKernels.lanes;
+    uint8_t laneMax[INTER_SEQ_LANES];
+    for (size_t start = 0; start < count; start += lanes) {
+        in.dbSequences = db_sequences + start;
+        in.dbLengths = db_lengths + start;
+        in.count = std::min(lanes, count - start);
+        in.maxLength = 0;
+        for (size_t lane = 0; lane < in.count; lane++) {
+            in.maxLength = std::max(in.maxLength, in.dbLengths[lane]);
+        }
+        batchKernels.batchScoring(in, laneMax);
+        // a cell can only saturate if its diagonal predecessor was larger than UCHAR_MAX - maxGain
+        for (size_t lane = 0; lane < in.count; lane++) {
+            scores[start + lane] = (laneMax[lane] + maxGain > UCHAR_MAX) ? -1 : laneMax[lane];
+        }
+    }
+}
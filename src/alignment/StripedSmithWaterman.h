@@ -45,6 +45,8 @@
 
 #include "Sequence.h"
 #include "EvalueComputation.h"
+#include "SimdDispatch.h"
+
 typedef struct {
     short qStartPos;
     short dbStartPos;
@@ -214,6 +216,44 @@ public:
    int ungapped_alignment(const unsigned char *db_sequence,
                           int32_t db_length);
 
+    /*!	@function	Ungapped alignment scores of several targets against the query of ssw_init, one target per byte lane.
+     Gives the same scores as ungapped_alignment.
+
+     @param	db_sequences	getBatchLanes() transposed numeric targets, residue j of lane t is at db_sequences[j * getBatchLanes() + t],
+     positions past the end of a target hold UNGAPPED_PADDING, aligned to SimdDispatch::MAX_LANES
+     @param	db_length	length of the longest target
+     @param	scores	output: max diagonal score per lane
+     */
+    void ungapped_alignment_batch(const unsigned char *db_sequences, int32_t db_length, uint8_t *scores);
+
+    // residue with score 0 against every query position
+    const static unsigned char UNGAPPED_PADDING = 21;
+
+    /*!	@function	Inter-sequence (SWIPE-like) Smith-Waterman scoring of several targets against the query of ssw_init.
+     Each target occupies one unsigned 8-bit SIMD lane, so no striped query profile has to be traversed per target.
+     Only the best local alignment score is computed. Supported for sequence-sequence alignments only.
+
+     @param	db_sequences	up to INTER_SEQ_LANES numeric target sequences
+     @param	db_lengths	lengths of the target sequences
+     @param	count	number of target sequences
+     @param	scores	output: alignment score per target or -1 if the 8-bit score could have saturated
+     */
+    void ssw_score_batch(const unsigned char **db_sequences, const int32_t *db_lengths, size_t count,
+                         const uint8_t gap_open, const uint8_t gap_extend, int32_t *scores);
+
+    // with 16 lanes (sse) the batch kernel is slower than the striped byte pass
+    bool canScoreBatch() const {
+        return isQueryProfile == false && isTargetProfile == false && batchKernels.lanes >= 32;
+    }
+
+    // maximum number of targets passed to ssw_score_batch at once
+    const static size_t INTER_SEQ_LANES = SimdDispatch::MAX_LANES;
+
+    // number of 8-bit lanes of the runtime selected batch kernel
+    size_t getBatchLanes() const {
+        return batchKernels.lanes;
+    }
+
   /*!	@function	Create the query profile using the query sequence.
    @param	read	pointer to the query sequence; the query sequence needs to be numbers
    @param	readLen	length of the query sequence
@@ -280,6 +320,16 @@ private:
     simd_int* vHmax;
     uint8_t * maxColumn;
 
+    // inter-sequence scoring: H and E of the previous target column, the score column profile and the bias of each query row
+    const SimdKernels &batchKernels;
+    uint8_t* vBatchH;
+    uint8_t* vBatchE;
+    uint8_t* vBatchProfile;
+    uint8_t* vBatchRowBias;
+    // query profile with SimdDispatch::PROFILE_SIZE bytes per position for ungapped_alignment_batch, built on first use
+    uint8_t* vUngappedProfile;
+    bool ungappedProfileValid;
+
     // target variables
     simd_int* target_profile_byte;
     int segSize;
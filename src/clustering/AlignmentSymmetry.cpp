@@ -5,7 +5,9 @@
 #include <climits>
 #include <new>
 #include <algorithm>
+#include <vector>
 #include "Parameters.h"
+#include "Matcher.h"
 #include "Util.h"
 #include "Debug.h"
 #include "FastSort.h"
@@ -17,9 +19,15 @@
 
 #define LEN(x, y) (x[y+1] - x[y])
 
+static bool compareLinkBySetId(const std::pair<unsigned int, unsigned short> &first,
+                               const std::pair<unsigned int, unsigned short> &second) {
+    return first.first < second.first;
+}
+
+template <typename Offset>
 void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsigned int>*seqDbr,
-                                   unsigned int **elementLookupTable, unsigned short **elementScoreTable,
-                                   int scoretype, size_t *offsets) {
+                                   unsigned int *elements, unsigned short *scores, int scoretype,
+                                   const Offset *setStart, const Offset *setSizeOffsets) {
     const int alnType = alnDbr->getDbtype();
     const size_t dbSize = seqDbr->getSize();
     const size_t flushSize = 1000000;
@@ -43,28 +51,53 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                 char *data = alnDbr->getDataByDBKey(clusterId, thread_idx);
 
                 if (*data == '\0') { // check if file contains entry
-                    elementLookupTable[i][0] = seqDbr->getId(clusterId);
-                    if (elementScoreTable != NULL) {
+                    elements[setStart[i]] = seqDbr->getId(clusterId);
+                    if (scores != NULL) {
                         if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_ALIGNMENT_RES)) {
                             if (scoretype == Parameters::APC_ALIGNMENTSCORE) {
                                 //column 1 = alignment score
-                                elementScoreTable[i][0] = (unsigned short) (USHRT_MAX);
+                                scores[setStart[i]] = (unsigned short) (USHRT_MAX);
                             } else {
                                 //column 2 = sequence identity [0-1]
-                                elementScoreTable[i][0] = (unsigned short) (1.0 * 1000.0f);
+                                scores[setStart[i]] = (unsigned short) (1.0 * 1000.0f);
                             }
                         } else if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_PREFILTER_RES) ||
                                    Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_PREFILTER_REV_RES)) {
                             //column 1 = alignment score or sequence identity [0-100]
-                            elementScoreTable[i][0] = (unsigned short) (USHRT_MAX);
+                            scores[setStart[i]] = (unsigned short) (USHRT_MAX);
                         } else if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_CLUSTER_RES)) {
-                            elementScoreTable[i][0] = (unsigned short) (USHRT_MAX);
+                            scores[setStart[i]] = (unsigned short) (USHRT_MAX);
                         }
                     }
                     continue;
                 }
-                size_t setSize = LEN(offsets, i);
+                size_t setSize = LEN(setSizeOffsets, i);
                 size_t writePos = 0;
+                if (Matcher::isBinaryResult(data)) {
+                    const Matcher::binary_header_t *header = Matcher::getBinaryHeader(data);
+                    const Matcher::binary_result_t *records = Matcher::getBinaryResults(data);
+                    if (header->count > setSize) {
+                        Debug(Debug::ERROR) << "Set " << i << " has more elements than allocated (" << setSize << ")!\n";
+                        EXIT(EXIT_FAILURE);
+                    }
+                    for (unsigned int j = 0; j < header->count; j++) {
+                        const size_t currElement = seqDbr->getId(records[j].dbKey);
+                        if (currElement == UINT_MAX || currElement > seqDbr->getSize()) {
+                            Debug(Debug::ERROR) << "Element " << records[j].dbKey
+                                                << " contained in some alignment list, but not contained in the sequence database!\n";
+                            EXIT(EXIT_FAILURE);
+                        }
+                        if (scores != NULL) {
+                            if (scoretype == Parameters::APC_ALIGNMENTSCORE) {
+                                scores[setStart[i] + j] = (unsigned short) (records[j].score);
+                            } else {
+                                scores[setStart[i] + j] = (unsigned short) (records[j].seqId * 1000.0f);
+                            }
+                        }
+                        elements[setStart[i] + j] = currElement;
+                    }
+                    continue;
+                }
                 while (*data != '\0') {
                     if (writePos >= setSize) {
                         Debug(Debug::ERROR) << "Set " << i
@@ -77,16 +110,16 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                     Util::parseKey(data, dbKey);
                     const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
                     const size_t currElement = seqDbr->getId(key);
-                    if (elementScoreTable != NULL) {
+                    if (scores != NULL) {
                         if (Parameters::isEqualDbtype(alnType,Parameters::DBTYPE_ALIGNMENT_RES)) {
                             if (scoretype == Parameters::APC_ALIGNMENTSCORE) {
                                 //column 1 = alignment score
                                 Util::parseByColumnNumber(data, similarity, 1);
-                                elementScoreTable[i][writePos] = (unsigned short) (atof(similarity));
+                                scores[setStart[i] + writePos] = (unsigned short) (atof(similarity));
                             } else {
                                 //column 2 = sequence identity [0-1]
                                 Util::parseByColumnNumber(data, similarity, 2);
-                                elementScoreTable[i][writePos] = (unsigned short) (atof(similarity) * 1000.0f);
+                                scores[setStart[i] + writePos] = (unsigned short) (atof(similarity) * 1000.0f);
                             }
                         }
                         else if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_PREFILTER_RES) ||
@@ -94,10 +127,10 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                             //column 1 = alignment score or sequence identity [0-100]
                             Util::parseByColumnNumber(data, similarity, 1);
                             short sim = atoi(similarity);
-                            elementScoreTable[i][writePos] = (unsigned short) (sim >0 ? sim : -sim);
+                            scores[setStart[i] + writePos] = (unsigned short) (sim >0 ? sim : -sim);
                         }
                         else if (Parameters::isEqualDbtype(alnType, Parameters::DBTYPE_CLUSTER_RES)) {
-                            elementScoreTable[i][writePos] = (unsigned short) (USHRT_MAX);
+                            scores[setStart[i] + writePos] = (unsigned short) (USHRT_MAX);
                         }
                         else {
                             Debug(Debug::ERROR) << "Alignment format is not supported!\n";
@@ -110,7 +143,7 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
                                             << " contained in some alignment list, but not contained in the sequence database!\n";
                         EXIT(EXIT_FAILURE);
                     }
-                    elementLookupTable[i][writePos] = currElement;
+                    elements[setStart[i] + writePos] = currElement;
                     writePos++;
                     data = Util::skipLine(data);
                 }
@@ -120,7 +153,8 @@ void AlignmentSymmetry::readInData(DBReader<unsigned int>*alnDbr, DBReader<unsig
     }
 }
 
-size_t AlignmentSymmetry::findMissingLinks(unsigned int ** elementLookupTable, size_t * offsetTable, size_t dbSize, int threads) {
+template <typename Offset>
+size_t AlignmentSymmetry::findMissingLinks(unsigned int *elements, Offset *offsetTable, size_t dbSize, int threads) {
     // init memory for parallel merge
     unsigned int * tmpSize = new(std::nothrow) unsigned int[threads * dbSize];
     Util::checkAllocation(tmpSize, "Can not allocate memory in findMissingLinks");
@@ -134,11 +168,12 @@ size_t AlignmentSymmetry::findMissingLinks(unsigned int ** elementLookupTable, s
 #pragma omp for schedule(dynamic, 1000)
         for (size_t setId = 0; setId < dbSize; setId++) {
             const size_t elementSize = LEN(offsetTable, setId);
+            const unsigned int *setElements = elements + offsetTable[setId];
             for (size_t elementId = 0; elementId < elementSize; elementId++) {
-                const unsigned int currElm = elementLookupTable[setId][elementId];
-                const unsigned int currElementSize = LEN(offsetTable, currElm);
-                const bool elementFound = std::binary_search(elementLookupTable[currElm],
-                                                             elementLookupTable[currElm] + currElementSize, setId);
+                const unsigned int currElm = setElements[elementId];
+                const unsigned int *currElements = elements + offsetTable[currElm];
+                const bool elementFound = std::binary_search(currElements,
+                                                             currElements + LEN(offsetTable, currElm), setId);
                 // this is a new connection since setId is not contained in currentElementSet
                 if (elementFound == false) {
                     tmpSize[static_cast<size_t>(currElm) * static_cast<size_t>(threads) +
@@ -164,13 +199,19 @@ size_t AlignmentSymmetry::findMissingLinks(unsigned int ** elementLookupTable, s
     return symmetricElementCount;
 }
 
-void AlignmentSymmetry::addMissingLinks(unsigned int **elementLookupTable,
-                                        size_t * offsetTableWithOutNewLinks, size_t * offsetTableWithNewLinks, size_t dbSize, unsigned short **elementScoreTable) {
+template <typename Offset>
+void AlignmentSymmetry::addMissingLinks(unsigned int *elements, const Offset *offsetTableWithOutNewLinks,
+                                        const Offset *offsetTableWithNewLinks, size_t dbSize, unsigned short *scores,
+                                        int threads) {
+    // number of links already appended to each set
+    unsigned int *addedLinks = new(std::nothrow) unsigned int[dbSize];
+    Util::checkAllocation(addedLinks, "Can not allocate memory in addMissingLinks");
+    memset(addedLinks, 0, dbSize * sizeof(unsigned int));
 
     // iterate over all connections and check if it exists in the corresponding set
     // if not add it
     Debug::Progress progress(dbSize);
-
+#pragma omp parallel for schedule(dynamic, 1000) num_threads(threads)
     for(size_t setId = 0; setId < dbSize; setId++) {
         progress.updateProgress();
         const size_t oldElementSize = LEN(offsetTableWithOutNewLinks, setId);
@@ -181,44 +222,76 @@ void AlignmentSymmetry::addMissingLinks(unsigned int **elementLookupTable,
                                    " OldElementSize(" << oldElementSize <<") in addMissingLinks";
             EXIT(EXIT_FAILURE);
         }
+        const size_t setStart = offsetTableWithNewLinks[setId];
         for(size_t elementId = 0; elementId < oldElementSize; elementId++) {
-            const unsigned int currElm = elementLookupTable[setId][elementId];
+            const unsigned int currElm = elements[setStart + elementId];
             if(currElm == UINT_MAX || currElm > dbSize){
                 Debug(Debug::ERROR) << "currElm > dbSize in element list (addMissingLinks). This should not happen.\n";
                 EXIT(EXIT_FAILURE);
             }
             const unsigned int oldCurrElementSize = LEN(offsetTableWithOutNewLinks, currElm);
             const unsigned int newCurrElementSize = LEN(offsetTableWithNewLinks, currElm);
+            const size_t currStart = offsetTableWithNewLinks[currElm];
 
             bool found = false;
             // check if setId is already in set of currElm
+            // only the old part is searched, which no thread writes to
             for(size_t pos = 0; pos < oldCurrElementSize && found == false; pos++){
-                found = (elementLookupTable[currElm][pos] == setId);
+                found = (elements[currStart + pos] == setId);
             }
             // this is a new connection
             if(found == false){ // add connection if it could not be found
-                // find pos to write
-                size_t pos = oldCurrElementSize;
-                while( pos < newCurrElementSize && elementLookupTable[currElm][pos] != UINT_MAX ){
-                    pos++;
-                }
-
+                const size_t pos = oldCurrElementSize + __sync_fetch_and_add(&addedLinks[currElm], 1);
                 if(pos >= newCurrElementSize){
                     Debug(Debug::ERROR) << "pos(" << pos << ") > newCurrElementSize(" << newCurrElementSize << "). This should not happen.\n";
                     EXIT(EXIT_FAILURE);
                 }
-                elementLookupTable[currElm][pos] = setId;
-                elementScoreTable[currElm][pos]=elementScoreTable[setId][elementId];
+                elements[currStart + pos] = setId;
+                scores[currStart + pos] = scores[setStart + elementId];
             }
         }
     }
+
+    // restore the order of the serial insertion (ascending setId)
+    // links of the same setId are added by one thread in order, so a stable sort is enough
+#pragma omp parallel num_threads(threads)
+    {
+        std::vector<std::pair<unsigned int, unsigned short>> links;
+#pragma omp for schedule(dynamic, 1000)
+        for (size_t setId = 0; setId < dbSize; setId++) {
+            if (addedLinks[setId] < 2) {
+                continue;
+            }
+            const size_t start = offsetTableWithNewLinks[setId] + LEN(offsetTableWithOutNewLinks, setId);
+            links.clear();
+            for (size_t pos = start; pos < start + addedLinks[setId]; pos++) {
+                links.emplace_back(elements[pos], scores[pos]);
+            }
+            std::stable_sort(links.begin(), links.end(), compareLinkBySetId);
+            for (size_t i = 0; i < links.size(); i++) {
+                elements[start + i] = links[i].first;
+                scores[start + i] = links[i].second;
+            }
+        }
+    }
+    delete [] addedLinks;
 }
 
 // sort each element vector for bsearch
-void AlignmentSymmetry::sortElements(unsigned int **elementLookupTable, size_t *elementOffsets, size_t dbSize) {
+template <typename Offset>
+void AlignmentSymmetry::sortElements(unsigned int *elements, const Offset *elementOffsets, size_t dbSize) {
 #pragma omp parallel for schedule(dynamic, 1000)
     for (size_t i = 0; i < dbSize; i++) {
-        SORT_SERIAL(elementLookupTable[i], elementLookupTable[i] + LEN(elementOffsets, i));
+        SORT_SERIAL(elements + elementOffsets[i], elements + elementOffsets[i + 1]);
     }
 }
+
+#define INSTANTIATE(Offset) \
+template void AlignmentSymmetry::readInData<Offset>(DBReader<unsigned int>*, DBReader<unsigned int>*, unsigned int *, unsigned short *, int, const Offset *, const Offset *); \
+template size_t AlignmentSymmetry::findMissingLinks<Offset>(unsigned int *, Offset *, size_t, int); \
+template void AlignmentSymmetry::addMissingLinks<Offset>(unsigned int *, const Offset *, const Offset *, size_t, unsigned short *, int); \
+template void AlignmentSymmetry::sortElements<Offset>(unsigned int *, const Offset *, size_t);
+INSTANTIATE(unsigned int)
+INSTANTIATE(size_t)
+#undef INSTANTIATE
 #undef LEN
@@ -13,7 +13,11 @@
 
 class AlignmentSymmetry {
 public:
-    static void readInData(DBReader<unsigned int>*pReader, DBReader<unsigned int>*pDBReader, unsigned int **pInt,unsigned short**elementScoreTable, int scoretype, size_t *offsets);
+    // the graph is stored in CSR form: the set i is elements[offsets[i]] to elements[offsets[i + 1]]
+    // Offset is unsigned int if the number of links fits in 32 bits, otherwise size_t
+    template <typename Offset>
+    static void readInData(DBReader<unsigned int>*alnDbr, DBReader<unsigned int>*seqDbr, unsigned int *elements,
+                           unsigned short *scores, int scoretype, const Offset *setStart, const Offset *setSizeOffsets);
     template<typename T>
     static void computeOffsetFromCounts(T* elementSizes, size_t dbSize)  {
         size_t prevElementLength = elementSizes[0];
@@ -24,21 +28,12 @@ public:
             prevElementLength = currElementLength;
         }
     }
-    static size_t findMissingLinks(unsigned int **elementLookupTable, size_t *offsetTable, size_t dbSize, int threads);
-    static void addMissingLinks(unsigned int **elementLookupTable, size_t *offsetTable, size_t * newOffset, size_t dbSize,unsigned short**elementScoreTable);
-    static void sortElements(unsigned int **elementLookupTable, size_t *offsets, size_t dbSize);
-
-    template <typename T>
-    static void setupPointers(T *elements, T **elementLookupTable, size_t *elementOffset,
-                                 unsigned int dbSize, size_t totalElementCount) {
-        for(size_t i = 0; i < dbSize; i++) {
-            if(totalElementCount < elementOffset[i]){
-                Debug(Debug::ERROR) << "Error in setupPointers. totalElementCount "
-                                    << "(" << totalElementCount << ") < elementOffset["<<i<<"] (" << elementOffset[i] << ")\n";
-                EXIT(EXIT_FAILURE);
-            }
-            elementLookupTable[i] = elements + elementOffset[i];
-        }
-    }
+    template <typename Offset>
+    static size_t findMissingLinks(unsigned int *elements, Offset *offsetTable, size_t dbSize, int threads);
+    template <typename Offset>
+    static void addMissingLinks(unsigned int *elements, const Offset *offsetTableWithOutNewLinks,
+                                const Offset *offsetTableWithNewLinks, size_t dbSize, unsigned short *scores, int threads);
+    template <typename Offset>
+    static void sortElements(unsigned int *elements, const Offset *elementOffsets, size_t dbSize);
 };
 #endif //MMSEQS_ALIGNMENTSYMMETRY_H
@@ -2,12 +2,14 @@
 #include "Util.h"
 #include "Debug.h"
 #include "AlignmentSymmetry.h"
+#include "Matcher.h"
 #include "Timer.h"
 
 #include <queue>
 #include <algorithm>
 #include <climits>
 #include <unordered_map>
+#include <vector>
 #include <FastSort.h>
 
 #ifdef OPENMP
@@ -35,6 +37,65 @@ ClusteringAlgorithms::~ClusteringAlgorithms(){
     delete [] clustersizes;
 }
 
+template <typename Offset>
+void ClusteringAlgorithms::clusterGraph(int mode, unsigned int *assignedcluster, size_t elementCount) {
+    unsigned int * elements = new(std::nothrow) unsigned int[elementCount];
+    Util::checkAllocation(elements, "Can not allocate elements memory in ClusteringAlgorithms::clusterGraph");
+    unsigned short *score = NULL;
+    Offset *elementOffsets = new(std::nothrow) Offset[dbSize + 1];
+    Util::checkAllocation(elementOffsets, "Can not allocate elementOffsets memory in ClusteringAlgorithms::clusterGraph");
+    elementOffsets[dbSize] = 0;
+    short *bestscore = new(std::nothrow) short[dbSize];
+    Util::checkAllocation(bestscore, "Can not allocate bestscore memory in ClusteringAlgorithms::clusterGraph");
+    std::fill_n(bestscore, dbSize, SHRT_MIN);
+
+    readInClusterData(elements, score, elementOffsets, elementCount);
+    ClusteringAlgorithms::initClustersizes();
+    if (mode == 1) {
+        setCover(elements, score, assignedcluster, bestscore, elementOffsets);
+    } else if (mode == 3) {
+        Debug(Debug::INFO) << "connected component mode" << "\n";
+        for (int cl_size = dbSize - 1; cl_size >= 0; cl_size--) {
+            unsigned int representative = sorted_clustersizes[cl_size];
+            if (assignedcluster[representative] == UINT_MAX) {
+                assignedcluster[representative] = representative;
+                std::queue<int> myqueue;
+                myqueue.push(representative);
+                std::queue<int> iterationcutoffs;
+                iterationcutoffs.push(0);
+                //delete clusters of members;
+                while (!myqueue.empty()) {
+                    int currentid = myqueue.front();
+                    int iterationcutoff = iterationcutoffs.front();
+                    assignedcluster[currentid] = representative;
+                    myqueue.pop();
+                    iterationcutoffs.pop();
+                    size_t elementSize = (elementOffsets[currentid + 1] - elementOffsets[currentid]);
+                    for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                        unsigned int elementtodelete = elements[elementOffsets[currentid] + elementId];
+                        if (assignedcluster[elementtodelete] == UINT_MAX && iterationcutoff < maxiterations) {
+                            myqueue.push(elementtodelete);
+                            iterationcutoffs.push((iterationcutoff + 1));
+                        }
+                        assignedcluster[elementtodelete] = representative;
+                    }
+                }
+
+            }
+        }
+    }
+    //delete unnecessary datastructures
+    delete [] sorted_clustersizes;
+    delete [] clusterid_to_arrayposition;
+    delete [] borders_of_set;
+
+
+    delete [] elements;
+    delete [] elementOffsets;
+    delete [] score;
+    delete [] bestscore;
+}
+
 std::pair<unsigned int, unsigned int> * ClusteringAlgorithms::execute(int mode) {
     // init data
 
@@ -57,70 +118,15 @@ std::pair<unsigned int, unsigned int> * ClusteringAlgorithms::execute(int mode)
             for (size_t i = 0; i < alnDbr->getSize(); i++) {
                 const char *data = alnDbr->getData(i, thread_idx);
                 const size_t dataSize = alnDbr->getEntryLen(i);
-                elementCount += (*data == '\0') ? 1 : Util::countLines(data, dataSize);
+                elementCount += (*data == '\0') ? 1 : Matcher::countAlignmentResults(data, dataSize);
             }
         }
-        unsigned int * elements = new(std::nothrow) unsigned int[elementCount];
-        Util::checkAllocation(elements, "Can not allocate elements memory in ClusteringAlgorithms::execute");
-        unsigned int ** elementLookupTable = new(std::nothrow) unsigned int*[dbSize];
-        Util::checkAllocation(elementLookupTable, "Can not allocate elementLookupTable memory in ClusteringAlgorithms::execute");
-        unsigned short **scoreLookupTable = new(std::nothrow) unsigned short *[dbSize];
-        Util::checkAllocation(scoreLookupTable, "Can not allocate scoreLookupTable memory in ClusteringAlgorithms::execute");
-        unsigned short *score = NULL;
-        size_t *elementOffsets = new(std::nothrow) size_t[dbSize + 1];
-        Util::checkAllocation(elementOffsets, "Can not allocate elementOffsets memory in ClusteringAlgorithms::execute");
-        elementOffsets[dbSize] = 0;
-        short *bestscore = new(std::nothrow) short[dbSize];
-        Util::checkAllocation(bestscore, "Can not allocate bestscore memory in ClusteringAlgorithms::execute");
-        std::fill_n(bestscore, dbSize, SHRT_MIN);
-
-        readInClusterData(elementLookupTable, elements, scoreLookupTable, score, elementOffsets, elementCount);
-        ClusteringAlgorithms::initClustersizes();
-        if (mode == 1) {
-            setCover(elementLookupTable, scoreLookupTable, assignedcluster, bestscore, elementOffsets);
-        } else if (mode == 3) {
-            Debug(Debug::INFO) << "connected component mode" << "\n";
-            for (int cl_size = dbSize - 1; cl_size >= 0; cl_size--) {
-                unsigned int representative = sorted_clustersizes[cl_size];
-                if (assignedcluster[representative] == UINT_MAX) {
-                    assignedcluster[representative] = representative;
-                    std::queue<int> myqueue;
-                    myqueue.push(representative);
-                    std::queue<int> iterationcutoffs;
-                    iterationcutoffs.push(0);
-                    //delete clusters of members;
-                    while (!myqueue.empty()) {
-                        int currentid = myqueue.front();
-                        int iterationcutoff = iterationcutoffs.front();
-                        assignedcluster[currentid] = representative;
-                        myqueue.pop();
-                        iterationcutoffs.pop();
-                        size_t elementSize = (elementOffsets[currentid + 1] - elementOffsets[currentid]);
-                        for (size_t elementId = 0; elementId < elementSize; elementId++) {
-                            unsigned int elementtodelete = elementLookupTable[currentid][elementId];
-                            if (assignedcluster[elementtodelete] == UINT_MAX && iterationcutoff < maxiterations) {
-                                myqueue.push(elementtodelete);
-                                iterationcutoffs.push((iterationcutoff + 1));
-                            }
-                            assignedcluster[elementtodelete] = representative;
-                        }
-                    }
-
-                }
-            }
+        // adding the missing links at most doubles the number of links
+        if (2 * elementCount < UINT_MAX) {
+            clusterGraph<unsigned int>(mode, assignedcluster, elementCount);
+        } else {
+            clusterGraph<size_t>(mode, assignedcluster, elementCount);
         }
-        //delete unnecessary datastructures
-        delete [] sorted_clustersizes;
-        delete [] clusterid_to_arrayposition;
-        delete [] borders_of_set;
-
-
-        delete [] elementLookupTable;
-        delete [] elements;
-        delete [] elementOffsets;
-        delete [] scoreLookupTable;
-        delete [] score;
-        delete [] bestscore;
     }
 
 
@@ -201,8 +207,14 @@ void ClusteringAlgorithms::decreaseClustersize(unsigned int clusterid){
     clustersizes[clusterid]--;
 }
 
-void ClusteringAlgorithms::setCover(unsigned int **elementLookupTable, unsigned short ** elementScoreLookupTable,
-                                    unsigned int *assignedcluster, short *bestscore, size_t *newElementOffsets) {
+template <typename Offset>
+void ClusteringAlgorithms::setCover(unsigned int *elements, unsigned short *scores,
+                                    unsigned int *assignedcluster, short *bestscore, const Offset *newElementOffsets) {
+    // for large clusters the sets to decrease are collected in parallel,
+    // the bucket updates are applied serially in the original order
+    std::vector<size_t> decreaseOffsets;
+    std::vector<unsigned int> decreaseIds;
+    std::vector<char> representativeFound;
     for (int64_t cl_size = dbSize - 1; cl_size >= 0; cl_size--) {
         const unsigned int representative = sorted_clustersizes[cl_size];
         if (representative == UINT_MAX) {
@@ -212,11 +224,14 @@ void ClusteringAlgorithms::setCover(unsigned int **elementLookupTable, unsigned
         removeClustersize(representative);
         assignedcluster[representative] = representative;
         //delete clusters of members;
+        const unsigned int *representativeElements = elements + newElementOffsets[representative];
+        const unsigned short *representativeScores = scores + newElementOffsets[representative];
         size_t elementSize = (newElementOffsets[representative + 1] - newElementOffsets[representative]);
+        size_t linkCount = 0;
         for (size_t elementId = 0; elementId < elementSize; elementId++) {
-            const unsigned int elementtodelete = elementLookupTable[representative][elementId];
+            const unsigned int elementtodelete = representativeElements[elementId];
             // float seqId = elementScoreTable[representative][elementId];
-            const short seqId = elementScoreLookupTable[representative][elementId];
+            const short seqId = representativeScores[elementId];
             //  Debug(Debug::INFO)<<seqId<<"\t"<<bestscore[elementtodelete]<<"\n";
             // becareful of this criteria
             if (seqId > bestscore[elementtodelete]) {
@@ -227,15 +242,89 @@ void ClusteringAlgorithms::setCover(unsigned int **elementLookupTable, unsigned
             if (elementtodelete == representative) {
                 continue;
             }
+            linkCount += newElementOffsets[elementtodelete + 1] - newElementOffsets[elementtodelete];
             if (clustersizes[elementtodelete] < 1) {
                 continue;
             }
             removeClustersize(elementtodelete);
         }
 
+        if (threads > 1 && linkCount >= PARALLEL_SET_COVER_MIN_LINKS) {
+            // clustersizes do not change their sign until all members are processed,
+            // so the sets that will be decreased are known upfront
+            decreaseOffsets.resize(elementSize + 1);
+            representativeFound.resize(elementSize);
+#pragma omp parallel num_threads(threads)
+            {
+#pragma omp for schedule(dynamic, 16)
+                for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                    const unsigned int elementtodelete = representativeElements[elementId];
+                    size_t count = 0;
+                    if (elementtodelete != representative && clustersizes[elementtodelete] >= 0) {
+                        for (Offset pos = newElementOffsets[elementtodelete]; pos < newElementOffsets[elementtodelete + 1]; pos++) {
+                            count += (clustersizes[elements[pos]] > 0);
+                        }
+                    }
+                    decreaseOffsets[elementId + 1] = count;
+                }
+#pragma omp single
+                {
+                    decreaseOffsets[0] = 0;
+                    for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                        decreaseOffsets[elementId + 1] += decreaseOffsets[elementId];
+                    }
+                    decreaseIds.resize(decreaseOffsets[elementSize]);
+                }
+#pragma omp for schedule(dynamic, 16)
+                for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                    const unsigned int elementtodelete = representativeElements[elementId];
+                    bool found = false;
+                    if (elementtodelete != representative && clustersizes[elementtodelete] >= 0) {
+                        size_t writePos = decreaseOffsets[elementId];
+                        for (Offset pos = newElementOffsets[elementtodelete]; pos < newElementOffsets[elementtodelete + 1]; pos++) {
+                            const unsigned int elementtodecrease = elements[pos];
+                            found |= (elementtodecrease == representative);
+                            if (clustersizes[elementtodecrease] > 0) {
+                                decreaseIds[writePos++] = elementtodecrease;
+                            }
+                        }
+                    }
+                    representativeFound[elementId] = found;
+                }
+            }
+
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                const unsigned int elementtodelete = representativeElements[elementId];
+                if (elementtodelete == representative) {
+                    clustersizes[elementtodelete] = -1;
+                    continue;
+                }
+                if (clustersizes[elementtodelete] < 0) {
+                    continue;
+                }
+                clustersizes[elementtodelete] = -1;
+                for (size_t pos = decreaseOffsets[elementId]; pos < decreaseOffsets[elementId + 1]; pos++) {
+                    const unsigned int elementtodecrease = decreaseIds[pos];
+                    if (clustersizes[elementtodecrease] == 1) {
+                        Debug(Debug::ERROR) << "there must be an error: " << seqDbr->getDbKey(elementtodelete) <<
+                                            " deleted from " << seqDbr->getDbKey(elementtodecrease) <<
+                                            " that now is empty, but not assigned to a cluster\n";
+                    } else if (clustersizes[elementtodecrease] > 0) {
+                        decreaseClustersize(elementtodecrease);
+                    }
+                }
+                if (!representativeFound[elementId]) {
+                    Debug(Debug::ERROR) << "error with cluster:\t" << seqDbr->getDbKey(representative) <<
+                                        "\tis not contained in set:\t" << seqDbr->getDbKey(elementtodelete) << ".\n";
+                }
+            }
+            continue;
+        }
+
         for (size_t elementId = 0; elementId < elementSize; elementId++) {
             bool representativefound = false;
-            const unsigned int elementtodelete = elementLookupTable[representative][elementId];
+            const unsigned int elementtodelete = representativeElements[elementId];
+            const unsigned int *currElements = elements + newElementOffsets[elementtodelete];
             const unsigned int currElementSize = (newElementOffsets[elementtodelete + 1] -
                                                   newElementOffsets[elementtodelete]);
             if (elementtodelete == representative) {
@@ -248,7 +337,7 @@ void ClusteringAlgorithms::setCover(unsigned int **elementLookupTable, unsigned
             clustersizes[elementtodelete] = -1;
             //decrease clustersize of sets that contain the element
             for (size_t elementId2 = 0; elementId2 < currElementSize; elementId2++) {
-                const unsigned int elementtodecrease = elementLookupTable[elementtodelete][elementId2];
+                const unsigned int elementtodecrease = currElements[elementId2];
                 if (representative == elementtodecrease) {
                     representativefound = true;
                 }
@@ -295,6 +384,24 @@ void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluste
 
             const size_t alnId = alnDbr->getId(clusterKey);
             char *data = alnDbr->getData(alnId, thread_idx);
+            if (Matcher::isBinaryResult(data)) {
+                const Matcher::binary_header_t *header = Matcher::getBinaryHeader(data);
+                const Matcher::binary_result_t *records = Matcher::getBinaryResults(data);
+                for (unsigned int j = 0; j < header->count; j++) {
+                    unsigned int currElement = seqDbr->getId(records[j].dbKey);
+                    if (currElement == UINT_MAX || currElement > seqDbr->getSize()) {
+                        Debug(Debug::ERROR) << "Element " << records[j].dbKey
+                                            << " contained in some alignment list, but not contained in the sequence database!\n";
+                        EXIT(EXIT_FAILURE);
+                    }
+                    unsigned int targetId;
+                    __atomic_load(&assignedcluster[currElement], &targetId ,__ATOMIC_RELAXED);
+                    do {
+                        if (targetId <= clusterId) break;
+                    } while (!__atomic_compare_exchange(&assignedcluster[currElement],  &targetId,  &clusterId , false,  __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+                }
+                continue;
+            }
 
             while (*data != '\0') {
                 char dbKey[255 + 1];
@@ -331,9 +438,9 @@ void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluste
 
 }
 
-void ClusteringAlgorithms::readInClusterData(unsigned int **elementLookupTable, unsigned int *&elements,
-                                             unsigned short **scoreLookupTable, unsigned short *&scores,
-                                             size_t *elementOffsets, size_t totalElementCount) {
+template <typename Offset>
+void ClusteringAlgorithms::readInClusterData(unsigned int *&elements, unsigned short *&scores,
+                                             Offset *elementOffsets, size_t totalElementCount) {
     Timer timer;
 #pragma omp parallel
     {
@@ -347,26 +454,28 @@ void ClusteringAlgorithms::readInClusterData(unsigned int **elementLookupTable,
             const size_t alnId = alnDbr->getId(clusterId);
             const char *data = alnDbr->getData(alnId, thread_idx);
             const size_t dataSize = alnDbr->getEntryLen(alnId);
-            elementOffsets[i] = (*data == '\0') ? 1 : Util::countLines(data, dataSize);
+            elementOffsets[i] = (*data == '\0') ? 1 : Matcher::countAlignmentResults(data, dataSize);
         }
     }
 
     // make offset table
     AlignmentSymmetry::computeOffsetFromCounts(elementOffsets, dbSize);
-    // set element edge pointers by using the offset table
-    AlignmentSymmetry::setupPointers<unsigned int>(elements, elementLookupTable, elementOffsets, dbSize,
-                                                   totalElementCount);
+    if (totalElementCount < elementOffsets[dbSize]) {
+        Debug(Debug::ERROR) << "Error in readInClusterData. totalElementCount "
+                            << "(" << totalElementCount << ") < elementOffsets[" << dbSize << "] (" << elementOffsets[dbSize] << ")\n";
+        EXIT(EXIT_FAILURE);
+    }
     // fill elements
-    AlignmentSymmetry::readInData(alnDbr, seqDbr, elementLookupTable, NULL, 0, elementOffsets);
+    AlignmentSymmetry::readInData(alnDbr, seqDbr, elements, (unsigned short *) NULL, 0, elementOffsets, elementOffsets);
     Debug(Debug::INFO) << "Sort entries\n";
-    AlignmentSymmetry::sortElements(elementLookupTable, elementOffsets, dbSize);
+    AlignmentSymmetry::sortElements(elements, elementOffsets, dbSize);
     Debug(Debug::INFO) << "Find missing connections\n";
 
-    size_t *newElementOffsets = new size_t[dbSize + 1];
-    memcpy(newElementOffsets, elementOffsets, sizeof(size_t) * (dbSize + 1));
+    Offset *newElementOffsets = new Offset[dbSize + 1];
+    memcpy(newElementOffsets, elementOffsets, sizeof(Offset) * (dbSize + 1));
 
     // findMissingLinks detects new possible connections and updates the elementOffsets with new sizes
-    const size_t symmetricElementCount = AlignmentSymmetry::findMissingLinks(elementLookupTable,
+    const size_t symmetricElementCount = AlignmentSymmetry::findMissingLinks(elements,
                                                                              newElementOffsets, dbSize,
                                                                              threads);
     // resize elements
@@ -379,15 +488,13 @@ void ClusteringAlgorithms::readInClusterData(unsigned int **elementLookupTable,
     Util::checkAllocation(scores, "Can not allocate scores memory in readInClusterData");
     std::fill_n(scores, symmetricElementCount, 0);
     Debug(Debug::INFO) << "Found " << symmetricElementCount - totalElementCount << " new connections.\n";
-    AlignmentSymmetry::setupPointers<unsigned int>  (elements, elementLookupTable, newElementOffsets, dbSize, symmetricElementCount);
-    AlignmentSymmetry::setupPointers<unsigned short>(scores, scoreLookupTable, newElementOffsets, dbSize, symmetricElementCount);
     //time
     Debug(Debug::INFO) << "Reconstruct initial order\n";
     alnDbr->remapData(); // need to free memory
-    AlignmentSymmetry::readInData(alnDbr, seqDbr, elementLookupTable, scoreLookupTable, scoretype, elementOffsets);
+    AlignmentSymmetry::readInData(alnDbr, seqDbr, elements, scores, scoretype, newElementOffsets, elementOffsets);
     alnDbr->remapData(); // need to free memory
     Debug(Debug::INFO) << "Add missing connections\n";
-    AlignmentSymmetry::addMissingLinks(elementLookupTable, elementOffsets, newElementOffsets, dbSize, scoreLookupTable);
+    AlignmentSymmetry::addMissingLinks(elements, elementOffsets, newElementOffsets, dbSize, scores, threads);
     maxClustersize = 0;
     for (size_t i = 0; i < dbSize; i++) {
         size_t elementCount = newElementOffsets[i + 1] - newElementOffsets[i];
@@ -395,7 +502,7 @@ void ClusteringAlgorithms::readInClusterData(unsigned int **elementLookupTable,
         clustersizes[i] = elementCount;
     }
 
-    memcpy(elementOffsets, newElementOffsets, sizeof(size_t) * (dbSize + 1));
+    memcpy(elementOffsets, newElementOffsets, sizeof(Offset) * (dbSize + 1));
     delete[] newElementOffsets;
     Debug(Debug::INFO) << "\nTime for read in: " << timer.lap() << "\n";
 }
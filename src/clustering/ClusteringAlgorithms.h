@@ -44,8 +44,15 @@ private:
     int maxiterations;
 
 
-    void setCover(unsigned int **elementLookup, unsigned short ** elementScoreLookupTable,
-                  unsigned int *assignedcluster, short *bestscore, size_t *offsets);
+    // minimum number of links touched by a representative to collect its updates in parallel
+    static const size_t PARALLEL_SET_COVER_MIN_LINKS = 100000;
+
+    template <typename Offset>
+    void clusterGraph(int mode, unsigned int *assignedcluster, size_t elementCount);
+
+    template <typename Offset>
+    void setCover(unsigned int *elements, unsigned short *scores,
+                  unsigned int *assignedcluster, short *bestscore, const Offset *offsets);
 
     void greedyIncremental(unsigned int **elementLookupTable, size_t *elementOffsets,
                            size_t n, unsigned int *assignedcluster) ;
@@ -54,9 +61,9 @@ private:
     void greedyIncrementalLowMem(unsigned int *assignedcluster) ;
 
 
-    void readInClusterData(unsigned int **elementLookupTable, unsigned int *&elements,
-                           unsigned short **scoreLookupTable, unsigned short *&scores,
-                           size_t *elementOffsets, size_t totalElementCount)  ;
+    template <typename Offset>
+    void readInClusterData(unsigned int *&elements, unsigned short *&scores,
+                           Offset *elementOffsets, size_t totalElementCount);
 
 };
 
@@ -4,6 +4,7 @@
 #include "DistanceCalculator.h"
 #include "FileUtil.h"
 #include "Timer.h"
+#include "SimdDispatch.h"
 
 #include <iomanip>
 
@@ -47,6 +48,7 @@ void printUsage(bool showExtended) {
 
     usage << tool_introduction << "\n\n";
     usage << tool_name << " Version: " << version << "\n";
+    usage << "SIMD kernels: " << SimdDispatch::getKernels().name << "\n";
     usage << "© " << main_author << "\n\n";
     usage << "usage: " << binary_name << " <command> [<args>]" << "\n";
 
@@ -180,6 +182,7 @@ int shellcompletion(int argc, const char **argv) {
 }
 
 int main(int argc, const char **argv) {
+    SimdDispatch::checkCompiledArch();
     if (argc < 2) {
         printUsage(false);
         return EXIT_SUCCESS;
@@ -0,0 +1,103 @@
+#include "AsyncWriter.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+AsyncWriter::AsyncWriter(FILE **files, char **buffers, size_t bufferSize, unsigned int threads)
+        : files(files), slotSize(bufferSize / 2), states(threads), stopped(false) {
+    if (slotSize == 0) {
+        Debug(Debug::ERROR) << "Write buffer is too small for asynchronous writing\n";
+        EXIT(EXIT_FAILURE);
+    }
+    for (unsigned int i = 0; i < threads; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            states[i].slots[j].data = buffers[i] + j * slotSize;
+            states[i].slots[j].size = 0;
+            states[i].slots[j].pending = false;
+        }
+        states[i].active = 0;
+        states[i].blockedTime = 0.0;
+    }
+    worker = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+    if (worker.joinable()) {
+        finish();
+    }
+}
+
+void AsyncWriter::write(const void *data, size_t size, unsigned int thrIdx) {
+    ThreadState &state = states[thrIdx];
+    const char *in = static_cast<const char *>(data);
+    while (size > 0) {
+        Slot &slot = state.slots[state.active];
+        const size_t count = std::min(size, slotSize - slot.size);
+        memcpy(slot.data + slot.size, in, count);
+        slot.size += count;
+        in += count;
+        size -= count;
+        if (slot.size == slotSize) {
+            submit(thrIdx);
+        }
+    }
+}
+
+void AsyncWriter::submit(unsigned int thrIdx) {
+    ThreadState &state = states[thrIdx];
+    std::unique_lock<std::mutex> lock(mutex);
+    state.slots[state.active].pending = true;
+    queue.push_back(std::make_pair(thrIdx, state.active));
+    queueCondition.notify_one();
+    state.active ^= 1;
+    Slot &next = state.slots[state.active];
+    if (next.pending) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        slotCondition.wait(lock, [&next] { return next.pending == false; });
+        state.blockedTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void AsyncWriter::run() {
+    while (true) {
+        std::pair<unsigned int, int> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queueCondition.wait(lock, [this] { return stopped || queue.empty() == false; });
+            if (queue.empty()) {
+                return;
+            }
+            job = queue.front();
+            queue.pop_front();
+        }
+        // the owning thread does not touch a pending slot
+        Slot &slot = states[job.first].slots[job.second];
+        if (fwrite(slot.data, sizeof(char), slot.size, files[job.first]) != slot.size) {
+            Debug(Debug::ERROR) << "Can not write to data file in background writer\n";
+            EXIT(EXIT_FAILURE);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot.size = 0;
+            slot.pending = false;
+        }
+        slotCondition.notify_all();
+    }
+}
+
+void AsyncWriter::finish() {
+    for (unsigned int i = 0; i < states.size(); ++i) {
+        if (states[i].slots[states[i].active].size > 0) {
+            submit(i);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    queueCondition.notify_one();
+    worker.join();
+}
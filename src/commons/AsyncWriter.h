@@ -0,0 +1,62 @@
+#ifndef MMSEQS_ASYNCWRITER_H
+#define MMSEQS_ASYNCWRITER_H
+
+// Double buffered writing of the per-thread DBWriter data files. Each caller thread fills
+// one half of its buffer while a background thread writes the other half, so compute
+// threads only wait when the file system is slower than they produce output.
+// Writes of one caller thread reach its file in order.
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class AsyncWriter {
+public:
+    // buffers[i] of bufferSize bytes is split into the two halves used for files[i]
+    AsyncWriter(FILE **files, char **buffers, size_t bufferSize, unsigned int threads);
+    ~AsyncWriter();
+
+    void write(const void *data, size_t size, unsigned int thrIdx);
+
+    // writes all buffered data and stops the background thread
+    void finish();
+
+    // seconds caller thread thrIdx waited for the background thread
+    double getBlockedTime(unsigned int thrIdx) const {
+        return states[thrIdx].blockedTime;
+    }
+
+private:
+    struct Slot {
+        char *data;
+        size_t size;
+        bool pending;
+    };
+
+    struct ThreadState {
+        Slot slots[2];
+        int active;
+        double blockedTime;
+    };
+
+    void submit(unsigned int thrIdx);
+    void run();
+
+    FILE **files;
+    size_t slotSize;
+    std::vector<ThreadState> states;
+    // filled slots in submission order as (thread, slot)
+    std::deque<std::pair<unsigned int, int> > queue;
+    std::mutex mutex;
+    std::condition_variable queueCondition;
+    std::condition_variable slotCondition;
+    bool stopped;
+    std::thread worker;
+};
+
+#endif
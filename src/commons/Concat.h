@@ -14,6 +14,10 @@
 #include <algorithm>
 #include <fcntl.h>
 #include <limits.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "Debug.h"
 #include "Util.h"
@@ -124,6 +128,9 @@ public:
                 Debug(Debug::ERROR) << "Error with input descriptor\n";
                 EXIT(EXIT_FAILURE);
             }
+            if (copyFileRange(input_desc, output_desc, stat_buf.st_size)) {
+                continue;
+            }
 
             size_t insize = io_blksize(stat_buf);
             insize = std::max(insize, outsize);
@@ -144,6 +151,35 @@ public:
     }
 
 
+    // copies the input inside the kernel, which also reflinks on filesystems that support it
+    // returns false without copying anything if copy_file_range is not available for these files
+    static bool copyFileRange(int input_desc, int out_desc, size_t size) {
+#if defined(__linux__) && defined(SYS_copy_file_range)
+        size_t copied = 0;
+        while (copied < size) {
+            ssize_t result = syscall(SYS_copy_file_range, input_desc, NULL, out_desc, NULL, size - copied, 0);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (copied == 0 && (result == 0 || (result < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL
+                                                              || errno == EOPNOTSUPP || errno == EBADF)))) {
+                return false;
+            }
+            if (result <= 0) {
+                Debug(Debug::ERROR) << "copy_file_range error nr: " << errno << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            copied += result;
+        }
+        return true;
+#else
+        (void) input_desc;
+        (void) out_desc;
+        (void) size;
+        return false;
+#endif
+    }
+
     static bool doConcat(int input_desc, int out_desc, const char *buf, size_t bufsize) {
         while (true) {
             /* Read a block of input.  */
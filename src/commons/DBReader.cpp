@@ -10,6 +10,7 @@
 #include <sys/stat.h>
 
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "MemoryMapped.h"
 #include "Debug.h"
@@ -27,7 +28,8 @@ threads(threads), dataMode(dataMode), dataFileName(strdup(dataFileName_)),
         indexFileName(strdup(indexFileName_)), size(0), dataFiles(NULL), dataSizeOffset(NULL), dataFileCnt(0),
         totalDataSize(0), dataSize(0), lastKey(T()), closed(1), dbtype(Parameters::DBTYPE_GENERIC_DB),
         compressedBuffers(NULL), compressedBufferSizes(NULL), index(NULL), id2local(NULL), local2id(NULL),
-        dataMapped(false), accessType(0), externalData(false), didMlock(false)
+        dataMapped(false), accessType(0), externalData(false), didMlock(false),
+        mappedIndex(NULL), mappedIndexSize(0), ddict(NULL)
 {}
 
 template <typename T>
@@ -36,7 +38,8 @@ DBReader<T>::DBReader(DBReader<T>::Index *index, size_t size, size_t dataSize, T
         threads(threads), dataMode(USE_INDEX), dataFileName(NULL), indexFileName(NULL),
         size(size), dataFiles(NULL), dataSizeOffset(NULL), dataFileCnt(0), totalDataSize(0), dataSize(dataSize), lastKey(lastKey),
         maxSeqLen(maxSeqLen), closed(1), dbtype(dbType), compressedBuffers(NULL), compressedBufferSizes(NULL), index(index), sortedByOffset(true),
-        id2local(NULL), local2id(NULL), dataMapped(false), accessType(NOSORT), externalData(true), didMlock(false)
+        id2local(NULL), local2id(NULL), dataMapped(false), accessType(NOSORT), externalData(true), didMlock(false),
+        mappedIndex(NULL), mappedIndexSize(0), ddict(NULL)
 {}
 
 template <typename T>
@@ -157,21 +160,24 @@ template <typename T> bool DBReader<T>::open(int accessType){
     }
     bool isSortedById = false;
     if (externalData == false) {
-        MemoryMapped indexData(indexFileName, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
-        if (!indexData.isValid()){
-            Debug(Debug::ERROR) << "Cannot open index file " << indexFileName << "\n";
-            EXIT(EXIT_FAILURE);
-        }
-        char* indexDataChar = (char *) indexData.getData();
-        size_t indexDataSize = indexData.size();
-        size = Util::ompCountLines(indexDataChar, indexDataSize, threads);
+        bool isSortedById = false;
+        if (readBinaryIndex(&isSortedById) == false) {
+            MemoryMapped indexData(indexFileName, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+            if (!indexData.isValid()){
+                Debug(Debug::ERROR) << "Cannot open index file " << indexFileName << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            char* indexDataChar = (char *) indexData.getData();
+            size_t indexDataSize = indexData.size();
+            size = Util::ompCountLines(indexDataChar, indexDataSize, threads);
 
-        index = new(std::nothrow) Index[size];
-        Util::checkAllocation(index, "Cannot allocate index memory in DBReader");
-        incrementMemory(sizeof(Index) * size);
+            index = new(std::nothrow) Index[size];
+            Util::checkAllocation(index, "Cannot allocate index memory in DBReader");
+            incrementMemory(sizeof(Index) * size);
 
-        bool isSortedById = readIndex(indexDataChar, indexDataSize, index, dataSize);
-        indexData.close();
+            isSortedById = readIndex(indexDataChar, indexDataSize, index, dataSize);
+            indexData.close();
+        }
 
         // sortIndex also handles access modes that don't require sorting
         sortIndex(isSortedById);
@@ -204,6 +210,22 @@ template <typename T> bool DBReader<T>::open(int accessType){
                 EXIT(EXIT_FAILURE);
             }
         }
+        if (dataFileName != NULL) {
+            std::string dictFileName = std::string(dataFileName) + ".dict";
+            if (FileUtil::fileExists(dictFileName.c_str())) {
+                MemoryMapped dictData(dictFileName, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+                if (dictData.isValid() == false) {
+                    Debug(Debug::ERROR) << "Cannot open dictionary file " << dictFileName << "\n";
+                    EXIT(EXIT_FAILURE);
+                }
+                ddict = ZSTD_createDDict(dictData.getData(), dictData.size());
+                dictData.close();
+                if (ddict == NULL) {
+                    Debug(Debug::ERROR) << "ZSTD_createDDict() error for " << dictFileName << "\n";
+                    EXIT(EXIT_FAILURE);
+                }
+            }
+        }
     }
 
     closed = 0;
@@ -490,8 +512,16 @@ template <typename T> void DBReader<T>::close(){
         delete [] compressedBufferSizes;
         delete [] dstream;
     }
+    if (ddict != NULL) {
+        ZSTD_freeDDict(ddict);
+        ddict = NULL;
+    }
 
-    if(externalData == false) {
+    if (mappedIndex != NULL) {
+        munmap(mappedIndex, mappedIndexSize);
+        mappedIndex = NULL;
+        index = NULL;
+    } else if(externalData == false) {
         delete[] index;
         decrementMemory(size*sizeof(Index));
     }
@@ -514,7 +544,14 @@ template <typename T> char* DBReader<T>::getDataCompressed(size_t id, int thrIdx
     const void *cBuff = static_cast<void *>(data + sizeof(unsigned int));
     const char *dataStart = data + sizeof(unsigned int);
     bool isCompressed = (dataStart[cSize] == 0) ? true : false;
-    if(isCompressed){
+    if(isCompressed && ddict != NULL){
+        totalSize = ZSTD_decompress_usingDDict(dstream[thrIdx], compressedBuffers[thrIdx], compressedBufferSizes[thrIdx], cBuff, cSize, ddict);
+        if (ZSTD_isError(totalSize)) {
+            Debug(Debug::ERROR) << id << " ZSTD_decompress_usingDDict " << ZSTD_getErrorName(totalSize) << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        compressedBuffers[thrIdx][totalSize] = '\0';
+    }else if(isCompressed){
         ZSTD_inBuffer input = {cBuff, cSize, 0};
         while (input.pos < input.size) {
             ZSTD_outBuffer output = {compressedBuffers[thrIdx], compressedBufferSizes[thrIdx], 0};
@@ -853,6 +890,143 @@ unsigned int DBReader<unsigned int>::indexIdToNum(unsigned int * id) {
     return *id;
 }
 
+// a binary index starts with this header followed by the Index array in the order of the text index
+struct BinaryIndexHeader {
+    char magic[8];
+    uint64_t entries;
+    uint64_t dataSize;
+    // stat of the text index the binary index was created from
+    uint64_t indexFileSize;
+    uint64_t indexFileInode;
+    int64_t indexFileMtime;
+    int64_t indexFileMtimeNsec;
+    uint32_t lastKey;
+    uint32_t maxSeqLen;
+    uint32_t sortedById;
+    uint32_t entrySize;
+};
+
+static const char BINARY_INDEX_MAGIC[8] = { 'M', 'M', 'S', 'B', 'I', 'D', 'X', '1' };
+
+static void setBinaryIndexStamp(const struct stat &indexStat, BinaryIndexHeader &header) {
+    header.indexFileSize = indexStat.st_size;
+    header.indexFileInode = indexStat.st_ino;
+    header.indexFileMtime = indexStat.st_mtime;
+#ifdef __APPLE__
+    header.indexFileMtimeNsec = indexStat.st_mtimespec.tv_nsec;
+#else
+    header.indexFileMtimeNsec = indexStat.st_mtim.tv_nsec;
+#endif
+}
+
+template <typename T>
+bool DBReader<T>::readBinaryIndex(bool *) {
+    return false;
+}
+
+template<>
+bool DBReader<unsigned int>::readBinaryIndex(bool *isSortedById) {
+    std::string binaryIndexFileName = std::string(indexFileName) + ".bin";
+    struct stat indexStat;
+    if (stat(indexFileName, &indexStat) != 0) {
+        return false;
+    }
+    int fd = ::open(binaryIndexFileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat binaryStat;
+    if (fstat(fd, &binaryStat) != 0 || static_cast<size_t>(binaryStat.st_size) < sizeof(BinaryIndexHeader)) {
+        ::close(fd);
+        return false;
+    }
+    // private mapping, sortIndex may reorder the entries in place
+    void *mapped = mmap(NULL, binaryStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    const BinaryIndexHeader *header = static_cast<const BinaryIndexHeader *>(mapped);
+    BinaryIndexHeader expected;
+    setBinaryIndexStamp(indexStat, expected);
+    if (memcmp(header->magic, BINARY_INDEX_MAGIC, sizeof(BINARY_INDEX_MAGIC)) != 0
+        || header->entrySize != sizeof(Index)
+        || static_cast<size_t>(binaryStat.st_size) != sizeof(BinaryIndexHeader) + header->entries * sizeof(Index)) {
+        Debug(Debug::WARNING) << "Ignoring invalid binary index " << binaryIndexFileName << "\n";
+        munmap(mapped, binaryStat.st_size);
+        return false;
+    }
+    if (header->indexFileSize != expected.indexFileSize || header->indexFileInode != expected.indexFileInode
+        || header->indexFileMtime != expected.indexFileMtime || header->indexFileMtimeNsec != expected.indexFileMtimeNsec) {
+        Debug(Debug::WARNING) << "Ignoring outdated binary index " << binaryIndexFileName << "\n";
+        munmap(mapped, binaryStat.st_size);
+        return false;
+    }
+
+    size = header->entries;
+    dataSize = header->dataSize;
+    lastKey = header->lastKey;
+    maxSeqLen = header->maxSeqLen;
+    *isSortedById = header->sortedById != 0;
+    index = reinterpret_cast<Index *>(static_cast<char *>(mapped) + sizeof(BinaryIndexHeader));
+    mappedIndex = mapped;
+    mappedIndexSize = binaryStat.st_size;
+    return true;
+}
+
+template <typename T>
+void DBReader<T>::writeBinaryIndex(const std::string &, int) {
+    Debug(Debug::ERROR) << "Binary index is only supported for numeric keys\n";
+    EXIT(EXIT_FAILURE);
+}
+
+template<>
+void DBReader<unsigned int>::writeBinaryIndex(const std::string &indexFileName, int threads) {
+    std::string binaryIndexFileName = indexFileName + ".bin";
+    if (FileUtil::fileExists(binaryIndexFileName.c_str())) {
+        FileUtil::remove(binaryIndexFileName.c_str());
+    }
+    struct stat indexStat;
+    if (stat(indexFileName.c_str(), &indexStat) != 0) {
+        Debug(Debug::ERROR) << "Cannot open index file " << indexFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    // keep the order of the text index, open sorts the mapped entries the same way it sorts parsed ones
+    DBReader<unsigned int> reader(indexFileName.c_str(), indexFileName.c_str(), threads, USE_INDEX);
+    reader.open(HARDNOSORT);
+
+    BinaryIndexHeader header;
+    memset(&header, 0, sizeof(BinaryIndexHeader));
+    memcpy(header.magic, BINARY_INDEX_MAGIC, sizeof(BINARY_INDEX_MAGIC));
+    header.entries = reader.getSize();
+    header.dataSize = reader.getDataSize();
+    header.lastKey = reader.getLastKey();
+    header.maxSeqLen = reader.getMaxSeqLen();
+    header.sortedById = 1;
+    for (size_t i = 1; i < reader.getSize(); ++i) {
+        if (reader.index[i].id < reader.index[i - 1].id) {
+            header.sortedById = 0;
+            break;
+        }
+    }
+    header.entrySize = sizeof(Index);
+    setBinaryIndexStamp(indexStat, header);
+
+    FILE *file = FileUtil::openAndDelete(binaryIndexFileName.c_str(), "w");
+    if (fwrite(&header, sizeof(BinaryIndexHeader), 1, file) != 1
+        || fwrite(reader.index, sizeof(Index), reader.getSize(), file) != reader.getSize()) {
+        Debug(Debug::ERROR) << "Cannot write binary index " << binaryIndexFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fclose(file) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << binaryIndexFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    reader.close();
+}
+
 template <typename T> void DBReader<T>::unmapData() {
     if (dataMapped == true) {
         for(size_t fileIdx = 0; fileIdx < dataFileNames.size(); fileIdx++) {
@@ -938,14 +1112,22 @@ DBReader<unsigned int> *DBReader<unsigned int>::unserialize(const char* data, in
 
 template<typename T>
 void DBReader<T>::setData(char *data, size_t dataSize) {
+    setData(&data, &dataSize, 1);
+}
+
+template<typename T>
+void DBReader<T>::setData(char **data, size_t *dataSizes, size_t count) {
     if(dataFiles == NULL){
-        dataFiles = new char*[1];
-        dataSizeOffset = new size_t[2];
-        dataSizeOffset[0] = 0;
-        dataSizeOffset[1] = dataSize;
-        totalDataSize = dataSize;
-        dataFileCnt = 1;
-        dataFiles[0] = data;
+        dataFiles = new char*[count];
+        dataSizeOffset = new size_t[count + 1];
+        totalDataSize = 0;
+        for (size_t i = 0; i < count; i++) {
+            dataFiles[i] = data[i];
+            dataSizeOffset[i] = totalDataSize;
+            totalDataSize += dataSizes[i];
+        }
+        dataSizeOffset[count] = totalDataSize;
+        dataFileCnt = count;
     }else{
         Debug(Debug::ERROR) << "DataFiles is already set." << "\n";
         EXIT(EXIT_FAILURE);
@@ -1054,12 +1236,18 @@ void DBReader<T>::moveDb(const std::string &srcDbName, const std::string &dstDbN
     if (FileUtil::fileExists((srcDbName + ".index").c_str())) {
         FileUtil::move((srcDbName + ".index").c_str(), (dstDbName + ".index").c_str());
     }
+    if (FileUtil::fileExists((srcDbName + ".index.bin").c_str())) {
+        FileUtil::move((srcDbName + ".index.bin").c_str(), (dstDbName + ".index.bin").c_str());
+    }
     if (FileUtil::fileExists((srcDbName + ".dbtype").c_str())) {
         FileUtil::move((srcDbName + ".dbtype").c_str(), (dstDbName + ".dbtype").c_str());
     }
     if (FileUtil::fileExists((srcDbName + ".lookup").c_str())) {
         FileUtil::move((srcDbName + ".lookup").c_str(), (dstDbName + ".lookup").c_str());
     }
+    if (FileUtil::fileExists((srcDbName + ".dict").c_str())) {
+        FileUtil::move((srcDbName + ".dict").c_str(), (dstDbName + ".dict").c_str());
+    }
 }
 
 template<typename T>
@@ -1072,6 +1260,10 @@ void DBReader<T>::removeDb(const std::string &databaseName){
     if (FileUtil::fileExists(index.c_str())) {
         FileUtil::remove(index.c_str());
     }
+    std::string binaryIndex = databaseName + ".index.bin";
+    if (FileUtil::fileExists(binaryIndex.c_str())) {
+        FileUtil::remove(binaryIndex.c_str());
+    }
     std::string dbTypeFile = databaseName + ".dbtype";
     if (FileUtil::fileExists(dbTypeFile.c_str())) {
         FileUtil::remove(dbTypeFile.c_str());
@@ -1084,6 +1276,10 @@ void DBReader<T>::removeDb(const std::string &databaseName){
     if (FileUtil::fileExists(lookupFile.c_str())) {
         FileUtil::remove(lookupFile.c_str());
     }
+    std::string dictFile = databaseName + ".dict";
+    if (FileUtil::fileExists(dictFile.c_str())) {
+        FileUtil::remove(dictFile.c_str());
+    }
 }
 
 typedef void (*DbAction)(const std::string &, const std::string &);
@@ -1116,9 +1312,11 @@ void copyLinkDb(const std::string &databaseName, const std::string &outDb, DBFil
     const DBSuffix suffices[] = {
         { DBFiles::DATA_INDEX,    ".index"            },
         { DBFiles::DATA_DBTYPE,   ".dbtype"           },
+        { DBFiles::DATA_DBTYPE,   ".dict"             },
         { DBFiles::HEADER,        "_h"                },
         { DBFiles::HEADER_INDEX,  "_h.index"          },
         { DBFiles::HEADER_DBTYPE, "_h.dbtype"         },
+        { DBFiles::HEADER_DBTYPE, "_h.dict"           },
         { DBFiles::LOOKUP,        ".lookup"           },
         { DBFiles::SOURCE,        ".source"           },
         { DBFiles::TAX_MAPPING,   "_mapping"          },
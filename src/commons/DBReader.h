@@ -297,6 +297,9 @@ public:
 
     static void removeDb(const std::string &databaseName);
 
+    // writes <indexFileName>.bin, a binary copy of the index that open() maps instead of parsing the text index
+    static void writeBinaryIndex(const std::string &indexFileName, int threads);
+
 
     static void aliasDb(const std::string &databaseName, const std::string &alias, DBFiles::Files dbFilesFlags = DBFiles::ALL);
     static void softlinkDb(const std::string &databaseName, const std::string &outDb, DBFiles::Files dbFilesFlags = DBFiles::ALL);
@@ -306,6 +309,9 @@ public:
 
     bool readIndex(char *data, size_t indexDataSize, Index *index, size_t & dataSize);
 
+    // maps the binary index if it exists and matches the text index
+    bool readBinaryIndex(bool *isSortedById);
+
     void readLookup(char *data, size_t dataSize, LookupEntry *lookup);
 
     void readIndexId(T* id, char * line, const char** cols);
@@ -415,6 +421,9 @@ public:
 
     void setData(char *data, size_t dataSize);
 
+    // use count consecutive memory blocks as data, offsets continue across blocks like for multiple data files
+    void setData(char **data, size_t *dataSizes, size_t count);
+
     void setMode(const int mode);
 
     size_t getOffset(size_t id);
@@ -482,6 +491,13 @@ private:
 
     bool didMlock;
 
+    // mapping of the binary index, index points into it
+    void *mappedIndex;
+    size_t mappedIndexSize;
+
+    // dictionary from <data>.dict for databases written with --compressed 2
+    ZSTD_DDict * ddict;
+
     // needed to prevent the compiler from optimizing away the loop
     char magicBytes;
 
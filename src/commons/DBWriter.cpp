@@ -1,4 +1,5 @@
 #include "DBWriter.h"
+#include "AsyncWriter.h"
 #include "DBReader.h"
 #include "Debug.h"
 #include "Util.h"
@@ -11,6 +12,8 @@
 #define SIMDE_ENABLE_NATIVE_ALIASES
 #include <simde/simde-common.h>
 
+#include <zdict.h>
+
 #include <cstdlib>
 #include <cstdio>
 #include <sstream>
@@ -34,6 +37,8 @@ DBWriter::DBWriter(const char *dataFileName_, const char *indexFileName_, unsign
     indexFileNames = new char *[threads];
     compressedBuffers=NULL;
     compressedBufferSizes=NULL;
+    cdict = NULL;
+    asyncWriter = NULL;
     if((mode & Parameters::WRITER_COMPRESSED_MODE) != 0){
         compressedBuffers = new char*[threads];
         compressedBufferSizes = new size_t[threads];
@@ -149,8 +154,10 @@ void DBWriter::open(size_t bufferSize) {
         incrementMemory(bufferSize);
         this->bufferSize = bufferSize;
 
-        // set buffer to 64
-        if (setvbuf(dataFiles[i], dataFilesBuffer[i], _IOFBF, bufferSize) != 0) {
+        if (getenv("MMSEQS_ASYNC_WRITE") != NULL) {
+            // the buffer is handed to the background writer, which writes it in large blocks
+            setvbuf(dataFiles[i], NULL, _IONBF, 0);
+        } else if (setvbuf(dataFiles[i], dataFilesBuffer[i], _IOFBF, bufferSize) != 0) {
             Debug(Debug::WARNING) << "Write buffer could not be allocated (bufferSize=" << bufferSize << ")\n";
         }
 
@@ -186,6 +193,9 @@ void DBWriter::open(size_t bufferSize) {
             cstream[i] = ZSTD_createCStream();
         }
     }
+    if (getenv("MMSEQS_ASYNC_WRITE") != NULL) {
+        asyncWriter = new AsyncWriter(dataFiles, dataFilesBuffer, bufferSize, threads);
+    }
 
     closed = false;
 }
@@ -214,6 +224,16 @@ void DBWriter::writeDbtypeFile(const char* path, int dbtype, bool isCompressed)
 
 
 void DBWriter::close(bool merge, bool needsSort) {
+    if (asyncWriter != NULL) {
+        asyncWriter->finish();
+        std::ostringstream blocked;
+        for (unsigned int i = 0; i < threads; i++) {
+            blocked << " " << asyncWriter->getBlockedTime(i) << "s";
+        }
+        Debug(Debug::INFO) << "Time blocked on writing to " << FileUtil::baseName(dataFileName) << ":" << blocked.str() << "\n";
+        delete asyncWriter;
+        asyncWriter = NULL;
+    }
     // close all datafiles
     for (unsigned int i = 0; i < threads; i++) {
         if (fclose(dataFiles[i]) != 0) {
@@ -240,7 +260,31 @@ void DBWriter::close(bool merge, bool needsSort) {
     mergeResults(dataFileName, indexFileName, (const char **) dataFileNames, (const char **) indexFileNames,
                  threads, merge, ((mode & Parameters::WRITER_LEXICOGRAPHIC_MODE) != 0), needsSort);
 
-    writeDbtypeFile(dataFileName, dbtype, (mode & Parameters::WRITER_COMPRESSED_MODE) != 0);
+    if ((mode & Parameters::WRITER_COMPRESSED_DICT_MODE) != 0) {
+        // the plain entries are read back for compression, a stale dbtype must not mark them as compressed
+        std::string dbtypeFileName = std::string(dataFileName) + ".dbtype";
+        if (FileUtil::fileExists(dbtypeFileName.c_str())) {
+            FileUtil::remove(dbtypeFileName.c_str());
+        }
+        compressWithDictionary(merge);
+        writeDbtypeFile(dataFileName, dbtype, true);
+    } else {
+        writeDbtypeFile(dataFileName, dbtype, (mode & Parameters::WRITER_COMPRESSED_MODE) != 0);
+        std::string dictFileName = std::string(dataFileName) + ".dict";
+        if (FileUtil::fileExists(dictFileName.c_str())) {
+            FileUtil::remove(dictFileName.c_str());
+        }
+    }
+
+    // binary index sidecar that DBReader maps instead of parsing the text index
+    if (getenv("MMSEQS_BINARY_INDEX") != NULL) {
+        DBReader<unsigned int>::writeBinaryIndex(indexFileName, threads);
+    } else {
+        std::string binaryIndexFileName = std::string(indexFileName) + ".bin";
+        if (FileUtil::fileExists(binaryIndexFileName.c_str())) {
+            FileUtil::remove(binaryIndexFileName.c_str());
+        }
+    }
 
     for (unsigned int i = 0; i < threads; i++) {
         delete [] dataFilesBuffer[i];
@@ -251,6 +295,95 @@ void DBWriter::close(bool merge, bool needsSort) {
     closed = true;
 }
 
+void DBWriter::compressWithDictionary(bool merge) {
+    DBReader<unsigned int> reader(dataFileName, indexFileName, threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+    reader.open(DBReader<unsigned int>::NOSORT);
+
+    // zstd recommends about a hundred times the dictionary size as training data
+    const size_t maxDictSize = 112640;
+    const size_t maxSampleSize = 131072;
+    const size_t stride = std::max(reader.getDataSize() / (100 * maxDictSize), static_cast<size_t>(1));
+    std::string samples;
+    std::vector<size_t> sampleSizes;
+    for (size_t id = 0; id < reader.getSize(); id += stride) {
+        size_t length = std::min(std::max(reader.getEntryLen(id), static_cast<size_t>(1)) - 1, maxSampleSize);
+        if (length > 0) {
+            samples.append(reader.getData(id, 0), length);
+            sampleSizes.push_back(length);
+        }
+    }
+    const size_t dictCapacity = std::min(maxDictSize, samples.size() / 10);
+    std::vector<char> dictionary(std::max(dictCapacity, static_cast<size_t>(1)));
+    size_t dictSize = 0;
+    if (dictCapacity >= 1024) {
+        dictSize = ZDICT_trainFromBuffer(dictionary.data(), dictCapacity, samples.data(), sampleSizes.data(), sampleSizes.size());
+        if (ZDICT_isError(dictSize)) {
+            Debug(Debug::WARNING) << "Cannot train compression dictionary for " << dataFileName << ": " << ZDICT_getErrorName(dictSize) << "\n";
+            dictSize = 0;
+        }
+    }
+    samples.clear();
+    samples.shrink_to_fit();
+
+    std::string dictFileName = std::string(dataFileName) + ".dict";
+    ZSTD_CDict* dict = NULL;
+    if (dictSize > 0) {
+        dict = ZSTD_createCDict(dictionary.data(), dictSize, 3);
+        if (dict == NULL) {
+            Debug(Debug::ERROR) << "ZSTD_createCDict() error for " << dataFileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        FILE* dictFile = FileUtil::openAndDelete(dictFileName.c_str(), "wb");
+        if (fwrite(dictionary.data(), sizeof(char), dictSize, dictFile) != dictSize) {
+            Debug(Debug::ERROR) << "Cannot write to file " << dictFileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (fclose(dictFile) != 0) {
+            Debug(Debug::ERROR) << "Cannot close file " << dictFileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    } else {
+        Debug(Debug::WARNING) << "Compressing " << dataFileName << " without dictionary\n";
+        if (FileUtil::fileExists(dictFileName.c_str())) {
+            FileUtil::remove(dictFileName.c_str());
+        }
+    }
+
+    std::string tmpData = std::string(dataFileName) + "_dict";
+    std::string tmpIndex = tmpData + ".index";
+    DBWriter writer(tmpData.c_str(), tmpIndex.c_str(), threads, Parameters::WRITER_COMPRESSED_MODE, Parameters::DBTYPE_OMIT_FILE);
+    writer.cdict = dict;
+    writer.open();
+#pragma omp parallel num_threads(threads)
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+#pragma omp for schedule(static)
+        for (size_t id = 0; id < reader.getSize(); id++) {
+            size_t length = std::max(reader.getEntryLen(id), static_cast<size_t>(1)) - 1;
+            writer.writeData(reader.getData(id, thread_idx), length, reader.getDbKey(id), thread_idx);
+        }
+    }
+    writer.close(merge);
+    reader.close();
+    if (dict != NULL) {
+        ZSTD_freeCDict(dict);
+    }
+
+    std::vector<std::string> files = FileUtil::findDatafiles(dataFileName);
+    for (size_t i = 0; i < files.size(); ++i) {
+        FileUtil::remove(files[i].c_str());
+    }
+    DBReader<unsigned int>::moveDatafiles(FileUtil::findDatafiles(tmpData.c_str()), dataFileName);
+    FileUtil::move(tmpIndex.c_str(), indexFileName);
+    std::string tmpBinaryIndex = tmpIndex + ".bin";
+    if (FileUtil::fileExists(tmpBinaryIndex.c_str())) {
+        FileUtil::remove(tmpBinaryIndex.c_str());
+    }
+}
+
 void DBWriter::writeStart(unsigned int thrIdx) {
     checkClosed();
     if (thrIdx >= threads) {
@@ -262,7 +395,14 @@ void DBWriter::writeStart(unsigned int thrIdx) {
         state[thrIdx] = INIT_STATE;
         threadBufferOffset[thrIdx]=0;
         int cLevel = 3;
-        size_t const initResult = ZSTD_initCStream(cstream[thrIdx], cLevel);
+        size_t initResult;
+        if (cdict != NULL) {
+            // the reader always knows the dictionary, so do not store its id in every entry
+            ZSTD_frameParameters frameParams = { 0, 0, 1 };
+            initResult = ZSTD_initCStream_usingCDict_advanced(cstream[thrIdx], cdict, frameParams, ZSTD_CONTENTSIZE_UNKNOWN);
+        } else {
+            initResult = ZSTD_initCStream(cstream[thrIdx], cLevel);
+        }
         if (ZSTD_isError(initResult)) {
             Debug(Debug::ERROR) << "ZSTD_initCStream() error in thread " << thrIdx << ". Error "
                                 << ZSTD_getErrorName(initResult) << "\n";
@@ -278,7 +418,8 @@ size_t DBWriter::writeAdd(const char* data, size_t dataSize, unsigned int thrIdx
         EXIT(EXIT_FAILURE);
     }
     bool isCompressedDB = (mode & Parameters::WRITER_COMPRESSED_MODE) != 0;
-    if(isCompressedDB && state[thrIdx] == INIT_STATE && dataSize < 60){
+    // with a dictionary even short entries compress well
+    if(isCompressedDB && state[thrIdx] == INIT_STATE && dataSize < (cdict != NULL ? 16 : 60)){
         state[thrIdx] = NOTCOMPRESSED;
     }
     size_t totalWriten = 0;
@@ -307,7 +448,7 @@ size_t DBWriter::writeAdd(const char* data, size_t dataSize, unsigned int thrIdx
         if(isCompressedDB){
             written = addToThreadBuffer(data, sizeof(char), dataSize,  thrIdx);
         }else{
-            written = fwrite(data, sizeof(char), dataSize, dataFiles[thrIdx]);
+            written = writeToDataFile(data, dataSize, thrIdx);
         }
         if (written != dataSize) {
             Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
@@ -349,8 +490,8 @@ void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte,
             compressedLength = offsets[thrIdx] - starts[thrIdx];
         }
         unsigned int compressedLengthInt = static_cast<unsigned int>(compressedLength);
-        size_t written2 = fwrite(&compressedLengthInt, sizeof(unsigned int), 1, dataFiles[thrIdx]);
-        if (written2 != 1) {
+        size_t written2 = writeToDataFile(&compressedLengthInt, sizeof(unsigned int), thrIdx);
+        if (written2 != sizeof(unsigned int)) {
             Debug(Debug::ERROR) << "Can not write entry length to data file " << dataFileNames[thrIdx] << "\n";
             EXIT(EXIT_FAILURE);
         }
@@ -366,7 +507,7 @@ void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte,
         if(isCompressedDB && state[thrIdx]==NOTCOMPRESSED){
             nullByte = static_cast<char>(0xFF);
         }
-        const size_t written = fwrite(&nullByte, sizeof(char), 1, dataFiles[thrIdx]);
+        const size_t written = writeToDataFile(&nullByte, sizeof(char), thrIdx);
         if (written != 1) {
             Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
             EXIT(EXIT_FAILURE);
@@ -424,7 +565,7 @@ void DBWriter::alignToPageSize(int thrIdx) {
     size_t newOffset = ((pageSize - 1) & currentOffset) ? ((currentOffset + pageSize) & ~(pageSize - 1)) : currentOffset;
     char nullByte = '\0';
     for (size_t i = currentOffset; i < newOffset; ++i) {
-        size_t written = fwrite(&nullByte, sizeof(char), 1, dataFiles[thrIdx]);
+        size_t written = writeToDataFile(&nullByte, sizeof(char), thrIdx);
         if (written != 1) {
             Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
             EXIT(EXIT_FAILURE);
@@ -554,9 +695,22 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
             mergedSizes.push_back(cumulativeSize);
         }
 
+        // the first thread's data file becomes the merged file, so only the others are copied
+        const bool reuseFirstFile = mergeDatafiles && dataFilenames[0].size() == 1;
         if (mergeDatafiles) {
-            FILE *outFh = FileUtil::openAndDelete(outFileName, "w");
-            Concat::concatFiles(datafiles, outFh);
+            FILE *outFh;
+            if (reuseFirstFile) {
+                FileUtil::move(dataFilenames[0][0].c_str(), outFileName);
+                outFh = fopen(outFileName, "r+");
+                if (outFh == NULL || fseek(outFh, 0, SEEK_END) != 0) {
+                    Debug(Debug::ERROR) << "Cannot open data file " << outFileName << "\n";
+                    EXIT(EXIT_FAILURE);
+                }
+            } else {
+                outFh = FileUtil::openAndDelete(outFileName, "w");
+            }
+            std::vector<FILE*> appendFiles(datafiles.begin() + (reuseFirstFile ? 1 : 0), datafiles.end());
+            Concat::concatFiles(appendFiles, outFh);
             if (fclose(outFh) != 0) {
                 Debug(Debug::ERROR) << "Cannot close data file " << outFileName << "\n";
                 EXIT(EXIT_FAILURE);
@@ -573,7 +727,7 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
         if (mergeDatafiles) {
             for (unsigned int i = 0; i < dataFilenames.size(); i++) {
                 std::vector<std::string>& filenames = dataFilenames[i];
-                for (size_t j = 0; j < filenames.size(); ++j) {
+                for (size_t j = (i == 0 && reuseFirstFile) ? 1 : 0; j < filenames.size(); ++j) {
                     FileUtil::remove(filenames[j].c_str());
                 }
             }
@@ -670,8 +824,16 @@ void DBWriter::sortIndex(const char *inFileNameIndex, const char *outFileNameInd
     }
 }
 
+size_t DBWriter::writeToDataFile(const void *data, size_t dataSize, unsigned int thrIdx) {
+    if (asyncWriter != NULL) {
+        asyncWriter->write(data, dataSize, thrIdx);
+        return dataSize;
+    }
+    return fwrite(data, sizeof(char), dataSize, dataFiles[thrIdx]);
+}
+
 void DBWriter::writeThreadBuffer(unsigned int idx, size_t dataSize) {
-    size_t written = fwrite(threadBuffer[idx], 1, dataSize, dataFiles[idx]);
+    size_t written = writeToDataFile(threadBuffer[idx], dataSize, idx);
     if (written != dataSize) {
         Debug(Debug::ERROR) << "writeThreadBuffer: Could not write to data file " << dataFileNames[idx] << "\n";
         EXIT(EXIT_FAILURE);
@@ -10,6 +10,7 @@
 #include "MemoryTracker.h"
 
 template <typename T> class DBReader;
+class AsyncWriter;
 
 class DBWriter : public MemoryTracker  {
 public:
@@ -67,6 +68,7 @@ public:
 private:
     size_t addToThreadBuffer(const void *data, size_t itmesize, size_t nitems, int threadIdx);
     void writeThreadBuffer(unsigned int idx, size_t dataSize);
+    size_t writeToDataFile(const void *data, size_t dataSize, unsigned int thrIdx);
 
     void checkClosed();
 
@@ -79,6 +81,9 @@ private:
 
     static void sortIndex(const char *inFileNameIndex, const char *outFileNameIndex, const bool lexicographicOrder);
 
+    // trains a dictionary on the merged plain output and rewrites it compressed with that dictionary
+    void compressWithDictionary(bool merge);
+
     char* dataFileName;
     char* indexFileName;
 
@@ -102,6 +107,10 @@ private:
     static const int NOTCOMPRESSED=1;
     static const int COMPRESSED=2;
     ZSTD_CStream** cstream;
+    // shared dictionary used by all compression streams, owned by the writer that trained it
+    ZSTD_CDict* cdict;
+    // background writing of the data files, enabled with MMSEQS_ASYNC_WRITE
+    AsyncWriter* asyncWriter;
 
     const unsigned int threads;
     const size_t mode;
@@ -0,0 +1,195 @@
+#include "HugePages.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+
+#define HUGE_PAGE_2M (2UL * 1024 * 1024)
+#define HUGE_PAGE_1G (1024UL * 1024 * 1024)
+// from linux/mman.h
+#define MMSEQS_MAP_HUGE_SHIFT 26
+
+int HugePages::mode = HugePages::MODE_NONE;
+
+struct HugePageRegion {
+    void *base;
+    size_t mappedBytes;
+    size_t requestedBytes;
+};
+
+// regions returned by allocate that are backed by their own mapping, keyed by the returned pointer
+static std::map<const void *, HugePageRegion> regions;
+static bool hugetlbWarned = false;
+
+void HugePages::setMode(int mode) {
+    HugePages::mode = mode;
+}
+
+static inline size_t roundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void *mapTransparent(size_t size, HugePageRegion &region) {
+#ifdef MADV_HUGEPAGE
+    // over-allocate so that the returned memory starts at a huge page boundary
+    region.mappedBytes = size + HUGE_PAGE_2M;
+    region.base = mmap(NULL, region.mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region.base == MAP_FAILED) {
+        return NULL;
+    }
+    char *aligned = reinterpret_cast<char *>(roundUp(reinterpret_cast<size_t>(region.base), HUGE_PAGE_2M));
+    if (madvise(aligned, roundUp(size, HUGE_PAGE_2M), MADV_HUGEPAGE) != 0) {
+        Debug(Debug::WARNING) << "Transparent huge pages are not available\n";
+    }
+    return aligned;
+#else
+    (void) size;
+    (void) region;
+    return NULL;
+#endif
+}
+
+static void *mapHugetlb(size_t size, size_t pageSize, int pageShift, HugePageRegion &region) {
+#ifdef MAP_HUGETLB
+    region.mappedBytes = roundUp(size, pageSize);
+    region.base = mmap(NULL, region.mappedBytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (pageShift << MMSEQS_MAP_HUGE_SHIFT), -1, 0);
+    if (region.base == MAP_FAILED) {
+        return NULL;
+    }
+    return region.base;
+#else
+    (void) size;
+    (void) pageSize;
+    (void) pageShift;
+    (void) region;
+    return NULL;
+#endif
+}
+
+void *HugePages::allocate(size_t size) {
+    void *ptr = NULL;
+    HugePageRegion region;
+    region.requestedBytes = size;
+    if (mode != MODE_NONE && size >= HUGE_PAGE_2M) {
+        if (mode == MODE_HUGETLB_2M) {
+            ptr = mapHugetlb(size, HUGE_PAGE_2M, 21, region);
+        } else if (mode == MODE_HUGETLB_1G) {
+            ptr = mapHugetlb(size, HUGE_PAGE_1G, 30, region);
+        }
+        if (ptr == NULL && mode != MODE_TRANSPARENT) {
+#pragma omp critical (HugePages)
+            {
+                if (hugetlbWarned == false) {
+                    Debug(Debug::WARNING) << "Could not reserve " << size << " bytes of hugetlb pages. Using transparent huge pages instead\n";
+                    hugetlbWarned = true;
+                }
+            }
+        }
+        if (ptr == NULL) {
+            ptr = mapTransparent(size, region);
+        }
+    }
+    if (ptr == NULL) {
+        ptr = calloc(std::max(size, static_cast<size_t>(1)), 1);
+        Util::checkAllocation(ptr, "Can not allocate " + SSTR(size) + " bytes in HugePages::allocate");
+        return ptr;
+    }
+#pragma omp critical (HugePages)
+    regions[ptr] = region;
+    return ptr;
+}
+
+void HugePages::release(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    bool mapped = false;
+    HugePageRegion region;
+#pragma omp critical (HugePages)
+    {
+        std::map<const void *, HugePageRegion>::iterator it = regions.find(ptr);
+        if (it != regions.end()) {
+            mapped = true;
+            region = it->second;
+            regions.erase(it);
+        }
+    }
+    if (mapped) {
+        munmap(region.base, region.mappedBytes);
+    } else {
+        free(ptr);
+    }
+}
+
+size_t HugePages::countHugePages(size_t *requestedBytes) {
+    std::vector<std::pair<size_t, size_t> > ranges;
+    *requestedBytes = 0;
+#pragma omp critical (HugePages)
+    {
+        for (std::map<const void *, HugePageRegion>::const_iterator it = regions.begin(); it != regions.end(); ++it) {
+            const size_t start = reinterpret_cast<size_t>(it->first);
+            ranges.push_back(std::make_pair(start, start + it->second.requestedBytes));
+            *requestedBytes += it->second.requestedBytes;
+        }
+    }
+    if (ranges.empty()) {
+        return 0;
+    }
+
+    // every mapping in smaps starts with its address range followed by its counters in kB
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    size_t pages = 0;
+    bool overlaps = false;
+    size_t kernelPageSize = 4;
+    size_t anonHuge = 0;
+    size_t hugetlb = 0;
+    while (true) {
+        const bool good = static_cast<bool>(std::getline(smaps, line));
+        const bool header = good && line.empty() == false && isxdigit(line[0]) && (line[0] < 'A' || line[0] > 'F');
+        if (good == false || header) {
+            if (overlaps) {
+                pages += (kernelPageSize > 4) ? hugetlb / kernelPageSize : anonHuge / (HUGE_PAGE_2M / 1024);
+            }
+            if (good == false) {
+                break;
+            }
+            const size_t dash = line.find('-');
+            const size_t from = strtoull(line.c_str(), NULL, 16);
+            const size_t to = strtoull(line.c_str() + dash + 1, NULL, 16);
+            overlaps = false;
+            for (size_t i = 0; i < ranges.size() && overlaps == false; i++) {
+                overlaps = from < ranges[i].second && ranges[i].first < to;
+            }
+            kernelPageSize = 4;
+            anonHuge = 0;
+            hugetlb = 0;
+            continue;
+        }
+        if (overlaps == false) {
+            continue;
+        }
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        const size_t value = strtoull(line.c_str() + colon + 1, NULL, 10);
+        if (line.compare(0, colon, "KernelPageSize") == 0) {
+            kernelPageSize = value;
+        } else if (line.compare(0, colon, "AnonHugePages") == 0) {
+            anonHuge = value;
+        } else if (line.compare(0, colon, "Private_Hugetlb") == 0 || line.compare(0, colon, "Shared_Hugetlb") == 0) {
+            hugetlb += value;
+        }
+    }
+    return pages;
+}
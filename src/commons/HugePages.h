@@ -0,0 +1,38 @@
+#ifndef MMSEQS_HUGEPAGES_H
+#define MMSEQS_HUGEPAGES_H
+
+// Allocator for large randomly accessed arrays such as the prefilter index and the
+// diagonal buffers, which otherwise spend a lot of time in TLB misses with 4 KB pages.
+// The process wide mode selects whether allocations are backed by transparent huge pages
+// or by pages from the hugetlb pool. Allocations smaller than a huge page and all
+// allocations in MODE_NONE fall back to calloc. Memory is always returned zeroed.
+
+#include <cstddef>
+
+class HugePages {
+public:
+    static const int MODE_NONE = 0;
+    static const int MODE_TRANSPARENT = 1;
+    static const int MODE_HUGETLB_2M = 2;
+    static const int MODE_HUGETLB_1G = 3;
+
+    static void setMode(int mode);
+
+    static int getMode() {
+        return mode;
+    }
+
+    static void *allocate(size_t size);
+
+    // releases memory returned by allocate, NULL is ignored
+    static void release(void *ptr);
+
+    // number of huge pages that currently back memory returned by allocate,
+    // requestedBytes receives the size of all allocations that asked for huge pages
+    static size_t countHugePages(size_t *requestedBytes);
+
+private:
+    static int mode;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "NumaUtil.h"
+#include "Util.h"
+#include "Debug.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#ifdef HAVE_NUMA
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// from linux/mempolicy.h
+#define MMSEQS_MPOL_INTERLEAVE 3
+#define MMSEQS_MPOL_MF_MOVE (1 << 1)
+#endif
+
+// parses the kernel cpu/node list format, e.g. "0-3,8,10-11"
+static std::vector<int> parseList(const std::string &list) {
+    std::vector<int> values;
+    std::vector<std::string> ranges = Util::split(list, ",");
+    for (size_t i = 0; i < ranges.size(); i++) {
+        std::vector<std::string> range = Util::split(ranges[i], "-");
+        if (range.empty() || range[0].empty()) {
+            continue;
+        }
+        int from = Util::fast_atoi<int>(range[0].c_str());
+        int to = range.size() > 1 ? Util::fast_atoi<int>(range[1].c_str()) : from;
+        for (int value = from; value <= to; value++) {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+static std::string readLine(const std::string &file) {
+    std::ifstream in(file.c_str());
+    std::string line;
+    if (in.good()) {
+        std::getline(in, line);
+    }
+    return line;
+}
+
+std::vector<int> NumaUtil::getNodes() {
+    std::vector<int> nodes;
+#ifdef HAVE_NUMA
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0) {
+        std::vector<int> memoryNodes = parseList(readLine("/sys/devices/system/node/has_memory"));
+        for (size_t i = 0; i < memoryNodes.size(); i++) {
+            std::vector<int> cpus = getNodeCpus(memoryNodes[i]);
+            for (size_t j = 0; j < cpus.size(); j++) {
+                if (cpus[j] < CPU_SETSIZE && CPU_ISSET(cpus[j], &allowed)) {
+                    nodes.push_back(memoryNodes[i]);
+                    break;
+                }
+            }
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        nodes.push_back(0);
+    }
+    return nodes;
+}
+
+std::vector<int> NumaUtil::getNodeCpus(int node) {
+    return parseList(readLine("/sys/devices/system/node/node" + SSTR(node) + "/cpulist"));
+}
+
+bool NumaUtil::interleave(const void *addr, size_t size, const std::vector<int> &nodes) {
+#ifdef HAVE_NUMA
+    if (nodes.size() < 2 || size == 0) {
+        return false;
+    }
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t start = reinterpret_cast<size_t>(addr) & ~(pageSize - 1);
+    const size_t end = (reinterpret_cast<size_t>(addr) + size + pageSize - 1) & ~(pageSize - 1);
+    const size_t bitsPerWord = sizeof(unsigned long) * 8;
+    const size_t maxNode = static_cast<size_t>(*std::max_element(nodes.begin(), nodes.end()));
+    std::vector<unsigned long> nodeMask(maxNode / bitsPerWord + 1, 0);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodeMask[nodes[i] / bitsPerWord] |= 1UL << (nodes[i] % bitsPerWord);
+    }
+    long ret = syscall(SYS_mbind, start, end - start, MMSEQS_MPOL_INTERLEAVE, nodeMask.data(),
+                       nodeMask.size() * bitsPerWord, MMSEQS_MPOL_MF_MOVE);
+    if (ret != 0) {
+        Debug(Debug::WARNING) << "Could not interleave " << (end - start) << " bytes over " << nodes.size() << " NUMA nodes\n";
+        return false;
+    }
+    return true;
+#else
+    (void) addr;
+    (void) size;
+    (void) nodes;
+    return false;
+#endif
+}
+
+bool NumaUtil::pinThreadToNode(int node, std::vector<int> &previousCpus) {
+    previousCpus.clear();
+#ifdef HAVE_NUMA
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0) {
+        return false;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            previousCpus.push_back(cpu);
+        }
+    }
+    std::vector<int> cpus = getNodeCpus(node);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    size_t count = 0;
+    for (size_t i = 0; i < cpus.size(); i++) {
+        if (cpus[i] < CPU_SETSIZE && CPU_ISSET(cpus[i], &allowed)) {
+            CPU_SET(cpus[i], &set);
+            count++;
+        }
+    }
+    if (count == 0) {
+        return false;
+    }
+    return sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0;
+#else
+    (void) node;
+    return false;
+#endif
+}
+
+void NumaUtil::setThreadCpus(const std::vector<int> &cpus) {
+#ifdef HAVE_NUMA
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus.size(); i++) {
+        CPU_SET(cpus[i], &set);
+    }
+    sched_setaffinity(0, sizeof(cpu_set_t), &set);
+#else
+    (void) cpus;
+#endif
+}
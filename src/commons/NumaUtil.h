@@ -0,0 +1,37 @@
+#ifndef MMSEQS_NUMAUTIL_H
+#define MMSEQS_NUMAUTIL_H
+
+// Minimal NUMA support for large read-mostly structures such as the prefilter index.
+// Uses the mbind and sched_setaffinity system calls directly so that no libnuma is
+// needed. Without HAVE_NUMA all functions behave as on a single node machine.
+
+#include <cstddef>
+#include <vector>
+
+class NumaUtil {
+public:
+    // memory nodes that hold at least one cpu the calling thread may run on,
+    // a single node 0 if NUMA is not supported
+    static std::vector<int> getNodes();
+
+    // cpus belonging to a node
+    static std::vector<int> getNodeCpus(int node);
+
+    // node of the idx-th of count threads, threads are spread in contiguous blocks over the nodes
+    static int getThreadNode(int idx, int count, int nodes) {
+        return static_cast<int>((static_cast<size_t>(idx) * nodes) / count);
+    }
+
+    // spread the pages of [addr, addr + size) round-robin over nodes,
+    // pages that are already present are migrated
+    static bool interleave(const void *addr, size_t size, const std::vector<int> &nodes);
+
+    // restricts the calling thread to those of its allowed cpus that belong to node,
+    // the previously allowed cpus are returned in previousCpus
+    static bool pinThreadToNode(int node, std::vector<int> &previousCpus);
+
+    // restores the cpus returned by pinThreadToNode
+    static void setThreadCpus(const std::vector<int> &cpus);
+};
+
+#endif
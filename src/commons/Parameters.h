@@ -86,6 +86,8 @@ public:
     static const unsigned int DBTYPE_EXTENDED_COMPRESSED = 1;
     static const unsigned int DBTYPE_EXTENDED_INDEX_NEED_SRC = 2;
     static const unsigned int DBTYPE_EXTENDED_CONTEXT_PSEUDO_COUNTS = 4;
+    // entries contain fixed-width binary records instead of text lines
+    static const unsigned int DBTYPE_EXTENDED_BINARY = 8;
 
     // don't forget to add new database types to DBReader::getDbTypeName and Parameters::PARAM_OUTPUT_DBTYPE
 
@@ -112,6 +114,10 @@ public:
 
     static const unsigned int ALIGNMENT_OUTPUT_ALIGNMENT = 0;
     static const unsigned int ALIGNMENT_OUTPUT_CLUSTER = 1;
+    static const unsigned int ALIGNMENT_OUTPUT_BINARY = 2;
+
+    static const unsigned int PREFILTER_OUTPUT_TEXT = 0;
+    static const unsigned int PREFILTER_OUTPUT_BINARY = 1;
 
     static const unsigned int EXPAND_TRANSFER_EVALUE = 0;
     static const unsigned int EXPAND_RESCORE_BACKTRACE = 1;
@@ -122,7 +128,9 @@ public:
 
     static const unsigned int WRITER_ASCII_MODE = 0;
     static const unsigned int WRITER_COMPRESSED_MODE = 1;
-    static const unsigned int WRITER_LEXICOGRAPHIC_MODE = 2;
+    // zstd with a dictionary trained on the written entries, stored in <db>.dict
+    static const unsigned int WRITER_COMPRESSED_DICT_MODE = 2;
+    static const unsigned int WRITER_LEXICOGRAPHIC_MODE = 4;
 
     // convertalis alignment
     static const int FORMAT_ALIGNMENT_BLAST_TAB = 0;
@@ -226,6 +234,11 @@ public:
     static const int PRELOAD_MODE_MMAP = 2;
     static const int PRELOAD_MODE_MMAP_TOUCH = 3;
 
+    // numa mode
+    static const int NUMA_MODE_NONE = 0;
+    static const int NUMA_MODE_INTERLEAVE = 1;
+    static const int NUMA_MODE_REPLICATE = 2;
+
     static std::string getSplitModeName(int splitMode) {
         switch (splitMode) {
             case 0: return "Target";
@@ -299,6 +312,10 @@ public:
     static const int PARAM_RESULT_DIRECTION_QUERY  = 0;
     static const int PARAM_RESULT_DIRECTION_TARGET = 1;
 
+    // k-mer sort mode
+    static const int KMER_SORT_COMPARISON = 0;
+    static const int KMER_SORT_RADIX      = 1;
+
     // path to databases
     std::string db1;
     std::string db1Index;
@@ -385,6 +402,11 @@ public:
     int    split;                        // Split database in n equal chunks
     int    splitMode;                    // Split by query or target DB
     size_t splitMemoryLimit;             // Maximum memory in bytes a split can use
+    bool   compactIndex;                 // Delta encode the k-mer index entries
+    int    queryBatchSize;               // Queries whose index lookups are gathered together
+    size_t kmerListCacheSize;            // Memory in bytes for caching similar k-mer lists
+    int    numaMode;                     // Placement of the index on NUMA nodes
+    int    hugePages;                    // Back the index and diagonal buffers with huge pages
     size_t diskSpaceLimit;               // Maximum disk space in bytes for sliced reverse profile search
     bool   splitAA;                      // Split database by amino acid count instead
     int    preloadMode;                  // Preload mode of database
@@ -393,6 +415,7 @@ public:
     int    realignMaxSeqs;               // Max alignments to realign
     std::string spacedKmerPattern;       // User-specified kmer pattern
     std::string localTmp;                // Local temporary path
+    int    prefilterOutputMode;          // prefilter output mode 0=text, 1=binary
 
     // ALIGNMENT
     int alignmentMode;                   // alignment mode 0=fastest on parameters,
@@ -437,6 +460,7 @@ public:
     float orfFilterSens;
     double orfFilterEval;
     bool lcaSearch;
+    bool fusedAlign;
 
     // easysearch
     bool greedyBestHits;
@@ -520,6 +544,7 @@ public:
     int pickNbest;
     int adjustKmerLength;
     int resultDirection;
+    int kmerSortMode;
 
     // indexdb
     int checkCompatible;
@@ -707,6 +732,11 @@ public:
     PARAMETER(PARAM_SPLIT)
     PARAMETER(PARAM_SPLIT_MODE)
     PARAMETER(PARAM_SPLIT_MEMORY_LIMIT)
+    PARAMETER(PARAM_COMPACT_INDEX)
+    PARAMETER(PARAM_QUERY_BATCH_SIZE)
+    PARAMETER(PARAM_KMER_LIST_CACHE)
+    PARAMETER(PARAM_NUMA_MODE)
+    PARAMETER(PARAM_HUGE_PAGES)
     PARAMETER(PARAM_DISK_SPACE_LIMIT)
     PARAMETER(PARAM_SPLIT_AMINOACID)
     PARAMETER(PARAM_SUB_MAT)
@@ -718,6 +748,7 @@ public:
     PARAMETER(PARAM_PRELOAD_MODE)
     PARAMETER(PARAM_SPACED_KMER_PATTERN)
     PARAMETER(PARAM_LOCAL_TMP)
+    PARAMETER(PARAM_PREFILTER_OUTPUT_MODE)
     std::vector<MMseqsParameter*> prefilter;
     std::vector<MMseqsParameter*> ungappedprefilter;
 
@@ -819,6 +850,7 @@ public:
     PARAMETER(PARAM_PICK_N_SIMILAR)
     PARAMETER(PARAM_ADJUST_KMER_LEN)
     PARAMETER(PARAM_RESULT_DIRECTION)
+    PARAMETER(PARAM_KMER_SORT_MODE)
     // workflow
     PARAMETER(PARAM_RUNNER)
     PARAMETER(PARAM_REUSELATEST)
@@ -834,6 +866,7 @@ public:
     PARAMETER(PARAM_ORF_FILTER_S)
     PARAMETER(PARAM_ORF_FILTER_E)
     PARAMETER(PARAM_LCA_SEARCH)
+    PARAMETER(PARAM_FUSED_ALIGN)
 
     // easysearch
     PARAMETER(PARAM_GREEDY_BEST_HITS)
@@ -1038,6 +1071,7 @@ public:
     std::vector<MMseqsParameter*> kmerindexdb;
     std::vector<MMseqsParameter*> createindex;
     std::vector<MMseqsParameter*> createlinindex;
+    std::vector<MMseqsParameter*> appendindex;
     std::vector<MMseqsParameter*> convertalignments;
     std::vector<MMseqsParameter*> createdb;
     std::vector<MMseqsParameter*> convert2fasta;
@@ -1048,6 +1082,8 @@ public:
     std::vector<MMseqsParameter*> kmermatcher;
     std::vector<MMseqsParameter*> kmersearch;
     std::vector<MMseqsParameter*> countkmer;
+    std::vector<MMseqsParameter*> server;
+    std::vector<MMseqsParameter*> prefilteralign;
     std::vector<MMseqsParameter*> easylinclustworkflow;
     std::vector<MMseqsParameter*> linclustworkflow;
     std::vector<MMseqsParameter*> easysearchworkflow;
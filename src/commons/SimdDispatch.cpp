@@ -0,0 +1,181 @@
+#include "SimdDispatch.h"
+#include "SimdKernels.h"
+#include "Debug.h"
+#include "Util.h"
+#include "simd.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// kernels built with the compile time instruction set of the whole binary, used on non-x86 platforms
+// and on x86 CPUs without AVX2
+struct OpsGeneric {
+    typedef simd_int vec;
+    static const unsigned int LANES = VECSIZE_INT * 4;
+
+    static vec load(const void *x) { return simdi_load((const simd_int *) x); }
+    static vec loadu(const void *x) { return simdi_loadu((const simd_int *) x); }
+    static void store(void *x, vec y) { simdi_store((simd_int *) x, y); }
+    static void storeu(void *x, vec y) { simdi_storeu((simd_int *) x, y); }
+    static vec setzero() { return simdi_setzero(); }
+    static vec set8(char x) { return simdi8_set(x); }
+    static vec adds(vec x, vec y) { return simdui8_adds(x, y); }
+    static vec subs(vec x, vec y) { return simdui8_subs(x, y); }
+    static vec max(vec x, vec y) { return simdui8_max(x, y); }
+    static uint64_t eqMask(vec x, vec y) { return (unsigned int) simdi8_movemask(simdi8_eq(x, y)); }
+    static uint64_t gtMask(vec x, vec y) { return (unsigned int) simdi8_movemask(simdi8_gt(x, y)); }
+
+    // byte and 16 bit lane masks are vectors of 0 or -1
+    typedef simd_int mask;
+    typedef simd_int mask16;
+    static vec add8(vec x, vec y) { return simdi8_add(x, y); }
+    static vec sub8(vec x, vec y) { return simdi8_sub(x, y); }
+    static vec maxs8(vec x, vec y) { return simdi8_max(x, y); }
+    static vec minu8(vec x, vec y) { return simdui8_min(x, y); }
+    static vec or8(vec x, vec y) { return simdi_or(x, y); }
+    static mask gt8(vec x, vec y) { return simdi8_gt(x, y); }
+    static mask eq8(vec x, vec y) { return simdi8_eq(x, y); }
+    static vec blend(vec x, vec y, mask m) { return simdi8_blend(x, y, m); }
+    static vec maskz(mask m, vec x) { return simdi_and(m, x); }
+    static mask mor(mask x, mask y) { return simdi_or(x, y); }
+    static bool all(mask m) { return (unsigned int) simdi8_movemask(m) == SIMD_MOVEMASK_MAX; }
+    static vec set16(int16_t x) { return simdi16_set(x); }
+    static vec add16(vec x, vec y) { return simdi16_add(x, y); }
+    static vec sub16(vec x, vec y) { return simdi16_sub(x, y); }
+    static vec max16(vec x, vec y) { return simdi16_max(x, y); }
+    static vec and16(vec x, vec y) { return simdi_and(x, y); }
+    static vec slli16(vec x, int y) { return simdi16_slli(x, y); }
+    static mask16 gt16(vec x, vec y) { return simdi16_gt(x, y); }
+    static mask16 eq16(vec x, vec y) { return simdi16_eq(x, y); }
+    static vec blend16(vec x, vec y, mask16 m) { return simdi8_blend(x, y, m); }
+    static mask16 mor16(mask16 x, mask16 y) { return simdi_or(x, y); }
+    static mask16 mand16(mask16 x, mask16 y) { return simdi_and(x, y); }
+    static mask16 mandnot16(mask16 x, mask16 y) { return simdi_andnot(x, y); }
+
+    // zero extends the bytes of the lower (half 0) or upper (half 1) lanes to 16 bit
+    static vec widen(vec x, int half) {
+#ifdef AVX2
+        return _mm256_cvtepu8_epi16(half ? _mm256_extracti128_si256(x, 1) : _mm256_castsi256_si128(x));
+#else
+        return _mm_cvtepu8_epi16(half ? _mm_srli_si128(x, 8) : x);
+#endif
+    }
+
+    // byte mask of the 16 bit masks of the lower and upper lanes
+    static mask packMasks(mask16 lo, mask16 hi) {
+#ifdef AVX2
+        return _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+#else
+        return _mm_packs_epi16(lo, hi);
+#endif
+    }
+
+    static vec lookup(const char *profile, vec index) {
+#ifdef AVX2
+        const __m256i value = _mm256_load_si256((const __m256i *) profile);
+        const __m256i K0 = _mm256_setr_epi8(
+                (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70,
+                (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0);
+        const __m256i K1 = _mm256_setr_epi8(
+                (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0,
+                (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70);
+        return _mm256_or_si256(_mm256_shuffle_epi8(value, _mm256_add_epi8(index, K0)),
+                               _mm256_shuffle_epi8(_mm256_permute4x64_epi64(value, 0x4E), _mm256_add_epi8(index, K1)));
+#else
+        // each position has 32 byte, 20 scores and 12 zeros
+        __m128i score_matrix_vec01 = _mm_load_si128((const __m128i *) profile);
+        __m128i score_matrix_vec16 = _mm_load_si128((const __m128i *) (profile + 16));
+        __m128i score01 = _mm_shuffle_epi8(score_matrix_vec01, index);
+        __m128i score16 = _mm_shuffle_epi8(score_matrix_vec16, index);
+        // t[i] < 16 selects the first half, 15 < t[i] the second
+        __m128i lookup_mask01 = _mm_cmplt_epi8(index, _mm_set1_epi8(16));
+        __m128i lookup_mask16 = _mm_cmplt_epi8(_mm_set1_epi8(15), index);
+        score01 = _mm_and_si128(lookup_mask01, score01);
+        score16 = _mm_and_si128(lookup_mask16, score16);
+        return _mm_add_epi8(score01, score16);
+#endif
+    }
+};
+
+const SimdKernels kernelsGeneric = {
+    "generic", OpsGeneric::LANES, diagonalScoringKernel<OpsGeneric>, batchScoringKernel<OpsGeneric>,
+    ungappedScoringKernel<OpsGeneric>, msaRowDiffKernel<OpsGeneric>, bandedRoundKernel<OpsGeneric>
+};
+
+#ifdef HAVE_SIMD_DISPATCH
+enum SimdLevel {
+    SIMD_GENERIC = 0,
+    SIMD_AVX2,
+    SIMD_AVX512BW,
+    SIMD_AVX512VBMI
+};
+
+int parseForcedLevel(const char *level) {
+    if (strcmp(level, "generic") == 0) {
+        return SIMD_GENERIC;
+    } else if (strcmp(level, "avx2") == 0) {
+        return SIMD_AVX2;
+    } else if (strcmp(level, "avx512bw") == 0) {
+        return SIMD_AVX512BW;
+    } else if (strcmp(level, "avx512vbmi") == 0) {
+        return SIMD_AVX512VBMI;
+    }
+    Debug(Debug::ERROR) << "Invalid MMSEQS_FORCE_SIMD value " << level << ". Valid values are generic, avx2, avx512bw and avx512vbmi\n";
+    EXIT(EXIT_FAILURE);
+}
+#endif
+
+const SimdKernels *selectKernels() {
+#ifdef HAVE_SIMD_DISPATCH
+    int maxLevel = SIMD_AVX512VBMI;
+    const char *forced = getenv("MMSEQS_FORCE_SIMD");
+    if (forced != NULL) {
+        maxLevel = parseForcedLevel(forced);
+    }
+    __builtin_cpu_init();
+    if (maxLevel >= SIMD_AVX512VBMI && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vbmi")) {
+        return getSimdKernelsAVX512VBMI();
+    }
+    if (maxLevel >= SIMD_AVX512BW && __builtin_cpu_supports("avx512bw")) {
+        return getSimdKernelsAVX512BW();
+    }
+    if (maxLevel >= SIMD_AVX2 && __builtin_cpu_supports("avx2")) {
+        return getSimdKernelsAVX2();
+    }
+#endif
+    return &kernelsGeneric;
+}
+
+}
+
+const SimdKernels &SimdDispatch::getKernels() {
+    static const SimdKernels *kernels = selectKernels();
+    return *kernels;
+}
+
+void SimdDispatch::checkCompiledArch() {
+#ifdef HAVE_SIMD_DISPATCH
+    __builtin_cpu_init();
+    const char *missing = NULL;
+#if defined(__AVX512BW__)
+    if (__builtin_cpu_supports("avx512bw") == false) {
+        missing = "AVX512BW";
+    }
+#elif defined(__AVX2__)
+    if (__builtin_cpu_supports("avx2") == false) {
+        missing = "AVX2";
+    }
+#elif defined(__SSE4_1__)
+    if (__builtin_cpu_supports("sse4.1") == false) {
+        missing = "SSE4.1";
+    }
+#endif
+    if (missing != NULL) {
+        Debug(Debug::ERROR) << "This binary was compiled for " << missing << " but the CPU does not support it. "
+                            << "Please use a build with a lower SIMD level, the runtime dispatched kernels are selected automatically\n";
+        EXIT(EXIT_FAILURE);
+    }
+#endif
+}
@@ -0,0 +1,133 @@
+#ifndef MMSEQS_SIMDDISPATCH_H
+#define MMSEQS_SIMDDISPATCH_H
+
+// Kernels that are compiled for several instruction sets and selected at runtime.
+//
+// simd_int and everything built on it (striped Smith-Waterman, k-mer generation, diagonal counting)
+// keeps the width chosen by MMSEQS_ARCH at compile time. The kernels here only work on byte lanes,
+// so an AVX2 and AVX-512 version of each is compiled into every x86 binary and the widest one the
+// CPU supports is used. The per instruction set translation units include this header, it must
+// not pull in any code that could be emitted with their compile flags.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// input of the inter-sequence Smith-Waterman kernel, one target per byte lane
+struct BatchScoringInput {
+    const int8_t *querySequence;
+    int32_t queryLength;
+    // substitution scores indexed [target][query]
+    const int8_t *mat;
+    int32_t alphabetSize;
+    uint8_t bias;
+    // bias - composition bias of each query position
+    const uint8_t *rowBias;
+    const unsigned char **dbSequences;
+    const int32_t *dbLengths;
+    size_t count;
+    int32_t maxLength;
+    uint8_t gapOpen;
+    uint8_t gapExtend;
+    // queryLength * lanes bytes each, aligned to SimdDispatch::MAX_LANES
+    uint8_t *H;
+    uint8_t *E;
+    // alphabetSize * lanes bytes, aligned to SimdDispatch::MAX_LANES
+    uint8_t *profile;
+};
+
+// one anti-diagonal of the banded ksw_extz2_sse extension of one pair per byte lane, see
+// BandedNucleotideAligner::extendBatch. Per target position t the DP arrays hold one byte per lane at
+// t * lanes + lane and H one 16 bit word at the same index, all aligned to the vector size.
+struct BandedRoundInput {
+    int r;
+    uint8_t *u;
+    uint8_t *v;
+    uint8_t *x;
+    uint8_t *y;
+    uint8_t *s;
+    const uint8_t *target;
+    // residue r - t of a lane is at (r - t + 16) * lanes, ksw2 reads zeros before the query
+    const uint8_t *query;
+    int16_t *H;
+    // (t - tBase) * lanes bytes of traceback per position, NULL for score only
+    uint8_t *trace;
+    // band of each lane: st and en rounded to 16 as in ksw2, st0 and en0 exact, sEnd is the last position
+    // that gets a new score and en1 the end of ksw2's four way interleaved maximum loop.
+    // Lanes that do not take part have st = st0 = INT16_MAX and en = en0 = sEnd = -1.
+    const int16_t *st;
+    const int16_t *en;
+    const int16_t *st0;
+    const int16_t *en0;
+    const int16_t *sEnd;
+    const int16_t *en1;
+    // x and v left of st of each lane
+    const uint8_t *x1;
+    const uint8_t *v1;
+    // minimum st and st0, maximum en, en0 and sEnd over the lanes
+    int tBase;
+    int hStart;
+    int tTop;
+    int hEnd;
+    int sEndMax;
+    // all lanes share one band, no masking needed
+    bool uniform;
+    int8_t gapOpen;
+    int8_t gapExtend;
+    int8_t match;
+    int8_t mismatch;
+    int8_t wildcard;
+    int8_t maxDiff;
+};
+
+struct SimdKernels {
+    const char *name;
+    // number of byte lanes in one vector
+    unsigned int lanes;
+
+    // scores one diagonal of lanes sequences at once with saturating byte arithmetic
+    // profile has PROFILE_SIZE bytes per query position, dbSeq holds seqLen * lanes transposed residues
+    // maxScores receives the maximum score of each lane
+    void (*diagonalScoring)(const char *profile, char bias, unsigned int seqLen,
+                            const unsigned char *dbSeq, unsigned char *maxScores);
+
+    // score-only local alignment of up to lanes targets, writes the biased maximum of each lane to laneMax
+    void (*batchScoring)(const BatchScoringInput &in, uint8_t *laneMax);
+
+    // best ungapped local score over all diagonals of lanes targets at once
+    // profile has PROFILE_SIZE bytes per query position, dbSeq holds dbLength * lanes transposed residues
+    void (*ungappedScoring)(const char *profile, char bias, unsigned int queryLength,
+                            const unsigned char *dbSeq, unsigned int dbLength, unsigned char *maxScores);
+
+    // compares two MSA rows over [from, to), returns the number of columns where both rows hold differing
+    // residues (< 20) and writes the number of columns where both hold a residue to coverage
+    // stops early once the difference reaches maxDiff, coverage is then incomplete
+    int (*msaRowDiff)(const char *x, const char *y, int from, int to, int maxDiff, int *coverage);
+
+    // computes round in.r of up to lanes banded extensions, writes the maximum H of each lane over its band and
+    // its position (the first one in ksw2's order) to maxH and maxT
+    void (*bandedRound)(const BandedRoundInput &in, int16_t *maxH, int16_t *maxT);
+};
+
+class SimdDispatch {
+public:
+    // widest kernel, use for buffer sizes
+    static const unsigned int MAX_LANES = 64;
+    static const unsigned int PROFILE_SIZE = 32;
+    // bandedRound ranks the target positions of its lanes within BANDED_MAX_TLEN_BITS of a 16 bit word
+    static const int BANDED_MAX_TLEN_BITS = 12;
+    static const int BANDED_MAX_TLEN = 1 << BANDED_MAX_TLEN_BITS;
+
+    // kernels for the best instruction set of this CPU
+    // MMSEQS_FORCE_SIMD=generic|avx2|avx512bw|avx512vbmi caps the selection
+    static const SimdKernels &getKernels();
+
+    // exits with an error if the binary was compiled for instructions this CPU lacks
+    static void checkCompiledArch();
+};
+
+// kernel tables of the instruction set specific translation units
+const SimdKernels *getSimdKernelsAVX2();
+const SimdKernels *getSimdKernelsAVX512BW();
+const SimdKernels *getSimdKernelsAVX512VBMI();
+
+#endif
@@ -0,0 +1,80 @@
+// Compiled with -mavx2, only include headers without inline code here (see SimdDispatch.h)
+#include <immintrin.h>
+#include "SimdKernels.h"
+
+namespace {
+
+struct OpsAVX2 {
+    typedef __m256i vec;
+    static const unsigned int LANES = 32;
+
+    static vec load(const void *x) { return _mm256_load_si256((const __m256i *) x); }
+    static vec loadu(const void *x) { return _mm256_loadu_si256((const __m256i *) x); }
+    static void store(void *x, vec y) { _mm256_store_si256((__m256i *) x, y); }
+    static void storeu(void *x, vec y) { _mm256_storeu_si256((__m256i *) x, y); }
+    static vec setzero() { return _mm256_setzero_si256(); }
+    static vec set8(char x) { return _mm256_set1_epi8(x); }
+    static vec adds(vec x, vec y) { return _mm256_adds_epu8(x, y); }
+    static vec subs(vec x, vec y) { return _mm256_subs_epu8(x, y); }
+    static vec max(vec x, vec y) { return _mm256_max_epu8(x, y); }
+    static uint64_t eqMask(vec x, vec y) { return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)); }
+    static uint64_t gtMask(vec x, vec y) { return (uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi8(x, y)); }
+
+    // byte and 16 bit lane masks are vectors of 0 or -1
+    typedef __m256i mask;
+    typedef __m256i mask16;
+    static vec add8(vec x, vec y) { return _mm256_add_epi8(x, y); }
+    static vec sub8(vec x, vec y) { return _mm256_sub_epi8(x, y); }
+    static vec maxs8(vec x, vec y) { return _mm256_max_epi8(x, y); }
+    static vec minu8(vec x, vec y) { return _mm256_min_epu8(x, y); }
+    static vec or8(vec x, vec y) { return _mm256_or_si256(x, y); }
+    static mask gt8(vec x, vec y) { return _mm256_cmpgt_epi8(x, y); }
+    static mask eq8(vec x, vec y) { return _mm256_cmpeq_epi8(x, y); }
+    static vec blend(vec x, vec y, mask m) { return _mm256_blendv_epi8(x, y, m); }
+    static vec maskz(mask m, vec x) { return _mm256_and_si256(m, x); }
+    static mask mor(mask x, mask y) { return _mm256_or_si256(x, y); }
+    static bool all(mask m) { return (uint32_t) _mm256_movemask_epi8(m) == 0xFFFFFFFFU; }
+    static vec set16(int16_t x) { return _mm256_set1_epi16(x); }
+    static vec add16(vec x, vec y) { return _mm256_add_epi16(x, y); }
+    static vec sub16(vec x, vec y) { return _mm256_sub_epi16(x, y); }
+    static vec max16(vec x, vec y) { return _mm256_max_epi16(x, y); }
+    static vec and16(vec x, vec y) { return _mm256_and_si256(x, y); }
+    static vec slli16(vec x, int y) { return _mm256_slli_epi16(x, y); }
+    static mask16 gt16(vec x, vec y) { return _mm256_cmpgt_epi16(x, y); }
+    static mask16 eq16(vec x, vec y) { return _mm256_cmpeq_epi16(x, y); }
+    static vec blend16(vec x, vec y, mask16 m) { return _mm256_blendv_epi8(x, y, m); }
+    static mask16 mor16(mask16 x, mask16 y) { return _mm256_or_si256(x, y); }
+    static mask16 mand16(mask16 x, mask16 y) { return _mm256_and_si256(x, y); }
+    static mask16 mandnot16(mask16 x, mask16 y) { return _mm256_andnot_si256(x, y); }
+    static vec widen(vec x, int half) {
+        return _mm256_cvtepu8_epi16(half ? _mm256_extracti128_si256(x, 1) : _mm256_castsi256_si128(x));
+    }
+    // packs works within 128-bit lanes, the permute restores the lane order
+    static mask packMasks(mask16 lo, mask16 hi) {
+        return _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+    }
+
+    // 32 entry table lookup across both 128-bit lanes, same as UngappedAlignment::Shuffle
+    static vec lookup(const char *profile, vec index) {
+        const __m256i value = _mm256_load_si256((const __m256i *) profile);
+        const __m256i K0 = _mm256_setr_epi8(
+                (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70,
+                (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0);
+        const __m256i K1 = _mm256_setr_epi8(
+                (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0, (char)0xF0,
+                (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70, (char)0x70);
+        return _mm256_or_si256(_mm256_shuffle_epi8(value, _mm256_add_epi8(index, K0)),
+                               _mm256_shuffle_epi8(_mm256_permute4x64_epi64(value, 0x4E), _mm256_add_epi8(index, K1)));
+    }
+};
+
+const SimdKernels kernelsAVX2 = {
+    "avx2", OpsAVX2::LANES, diagonalScoringKernel<OpsAVX2>, batchScoringKernel<OpsAVX2>,
+    ungappedScoringKernel<OpsAVX2>, msaRowDiffKernel<OpsAVX2>, bandedRoundKernel<OpsAVX2>
+};
+
+}
+
+const SimdKernels *getSimdKernelsAVX2() {
+    return &kernelsAVX2;
+}
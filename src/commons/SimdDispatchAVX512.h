@@ -0,0 +1,79 @@
+#ifndef MMSEQS_SIMDDISPATCHAVX512_H
+#define MMSEQS_SIMDDISPATCHAVX512_H
+
+// 64 lane byte operations shared by the AVX512BW and AVX512VBMI translation units
+#include <immintrin.h>
+#include "SimdKernels.h"
+
+namespace {
+
+struct OpsAVX512 {
+    typedef __m512i vec;
+    static const unsigned int LANES = 64;
+
+    static vec load(const void *x) { return _mm512_load_si512(x); }
+    static vec loadu(const void *x) { return _mm512_loadu_si512(x); }
+    static void store(void *x, vec y) { _mm512_store_si512(x, y); }
+    static void storeu(void *x, vec y) { _mm512_storeu_si512(x, y); }
+    static vec setzero() { return _mm512_setzero_si512(); }
+    static vec set8(char x) { return _mm512_set1_epi8(x); }
+    static vec adds(vec x, vec y) { return _mm512_adds_epu8(x, y); }
+    static vec subs(vec x, vec y) { return _mm512_subs_epu8(x, y); }
+    static vec max(vec x, vec y) { return _mm512_max_epu8(x, y); }
+    static uint64_t eqMask(vec x, vec y) { return _mm512_cmpeq_epi8_mask(x, y); }
+    static uint64_t gtMask(vec x, vec y) { return _mm512_cmpgt_epi8_mask(x, y); }
+
+    // lane masks live in mask registers
+    typedef __mmask64 mask;
+    typedef __mmask32 mask16;
+    static vec add8(vec x, vec y) { return _mm512_add_epi8(x, y); }
+    static vec sub8(vec x, vec y) { return _mm512_sub_epi8(x, y); }
+    static vec maxs8(vec x, vec y) { return _mm512_max_epi8(x, y); }
+    static vec minu8(vec x, vec y) { return _mm512_min_epu8(x, y); }
+    static vec or8(vec x, vec y) { return _mm512_or_si512(x, y); }
+    static mask gt8(vec x, vec y) { return _mm512_cmpgt_epi8_mask(x, y); }
+    static mask eq8(vec x, vec y) { return _mm512_cmpeq_epi8_mask(x, y); }
+    static vec blend(vec x, vec y, mask m) { return _mm512_mask_blend_epi8(m, x, y); }
+    static vec maskz(mask m, vec x) { return _mm512_maskz_mov_epi8(m, x); }
+    static mask mor(mask x, mask y) { return x | y; }
+    static bool all(mask m) { return m == ~0ULL; }
+    static vec set16(int16_t x) { return _mm512_set1_epi16(x); }
+    static vec add16(vec x, vec y) { return _mm512_add_epi16(x, y); }
+    static vec sub16(vec x, vec y) { return _mm512_sub_epi16(x, y); }
+    static vec max16(vec x, vec y) { return _mm512_max_epi16(x, y); }
+    static vec and16(vec x, vec y) { return _mm512_and_si512(x, y); }
+    static vec slli16(vec x, int y) { return _mm512_slli_epi16(x, y); }
+    static mask16 gt16(vec x, vec y) { return _mm512_cmpgt_epi16_mask(x, y); }
+    static mask16 eq16(vec x, vec y) { return _mm512_cmpeq_epi16_mask(x, y); }
+    static vec blend16(vec x, vec y, mask16 m) { return _mm512_mask_blend_epi16(m, x, y); }
+    static mask16 mor16(mask16 x, mask16 y) { return x | y; }
+    static mask16 mand16(mask16 x, mask16 y) { return x & y; }
+    static mask16 mandnot16(mask16 x, mask16 y) { return ~x & y; }
+    static vec widen(vec x, int half) {
+        return _mm512_cvtepu8_epi16(half ? _mm512_extracti64x4_epi64(x, 1) : _mm512_castsi512_si256(x));
+    }
+    static mask packMasks(mask16 lo, mask16 hi) { return lo | (static_cast<uint64_t>(hi) << 32); }
+
+    // the zero masked forms compile to the same instructions but avoid gcc's uninitialized warnings
+    // for the undefined source operand of the unmasked intrinsics
+    static vec lookup(const char *profile, vec index) {
+#ifdef __AVX512VBMI__
+        // residues are < 32, so the 32 byte profile in the lower half is enough for a full 64 lane lookup
+        __m512i table = _mm512_maskz_loadu_epi8(0xFFFFFFFFULL, profile);
+        return _mm512_maskz_permutexvar_epi8(~0ULL, index, table);
+#else
+        // shuffle_epi8 only looks up within 128-bit lanes, so both profile halves are broadcast to every lane
+        // and the half is selected by residue < 16
+        __m512i table01 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_load_si128((const __m128i *) profile));
+        __m512i table16 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_load_si128((const __m128i *) (profile + 16)));
+        __m512i score01 = _mm512_shuffle_epi8(table01, index);
+        __m512i score16 = _mm512_shuffle_epi8(table16, index);
+        __mmask64 mask16 = _mm512_cmpgt_epu8_mask(index, _mm512_set1_epi8(15));
+        return _mm512_mask_blend_epi8(mask16, score01, score16);
+#endif
+    }
+};
+
+}
+
+#endif
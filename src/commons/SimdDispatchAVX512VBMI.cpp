@@ -0,0 +1,15 @@
+// Compiled with -mavx512f -mavx512bw -mavx512vbmi, only include headers without inline code here (see SimdDispatch.h)
+#include "SimdDispatchAVX512.h"
+
+namespace {
+
+const SimdKernels kernelsAVX512VBMI = {
+    "avx512vbmi", OpsAVX512::LANES, diagonalScoringKernel<OpsAVX512>, batchScoringKernel<OpsAVX512>,
+    ungappedScoringKernel<OpsAVX512>, msaRowDiffKernel<OpsAVX512>, bandedRoundKernel<OpsAVX512>
+};
+
+}
+
+const SimdKernels *getSimdKernelsAVX512VBMI() {
+    return &kernelsAVX512VBMI;
+}
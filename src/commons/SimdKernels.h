@@ -0,0 +1,401 @@
+#ifndef MMSEQS_SIMDKERNELS_H
+#define MMSEQS_SIMDKERNELS_H
+
+// Bodies of the runtime dispatched kernels, instantiated once per instruction set.
+// Ops provides the vector type, LANES and the byte operations. Everything is in an anonymous namespace
+// so that no instantiation compiled with wider instructions can be picked up by another translation unit.
+
+#include <string.h>
+#include "SimdDispatch.h"
+
+namespace {
+
+template <typename Ops>
+void diagonalScoringKernel(const char *profile, char bias, unsigned int seqLen,
+                           const unsigned char *dbSeq, unsigned char *maxScores) {
+    typedef typename Ops::vec vec;
+    vec vscore = Ops::setzero();
+    vec vMaxScore = Ops::setzero();
+    const vec vBias = Ops::set8(bias);
+    for (unsigned int pos = 0; pos < seqLen; pos++) {
+        vec template01 = Ops::load(&dbSeq[pos * Ops::LANES]);
+        vec score_vec_8bit = Ops::lookup(&profile[pos * SimdDispatch::PROFILE_SIZE], template01);
+        vscore = Ops::adds(vscore, score_vec_8bit);
+        vscore = Ops::subs(vscore, vBias);
+        vMaxScore = Ops::max(vMaxScore, vscore);
+    }
+    Ops::storeu(maxScores, vMaxScore);
+}
+
+// same recurrence as SmithWaterman::ungapped_alignment, each diagonal is scored from its first cell
+template <typename Ops>
+void ungappedScoringKernel(const char *profile, char bias, unsigned int queryLength,
+                           const unsigned char *dbSeq, unsigned int dbLength, unsigned char *maxScores) {
+    typedef typename Ops::vec vec;
+    const vec vBias = Ops::set8(bias);
+    vec vMaxScore = Ops::setzero();
+    // diagonals starting at the first target position
+    for (unsigned int queryStart = 0; queryStart < queryLength; queryStart++) {
+        const unsigned int length = (queryLength - queryStart < dbLength) ? queryLength - queryStart : dbLength;
+        const char *profilePos = profile + queryStart * SimdDispatch::PROFILE_SIZE;
+        vec vscore = Ops::setzero();
+        for (unsigned int pos = 0; pos < length; pos++) {
+            vec template01 = Ops::load(&dbSeq[pos * Ops::LANES]);
+            vscore = Ops::adds(vscore, Ops::lookup(&profilePos[pos * SimdDispatch::PROFILE_SIZE], template01));
+            vscore = Ops::subs(vscore, vBias);
+            vMaxScore = Ops::max(vMaxScore, vscore);
+        }
+    }
+    // diagonals starting at the first query position
+    for (unsigned int dbStart = 1; dbStart < dbLength; dbStart++) {
+        const unsigned int length = (dbLength - dbStart < queryLength) ? dbLength - dbStart : queryLength;
+        const unsigned char *dbPos = dbSeq + dbStart * Ops::LANES;
+        vec vscore = Ops::setzero();
+        for (unsigned int pos = 0; pos < length; pos++) {
+            vec template01 = Ops::load(&dbPos[pos * Ops::LANES]);
+            vscore = Ops::adds(vscore, Ops::lookup(&profile[pos * SimdDispatch::PROFILE_SIZE], template01));
+            vscore = Ops::subs(vscore, vBias);
+            vMaxScore = Ops::max(vMaxScore, vscore);
+        }
+    }
+    Ops::storeu(maxScores, vMaxScore);
+}
+
+// same biased unsigned byte arithmetic as sw_sse2_byte, see SmithWaterman::ssw_score_batch
+template <typename Ops>
+void batchScoringKernel(const BatchScoringInput &in, uint8_t *laneMax) {
+    typedef typename Ops::vec vec;
+    const size_t lanes = Ops::LANES;
+    memset(in.H, 0, in.queryLength * lanes * sizeof(uint8_t));
+    memset(in.E, 0, in.queryLength * lanes * sizeof(uint8_t));
+    // unused lanes and residues past the end of a shorter target score -bias, so H can only decrease there
+    memset(in.profile, 0, in.alphabetSize * lanes * sizeof(uint8_t));
+
+    const vec vGapO = Ops::set8(in.gapOpen);
+    const vec vGapE = Ops::set8(in.gapExtend);
+    vec vMax = Ops::setzero();
+    for (int32_t j = 0; j < in.maxLength; j++) {
+        // biased score of each query residue against the j-th residue of every lane
+        for (size_t lane = 0; lane < in.count; lane++) {
+            if (j < in.dbLengths[lane]) {
+                const int8_t *matRow = in.mat + in.dbSequences[lane][j] * in.alphabetSize;
+                for (int32_t aa = 0; aa < in.alphabetSize; aa++) {
+                    in.profile[aa * lanes + lane] = matRow[aa] + in.bias;
+                }
+            } else if (j == in.dbLengths[lane]) {
+                for (int32_t aa = 0; aa < in.alphabetSize; aa++) {
+                    in.profile[aa * lanes + lane] = 0;
+                }
+            }
+        }
+
+        vec vF = Ops::setzero();
+        vec vHDiag = Ops::setzero();
+        vec vHUp = Ops::setzero();
+        for (int32_t i = 0; i < in.queryLength; i++) {
+            vec vHLeft = Ops::load(in.H + i * lanes);
+            vec vE = Ops::load(in.E + i * lanes);
+            vE = Ops::max(Ops::subs(vE, vGapE), Ops::subs(vHLeft, vGapO));
+            vF = Ops::max(Ops::subs(vF, vGapE), Ops::subs(vHUp, vGapO));
+            vec vH = Ops::adds(vHDiag, Ops::load(in.profile + in.querySequence[i] * lanes));
+            vH = Ops::subs(vH, Ops::set8(in.rowBias[i]));
+            vH = Ops::max(vH, vE);
+            vH = Ops::max(vH, vF);
+            vMax = Ops::max(vMax, vH);
+            Ops::store(in.E + i * lanes, vE);
+            Ops::store(in.H + i * lanes, vH);
+            vHDiag = vHLeft;
+            vHUp = vH;
+        }
+    }
+    Ops::storeu(laneMax, vMax);
+}
+
+template <typename Ops>
+int msaRowDiffKernel(const char *x, const char *y, int from, int to, int maxDiff, int *coverage) {
+    typedef typename Ops::vec vec;
+    // residues are 0-19, X and the gap symbols are larger
+    const vec vLastResidue = Ops::set8(19);
+    const int lanes = static_cast<int>(Ops::LANES);
+    int diff = 0;
+    int cov = 0;
+    int pos = from;
+    for (; pos + lanes <= to && diff < maxDiff; pos += lanes) {
+        const vec vx = Ops::loadu(x + pos);
+        const vec vy = Ops::loadu(y + pos);
+        const uint64_t noResidue = Ops::gtMask(vx, vLastResidue) | Ops::gtMask(vy, vLastResidue);
+        const uint64_t same = Ops::eqMask(vx, vy);
+        cov += lanes - __builtin_popcountll(noResidue);
+        diff += lanes - __builtin_popcountll(same | noResidue);
+    }
+    for (; pos < to && diff < maxDiff; pos++) {
+        if (x[pos] < 20 && y[pos] < 20) {
+            cov++;
+            diff += (x[pos] != y[pos]);
+        }
+    }
+    *coverage = cov;
+    return diff;
+}
+
+
+// byte constants of the ksw_extz2_sse recurrence
+template <typename Ops>
+struct BandedConstants {
+    typedef typename Ops::vec vec;
+    vec zero, gapOpen, gapOpenExtend2, match, mismatch, wildcard, maxDiff, flag1, flag2, flag8, flag16;
+
+    explicit BandedConstants(const BandedRoundInput &in)
+            : zero(Ops::setzero()), gapOpen(Ops::set8(in.gapOpen)), gapOpenExtend2(Ops::set8((in.gapOpen + in.gapExtend) * 2)),
+              match(Ops::set8(in.match)), mismatch(Ops::set8(in.mismatch)), wildcard(Ops::set8(in.wildcard)),
+              maxDiff(Ops::set8(in.maxDiff)), flag1(Ops::set8(1)), flag2(Ops::set8(2)), flag8(Ops::set8(0x08)),
+              flag16(Ops::set8(0x10)) {}
+};
+
+// substitution score of target position t and query position r - t of every lane, 0 for the wildcard
+template <typename Ops>
+inline typename Ops::vec bandedScore(const BandedConstants<Ops> &c, const BandedRoundInput &in, int t) {
+    typedef typename Ops::vec vec;
+    const vec target = Ops::load(in.target + t * Ops::LANES);
+    const vec query = Ops::load(in.query + (in.r - t + 16) * Ops::LANES);
+    const typename Ops::mask wildcard = Ops::mor(Ops::eq8(target, c.wildcard), Ops::eq8(query, c.wildcard));
+    return Ops::blend(Ops::blend(c.mismatch, c.match, Ops::eq8(target, query)), c.zero, wildcard);
+}
+
+// one cell of ksw_extz2_sse from the differences x1, v1 of the cell on the left and u, y of the cell above
+template <typename Ops>
+inline void bandedCell(const BandedConstants<Ops> &c, bool withCigar, typename Ops::vec s, typename Ops::vec x1,
+                       typename Ops::vec v1, typename Ops::vec &u, typename Ops::vec &v, typename Ops::vec &x,
+                       typename Ops::vec &y, typename Ops::vec &d) {
+    typedef typename Ops::vec vec;
+    vec z = Ops::add8(s, c.gapOpenExtend2);
+    vec a = Ops::add8(x1, v1);
+    vec b = Ops::add8(y, u);
+    if (withCigar) {
+        d = Ops::maskz(Ops::gt8(a, z), c.flag1);
+        z = Ops::maxs8(z, a);
+        d = Ops::blend(d, c.flag2, Ops::gt8(b, z));
+    } else {
+        d = c.zero;
+        z = Ops::maxs8(z, a);
+    }
+    z = Ops::max(z, b);
+    z = Ops::minu8(z, c.maxDiff);
+    const vec uOld = u;
+    u = Ops::sub8(z, v1);
+    v = Ops::sub8(z, uOld);
+    z = Ops::sub8(z, c.gapOpen);
+    a = Ops::sub8(a, z);
+    b = Ops::sub8(b, z);
+    if (withCigar) {
+        const typename Ops::mask aPos = Ops::gt8(a, c.zero);
+        const typename Ops::mask bPos = Ops::gt8(b, c.zero);
+        x = Ops::maskz(aPos, a);
+        y = Ops::maskz(bPos, b);
+        d = Ops::or8(d, Ops::or8(Ops::maskz(aPos, c.flag8), Ops::maskz(bPos, c.flag16)));
+    } else {
+        x = Ops::maxs8(a, c.zero);
+        y = Ops::maxs8(b, c.zero);
+    }
+}
+
+// 16 bit lanes without from <= t <= to
+template <typename Ops>
+inline typename Ops::mask16 outsideBand(typename Ops::vec from, typename Ops::vec to, typename Ops::vec t) {
+    return Ops::mor16(Ops::gt16(from, t), Ops::gt16(t, to));
+}
+
+// byte lanes without from <= t <= to, the bounds are given as two vectors of 16 bit words
+template <typename Ops>
+inline typename Ops::mask outsideBand(const typename Ops::vec *from, const typename Ops::vec *to, typename Ops::vec t) {
+    return Ops::packMasks(outsideBand<Ops>(from[0], to[0], t), outsideBand<Ops>(from[1], to[1], t));
+}
+
+template <typename Ops>
+void bandedRoundKernel(const BandedRoundInput &in, int16_t *maxH, int16_t *maxT) {
+    typedef typename Ops::vec vec;
+    typedef typename Ops::mask mask;
+    typedef typename Ops::mask16 mask16;
+    const size_t lanes = Ops::LANES;
+    const size_t words = Ops::LANES / 2;
+    const int r = in.r;
+    const bool withCigar = in.trace != NULL;
+    const BandedConstants<Ops> c(in);
+    const vec qe16 = Ops::set16(in.gapOpen + in.gapExtend);
+    const int sweepEnd = (in.tTop > in.sEndMax) ? in.tTop : in.sEndMax;
+    const vec x1 = Ops::load(in.x1);
+    const vec v1 = Ops::load(in.v1);
+    vec best[2];
+    vec bestPos[2];
+
+    if (in.uniform) {
+        // st = tBase, en = tTop, st0 = hStart and en0 = hEnd for every lane
+        vec xPrev = x1;
+        vec vPrev = v1;
+        for (int t = in.tBase; t <= sweepEnd; ++t) {
+            if (t >= in.hStart && t <= in.sEndMax) {
+                Ops::store(in.s + t * lanes, bandedScore<Ops>(c, in, t));
+            }
+            if (t > in.tTop) {
+                continue;
+            }
+            const vec xt1 = xPrev;
+            const vec vt1 = vPrev;
+            xPrev = Ops::load(in.x + t * lanes);
+            vPrev = Ops::load(in.v + t * lanes);
+            vec u = Ops::load(in.u + t * lanes);
+            vec y = Ops::load(in.y + t * lanes);
+            vec v, x, d;
+            bandedCell<Ops>(c, withCigar, Ops::load(in.s + t * lanes), xt1, vt1, u, v, x, y, d);
+            Ops::store(in.u + t * lanes, u);
+            Ops::store(in.v + t * lanes, v);
+            Ops::store(in.x + t * lanes, x);
+            Ops::store(in.y + t * lanes, y);
+            if (withCigar) {
+                Ops::storeu(in.trace + (t - in.tBase) * lanes, d);
+            }
+        }
+
+        // H[t] += v[t] - qe, visiting the positions in the order in which ksw2 breaks ties of the maximum
+        const int st0 = in.hStart;
+        const int en0 = in.hEnd;
+        if (r == 0) {
+            const vec v0 = Ops::load(in.v);
+            for (int i = 0; i < 2; i++) {
+                best[i] = Ops::sub16(Ops::sub16(Ops::widen(v0, i), qe16), qe16);
+                Ops::store(in.H + i * words, best[i]);
+                bestPos[i] = Ops::setzero();
+            }
+        } else {
+            const vec last = (en0 > 0) ? Ops::load(in.u + en0 * lanes) : Ops::load(in.v + en0 * lanes);
+            const int from = (en0 > 0) ? en0 - 1 : en0;
+            for (int i = 0; i < 2; i++) {
+                best[i] = Ops::sub16(Ops::add16(Ops::load(in.H + from * lanes + i * words), Ops::widen(last, i)), qe16);
+                Ops::store(in.H + en0 * lanes + i * words, best[i]);
+                bestPos[i] = Ops::set16(en0);
+            }
+            const int en1 = st0 + (en0 - st0) / 4 * 4;
+            for (int group = 0; group < 5; ++group) {
+                const int tStart = (group < 4) ? st0 + group : en1;
+                const int tEnd = (group < 4) ? en1 : en0;
+                const int tStep = (group < 4) ? 4 : 1;
+                for (int t = tStart; t < tEnd; t += tStep) {
+                    const vec vt = Ops::load(in.v + t * lanes);
+                    const vec t16 = Ops::set16(t);
+                    for (int i = 0; i < 2; i++) {
+                        int16_t *H = in.H + t * lanes + i * words;
+                        const vec h = Ops::sub16(Ops::add16(Ops::load(H), Ops::widen(vt, i)), qe16);
+                        Ops::store(H, h);
+                        bestPos[i] = Ops::blend16(bestPos[i], t16, Ops::gt16(h, best[i]));
+                        best[i] = Ops::max16(best[i], h);
+                    }
+                }
+            }
+        }
+    } else {
+        vec st[2], en[2], st0[2], en0[2], sEnd[2], en1[2];
+        for (int i = 0; i < 2; i++) {
+            st[i] = Ops::load(in.st + i * words);
+            en[i] = Ops::load(in.en + i * words);
+            st0[i] = Ops::load(in.st0 + i * words);
+            en0[i] = Ops::load(in.en0 + i * words);
+            sEnd[i] = Ops::load(in.sEnd + i * words);
+            en1[i] = Ops::load(in.en1 + i * words);
+        }
+        // every position is masked to the lanes whose band contains it, the lanes keep their stale values elsewhere
+        vec xPrev = c.zero;
+        vec vPrev = c.zero;
+        for (int t = in.tBase; t <= sweepEnd; ++t) {
+            const vec t16 = Ops::set16(t);
+            const mask sOutside = outsideBand<Ops>(st0, sEnd, t16);
+            if (Ops::all(sOutside) == false) {
+                Ops::store(in.s + t * lanes, Ops::blend(bandedScore<Ops>(c, in, t), Ops::load(in.s + t * lanes), sOutside));
+            }
+            if (t > in.tTop) {
+                continue;
+            }
+            const mask idle = outsideBand<Ops>(st, en, t16);
+            const vec xOld = Ops::load(in.x + t * lanes);
+            const vec vOld = Ops::load(in.v + t * lanes);
+            if (Ops::all(idle)) {
+                xPrev = xOld;
+                vPrev = vOld;
+                continue;
+            }
+            const mask isStart = Ops::packMasks(Ops::eq16(st[0], t16), Ops::eq16(st[1], t16));
+            const vec xt1 = Ops::blend(xPrev, x1, isStart);
+            const vec vt1 = Ops::blend(vPrev, v1, isStart);
+            xPrev = xOld;
+            vPrev = vOld;
+            const vec uOld = Ops::load(in.u + t * lanes);
+            const vec yOld = Ops::load(in.y + t * lanes);
+            vec u = uOld;
+            vec y = yOld;
+            vec v, x, d;
+            bandedCell<Ops>(c, withCigar, Ops::load(in.s + t * lanes), xt1, vt1, u, v, x, y, d);
+            Ops::store(in.u + t * lanes, Ops::blend(u, uOld, idle));
+            Ops::store(in.v + t * lanes, Ops::blend(v, vOld, idle));
+            Ops::store(in.x + t * lanes, Ops::blend(x, xOld, idle));
+            Ops::store(in.y + t * lanes, Ops::blend(y, yOld, idle));
+            if (withCigar) {
+                Ops::storeu(in.trace + (t - in.tBase) * lanes, d);
+            }
+        }
+
+        // the tie breaking order of ksw2 differs between lanes here, so every position gets a rank:
+        // en0 first, then the four interleaved groups of ksw2's SSE loop, then its scalar tail
+        vec prevH[2] = { c.zero, c.zero };
+        if (in.hStart > 0) {
+            for (int i = 0; i < 2; i++) {
+                prevH[i] = Ops::load(in.H + (in.hStart - 1) * lanes + i * words);
+            }
+        }
+        vec bestRank[2];
+        for (int i = 0; i < 2; i++) {
+            best[i] = Ops::set16(INT16_MIN);
+            bestRank[i] = Ops::set16(INT16_MAX);
+            bestPos[i] = Ops::setzero();
+        }
+        const vec three = Ops::set16(3);
+        const vec tailRank = Ops::set16(4 * SimdDispatch::BANDED_MAX_TLEN);
+        const vec firstRank = Ops::set16(-1);
+        for (int t = in.hStart; t <= in.hEnd; ++t) {
+            const vec t16 = Ops::set16(t);
+            const vec vt = Ops::load(in.v + t * lanes);
+            const vec ut = Ops::load(in.u + t * lanes);
+            for (int i = 0; i < 2; i++) {
+                int16_t *H = in.H + t * lanes + i * words;
+                const vec h = Ops::load(H);
+                const mask16 isEn0 = Ops::eq16(en0[i], t16);
+                vec newH;
+                if (r == 0) {
+                    newH = Ops::sub16(Ops::sub16(Ops::widen(vt, i), qe16), qe16);
+                } else {
+                    newH = Ops::sub16(Ops::add16(h, Ops::widen(vt, i)), qe16);
+                    if (t > 0) {
+                        newH = Ops::blend16(newH, Ops::sub16(Ops::add16(prevH[i], Ops::widen(ut, i)), qe16), isEn0);
+                    }
+                }
+                prevH[i] = h;
+                const mask16 outside = outsideBand<Ops>(st0[i], en0[i], t16);
+                Ops::store(H, Ops::blend16(newH, h, outside));
+                vec rank = Ops::add16(Ops::slli16(Ops::and16(Ops::sub16(t16, st0[i]), three), SimdDispatch::BANDED_MAX_TLEN_BITS), t16);
+                rank = Ops::blend16(Ops::add16(tailRank, t16), rank, Ops::gt16(en1[i], t16));
+                rank = Ops::blend16(rank, firstRank, isEn0);
+                const mask16 tie = Ops::mand16(Ops::eq16(newH, best[i]), Ops::gt16(bestRank[i], rank));
+                const mask16 better = Ops::mandnot16(outside, Ops::mor16(Ops::gt16(newH, best[i]), tie));
+                best[i] = Ops::blend16(best[i], newH, better);
+                bestRank[i] = Ops::blend16(bestRank[i], rank, better);
+                bestPos[i] = Ops::blend16(bestPos[i], t16, better);
+            }
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        Ops::storeu(maxH + i * words, best[i]);
+        Ops::storeu(maxT + i * words, bestPos[i]);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef MMSEQS_KMERRADIXSORT_H
+#define MMSEQS_KMERRADIXSORT_H
+
+// In-place MSD radix sort (American flag sort) for KmerPosition tables.
+// Produces the same order as the KmerPosition comparators: the composite key
+// (kmer, seqLen descending, id, pos) is split into byte digits and sorted most
+// significant digit first. BY_SEQ_LEN selects the compareRepSequenceAndIdAndPos
+// order (otherwise compareRepSequenceAndIdAndDiag), REVERSE ignores the strand
+// bit 63 of the kmer like the *Reverse comparators.
+// Large buckets are partitioned with a parallel histogram, smaller buckets are
+// sorted independently by the threads. No extra memory is needed.
+#include "kmermatcher.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+template <typename T, bool BY_SEQ_LEN, bool REVERSE>
+class KmerRadixSort {
+public:
+    static void sort(KmerPosition<T> *kmers, size_t count, bool parallel) {
+        if (count < 2) {
+            return;
+        }
+        unsigned int threads = 1;
+#ifdef OPENMP
+        if (parallel) {
+            threads = static_cast<unsigned int>(omp_get_max_threads());
+        }
+#endif
+        unsigned int level = firstKmerDigit(kmers, count, threads);
+        if (threads > 1 && count >= PARALLEL_THRESHOLD) {
+            sortParallel(kmers, count, level, threads);
+        } else {
+            sortSerial(kmers, count, level);
+        }
+    }
+
+private:
+    typedef typename std::make_unsigned<T>::type UnsignedT;
+
+    static const unsigned int KMER_DIGITS = sizeof(size_t);
+    static const unsigned int SEQ_LEN_DIGITS = BY_SEQ_LEN ? sizeof(T) : 0;
+    static const unsigned int ID_DIGITS = sizeof(unsigned int);
+    static const unsigned int POS_DIGITS = sizeof(T);
+    static const unsigned int DIGITS = KMER_DIGITS + SEQ_LEN_DIGITS + ID_DIGITS + POS_DIGITS;
+
+    // ranges below this size are finished by std::sort
+    static const size_t SMALL_THRESHOLD = 64;
+    // ranges below this size are not worth a parallel partition
+    static const size_t PARALLEL_THRESHOLD = 1 << 16;
+
+    static inline size_t normalizedKmer(const KmerPosition<T> &kmer) {
+        return REVERSE ? BIT_SET(kmer.kmer, 63) : kmer.kmer;
+    }
+
+    // flip the sign bit so that signed values sort correctly as unsigned
+    static inline UnsignedT toUnsigned(T value) {
+        return static_cast<UnsignedT>(value) ^ (static_cast<UnsignedT>(1) << (sizeof(T) * 8 - 1));
+    }
+
+    static inline unsigned int digit(const KmerPosition<T> &kmer, unsigned int level) {
+        if (level < KMER_DIGITS) {
+            return (normalizedKmer(kmer) >> ((KMER_DIGITS - 1 - level) * 8)) & 0xFF;
+        }
+        level -= KMER_DIGITS;
+        if (level < SEQ_LEN_DIGITS) {
+            // longest sequence first
+            UnsignedT seqLen = static_cast<UnsignedT>(~toUnsigned(kmer.seqLen));
+            return (seqLen >> ((SEQ_LEN_DIGITS - 1 - level) * 8)) & 0xFF;
+        }
+        level -= SEQ_LEN_DIGITS;
+        if (level < ID_DIGITS) {
+            return (kmer.id >> ((ID_DIGITS - 1 - level) * 8)) & 0xFF;
+        }
+        level -= ID_DIGITS;
+        return (toUnsigned(kmer.pos) >> ((POS_DIGITS - 1 - level) * 8)) & 0xFF;
+    }
+
+    static bool compare(const KmerPosition<T> &first, const KmerPosition<T> &second) {
+        if (BY_SEQ_LEN) {
+            return REVERSE ? KmerPosition<T>::compareRepSequenceAndIdAndPosReverse(first, second)
+                           : KmerPosition<T>::compareRepSequenceAndIdAndPos(first, second);
+        }
+        return REVERSE ? KmerPosition<T>::compareRepSequenceAndIdAndDiagReverse(first, second)
+                       : KmerPosition<T>::compareRepSequenceAndIdAndDiag(first, second);
+    }
+
+    // skip leading kmer bytes that are identical for all entries
+    static unsigned int firstKmerDigit(const KmerPosition<T> *kmers, size_t count, unsigned int threads) {
+        const size_t first = normalizedKmer(kmers[0]);
+        size_t diff = 0;
+#pragma omp parallel for schedule(static) reduction(|:diff) num_threads(threads) if(threads > 1)
+        for (size_t i = 1; i < count; i++) {
+            diff |= normalizedKmer(kmers[i]) ^ first;
+        }
+        if (diff == 0) {
+            return KMER_DIGITS;
+        }
+        return static_cast<unsigned int>(__builtin_clzll(diff)) / 8;
+    }
+
+    static void histogram(const KmerPosition<T> *kmers, size_t count, unsigned int level, size_t *counts, unsigned int threads) {
+        std::fill(counts, counts + 256, 0);
+        if (threads == 1) {
+            for (size_t i = 0; i < count; i++) {
+                counts[digit(kmers[i], level)]++;
+            }
+            return;
+        }
+#pragma omp parallel num_threads(threads)
+        {
+            size_t localCounts[256] = {0};
+#pragma omp for schedule(static)
+            for (size_t i = 0; i < count; i++) {
+                localCounts[digit(kmers[i], level)]++;
+            }
+#pragma omp critical
+            {
+                for (size_t i = 0; i < 256; i++) {
+                    counts[i] += localCounts[i];
+                }
+            }
+        }
+    }
+
+    // finds the next level where the entries differ and moves each entry into its bucket
+    // returns false if the entries are equal in all remaining digits
+    static bool partition(KmerPosition<T> *kmers, size_t count, unsigned int &level, size_t *offsets, unsigned int threads) {
+        size_t counts[256];
+        for (; level < DIGITS; level++) {
+            histogram(kmers, count, level, counts, threads);
+            if (counts[digit(kmers[0], level)] != count) {
+                break;
+            }
+        }
+        if (level == DIGITS) {
+            return false;
+        }
+
+        size_t heads[256];
+        size_t sum = 0;
+        for (size_t i = 0; i < 256; i++) {
+            offsets[i] = sum;
+            heads[i] = sum;
+            sum += counts[i];
+        }
+        offsets[256] = sum;
+
+        for (size_t bucket = 0; bucket < 256; bucket++) {
+            const size_t end = offsets[bucket + 1];
+            while (heads[bucket] < end) {
+                KmerPosition<T> value = kmers[heads[bucket]];
+                unsigned int d = digit(value, level);
+                while (d != bucket) {
+                    std::swap(value, kmers[heads[d]++]);
+                    d = digit(value, level);
+                }
+                kmers[heads[bucket]++] = value;
+            }
+        }
+        return true;
+    }
+
+    static void sortSerial(KmerPosition<T> *kmers, size_t count, unsigned int level) {
+        if (count <= SMALL_THRESHOLD) {
+            std::sort(kmers, kmers + count, compare);
+            return;
+        }
+        size_t offsets[257];
+        if (partition(kmers, count, level, offsets, 1) == false) {
+            return;
+        }
+        for (size_t bucket = 0; bucket < 256; bucket++) {
+            const size_t bucketSize = offsets[bucket + 1] - offsets[bucket];
+            if (bucketSize > 1) {
+                sortSerial(kmers + offsets[bucket], bucketSize, level + 1);
+            }
+        }
+    }
+
+    static void sortParallel(KmerPosition<T> *kmers, size_t count, unsigned int level, unsigned int threads) {
+        size_t offsets[257];
+        if (partition(kmers, count, level, offsets, threads) == false) {
+            return;
+        }
+        // buckets that would dominate a single thread are partitioned in parallel again
+        const size_t largeBucket = std::max(count / threads, static_cast<size_t>(PARALLEL_THRESHOLD));
+        for (size_t bucket = 0; bucket < 256; bucket++) {
+            const size_t bucketSize = offsets[bucket + 1] - offsets[bucket];
+            if (bucketSize >= largeBucket) {
+                sortParallel(kmers + offsets[bucket], bucketSize, level + 1, threads);
+            }
+        }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+        for (size_t bucket = 0; bucket < 256; bucket++) {
+            const size_t bucketSize = offsets[bucket + 1] - offsets[bucket];
+            if (bucketSize > 1 && bucketSize < largeBucket) {
+                sortSerial(kmers + offsets[bucket], bucketSize, level + 1);
+            }
+        }
+    }
+};
+
+#endif
@@ -15,6 +15,7 @@
 #include "MarkovKmerScore.h"
 #include "FileUtil.h"
 #include "FastSort.h"
+#include "KmerRadixSort.h"
 
 #include <sys/stat.h>
 #include <sys/mman.h>
@@ -53,6 +54,40 @@ KmerPosition<T> *initKmerPositionMemory(size_t size) {
     return hashSeqPair;
 }
 
+// byDiagonal == false: sort by kmer, seq. length, id and pos
+// byDiagonal == true: sort by rep. sequence (stored in kmer), id and diagonal
+template <typename T>
+void sortKmerPositions(KmerPosition<T> *kmers, size_t count, bool isNucl, bool byDiagonal, int sortMode, bool parallel) {
+    if (sortMode == Parameters::KMER_SORT_RADIX) {
+        if (byDiagonal) {
+            if (isNucl) {
+                KmerRadixSort<T, false, true>::sort(kmers, count, parallel);
+            } else {
+                KmerRadixSort<T, false, false>::sort(kmers, count, parallel);
+            }
+        } else {
+            if (isNucl) {
+                KmerRadixSort<T, true, true>::sort(kmers, count, parallel);
+            } else {
+                KmerRadixSort<T, true, false>::sort(kmers, count, parallel);
+            }
+        }
+        return;
+    }
+
+    bool (*compare)(const KmerPosition<T> &, const KmerPosition<T> &);
+    if (byDiagonal) {
+        compare = isNucl ? KmerPosition<T>::compareRepSequenceAndIdAndDiagReverse : KmerPosition<T>::compareRepSequenceAndIdAndDiag;
+    } else {
+        compare = isNucl ? KmerPosition<T>::compareRepSequenceAndIdAndPosReverse : KmerPosition<T>::compareRepSequenceAndIdAndPos;
+    }
+    if (parallel) {
+        SORT_PARALLEL(kmers, kmers + count, compare);
+    } else {
+        SORT_SERIAL(kmers, kmers + count, compare);
+    }
+}
+
 void maskSequence(int maskMode, int maskLowerCase, Sequence &seq, int maskLetter, ProbabilityMatrix * probMatrix){
     if (maskMode == 1) {
         tantan::maskSequences((char*)seq.numSequence,
@@ -77,7 +112,8 @@ void maskSequence(int maskMode, int maskLowerCase, Sequence &seq, int maskLetter
 template <int TYPE, typename T>
 std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
                                                 Parameters & par, BaseMatrix * subMat, bool hashWholeSequence,
-                                                size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution){
+                                                size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                KmerBucketWriter<T> * bucketWriter){
     size_t offset = 0;
     int querySeqType  =  seqDbr.getDbtype();
     size_t longestKmer = par.kmerSize;
@@ -114,6 +150,10 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
         const unsigned int BUFFER_SIZE = 1048576;
         size_t bufferPos = 0;
         KmerPosition<T> * threadKmerBuffer = new KmerPosition<T>[BUFFER_SIZE];
+        unsigned short * threadKmerHashes = NULL;
+        if (bucketWriter != NULL) {
+            threadKmerHashes = new unsigned short[BUFFER_SIZE];
+        }
         SequencePosition * kmers = (SequencePosition *) malloc((par.pickNbest * (par.maxSeqLen + 1) + 1) * sizeof(SequencePosition));
         size_t kmersArraySize = par.maxSeqLen;
         const size_t flushSize = 100000000;
@@ -246,12 +286,17 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                     if(hashDistribution != NULL){
                         __sync_fetch_and_add(&hashDistribution[static_cast<unsigned short>(seqHash)], 1);
                     }
+                    if(threadKmerHashes != NULL){
+                        threadKmerHashes[bufferPos] = static_cast<unsigned short>(seqHash);
+                    }
                     bufferPos++;
                     if (bufferPos >= BUFFER_SIZE) {
                         size_t writeOffset = __sync_fetch_and_add(&offset, bufferPos);
                         if(writeOffset + bufferPos < kmerArraySize){
                             if(kmerArray!=NULL){
                                 memcpy(kmerArray + writeOffset, threadKmerBuffer, sizeof(KmerPosition<T>) * bufferPos);
+                            } else if(bucketWriter != NULL){
+                                bucketWriter->write(threadKmerBuffer, threadKmerHashes, bufferPos);
                             }
                         } else{
                             Debug(Debug::ERROR) << "Kmer array overflow. currKmerArrayOffset="<< writeOffset
@@ -320,6 +365,9 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                             threadKmerBuffer[bufferPos].id = seqId;
                             threadKmerBuffer[bufferPos].pos = (kmers + kmerIdx)->pos;
                             threadKmerBuffer[bufferPos].seqLen = seq.L;
+                            if(threadKmerHashes != NULL){
+                                threadKmerHashes[bufferPos] = (kmers + kmerIdx)->score;
+                            }
                             bufferPos++;
                             if(hashDistribution != NULL){
                                 __sync_fetch_and_add(&hashDistribution[(kmers + kmerIdx)->score], 1);
@@ -331,6 +379,8 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
                                     if(kmerArray!=NULL) {
                                         memcpy(kmerArray + writeOffset, threadKmerBuffer,
                                                sizeof(KmerPosition<T>) * bufferPos);
+                                    } else if(bucketWriter != NULL){
+                                        bucketWriter->write(threadKmerBuffer, threadKmerHashes, bufferPos);
                                     }
                                 } else{
                                     Debug(Debug::ERROR) << "Kmer array overflow. currKmerArrayOffset="<< writeOffset
@@ -362,10 +412,15 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
             size_t writeOffset = __sync_fetch_and_add(&offset, bufferPos);
             if(kmerArray != NULL){
                 memcpy(kmerArray+writeOffset, threadKmerBuffer, sizeof(KmerPosition<T>) * bufferPos);
+            } else if(bucketWriter != NULL){
+                bucketWriter->write(threadKmerBuffer, threadKmerHashes, bufferPos);
             }
         }
         free(kmers);
         delete[] threadKmerBuffer;
+        if (threadKmerHashes != NULL) {
+            delete[] threadKmerHashes;
+        }
         delete[] hierarchicalScoreDist;
         delete[] scoreDist;
         if (TYPE == Parameters::DBTYPE_HMM_PROFILE) {
@@ -405,11 +460,8 @@ KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t
 
     Debug(Debug::INFO) << "Sort kmer ";
     Timer timer;
-    if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<T>::compareRepSequenceAndIdAndPosReverse);
-    }else{
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<T>::compareRepSequenceAndIdAndPos);
-    }
+    const bool isNucl = Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES);
+    sortKmerPositions<T>(hashSeqPair, elementsToSort, isNucl, false, par.kmerSortMode, true);
     Debug(Debug::INFO) << timer.lap() << "\n";
 
     // assign rep. sequence to same kmer members
@@ -424,12 +476,7 @@ KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t
     // sort by rep. sequence (stored in kmer) and sequence id
     Debug(Debug::INFO) << "Sort by rep. sequence ";
     timer.reset();
-    if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, KmerPosition<T>::compareRepSequenceAndIdAndDiagReverse);
-    }else{
-        SORT_PARALLEL(hashSeqPair, hashSeqPair + writePos, KmerPosition<T>::compareRepSequenceAndIdAndDiag);
-    }
-    //kx::radix_sort(hashSeqPair, hashSeqPair + elementsToSort, SequenceComparision());
+    sortKmerPositions<T>(hashSeqPair, writePos, isNucl, true, par.kmerSortMode, true);
 //    for(size_t i = 0; i < writePos; i++){
 //        std::cout << BIT_CLEAR(hashSeqPair[i].kmer, 63) << "\t" << hashSeqPair[i].id << "\t" << hashSeqPair[i].pos << std::endl;
 //    }
@@ -590,6 +637,145 @@ size_t computeMemoryNeededLinearfilter(size_t totalKmer) {
 }
 
 
+template <typename T>
+KmerBucketWriter<T>::KmerBucketWriter(const std::string &prefix, size_t bucketCount) :
+        prefix(prefix), bucketCount(bucketCount), bucketOffsets(bucketCount + 1) {
+    files.reserve(bucketCount);
+    for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+        files.push_back(FileUtil::openFileOrDie(getBucketFile(prefix, bucket).c_str(), "wb", false));
+    }
+}
+
+template <typename T>
+KmerBucketWriter<T>::~KmerBucketWriter() {
+    close();
+}
+
+template <typename T>
+std::string KmerBucketWriter<T>::getBucketFile(const std::string &prefix, size_t bucket) {
+    return prefix + "_bucket_" + SSTR(bucket);
+}
+
+template <typename T>
+void KmerBucketWriter<T>::write(const KmerPosition<T> *kmers, const unsigned short *hashes, size_t count) {
+    const size_t bucketMask = bucketCount - 1;
+#pragma omp critical
+    {
+        // counting sort by bucket, then write every run with a single fwrite
+        std::fill(bucketOffsets.begin(), bucketOffsets.end(), 0);
+        for (size_t i = 0; i < count; i++) {
+            bucketOffsets[(hashes[i] & bucketMask) + 1]++;
+        }
+        for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+            bucketOffsets[bucket + 1] += bucketOffsets[bucket];
+        }
+        scatterBuffer.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            scatterBuffer[bucketOffsets[hashes[i] & bucketMask]++] = kmers[i];
+        }
+        size_t start = 0;
+        for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+            // offsets now point to the end of each run
+            size_t end = bucketOffsets[bucket];
+            if (end > start && fwrite(scatterBuffer.data() + start, sizeof(KmerPosition<T>), end - start, files[bucket]) != end - start) {
+                Debug(Debug::ERROR) << "Cannot write to file " << getBucketFile(prefix, bucket) << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            start = end;
+        }
+    }
+}
+
+template <typename T>
+void KmerBucketWriter<T>::close() {
+    for (size_t bucket = 0; bucket < files.size(); bucket++) {
+        if (fclose(files[bucket]) != 0) {
+            Debug(Debug::ERROR) << "Cannot close file " << getBucketFile(prefix, bucket) << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+    files.clear();
+}
+
+template <int TYPE, typename Entry, typename T>
+void sortAndGroupKmerBucket(const std::string &bucketFile, const std::string &splitFile, Parameters &par, bool parallelSort) {
+    size_t kmerCount = FileUtil::getFileSize(bucketFile) / sizeof(KmerPosition<T>);
+    KmerPosition<T> *hashSeqPair = initKmerPositionMemory<T>(kmerCount);
+    FILE *file = FileUtil::openFileOrDie(bucketFile.c_str(), "rb", true);
+    if (fread(hashSeqPair, sizeof(KmerPosition<T>), kmerCount, file) != kmerCount) {
+        Debug(Debug::ERROR) << "Cannot read file " << bucketFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fclose(file) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << bucketFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    const bool isNucl = (TYPE == Parameters::DBTYPE_NUCLEOTIDES);
+    sortKmerPositions<T>(hashSeqPair, kmerCount, isNucl, false, par.kmerSortMode, parallelSort);
+
+    size_t writePos = assignGroup<TYPE, T>(hashSeqPair, kmerCount, par.includeOnlyExtendable, par.covMode, par.covThr);
+
+    sortKmerPositions<T>(hashSeqPair, writePos, isNucl, true, par.kmerSortMode, parallelSort);
+
+    writeKmersToDisk<TYPE, Entry, T>(splitFile, hashSeqPair, writePos + 1);
+    delete [] hashSeqPair;
+}
+
+// reads the sequence DB once and spills all k-mers into buckets, which are then sorted and grouped independently
+// peak memory is bounded by the size of the buckets that are processed concurrently
+template <int TYPE, typename Entry, typename T>
+std::vector<std::string> doBucketedComputation(size_t splits, const std::string &prefix,
+                                               DBReader<unsigned int> &seqDbr, Parameters &par, BaseMatrix *subMat) {
+    const size_t threads = static_cast<size_t>(par.threads);
+    size_t bucketCount = 1;
+    while (bucketCount < splits * threads && bucketCount < KmerBucketWriter<T>::MAX_BUCKETS) {
+        bucketCount *= 2;
+    }
+    if (bucketCount < splits) {
+        Debug(Debug::WARNING) << "Buckets might exceed the memory limit, increase --split-memory-limit\n";
+    }
+    const size_t concurrentBuckets = std::max(static_cast<size_t>(1), std::min(threads, bucketCount / splits));
+
+    std::vector<std::string> splitFiles;
+    bool allDone = true;
+    for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+        splitFiles.push_back(prefix + "_split_" + SSTR(bucket));
+        std::string splitFileNameDone = splitFiles.back() + ".done";
+        allDone &= FileUtil::fileExists(splitFileNameDone.c_str());
+    }
+
+    if (allDone == false) {
+        Debug(Debug::INFO) << "Write k-mers into " << bucketCount << " buckets\n";
+        KmerBucketWriter<T> bucketWriter(prefix, bucketCount);
+        std::pair<size_t, size_t> ret = fillKmerPositionArray<TYPE, T>(NULL, SIZE_T_MAX, seqDbr, par, subMat, true, 0, SIZE_T_MAX, NULL, &bucketWriter);
+        bucketWriter.close();
+        if (TYPE == Parameters::DBTYPE_NUCLEOTIDES) {
+            par.kmerSize = ret.second;
+            Debug(Debug::INFO) << "\nAdjusted k-mer length " << par.kmerSize << "\n";
+        }
+    }
+    seqDbr.unmapData();
+
+    Debug(Debug::INFO) << "Sort and group " << bucketCount << " buckets, " << concurrentBuckets << " at once ";
+    Timer timer;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(concurrentBuckets) if(concurrentBuckets > 1)
+    for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+        std::string bucketFile = KmerBucketWriter<T>::getBucketFile(prefix, bucket);
+        std::string splitFileNameDone = splitFiles[bucket] + ".done";
+        if (FileUtil::fileExists(splitFileNameDone.c_str()) == false) {
+            // a single bucket at a time can use all threads for sorting
+            sortAndGroupKmerBucket<TYPE, Entry, T>(bucketFile, splitFiles[bucket], par, concurrentBuckets == 1);
+        }
+        if (FileUtil::fileExists(bucketFile.c_str())) {
+            FileUtil::remove(bucketFile.c_str());
+        }
+    }
+    Debug(Debug::INFO) << timer.lap() << "\n";
+
+    return splitFiles;
+}
+
 template <typename T>
 int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
 
@@ -621,15 +807,15 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
     size_t totalKmersPerSplit = std::max(static_cast<size_t>(1024+1),
                                          static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/sizeof(KmerPosition<T>))+1);
 
-    std::vector<std::pair<size_t, size_t>> hashRanges = setupKmerSplits<T>(par, subMat, seqDbr, totalKmersPerSplit, splits);
-    if(splits > 1){
-        Debug(Debug::INFO) << "Process file into " << hashRanges.size() << " parts\n";
-    }
     std::vector<std::string> splitFiles;
     KmerPosition<T> *hashSeqPair = NULL;
 
     size_t mpiRank = 0;
 #ifdef HAVE_MPI
+    std::vector<std::pair<size_t, size_t>> hashRanges = setupKmerSplits<T>(par, subMat, seqDbr, totalKmersPerSplit, splits);
+    if(splits > 1){
+        Debug(Debug::INFO) << "Process file into " << hashRanges.size() << " parts\n";
+    }
     splits = hashRanges.size();
     size_t fromSplit = 0;
     size_t splitCount = 1;
@@ -659,16 +845,16 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
         }
     }
 #else
-    for(size_t split = 0; split < hashRanges.size(); split++) {
-        std::string splitFileName = par.db2 + "_split_" +SSTR(split);
-        Debug(Debug::INFO) << "Generate k-mers list for " << (split+1) <<" split\n";
-
-        std::string splitFileNameDone = splitFileName + ".done";
-        if(FileUtil::fileExists(splitFileNameDone.c_str()) == false){
-            hashSeqPair = doComputation<T>(totalKmersPerSplit, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat);
+    if(splits > 1){
+        Debug(Debug::INFO) << "Not enough memory to process at once need to split\n";
+        if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
+            splitFiles = doBucketedComputation<Parameters::DBTYPE_NUCLEOTIDES, KmerEntryRev, T>(splits, par.db2, seqDbr, par, subMat);
+        }else{
+            splitFiles = doBucketedComputation<Parameters::DBTYPE_AMINO_ACIDS, KmerEntry, T>(splits, par.db2, seqDbr, par, subMat);
         }
-
-        splitFiles.push_back(splitFileName);
+    }else{
+        Debug(Debug::INFO) << "Generate k-mers list\n";
+        hashSeqPair = doComputation<T>(totalKmersPerSplit, 0, SIZE_T_MAX, par.db2 + "_split_0", seqDbr, par, subMat);
     }
 #endif
     if(mpiRank == 0){
@@ -1228,17 +1414,26 @@ void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqTy
 }
 
 template std::pair<size_t, size_t>  fillKmerPositionArray<0, short>(KmerPosition<short> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                                    KmerBucketWriter<short> * bucketWriter);
 template std::pair<size_t, size_t>  fillKmerPositionArray<1, short>(KmerPosition<short> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                                    KmerBucketWriter<short> * bucketWriter);
 template std::pair<size_t, size_t>  fillKmerPositionArray<2, short>(KmerPosition<short> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                    Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                                    KmerBucketWriter<short> * bucketWriter);
 template std::pair<size_t, size_t>  fillKmerPositionArray<0, int>(KmerPosition<int> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                                  KmerBucketWriter<int> * bucketWriter);
 template std::pair<size_t, size_t>  fillKmerPositionArray<1, int>(KmerPosition <int>* kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                                  KmerBucketWriter<int> * bucketWriter);
 template std::pair<size_t, size_t>  fillKmerPositionArray<2, int>(KmerPosition< int> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
-                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                                  KmerBucketWriter<int> * bucketWriter);
+
+template class KmerBucketWriter<short>;
+template class KmerBucketWriter<int>;
 
 template KmerPosition<short> *initKmerPositionMemory(size_t size);
 template KmerPosition<int> *initKmerPositionMemory(size_t size);
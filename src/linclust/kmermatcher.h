@@ -220,10 +220,37 @@ KmerPosition<T> * doComputation(size_t totalKmers, size_t split, size_t splits,
 template <typename T>
 KmerPosition<T> *initKmerPositionMemory(size_t size);
 
+// spills k-mers into on-disk buckets while the sequence DB is read
+// the bucket is chosen by the low bits of the k-mer hash, so all occurrences of a k-mer end up in the same bucket
+template <typename T>
+class KmerBucketWriter {
+public:
+    KmerBucketWriter(const std::string &prefix, size_t bucketCount);
+    ~KmerBucketWriter();
+
+    // scatters a thread buffer into the bucket files, hashes contains the k-mer hash of each entry
+    void write(const KmerPosition<T> *kmers, const unsigned short *hashes, size_t count);
+
+    void close();
+
+    static std::string getBucketFile(const std::string &prefix, size_t bucket);
+
+    // at most this many bucket files are open at once during the merge
+    static const size_t MAX_BUCKETS = 256;
+
+private:
+    const std::string prefix;
+    const size_t bucketCount;
+    std::vector<FILE *> files;
+    std::vector<size_t> bucketOffsets;
+    std::vector<KmerPosition<T>> scatterBuffer;
+};
+
 template <int TYPE, typename T>
 std::pair<size_t, size_t>  fillKmerPositionArray(KmerPosition<T> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
                                                  Parameters & par, BaseMatrix * subMat, bool hashWholeSequence,
-                                                 size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
+                                                 size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution,
+                                                 KmerBucketWriter<T> * bucketWriter = NULL);
 
 
 void maskSequence(int maskMode, int maskLowerCase,
@@ -1,5 +1,6 @@
 #include "CacheFriendlyOperations.h"
 #include "Util.h"
+#include "HugePages.h"
 
 #include <cmath>
 
@@ -9,9 +10,7 @@ CacheFriendlyOperations<BINSIZE>::CacheFriendlyOperations(size_t maxElement, siz
     size_t size = pow(2, ceil(log(maxElement)/log(2)));
     size = std::max(size >> MASK_0_5_BIT, (size_t) 1); // space needed in bit array
     duplicateBitArraySize = size;
-    duplicateBitArray = new(std::nothrow) unsigned char[size];
-    Util::checkAllocation(duplicateBitArray, "Cannot allocate duplicateBitArray memory in CacheFriendlyOperations");
-    memset(duplicateBitArray, 0, duplicateBitArraySize * sizeof(unsigned char));
+    duplicateBitArray = static_cast<unsigned char *>(HugePages::allocate(size));
 
     // find nearest upper power of 2^(x)
     initBinSize = pow(2, ceil(log(initBinSize)/log(2)));
@@ -22,14 +21,13 @@ CacheFriendlyOperations<BINSIZE>::CacheFriendlyOperations(size_t maxElement, siz
     bins = new(std::nothrow) CounterResult*[BINCOUNT];
     Util::checkAllocation(bins, "Cannot allocate bins memory in CacheFriendlyOperations");
 
-    binDataFrame = new(std::nothrow) CounterResult[BINCOUNT * binSize];
-    Util::checkAllocation(binDataFrame, "Cannot allocate binDataFrame memory in CacheFriendlyOperations");
+    binDataFrame = static_cast<CounterResult *>(HugePages::allocate(BINCOUNT * binSize * sizeof(CounterResult)));
 }
 
 template<unsigned int BINSIZE>
 CacheFriendlyOperations<BINSIZE>::~CacheFriendlyOperations<BINSIZE>(){
-    delete[] duplicateBitArray;
-    delete[] binDataFrame;
+    HugePages::release(duplicateBitArray);
+    HugePages::release(binDataFrame);
     delete[] tmpElementBuffer;
     delete[] bins;
 }
@@ -250,10 +248,8 @@ bool CacheFriendlyOperations<BINSIZE>::checkForOverflowAndResizeArray(bool inclu
 //            std::cout << "Found overlow " << n << std::endl;
             binSize = pow(2, ceil(log(binSize + 1)/log(2)));
 
-            delete[] binDataFrame;
-            binDataFrame = new(std::nothrow) CounterResult[BINCOUNT * binSize];
-            Util::checkAllocation(binDataFrame, "Cannot reallocate reallocBinMemory in CacheFriendlyOperations");
-            memset(binDataFrame, 0, sizeof(CounterResult) * binSize * BINCOUNT);
+            HugePages::release(binDataFrame);
+            binDataFrame = static_cast<CounterResult *>(HugePages::allocate(BINCOUNT * binSize * sizeof(CounterResult)));
 
             if (includeTmpResult) {
                 delete[] tmpElementBuffer;
@@ -17,6 +17,7 @@
 #include "KmerGenerator.h"
 #include "Parameters.h"
 #include "FastSort.h"
+#include "HugePages.h"
 #include <stdlib.h>
 #include <algorithm>
 
@@ -67,11 +68,9 @@ public:
     IndexTable(int alphabetSize, int kmerSize, bool externalData)
             : tableSize(MathUtil::ipow<size_t>(alphabetSize, kmerSize)), alphabetSize(alphabetSize),
               kmerSize(kmerSize), externalData(externalData), tableEntriesNum(0), size(0),
-              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), offsets(NULL) {
+              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), packedEntries(NULL), compact(false), offsets(NULL) {
         if (externalData == false) {
-            offsets = new(std::nothrow) size_t[tableSize + 1];
-            Util::checkAllocation(offsets, "Can not allocate entries memory in IndexTable");
-            memset(offsets, 0, (tableSize + 1) * sizeof(size_t));
+            offsets = static_cast<size_t *>(HugePages::allocate((tableSize + 1) * sizeof(size_t)));
         }
     }
 
@@ -82,14 +81,12 @@ public:
 
     void deleteEntries() {
         if (externalData == false) {
-            if (entries != NULL) {
-                delete[] entries;
-                entries = NULL;
-            }
-            if (offsets != NULL) {
-                delete[] offsets;
-                offsets = NULL;
-            }
+            HugePages::release(entries);
+            entries = NULL;
+            HugePages::release(packedEntries);
+            packedEntries = NULL;
+            HugePages::release(offsets);
+            offsets = NULL;
         }
     }
 
@@ -176,6 +173,117 @@ public:
         return (entries + offsets[kmer]);
     }
 
+    // get the delta encoded list of DB sequences containing this k-mer, decode it with unpackDBSeqList
+    inline const unsigned char *getPackedDBSeqList(size_t kmer, size_t *matchedListSize) {
+        const unsigned char *list = packedEntries + offsets[kmer];
+        if (offsets[kmer + 1] == offsets[kmer]) {
+            *matchedListSize = 0;
+            return list;
+        }
+        size_t count = 0;
+        unsigned int shift = 0;
+        unsigned char byte;
+        do {
+            byte = *list++;
+            count |= static_cast<size_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        *matchedListSize = count;
+        return list;
+    }
+
+    static inline void unpackDBSeqList(const unsigned char *list, size_t count, IndexEntryLocal *out) {
+        unsigned int seqId = 0;
+        for (size_t start = 0; start < count; start += COMPACT_BLOCK_SIZE) {
+            const size_t blockSize = std::min(count - start, static_cast<size_t>(COMPACT_BLOCK_SIZE));
+            const unsigned int width = *list++;
+            switch (width) {
+                case 1:
+                    unpackBlock<1>(list, blockSize, seqId, out + start);
+                    break;
+                case 2:
+                    unpackBlock<2>(list, blockSize, seqId, out + start);
+                    break;
+                case 3:
+                    unpackBlock<3>(list, blockSize, seqId, out + start);
+                    break;
+                default:
+                    unpackBlock<4>(list, blockSize, seqId, out + start);
+                    break;
+            }
+            list += blockSize * (width + sizeof(unsigned short));
+        }
+    }
+
+    bool isCompact() {
+        return compact;
+    }
+
+    // replace the entries by the delta encoded layout (see packDBSeqList)
+    // offsets point to bytes in the packed entries afterwards
+    void compactEntries() {
+        if (compact) {
+            return;
+        }
+        const size_t chunkCount = std::min(tableSize, static_cast<size_t>(4096));
+        const size_t chunkLength = (tableSize + chunkCount - 1) / chunkCount;
+        unsigned char **chunkData = new unsigned char*[chunkCount];
+        size_t *chunkOffsets = new size_t[chunkCount + 1];
+        size_t *chunkEnds = new size_t[chunkCount];
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            chunkEnds[chunk] = offsets[std::min(tableSize, (chunk + 1) * chunkLength)];
+        }
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            const size_t from = std::min(tableSize, chunk * chunkLength);
+            const size_t to = std::min(tableSize, from + chunkLength);
+            size_t chunkSize = 0;
+            for (size_t i = from; i < to; i++) {
+                const size_t end = (i + 1 == to) ? chunkEnds[chunk] : offsets[i + 1];
+                chunkSize += packedDBSeqListSize(entries + offsets[i], end - offsets[i]);
+            }
+            chunkData[chunk] = static_cast<unsigned char *>(malloc(std::max(chunkSize, static_cast<size_t>(1))));
+            Util::checkAllocation(chunkData[chunk], "Can not allocate compact entries memory in IndexTable::compactEntries");
+            // offsets[i + 1] is still the original offset when list i is packed
+            size_t pos = 0;
+            for (size_t i = from; i < to; i++) {
+                const size_t end = (i + 1 == to) ? chunkEnds[chunk] : offsets[i + 1];
+                const size_t start = offsets[i];
+                offsets[i] = pos;
+                pos += packDBSeqList(entries + start, end - start, chunkData[chunk] + pos);
+            }
+            chunkOffsets[chunk + 1] = pos;
+        }
+
+        chunkOffsets[0] = 0;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            chunkOffsets[chunk + 1] += chunkOffsets[chunk];
+        }
+        const size_t packedSize = chunkOffsets[chunkCount];
+        HugePages::release(entries);
+        entries = NULL;
+
+        packedEntries = static_cast<unsigned char *>(HugePages::allocate(packedSize));
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            const size_t from = std::min(tableSize, chunk * chunkLength);
+            const size_t to = std::min(tableSize, from + chunkLength);
+            memcpy(packedEntries + chunkOffsets[chunk], chunkData[chunk], chunkOffsets[chunk + 1] - chunkOffsets[chunk]);
+            free(chunkData[chunk]);
+            for (size_t i = from; i < to; i++) {
+                offsets[i] += chunkOffsets[chunk];
+            }
+        }
+        offsets[tableSize] = packedSize;
+        compact = true;
+
+        Debug(Debug::INFO) << "Compact entries:  " << (packedSize + tableSize * sizeof(size_t))/1024/1024 << " MB\n";
+        delete[] chunkData;
+        delete[] chunkOffsets;
+        delete[] chunkEnds;
+    }
+
     void sortDBSeqLists() {
         #pragma omp parallel for
         for (size_t i = 0; i < tableSize; i++) {
@@ -190,6 +298,15 @@ public:
         return entries;
     }
 
+    unsigned char *getPackedEntries() {
+        return packedEntries;
+    }
+
+    // size of the entries array in bytes
+    size_t getEntriesSize() {
+        return compact ? offsets[tableSize] : tableEntriesNum * sizeof(IndexEntryLocal);
+    }
+
     inline size_t getOffset(size_t kmer) {
         return offsets[kmer];
     }
@@ -209,8 +326,7 @@ public:
         this->size = dbSize; // amount of sequences added
 
         // allocate memory for the sequence id lists
-        entries = new(std::nothrow) IndexEntryLocal[tableEntriesNum];
-        Util::checkAllocation(entries, "Can not allocate entries memory in IndexTable::initMemory");
+        entries = static_cast<IndexEntryLocal *>(HugePages::allocate(tableEntriesNum * sizeof(IndexEntryLocal)));
     }
 
     // allocates memory for index tables
@@ -226,21 +342,32 @@ public:
     }
 
     // init index table with external data (needed for index readin)
-    void initTableByExternalData(size_t sequenceCount, size_t tableEntriesNum, IndexEntryLocal *entries, size_t *entryOffsets) {
+    void initTableByExternalData(size_t sequenceCount, size_t tableEntriesNum, char *entries, size_t *entryOffsets, bool compact) {
         this->tableEntriesNum = tableEntriesNum;
         this->size = sequenceCount;
+        this->compact = compact;
 
-        this->entries = entries;
+        if (compact) {
+            this->packedEntries = (unsigned char *) entries;
+        } else {
+            this->entries = (IndexEntryLocal *) entries;
+        }
         this->offsets = entryOffsets;
     }
 
-    void initTableByExternalDataCopy(size_t sequenceCount, size_t tableEntriesNum, IndexEntryLocal *entries, size_t *entryOffsets) {
+    void initTableByExternalDataCopy(size_t sequenceCount, size_t tableEntriesNum, char *entries, size_t *entryOffsets, bool compact) {
         this->tableEntriesNum = tableEntriesNum;
         this->size = sequenceCount;
-
-        this->entries = new(std::nothrow) IndexEntryLocal[tableEntriesNum];
-        Util::checkAllocation(entries, "Can not allocate " + SSTR(tableEntriesNum * sizeof(IndexEntryLocal)) + " bytes for entries in IndexTable::initMemory");
-        memcpy(this->entries, entries, tableEntriesNum * sizeof(IndexEntryLocal));
+        this->compact = compact;
+
+        if (compact) {
+            const size_t packedSize = entryOffsets[tableSize];
+            this->packedEntries = static_cast<unsigned char *>(HugePages::allocate(packedSize));
+            memcpy(this->packedEntries, entries, packedSize);
+        } else {
+            this->entries = static_cast<IndexEntryLocal *>(HugePages::allocate(tableEntriesNum * sizeof(IndexEntryLocal)));
+            memcpy(this->entries, entries, tableEntriesNum * sizeof(IndexEntryLocal));
+        }
 
         memcpy(this->offsets, entryOffsets, (tableSize + 1) * sizeof(size_t));
     }
@@ -476,8 +603,105 @@ protected:
 
     // Index table entries: ids of sequences containing a certain k-mer, stored sequentially in the memory
     IndexEntryLocal *entries;
+    // delta encoded entries, replace entries after compactEntries
+    unsigned char *packedEntries;
+    bool compact;
     size_t *offsets;
 
+    // Compact k-mer list layout: the entry count as varint followed by blocks of up to
+    // COMPACT_BLOCK_SIZE entries. A block starts with the byte width (1-4) of its sequence id
+    // deltas, followed by the deltas and the 2 byte positions. Lists are sorted by sequence id
+    // so most deltas of long (memory heavy) lists fit into one or two bytes.
+    static const size_t COMPACT_BLOCK_SIZE = 16;
+
+    static inline unsigned int deltaWidth(unsigned int delta) {
+        return (delta < (1u << 8)) ? 1 : (delta < (1u << 16)) ? 2 : (delta < (1u << 24)) ? 3 : 4;
+    }
+
+    static size_t packedDBSeqListSize(const IndexEntryLocal *list, size_t count) {
+        if (count == 0) {
+            return 0;
+        }
+        size_t size = 1;
+        for (size_t value = count >> 7; value > 0; value >>= 7) {
+            size++;
+        }
+        unsigned int prevId = 0;
+        for (size_t start = 0; start < count; start += COMPACT_BLOCK_SIZE) {
+            const size_t end = std::min(count, start + COMPACT_BLOCK_SIZE);
+            unsigned int deltas = 0;
+            for (size_t i = start; i < end; i++) {
+                deltas |= list[i].seqId - prevId;
+                prevId = list[i].seqId;
+            }
+            size += 1 + (end - start) * (deltaWidth(deltas) + sizeof(unsigned short));
+        }
+        return size;
+    }
+
+    static size_t packDBSeqList(const IndexEntryLocal *list, size_t count, unsigned char *out) {
+        if (count == 0) {
+            return 0;
+        }
+        unsigned char *pos = out;
+        size_t value = count;
+        while (value >= 0x80) {
+            *pos++ = static_cast<unsigned char>(value | 0x80);
+            value >>= 7;
+        }
+        *pos++ = static_cast<unsigned char>(value);
+
+        unsigned int prevId = 0;
+        for (size_t start = 0; start < count; start += COMPACT_BLOCK_SIZE) {
+            const size_t end = std::min(count, start + COMPACT_BLOCK_SIZE);
+            unsigned int deltas = 0;
+            unsigned int blockPrevId = prevId;
+            for (size_t i = start; i < end; i++) {
+                deltas |= list[i].seqId - blockPrevId;
+                blockPrevId = list[i].seqId;
+            }
+            const unsigned int width = deltaWidth(deltas);
+            *pos++ = static_cast<unsigned char>(width);
+            for (size_t i = start; i < end; i++) {
+                const unsigned int delta = list[i].seqId - prevId;
+                prevId = list[i].seqId;
+                for (unsigned int byte = 0; byte < width; byte++) {
+                    *pos++ = static_cast<unsigned char>(delta >> (8 * byte));
+                }
+            }
+            for (size_t i = start; i < end; i++) {
+                const unsigned short position = list[i].position_j;
+                memcpy(pos, &position, sizeof(unsigned short));
+                pos += sizeof(unsigned short);
+            }
+        }
+        return pos - out;
+    }
+
+    template <unsigned int WIDTH>
+    static inline void unpackBlock(const unsigned char *block, size_t blockSize, unsigned int &seqId, IndexEntryLocal *out) {
+        for (size_t i = 0; i < blockSize; i++) {
+            unsigned int delta = block[i * WIDTH];
+            if (WIDTH > 1) {
+                delta |= static_cast<unsigned int>(block[i * WIDTH + 1]) << 8;
+            }
+            if (WIDTH > 2) {
+                delta |= static_cast<unsigned int>(block[i * WIDTH + 2]) << 16;
+            }
+            if (WIDTH > 3) {
+                delta |= static_cast<unsigned int>(block[i * WIDTH + 3]) << 24;
+            }
+            seqId += delta;
+            out[i].seqId = seqId;
+        }
+        const unsigned char *positions = block + blockSize * WIDTH;
+        for (size_t i = 0; i < blockSize; i++) {
+            unsigned short position;
+            memcpy(&position, positions + i * sizeof(unsigned short), sizeof(unsigned short));
+            out[i].position_j = position;
+        }
+    }
+
     // sequence lookup
     SequenceLookup *sequenceLookup;
 };
@@ -0,0 +1,70 @@
+#include "KmerListCache.h"
+#include "Util.h"
+
+#include <cstring>
+#include <cstdlib>
+
+KmerListCache::KmerListCache(size_t maxMemory) : maxMemory(maxMemory) {
+    size_t slotCount = 1024;
+    while (slotCount * 2 <= maxMemory / AVG_LIST_MEMORY) {
+        slotCount *= 2;
+    }
+    slotMask = slotCount - 1;
+    slots = new(std::nothrow) Slot[slotCount];
+    Util::checkAllocation(slots, "Can not allocate slots memory in KmerListCache");
+    for (size_t i = 0; i < slotCount; i++) {
+        slots[i].kmer = EMPTY_SLOT;
+        slots[i].size = 0;
+        slots[i].list = NULL;
+        slots[i].capacity = 0;
+        slots[i].threshold = 0;
+    }
+    locks = new int[LOCK_COUNT];
+    memset((int *) locks, 0, LOCK_COUNT * sizeof(int));
+    usedMemory = slotCount * sizeof(Slot);
+}
+
+KmerListCache::~KmerListCache() {
+    for (size_t i = 0; i <= slotMask; i++) {
+        free(slots[i].list);
+    }
+    delete[] slots;
+    delete[] locks;
+}
+
+const size_t *KmerListCache::get(size_t kmer, short threshold, size_t *size) {
+    const size_t slot = slotIndex(kmer, threshold);
+    readLock(slot);
+    const Slot &entry = slots[slot];
+    if (entry.kmer != kmer || entry.threshold != threshold) {
+        readUnlock(slot);
+        return NULL;
+    }
+    *size = entry.size;
+    return entry.list;
+}
+
+void KmerListCache::put(size_t kmer, short threshold, const size_t *list, size_t size) {
+    const size_t slot = slotIndex(kmer, threshold);
+    writeLock(slot);
+    Slot &entry = slots[slot];
+    if (size > entry.capacity) {
+        const size_t grow = (size - entry.capacity) * sizeof(size_t);
+        if (__sync_add_and_fetch(&usedMemory, grow) > maxMemory) {
+            __sync_fetch_and_sub(&usedMemory, grow);
+            writeUnlock(slot);
+            return;
+        }
+        free(entry.list);
+        entry.list = static_cast<size_t *>(malloc(size * sizeof(size_t)));
+        Util::checkAllocation(entry.list, "Can not allocate list memory in KmerListCache");
+        entry.capacity = size;
+    }
+    if (size > 0) {
+        memcpy(entry.list, list, size * sizeof(size_t));
+    }
+    entry.kmer = kmer;
+    entry.size = size;
+    entry.threshold = threshold;
+    writeUnlock(slot);
+}
@@ -0,0 +1,86 @@
+#ifndef MMSEQS_KMERLISTCACHE_H
+#define MMSEQS_KMERLISTCACHE_H
+
+// Bounded cache of similar k-mer lists that is shared by all prefilter threads.
+// A list is keyed by the index of its k-mer and the k-mer threshold it was generated
+// with, since the threshold changes with the composition bias of each query position.
+// Lists live in a direct mapped table, a new list replaces the list stored in its slot
+// and reuses its memory. Once the memory limit is reached a slot can not grow anymore.
+
+#include <cstddef>
+
+class KmerListCache {
+public:
+    KmerListCache(size_t maxMemory);
+    ~KmerListCache();
+
+    // returns the cached list or NULL if it is not cached, a returned list stays valid
+    // until release is called and has to be released before the next get or put
+    // of the same thread, other threads can read it at the same time
+    const size_t *get(size_t kmer, short threshold, size_t *size);
+
+    void release(size_t kmer, short threshold) {
+        readUnlock(slotIndex(kmer, threshold));
+    }
+
+    void put(size_t kmer, short threshold, const size_t *list, size_t size);
+
+    size_t getUsedMemory() const {
+        return usedMemory;
+    }
+
+private:
+    struct Slot {
+        size_t kmer;
+        size_t size;
+        size_t capacity;
+        size_t *list;
+        short threshold;
+    };
+
+    static const size_t EMPTY_SLOT = static_cast<size_t>(-1);
+    // expected memory of a cached list, determines the number of slots
+    static const size_t AVG_LIST_MEMORY = 1024;
+    static const size_t LOCK_COUNT = 4096;
+
+    Slot *slots;
+    size_t slotMask;
+    // reader-writer spin locks, each guarding every LOCK_COUNT-th slot
+    // -1 while a list is written, otherwise the number of readers
+    volatile int *locks;
+
+    size_t maxMemory;
+    size_t usedMemory;
+
+    inline size_t slotIndex(size_t kmer, short threshold) const {
+        size_t hash = (kmer ^ (static_cast<size_t>(static_cast<unsigned short>(threshold)) << 48)) * 0x9E3779B97F4A7C15ULL;
+        return (hash ^ (hash >> 29)) & slotMask;
+    }
+
+    inline void readLock(size_t slot) {
+        volatile int *lock = &locks[slot % LOCK_COUNT];
+        while (true) {
+            const int readers = *lock;
+            if (readers >= 0 && __sync_bool_compare_and_swap(lock, readers, readers + 1)) {
+                return;
+            }
+        }
+    }
+
+    inline void readUnlock(size_t slot) {
+        __sync_fetch_and_sub(&locks[slot % LOCK_COUNT], 1);
+    }
+
+    inline void writeLock(size_t slot) {
+        volatile int *lock = &locks[slot % LOCK_COUNT];
+        while (__sync_bool_compare_and_swap(lock, 0, -1) == false) {
+            while (*lock != 0) { ; }
+        }
+    }
+
+    inline void writeUnlock(size_t slot) {
+        __sync_bool_compare_and_swap(&locks[slot % LOCK_COUNT], -1, 0);
+    }
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "Prefiltering.h"
+#include "Alignment.h"
 #include "Util.h"
 #include "Parameters.h"
 #include "MMseqsMPI.h"
@@ -10,15 +11,9 @@
 #include <omp.h>
 #endif
 
-int prefilter(int argc, const char **argv, const Command& command) {
-    MMseqsMPI::init(argc, argv);
-
-    Parameters& par = Parameters::getInstance();
-    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER);
-
-    Timer timer;
-    int queryDbType = FileUtil::parseDbType(par.db1.c_str());
-    int targetDbType = FileUtil::parseDbType(par.db2.c_str());
+static bool getSearchDbTypes(const Parameters &par, int &queryDbType, int &targetDbType) {
+    queryDbType = FileUtil::parseDbType(par.db1.c_str());
+    targetDbType = FileUtil::parseDbType(par.db2.c_str());
     if(Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_INDEX_DB) == true) {
         DBReader<unsigned int> dbr(par.db2.c_str(), par.db2Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
         dbr.open(DBReader<unsigned int>::NOSORT);
@@ -28,19 +23,33 @@ int prefilter(int argc, const char **argv, const Command& command) {
     }
     if (queryDbType == -1 || targetDbType == -1) {
         Debug(Debug::ERROR) << "Please recreate your database or add a .dbtype file to your sequence/profile database.\n";
-        return EXIT_FAILURE;
+        return false;
     }
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_HMM_PROFILE) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_HMM_PROFILE)) {
         Debug(Debug::ERROR) << "Only the query OR the target database can be a profile database.\n";
-        return EXIT_FAILURE;
+        return false;
     }
 
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_AMINO_ACIDS) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_NUCLEOTIDES)) {
         Debug(Debug::ERROR) << "The prefilter can not search amino acids against nucleotides. Something might got wrong while createdb or createindex.\n";
-        return EXIT_FAILURE;
+        return false;
     }
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_NUCLEOTIDES) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_AMINO_ACIDS)) {
         Debug(Debug::ERROR) << "The prefilter can not search nucleotides against amino acids. Something might got wrong while createdb or createindex.\n";
+        return false;
+    }
+    return true;
+}
+
+int prefilter(int argc, const char **argv, const Command& command) {
+    MMseqsMPI::init(argc, argv);
+
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER);
+
+    int queryDbType;
+    int targetDbType;
+    if (getSearchDbTypes(par, queryDbType, targetDbType) == false) {
         return EXIT_FAILURE;
     }
 
@@ -60,3 +69,37 @@ int prefilter(int argc, const char **argv, const Command& command) {
 
     return EXIT_SUCCESS;
 }
+
+int prefilteralign(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_ALIGN);
+
+    int queryDbType;
+    int targetDbType;
+    if (getSearchDbTypes(par, queryDbType, targetDbType) == false) {
+        return EXIT_FAILURE;
+    }
+
+    std::pair<std::string, std::string> prefDb;
+    {
+        Prefiltering pref(par.db1, par.db1Index, par.db2, par.db2Index, queryDbType, targetDbType, par);
+        if (pref.canAlignInline()) {
+            Alignment aln(par.db1, par.db2, "", "", par.db3, par.db3Index, par, false);
+            pref.setAligner(&aln);
+            pref.runAllSplits(par.db3, par.db3Index);
+            return EXIT_SUCCESS;
+        }
+
+        // each target split only sees part of the hits of a query, they have to be merged before aligning
+        Debug(Debug::INFO) << "Target split mode cannot align inline. Writing prefilter result first\n";
+        prefDb = Util::databaseNames(par.db3 + "_pref");
+        pref.runAllSplits(prefDb.first, prefDb.second);
+    }
+
+    Alignment aln(par.db1, par.db2, prefDb.first, prefDb.second, par.db3, par.db3Index, par, false);
+    Debug(Debug::INFO) << "Calculation of alignments\n";
+    aln.run();
+    DBReader<unsigned int>::removeDb(prefDb.first);
+
+    return EXIT_SUCCESS;
+}
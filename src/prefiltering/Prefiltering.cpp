@@ -1,4 +1,5 @@
 #include "Prefiltering.h"
+#include "Alignment.h"
 #include "NucleotideMatrix.h"
 #include "ReducedMatrix.h"
 #include "ExtendedSubstitutionMatrix.h"
@@ -13,6 +14,8 @@
 #include "Parameters.h"
 #include "MemoryMapped.h"
 #include "FastSort.h"
+#include "NumaUtil.h"
+#include "HugePages.h"
 #include <sys/mman.h>
 
 #ifdef OPENMP
@@ -34,6 +37,10 @@ Prefiltering::Prefiltering(const std::string &queryDB,
         spacedKmerPattern(par.spacedKmerPattern),
         localTmp(par.localTmp),
         spacedKmer(par.spacedKmer != 0),
+        compactIndex(par.compactIndex),
+        queryBatchSize(static_cast<size_t>(par.queryBatchSize)),
+        kmerListCacheSize(par.kmerListCacheSize),
+        numaMode(par.numaMode),
         maskMode(par.maskMode),
         maskLowerCaseMode(par.maskLowerCaseMode),
         splitMode(par.splitMode),
@@ -50,8 +57,13 @@ Prefiltering::Prefiltering(const std::string &queryDB,
         aaBiasCorrection(par.compBiasCorrection != 0),
         covThr(par.covThr), covMode(par.covMode), includeIdentical(par.includeIdentity),
         preloadMode(par.preloadMode),
-        threads(static_cast<unsigned int>(par.threads)), compressed(par.compressed) {
+        threads(static_cast<unsigned int>(par.threads)), compressed(par.compressed),
+        outputDbType(Parameters::DBTYPE_PREFILTER_RES), aligner(NULL) {
     sameQTDB = isSameQTDB();
+    HugePages::setMode(par.hugePages);
+    if (par.prefilterOutputMode == Parameters::PREFILTER_OUTPUT_BINARY) {
+        outputDbType = DBReader<unsigned int>::setExtendedDbtype(outputDbType, Parameters::DBTYPE_EXTENDED_BINARY);
+    }
 
     // init the substitution matrices
     switch (querySeqType & Parameters::DBTYPE_MASK) {
@@ -84,6 +96,11 @@ Prefiltering::Prefiltering(const std::string &queryDB,
                 preloadMode = Parameters::PRELOAD_MODE_MMAP_TOUCH;
             }
         }
+        // pages of the mapped index file can not be replaced by huge pages, copy it into memory instead
+        if (par.hugePages != HugePages::MODE_NONE && preloadMode != Parameters::PRELOAD_MODE_FREAD) {
+            Debug(Debug::INFO) << "Index is copied into huge pages\n";
+            preloadMode = Parameters::PRELOAD_MODE_FREAD;
+        }
 
         tidxdbr = new DBReader<unsigned int>(targetDB.c_str(), targetDBIndex.c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
         tidxdbr->open(DBReader<unsigned int>::NOSORT);
@@ -149,6 +166,7 @@ Prefiltering::Prefiltering(const std::string &queryDB,
             }
             spacedKmer = data.spacedKmer != 0;
             spacedKmerPattern = PrefilteringIndexReader::getSpacedPattern(tidxdbr);
+            compactIndex = PrefilteringIndexReader::isCompactIndex(tidxdbr);
             seedScoringMatrixFile = MultiParam<NuclAA<std::string>>(PrefilteringIndexReader::getSubstitutionMatrix(tidxdbr));
         } else {
             Debug(Debug::ERROR) << "Outdated index version. Please recompute it with 'createindex'!\n";
@@ -185,7 +203,7 @@ Prefiltering::Prefiltering(const std::string &queryDB,
     Debug(Debug::INFO) << "Query database size: " << qdbr->getSize() << " type: " << Parameters::getDbTypeName(querySeqType) << "\n";
 
     setupSplit(*tdbr, alphabetSize - 1, querySeqType,
-               threads, templateDBIsIndex, memoryLimit, qdbr->getSize(),
+               threads, templateDBIsIndex, memoryLimit, qdbr->getSize(), compactIndex,
                maxResListLen, kmerSize, splits, splitMode);
 
     if(Parameters::isEqualDbtype(targetSeqType, Parameters::DBTYPE_NUCLEOTIDES) == false){
@@ -254,11 +272,11 @@ Prefiltering::~Prefiltering() {
 }
 
 void Prefiltering::setupSplit(DBReader<unsigned int>& tdbr, const int alphabetSize, const unsigned int querySeqTyp, const int threads,
-                              const bool templateDBIsIndex, const size_t memoryLimit, const size_t qDbSize,
+                              const bool templateDBIsIndex, const size_t memoryLimit, const size_t qDbSize, const bool compactIndex,
                               size_t &maxResListLen, int &kmerSize, int &split, int &splitMode) {
     size_t memoryNeeded = estimateMemoryConsumption(1, tdbr.getSize(), tdbr.getAminoAcidDBSize(), maxResListLen, alphabetSize,
                                                     kmerSize == 0 ? // if auto detect kmerSize
-                                                    IndexTable::computeKmerSize(tdbr.getAminoAcidDBSize()) : kmerSize, querySeqTyp, threads);
+                                                    IndexTable::computeKmerSize(tdbr.getAminoAcidDBSize()) : kmerSize, querySeqTyp, threads, compactIndex);
 
     int optimalSplitMode = Parameters::TARGET_DB_SPLIT;
     if (memoryNeeded > 0.9 * memoryLimit) {
@@ -291,7 +309,7 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& tdbr, const int alphabetSi
     if (memoryNeeded > 0.9 * memoryLimit) {
         // memory is not enough to compute everything at once
         //TODO add PROFILE_STATE (just 6-mers)
-        std::pair<int, int> splitSettings = Prefiltering::optimizeSplit(memoryLimit, &tdbr, alphabetSize, kmerSize, querySeqTyp, threads);
+        std::pair<int, int> splitSettings = Prefiltering::optimizeSplit(memoryLimit, &tdbr, alphabetSize, kmerSize, querySeqTyp, threads, compactIndex);
         if (splitSettings.second == -1) {
             Debug(Debug::ERROR) << "Cannot fit databases into " << ByteParser::format(memoryLimit) << ". Please use a computer with more main memory.\n";
             EXIT(EXIT_FAILURE);
@@ -348,7 +366,7 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& tdbr, const int alphabetSi
     }
 
     size_t memoryNeededPerSplit = estimateMemoryConsumption((splitMode == Parameters::TARGET_DB_SPLIT) ? split : 1, tdbr.getSize(),
-                                                            tdbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, kmerSize, querySeqTyp, threads);
+                                                            tdbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, kmerSize, querySeqTyp, threads, compactIndex);
     Debug(Debug::INFO) << "Estimated memory consumption: " << ByteParser::format(memoryNeededPerSplit) << "\n";
     if (memoryNeededPerSplit > 0.9 * memoryLimit) {
         Debug(Debug::WARNING) << "Process needs more than " << ByteParser::format(memoryLimit) << " main memory.\n" <<
@@ -373,6 +391,12 @@ void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string
     Debug(Debug::INFO) << "Merging " << splits << " target splits to " << FileUtil::baseName(outDB) << "\n";
     DBReader<unsigned int> reader1(fileNames[0].first.c_str(), fileNames[0].second.c_str(), 1, DBReader<unsigned int>::USE_INDEX);
     reader1.open(DBReader<unsigned int>::NOSORT);
+    if (DBReader<unsigned int>::getExtendedDbtype(reader1.getDbtype()) & Parameters::DBTYPE_EXTENDED_BINARY) {
+        reader1.close();
+        mergeBinaryTargetSplits(outDB, outDBIndex, fileNames, threads);
+        Debug(Debug::INFO) << "Time for merging target splits: " << timer.lap() << "\n";
+        return;
+    }
     DBReader<unsigned int>::Index *index1 = reader1.getIndex();
 
     size_t totalSize = 0;
@@ -478,6 +502,59 @@ void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string
     Debug(Debug::INFO) << "Time for merging target splits: " << timer.lap() << "\n";
 }
 
+void Prefiltering::mergeBinaryTargetSplits(const std::string &outDB, const std::string &outDBIndex, const std::vector<std::pair<std::string, std::string>> &fileNames, unsigned int threads) {
+    // binary entries cannot be located by scanning for null bytes, so every split is accessed through its index
+    const size_t splits = fileNames.size();
+    std::vector<DBReader<unsigned int>*> readers;
+    for (size_t i = 0; i < splits; ++i) {
+        DBReader<unsigned int> *reader = new DBReader<unsigned int>(fileNames[i].first.c_str(), fileNames[i].second.c_str(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+        reader->open(DBReader<unsigned int>::NOSORT);
+        if (i > 0 && reader->getSize() != readers[0]->getSize()) {
+            Debug(Debug::ERROR) << "Target split " << fileNames[i].first << " has a different number of entries\n";
+            EXIT(EXIT_FAILURE);
+        }
+        readers.push_back(reader);
+    }
+
+    DBWriter writer(outDB.c_str(), outDBIndex.c_str(), threads, 0, readers[0]->getDbtype());
+    writer.open();
+
+    Debug::Progress progress(readers[0]->getSize());
+#pragma omp parallel num_threads(threads)
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        std::string result;
+        result.reserve(1024);
+        std::vector<hit_t> hits;
+        hits.reserve(300);
+
+#pragma omp for schedule(dynamic, 10)
+        for (size_t id = 0; id < readers[0]->getSize(); id++) {
+            progress.updateProgress();
+            for (size_t file = 0; file < splits; file++) {
+                QueryMatcher::parsePrefilterHits(readers[file]->getData(id, thread_idx), hits);
+            }
+            if (hits.size() > 1) {
+                SORT_SERIAL(hits.begin(), hits.end(), hit_t::compareHitsByScoreAndId);
+            }
+            QueryMatcher::prefilterHitsToBinaryBuffer(result, hits.data(), hits.size());
+            writer.writeData(result.c_str(), result.size(), readers[0]->getDbKey(id), thread_idx);
+            hits.clear();
+            result.clear();
+        }
+    }
+    writer.close();
+
+    for (size_t i = 0; i < splits; ++i) {
+        readers[i]->close();
+        delete readers[i];
+        DBReader<unsigned int>::removeDb(fileNames[i].first);
+    }
+}
+
 
 ScoreMatrix Prefiltering::getScoreMatrix(const BaseMatrix& matrix, const size_t kmerSize) {
     if (templateDBIsIndex == true) {
@@ -528,9 +605,28 @@ void Prefiltering::getIndexTable(int split, size_t dbFrom, size_t dbSize) {
         }
 
         indexTable->printStatistics(kmerSubMat->num2aa);
+        if (compactIndex) {
+            indexTable->compactEntries();
+        }
         tdbr->remapData();
         Debug(Debug::INFO) << "Time for index table init: " << timer.lap() << "\n";
     }
+
+    if (numaMode == Parameters::NUMA_MODE_INTERLEAVE) {
+        std::vector<int> nodes = NumaUtil::getNodes();
+        if (nodes.size() < 2) {
+            Debug(Debug::WARNING) << "Only one NUMA node available. Index is not interleaved\n";
+            return;
+        }
+        const void *entries = indexTable->isCompact() ? (const void *) indexTable->getPackedEntries() : (const void *) indexTable->getEntries();
+        NumaUtil::interleave(entries, indexTable->getEntriesSize(), nodes);
+        NumaUtil::interleave(indexTable->getOffsets(), (indexTable->getTableSize() + 1) * sizeof(size_t), nodes);
+        if (sequenceLookup != NULL) {
+            NumaUtil::interleave(sequenceLookup->getData(), sequenceLookup->getDataSize() + 1, nodes);
+            NumaUtil::interleave(sequenceLookup->getOffsets(), (sequenceLookup->getSequenceCount() + 1) * sizeof(size_t), nodes);
+        }
+        Debug(Debug::INFO) << "Index interleaved over " << nodes.size() << " NUMA nodes\n";
+    }
 }
 
 bool Prefiltering::isSameQTDB() {
@@ -548,6 +644,15 @@ bool Prefiltering::isSameQTDB() {
     return (queryDB.compare(targetDB) == 0 || (match == true));
 }
 
+void Prefiltering::setAligner(Alignment *aligner) {
+    this->aligner = aligner;
+    outputDbType = aligner->getOutputDbtype();
+}
+
+bool Prefiltering::canAlignInline() const {
+    return splits == 1 || splitMode == Parameters::QUERY_DB_SPLIT;
+}
+
 void Prefiltering::runAllSplits(const std::string &resultDB, const std::string &resultDBIndex) {
     runSplits(resultDB, resultDBIndex, 0, splits, false);
 }
@@ -630,7 +735,7 @@ void Prefiltering::runMpiSplits(const std::string &resultDB, const std::string &
             // merge output databases
             mergePrefilterSplits(resultDB, resultDBIndex, splitFiles);
         } else {
-            DBWriter writer(resultDB.c_str(), resultDBIndex.c_str(), 1, compressed, Parameters::DBTYPE_PREFILTER_RES);
+            DBWriter writer(resultDB.c_str(), resultDBIndex.c_str(), 1, compressed, outputDbType);
             writer.open();
             writer.close();
         }
@@ -679,7 +784,7 @@ int Prefiltering::runSplits(const std::string &resultDB, const std::string &resu
                 resultReader.open(DBReader<unsigned int>::NOSORT);
                 resultReader.readMmapedDataInMemory();
                 const std::pair<std::string, std::string> tempDb = Util::databaseNames(resultDB + "_tmp");
-                DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), threads, compressed, Parameters::DBTYPE_PREFILTER_RES);
+                DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), threads, compressed, outputDbType);
                 resultWriter.open();
                 resultWriter.sortDatafileByIdOrder(resultReader);
                 resultWriter.close(true);
@@ -694,7 +799,7 @@ int Prefiltering::runSplits(const std::string &resultDB, const std::string &resu
             hasResult = true;
         }
     } else if (splitProcessCount == 0) {
-        DBWriter writer(resultDB.c_str(), resultDBIndex.c_str(), 1, compressed, Parameters::DBTYPE_PREFILTER_RES);
+        DBWriter writer(resultDB.c_str(), resultDBIndex.c_str(), 1, compressed, outputDbType);
         writer.open();
         writer.close();
         hasResult = false;
@@ -713,7 +818,11 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
 
     // create index table based on split parameter
     if (splitMode == Parameters::TARGET_DB_SPLIT) {
-        tdbr->decomposeDomainByAminoAcid(split, splits, &dbFrom, &dbSize);
+        if (templateDBIsIndex) {
+            PrefilteringIndexReader::getSplitRange(tidxdbr, split, tdbr, splits, &dbFrom, &dbSize);
+        } else {
+            tdbr->decomposeDomainByAminoAcid(split, splits, &dbFrom, &dbSize);
+        }
         if (dbSize == 0) {
             return false;
         }
@@ -747,13 +856,19 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
     size_t diagonalOverflow = 0;
     size_t trancatedCounter = 0;
     size_t totalQueryDBSize = querySize;
+    size_t alignmentsNum = 0;
+    size_t totalPassedNum = 0;
+    size_t kmerListCacheLookups = 0;
+    size_t kmerListCacheHits = 0;
+    size_t hugePageCount = 0;
+    size_t hugePageBytes = 0;
 
     size_t localThreads = 1;
 #ifdef OPENMP
     localThreads = std::max(std::min((size_t)threads, querySize), (size_t)1);
 #endif
 
-    DBWriter tmpDbw(resultDB.c_str(), resultDBIndex.c_str(), localThreads, compressed, Parameters::DBTYPE_PREFILTER_RES);
+    DBWriter tmpDbw(resultDB.c_str(), resultDBIndex.c_str(), localThreads, compressed, outputDbType);
     tmpDbw.open();
 
     // init all thread-specific data structures
@@ -770,21 +885,68 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
     Debug(Debug::INFO) << "Target db start " << (dbFrom + 1) << " to " << dbFrom + dbSize << "\n";
     Debug::Progress progress(querySize);
 
+    // similar k-mer lists only depend on the k-mer and threshold for substitution matrices
+    KmerListCache *kmerListCache = NULL;
+    if (kmerListCacheSize > 0 && Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_HMM_PROFILE) == false && takeOnlyBestKmer == false) {
+        kmerListCache = new KmerListCache(kmerListCacheSize);
+    }
+
+    // each node gets its own copy of the index, written by a thread pinned to the node
+    // so that the pages are allocated locally; node 0 keeps the loaded index
+    std::vector<int> nodes(1, 0);
+    std::vector<IndexTable *> nodeIndexTables(1, indexTable);
+    std::vector<SequenceLookup *> nodeSequenceLookups(1, sequenceLookup);
+    if (numaMode == Parameters::NUMA_MODE_REPLICATE) {
+        nodes = NumaUtil::getNodes();
+        if (nodes.size() < 2) {
+            Debug(Debug::WARNING) << "Only one NUMA node available. Index is not replicated\n";
+        }
+        for (size_t i = 1; i < nodes.size(); i++) {
+            std::vector<int> previousCpus;
+            NumaUtil::pinThreadToNode(nodes[i], previousCpus);
+            IndexTable *copy = new IndexTable(indexTable->getAlphabetSize(), indexTable->getKmerSize(), false);
+            char *entries = indexTable->isCompact() ? (char *) indexTable->getPackedEntries() : (char *) indexTable->getEntries();
+            copy->initTableByExternalDataCopy(indexTable->getSize(), indexTable->getTableEntriesNum(), entries, indexTable->getOffsets(), indexTable->isCompact());
+            nodeIndexTables.push_back(copy);
+            SequenceLookup *lookupCopy = NULL;
+            if (sequenceLookup != NULL) {
+                lookupCopy = new SequenceLookup(sequenceLookup->getSequenceCount(), sequenceLookup->getDataSize());
+                lookupCopy->initLookupByExternalDataCopy((char *) sequenceLookup->getData(), sequenceLookup->getOffsets());
+            }
+            nodeSequenceLookups.push_back(lookupCopy);
+            NumaUtil::setThreadCpus(previousCpus);
+        }
+        if (nodes.size() > 1) {
+            Debug(Debug::INFO) << "Index replicated on " << nodes.size() << " NUMA nodes\n";
+        }
+    }
+
 #pragma omp parallel num_threads(localThreads)
     {
         unsigned int thread_idx = 0;
 #ifdef OPENMP
         thread_idx = static_cast<unsigned int>(omp_get_thread_num());
 #endif
-        Sequence seq(qdbr->getMaxSeqLen(), querySeqType, kmerSubMat, kmerSize, spacedKmer, aaBiasCorrection, true, spacedKmerPattern);
-        QueryMatcher matcher(indexTable, sequenceLookup, kmerSubMat,  ungappedSubMat,
+        size_t node = 0;
+        std::vector<int> previousCpus;
+        if (nodes.size() > 1) {
+            node = NumaUtil::getThreadNode(thread_idx, localThreads, nodes.size());
+            NumaUtil::pinThreadToNode(nodes[node], previousCpus);
+        }
+        // queries of a batch are mapped at the same time so that the matcher can gather their index hits together
+        std::vector<Sequence *> batchSequences(queryBatchSize);
+        for (size_t i = 0; i < queryBatchSize; i++) {
+            batchSequences[i] = new Sequence(qdbr->getMaxSeqLen(), querySeqType, kmerSubMat, kmerSize, spacedKmer, aaBiasCorrection, true, spacedKmerPattern);
+        }
+        QueryMatcher matcher(nodeIndexTables[node], nodeSequenceLookups[node], kmerSubMat,  ungappedSubMat,
                              kmerThr, kmerSize, dbSize, std::max(tdbr->getMaxSeqLen(),qdbr->getMaxSeqLen()), maxResListLen, aaBiasCorrection,
                              diagonalScoring, minDiagScoreThr, takeOnlyBestKmer, targetSeqType==Parameters::DBTYPE_NUCLEOTIDES);
 
-        if (seq.profile_matrix != NULL) {
-            matcher.setProfileMatrix(seq.profile_matrix);
+        if (batchSequences[0]->profile_matrix != NULL) {
+            matcher.setProfileMatrix(batchSequences[0]->profile_matrix);
         } else if (_3merSubMatrix.isValid() && _2merSubMatrix.isValid()) {
             matcher.setSubstitutionMatrix(&_3merSubMatrix, &_2merSubMatrix);
+            matcher.setKmerListCache(kmerListCache);
         } else {
             matcher.setSubstitutionMatrix(NULL, NULL);
         }
@@ -792,76 +954,132 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
         char buffer[128];
         std::string result;
         result.reserve(1000000);
+        std::vector<hit_t> passedHits;
+        const bool binaryOutput = aligner == NULL && (DBReader<unsigned int>::getExtendedDbtype(outputDbType) & Parameters::DBTYPE_EXTENDED_BINARY);
+        Alignment::ThreadData *alignerData = NULL;
+        if (aligner != NULL) {
+            alignerData = new Alignment::ThreadData(*aligner);
+        }
 
-#pragma omp for schedule(dynamic, 2) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow, trancatedCounter)
-        for (size_t id = queryFrom; id < queryFrom + querySize; id++) {
-            progress.updateProgress();
-            // get query sequence
-            char *seqData = qdbr->getData(id, thread_idx);
-            unsigned int qKey = qdbr->getDbKey(id);
-            seq.mapSequence(id, qKey, seqData, qdbr->getSeqLen(id));
-            size_t targetSeqId = UINT_MAX;
-            if (sameQTDB || includeIdentical) {
-                targetSeqId = tdbr->getId(seq.getDbKey());
-                // only the corresponding split should include the id (hack for the hack)
-                if (targetSeqId >= dbFrom && targetSeqId < (dbFrom + dbSize) && targetSeqId != UINT_MAX) {
-                    targetSeqId = targetSeqId - dbFrom;
-                    if(targetSeqId > tdbr->getSize()){
-                        Debug(Debug::ERROR) << "targetSeqId: " << targetSeqId << " > target database size: "  << tdbr->getSize() <<  "\n";
-                        EXIT(EXIT_FAILURE);
+        // without batching each thread takes two queries at a time
+        const size_t blockSize = queryBatchSize > 1 ? queryBatchSize : 2;
+#pragma omp for schedule(dynamic, 1) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow, trancatedCounter, alignmentsNum, totalPassedNum, kmerListCacheLookups, kmerListCacheHits)
+        for (size_t blockStart = queryFrom; blockStart < queryFrom + querySize; blockStart += blockSize) {
+            const size_t blockEnd = std::min(blockStart + blockSize, queryFrom + querySize);
+            size_t batchStart = blockStart;
+            size_t batchEnd = blockStart;
+            for (size_t id = blockStart; id < blockEnd; id++) {
+                progress.updateProgress();
+                if (id == batchEnd) {
+                    // get query sequences
+                    batchStart = id;
+                    const size_t batchCount = std::min(blockEnd - id, queryBatchSize);
+                    for (size_t i = 0; i < batchCount; i++) {
+                        char *seqData = qdbr->getData(id + i, thread_idx);
+                        batchSequences[i]->mapSequence(id + i, qdbr->getDbKey(id + i), seqData, qdbr->getSeqLen(id + i));
                     }
-                }else{
-                    targetSeqId = UINT_MAX;
+                    batchEnd = id + ((queryBatchSize > 1) ? matcher.gatherBatch(batchSequences.data(), batchCount) : 1);
                 }
-            }
-            // calculate prefiltering results
-            std::pair<hit_t *, size_t> prefResults = matcher.matchQuery(&seq, targetSeqId, targetSeqType==Parameters::DBTYPE_NUCLEOTIDES);
-            size_t resultSize = prefResults.second;
-            const float queryLength = static_cast<float>(qdbr->getSeqLen(id));
-            for (size_t i = 0; i < resultSize; i++) {
-                hit_t *res = prefResults.first + i;
-                // correct the 0 indexed sequence id again to its real identifier
-                size_t targetSeqId1 = res->seqId + dbFrom;
-                // replace id with key
-                res->seqId = tdbr->getDbKey(targetSeqId1);
-                if (UNLIKELY(targetSeqId1 >= tdbr->getSize())) {
-                    Debug(Debug::WARNING) << "Wrong prefiltering result for query: " << qdbr->getDbKey(id) << " -> " << targetSeqId1 << "\t" << res->prefScore << "\n";
+                Sequence &seq = *batchSequences[id - batchStart];
+                unsigned int qKey = seq.getDbKey();
+                size_t targetSeqId = UINT_MAX;
+                if (sameQTDB || includeIdentical) {
+                    targetSeqId = tdbr->getId(seq.getDbKey());
+                    // only the corresponding split should include the id (hack for the hack)
+                    if (targetSeqId >= dbFrom && targetSeqId < (dbFrom + dbSize) && targetSeqId != UINT_MAX) {
+                        targetSeqId = targetSeqId - dbFrom;
+                        if(targetSeqId > tdbr->getSize()){
+                            Debug(Debug::ERROR) << "targetSeqId: " << targetSeqId << " > target database size: "  << tdbr->getSize() <<  "\n";
+                            EXIT(EXIT_FAILURE);
+                        }
+                    }else{
+                        targetSeqId = UINT_MAX;
+                    }
                 }
+                // calculate prefiltering results
+                std::pair<hit_t *, size_t> prefResults = matcher.matchQuery(&seq, targetSeqId, targetSeqType==Parameters::DBTYPE_NUCLEOTIDES);
+                size_t resultSize = prefResults.second;
+                const float queryLength = static_cast<float>(qdbr->getSeqLen(id));
+                for (size_t i = 0; i < resultSize; i++) {
+                    hit_t *res = prefResults.first + i;
+                    // correct the 0 indexed sequence id again to its real identifier
+                    size_t targetSeqId1 = res->seqId + dbFrom;
+                    // replace id with key
+                    res->seqId = tdbr->getDbKey(targetSeqId1);
+                    if (UNLIKELY(targetSeqId1 >= tdbr->getSize())) {
+                        Debug(Debug::WARNING) << "Wrong prefiltering result for query: " << qdbr->getDbKey(id) << " -> " << targetSeqId1 << "\t" << res->prefScore << "\n";
+                    }
+
+                    // TODO: check if this should happen when diagonalScoring == false
+                    if (covThr > 0.0 && (covMode == Parameters::COV_MODE_BIDIRECTIONAL
+                                                   || covMode == Parameters::COV_MODE_QUERY
+                                                   || covMode == Parameters::COV_MODE_LENGTH_SHORTER )) {
+                        const float targetLength = static_cast<float>(tdbr->getSeqLen(targetSeqId1));
+                        if (Util::canBeCovered(covThr, covMode, queryLength, targetLength) == false) {
+                            continue;
+                        }
+                    }
 
-                // TODO: check if this should happen when diagonalScoring == false
-                if (covThr > 0.0 && (covMode == Parameters::COV_MODE_BIDIRECTIONAL
-                                               || covMode == Parameters::COV_MODE_QUERY
-                                               || covMode == Parameters::COV_MODE_LENGTH_SHORTER )) {
-                    const float targetLength = static_cast<float>(tdbr->getSeqLen(targetSeqId1));
-                    if (Util::canBeCovered(covThr, covMode, queryLength, targetLength) == false) {
+                    if (binaryOutput || aligner != NULL) {
+                        passedHits.push_back(*res);
                         continue;
                     }
+                    // write prefiltering results to a string
+                    int len = QueryMatcher::prefilterHitToBuffer(buffer, *res);
+                    result.append(buffer, len);
                 }
+                if (aligner != NULL) {
+                    aligner->alignQuery(*alignerData, qKey, passedHits, result, thread_idx, alignmentsNum, totalPassedNum);
+                    passedHits.clear();
+                } else if (binaryOutput) {
+                    QueryMatcher::prefilterHitsToBinaryBuffer(result, passedHits.data(), passedHits.size());
+                    passedHits.clear();
+                }
+                tmpDbw.writeData(result.c_str(), result.length(), qKey, thread_idx);
+                result.clear();
 
-                // write prefiltering results to a string
-                int len = QueryMatcher::prefilterHitToBuffer(buffer, *res);
-                result.append(buffer, len);
-            }
-            tmpDbw.writeData(result.c_str(), result.length(), qKey, thread_idx);
-            result.clear();
-
-            // update statistics counters
-            if (resultSize != 0) {
-                notEmpty[id - queryFrom] = 1;
-            }
+                // update statistics counters
+                if (resultSize != 0) {
+                    notEmpty[id - queryFrom] = 1;
+                }
 
-            if (Debug::debugLevel >= Debug::INFO) {
-                kmersPerPos += matcher.getStatistics()->kmersPerPos;
-                dbMatches += matcher.getStatistics()->dbMatches;
-                doubleMatches += matcher.getStatistics()->doubleMatches;
-                querySeqLenSum += seq.L;
-                diagonalOverflow += matcher.getStatistics()->diagonalOverflow;
-                trancatedCounter += matcher.getStatistics()->truncated;
-                resSize += resultSize;
-                realResSize += std::min(resultSize, maxResListLen);
-                reslens[thread_idx]->emplace_back(resultSize);
+                if (Debug::debugLevel >= Debug::INFO) {
+                    kmersPerPos += matcher.getStatistics()->kmersPerPos;
+                    dbMatches += matcher.getStatistics()->dbMatches;
+                    doubleMatches += matcher.getStatistics()->doubleMatches;
+                    querySeqLenSum += seq.L;
+                    diagonalOverflow += matcher.getStatistics()->diagonalOverflow;
+                    trancatedCounter += matcher.getStatistics()->truncated;
+                    kmerListCacheLookups += matcher.getStatistics()->kmerListCacheLookups;
+                    kmerListCacheHits += matcher.getStatistics()->kmerListCacheHits;
+                    resSize += resultSize;
+                    realResSize += std::min(resultSize, maxResListLen);
+                    reslens[thread_idx]->emplace_back(resultSize);
+                }
             }
         } // step end
+
+        if (HugePages::getMode() != HugePages::MODE_NONE) {
+            // count while the diagonal buffers of every thread are still allocated
+#pragma omp master
+            hugePageCount = HugePages::countHugePages(&hugePageBytes);
+#pragma omp barrier
+        }
+
+        if (alignerData != NULL) {
+            delete alignerData;
+        }
+        for (size_t i = 0; i < batchSequences.size(); i++) {
+            delete batchSequences[i];
+        }
+        NumaUtil::setThreadCpus(previousCpus);
+    }
+    if (kmerListCache != NULL) {
+        delete kmerListCache;
+    }
+    for (size_t i = 1; i < nodeIndexTables.size(); i++) {
+        delete nodeIndexTables[i];
+        delete nodeSequenceLookups[i];
     }
 
     if (Debug::debugLevel >= Debug::INFO) {
@@ -870,6 +1088,8 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
                            doubleMatches / totalQueryDBSize,
                            querySeqLenSum, diagonalOverflow,
                            resSize / totalQueryDBSize, trancatedCounter);
+        stats.kmerListCacheLookups = kmerListCacheLookups;
+        stats.kmerListCacheHits = kmerListCacheHits;
 
         size_t empty = 0;
         for (size_t id = 0; id < querySize; id++) {
@@ -879,6 +1099,12 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
         }
 
         printStatistics(stats, reslens, localThreads, empty, maxResListLen);
+        if (HugePages::getMode() != HugePages::MODE_NONE) {
+            Debug(Debug::INFO) << hugePageCount << " huge pages obtained for " << hugePageBytes / 1024 / 1024 << " MB of huge page allocations\n";
+        }
+    }
+    if (aligner != NULL) {
+        Alignment::printStatistics(alignmentsNum, totalPassedNum, querySize);
     }
 
     if (splitMode == Parameters::TARGET_DB_SPLIT && splits == 1) {
@@ -909,7 +1135,7 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
         resultReader.open(DBReader<unsigned int>::NOSORT);
         resultReader.readMmapedDataInMemory();
         const std::pair<std::string, std::string> tempDb = Util::databaseNames((resultDB + "_tmp"));
-        DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), localThreads, compressed, Parameters::DBTYPE_PREFILTER_RES);
+        DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), localThreads, compressed, outputDbType);
         resultWriter.open();
         resultWriter.sortDatafileByIdOrder(resultReader);
         resultWriter.close(true);
@@ -940,6 +1166,10 @@ void Prefiltering::printStatistics(const statistics_t &stats, std::list<int> **r
     Debug(Debug::INFO) << stats.dbMatches << " DB matches per sequence\n";
     Debug(Debug::INFO) << stats.diagonalOverflow << " overflows\n";
     Debug(Debug::INFO) << stats.truncated << " queries produce too many hits (truncated result)\n";
+    if (stats.kmerListCacheLookups > 0) {
+        Debug(Debug::INFO) << (100.0 * stats.kmerListCacheHits / stats.kmerListCacheLookups) << "% k-mer list cache hits ("
+                           << stats.kmerListCacheHits << " of " << stats.kmerListCacheLookups << " lookups)\n";
+    }
     Debug(Debug::INFO) << stats.resultsPassedPrefPerSeq << " sequences passed prefiltering per query sequence";
     if (stats.resultsPassedPrefPerSeq > maxResults)
         Debug(Debug::WARNING) << " (ATTENTION: max. " << maxResults
@@ -1035,12 +1265,20 @@ int Prefiltering::getKmerThreshold(const float sensitivity, const bool isProfile
 size_t Prefiltering::estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
                                                size_t maxResListLen,
                                                int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                               int threads) {
+                                               int threads, bool compactIndex) {
     // for each residue in the database we need 7 byte
     size_t dbSizeSplit = (dbSize) / split;
     size_t residueSize = (resSize / split * 7);
     // 21^7 * pointer size is needed for the index
     size_t indexTableSize = static_cast<size_t>(pow(alphabetSize, kmerSize)) * sizeof(size_t);
+    if (compactIndex) {
+        // compact entries need 2 byte for the position and the width of the id delta within a k-mer list
+        // and a block header per 16 entries, the lookup still needs 1 byte
+        const double avgKmerListLen = std::max(1.0, static_cast<double>(resSize / split) / pow(alphabetSize, kmerSize));
+        const double avgIdDelta = static_cast<double>(dbSizeSplit) / avgKmerListLen;
+        const size_t deltaBytes = (avgIdDelta < 256.0) ? 1 : (avgIdDelta < 65536.0) ? 2 : (avgIdDelta < 16777216.0) ? 3 : 4;
+        residueSize = (resSize / split) * (1 + 2 + deltaBytes) + (resSize / split) / 16;
+    }
     // memory needed for the threads
     // This memory is an approx. for Countint32Array and QueryTemplateLocalFast
     size_t threadSize = threads * (
@@ -1071,7 +1309,7 @@ size_t Prefiltering::estimateHDDMemoryConsumption(size_t dbSize, size_t maxResLi
 }
 
 std::pair<int, int> Prefiltering::optimizeSplit(size_t totalMemoryInByte, DBReader<unsigned int> *tdbr,
-                                                int alphabetSize, int externalKmerSize, unsigned int querySeqType, unsigned int threads) {
+                                                int alphabetSize, int externalKmerSize, unsigned int querySeqType, unsigned int threads, bool compactIndex) {
 
     int startKmerSize = (externalKmerSize == 0) ? 6 : externalKmerSize;
     int endKmerSize   = (externalKmerSize == 0) ? 7 : externalKmerSize;
@@ -1095,7 +1333,7 @@ std::pair<int, int> Prefiltering::optimizeSplit(size_t totalMemoryInByte, DBRead
                 size_t neededSize = estimateMemoryConsumption(optSplit, tdbr->getSize(),
                                                               tdbr->getAminoAcidDBSize(),
                                                               0, alphabetSize, optKmerSize, querySeqType,
-                                                              threads);
+                                                              threads, compactIndex);
                 if (neededSize < 0.9 * totalMemoryInByte) {
                     return std::make_pair(optKmerSize, optSplit);
                 }
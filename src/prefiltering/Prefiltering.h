@@ -13,6 +13,8 @@
 #include <list>
 #include <utility>
 
+class Alignment;
+
 class Prefiltering {
 public:
     Prefiltering(
@@ -33,6 +35,12 @@ public:
 
     int runSplits(const std::string &resultDB, const std::string &resultDBIndex, size_t fromSplit, size_t splitProcessCount, bool merge);
 
+    // align the hits of each query right away and write the alignment result instead of the prefilter result
+    void setAligner(Alignment *aligner);
+
+    // inline alignment needs all targets of a query within a single split
+    bool canAlignInline() const;
+
     // merge file
     void mergePrefilterSplits(const std::string &outDb, const std::string &outDBIndex,
                     const std::vector<std::pair<std::string, std::string>> &splitFiles);
@@ -41,7 +49,7 @@ public:
     static BaseMatrix *getSubstitutionMatrix(const MultiParam<NuclAA<std::string>> &scoringMatrixFile, MultiParam<NuclAA<int>> alphabetSize, float bitFactor, bool profileState, bool isNucl);
 
     static void setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqType, const int threads,
-                           const bool templateDBIsIndex, const size_t memoryLimit, const size_t qDbSize,
+                           const bool templateDBIsIndex, const size_t memoryLimit, const size_t qDbSize, const bool compactIndex,
                            size_t& maxResListLen, int& kmerSize, int& split, int& splitMode);
 
     static int getKmerThreshold(const float sensitivity, const bool isProfile, const bool hasContextPseudoCnts,
@@ -50,6 +58,9 @@ public:
     static void mergeTargetSplits(const std::string &outDB, const std::string &outDBIndex,
                                   const std::vector<std::pair<std::string, std::string>> &fileNames, unsigned int threads);
 
+    static void mergeBinaryTargetSplits(const std::string &outDB, const std::string &outDBIndex,
+                                        const std::vector<std::pair<std::string, std::string>> &fileNames, unsigned int threads);
+
 private:
     const std::string queryDB;
     const std::string queryDBIndex;
@@ -75,6 +86,10 @@ private:
     bool spacedKmer;
     int alphabetSize;
     bool templateDBIsIndex;
+    bool compactIndex;
+    size_t queryBatchSize;
+    size_t kmerListCacheSize;
+    int numaMode;
     int maskMode;
     int maskLowerCaseMode;
     int splitMode;
@@ -98,18 +113,20 @@ private:
     int preloadMode;
     const unsigned int threads;
     int compressed;
+    int outputDbType;
+    Alignment *aligner;
 
     bool runSplit(const std::string &resultDB, const std::string &resultDBIndex, size_t split, bool merge);
 
     // compute kmer size and split size for index table
     static std::pair<int, int> optimizeSplit(size_t totalMemoryInByte, DBReader<unsigned int> *tdbr, int alphabetSize, int kmerSize,
-                                             unsigned int querySeqType, unsigned int threads);
+                                             unsigned int querySeqType, unsigned int threads, bool compactIndex);
 
     // estimates memory consumption while runtime
     static size_t estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
                                             size_t maxHitsPerQuery,
                                             int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                            int threads);
+                                            int threads, bool compactIndex);
 
     static size_t estimateHDDMemoryConsumption(size_t dbSize, size_t maxResListLen);
 
@@ -6,6 +6,9 @@
 #include "IndexBuilder.h"
 #include "Parameters.h"
 
+#include <algorithm>
+#include <vector>
+
 const char*  PrefilteringIndexReader::CURRENT_VERSION = "16";
 unsigned int PrefilteringIndexReader::VERSION = 0;
 unsigned int PrefilteringIndexReader::META = 1;
@@ -32,6 +35,11 @@ unsigned int PrefilteringIndexReader::GENERATOR = 22;
 unsigned int PrefilteringIndexReader::SPACEDPATTERN = 23;
 unsigned int PrefilteringIndexReader::ALNINDEX = 24;
 unsigned int PrefilteringIndexReader::ALNDATA = 25;
+unsigned int PrefilteringIndexReader::ENTRIESENCODING = 26;
+unsigned int PrefilteringIndexReader::SEQFROM = 27;
+unsigned int PrefilteringIndexReader::BASESPLITS = 28;
+unsigned int PrefilteringIndexReader::DBR1DATAOFFSET = 29;
+unsigned int PrefilteringIndexReader::HDR1DATAOFFSET = 30;
 
 extern const char* version;
 
@@ -56,7 +64,7 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
                                               BaseMatrix *subMat, int maxSeqLen,
                                               bool hasSpacedKmer, const std::string &spacedKmerPattern,
                                               bool compBiasCorrection, int alphabetSize, int kmerSize,
-                                              int maskMode, int maskLowerCase, int kmerThr, int splits) {
+                                              int maskMode, int maskLowerCase, int kmerThr, int splits, bool compactIndex) {
 
     const int SPLIT_META = splits > 1 ? 0 : 0;
     const int SPLIT_SEQS = splits > 1 ? 1 : 0;
@@ -217,69 +225,467 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
         if (dbSize == 0) {
             continue;
         }
+        writeSplit(writer, SPLIT_INDX + s, s, dbr1, dbFrom, dbSize, subMat, &seq, adjustAlphabetSize, kmerSize, maskMode, maskLowerCase, kmerThr, compactIndex);
+    }
+
+    writer.close(false);
+}
+
+void PrefilteringIndexReader::writeSplit(DBWriter &writer, unsigned int thread, unsigned int split,
+                                         DBReader<unsigned int> *dbr, size_t dbFrom, size_t dbSize,
+                                         BaseMatrix *subMat, Sequence *seq, int alphabetSize, int kmerSize,
+                                         int maskMode, int maskLowerCase, int kmerThr, bool compactIndex) {
+    IndexTable indexTable(alphabetSize, kmerSize, false);
+    SequenceLookup *sequenceLookup = NULL;
+    IndexBuilder::fillDatabase(&indexTable,
+                               (maskMode == 1 || maskLowerCase == 1) ? &sequenceLookup : NULL,
+                               (maskMode == 0 ) ? &sequenceLookup : NULL,
+                               *subMat, seq, dbr, dbFrom, dbFrom + dbSize, kmerThr, maskMode, maskLowerCase);
+    indexTable.printStatistics(subMat->num2aa);
+    if (compactIndex) {
+        indexTable.compactEntries();
+    }
+
+    if (sequenceLookup == NULL) {
+        Debug(Debug::ERROR) << "Invalid mask mode. No sequence lookup created!\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    writeIndexTable(writer, thread, split, dbFrom, indexTable, sequenceLookup);
+    delete sequenceLookup;
+}
+
+void PrefilteringIndexReader::writeIndexTable(DBWriter &writer, unsigned int thread, unsigned int split, size_t dbFrom,
+                                              IndexTable &indexTable, SequenceLookup *sequenceLookup) {
+    // save the entries
+    unsigned int keyOffset = 1000 * split;
+    Debug(Debug::INFO) << "Write ENTRIES (" << (keyOffset + ENTRIES) << ")\n";
+    char *entries = indexTable.isCompact() ? (char *) indexTable.getPackedEntries() : (char *) indexTable.getEntries();
+    size_t entriesSize = indexTable.getEntriesSize();
+    writer.writeData(entries, entriesSize, (keyOffset + ENTRIES), thread);
+    writer.alignToPageSize(thread);
+
+    Debug(Debug::INFO) << "Write ENTRIESENCODING (" << (keyOffset + ENTRIESENCODING) << ")\n";
+    int entriesEncoding = indexTable.isCompact() ? ENTRIES_ENCODING_DELTA : ENTRIES_ENCODING_PLAIN;
+    writer.writeData((char *) &entriesEncoding, sizeof(int), (keyOffset + ENTRIESENCODING), thread);
+    writer.alignToPageSize(thread);
+
+    // save the size
+    Debug(Debug::INFO) << "Write ENTRIESOFFSETS (" << (keyOffset + ENTRIESOFFSETS) << ")\n";
+    char *offsets = (char*)indexTable.getOffsets();
+    size_t offsetsSize = (indexTable.getTableSize() + 1) * sizeof(size_t);
+    writer.writeData(offsets, offsetsSize, (keyOffset + ENTRIESOFFSETS), thread);
+    writer.alignToPageSize(thread);
+    indexTable.deleteEntries();
+
+    Debug(Debug::INFO) << "Write SEQINDEXDATASIZE (" << (keyOffset + SEQINDEXDATASIZE) << ")\n";
+    int64_t seqindexDataSize = sequenceLookup->getDataSize();
+    char *seqindexDataSizePtr = (char *) &seqindexDataSize;
+    writer.writeData(seqindexDataSizePtr, 1 * sizeof(int64_t), (keyOffset + SEQINDEXDATASIZE), thread);
+    writer.alignToPageSize(thread);
+
+    size_t *sequenceOffsets = sequenceLookup->getOffsets();
+    size_t sequenceCount = sequenceLookup->getSequenceCount();
+    Debug(Debug::INFO) << "Write SEQINDEXSEQOFFSET (" << (keyOffset + SEQINDEXSEQOFFSET) << ")\n";
+    writer.writeData((char *) sequenceOffsets, (sequenceCount + 1) * sizeof(size_t), (keyOffset + SEQINDEXSEQOFFSET), thread);
+    writer.alignToPageSize(thread);
+
+    Debug(Debug::INFO) << "Write SEQINDEXDATA (" << (keyOffset + SEQINDEXDATA) << ")\n";
+    writer.writeData(sequenceLookup->getData(), (sequenceLookup->getDataSize() + 1) * sizeof(char), (keyOffset + SEQINDEXDATA), thread);
+    writer.alignToPageSize(thread);
+
+    // ENTRIESNUM
+    Debug(Debug::INFO) << "Write ENTRIESNUM (" << (keyOffset + ENTRIESNUM) << ")\n";
+    uint64_t entriesNum = indexTable.getTableEntriesNum();
+    char *entriesNumPtr = (char *) &entriesNum;
+    writer.writeData(entriesNumPtr, 1 * sizeof(uint64_t), (keyOffset + ENTRIESNUM), thread);
+    writer.alignToPageSize(thread);
+
+    // SEQCOUNT
+    Debug(Debug::INFO) << "Write SEQCOUNT (" << (keyOffset + SEQCOUNT) << ")\n";
+    size_t tablesize = indexTable.getSize();
+    char *tablesizePtr = (char *) &tablesize;
+    writer.writeData(tablesizePtr, 1 * sizeof(size_t), (keyOffset + SEQCOUNT), thread);
+    writer.alignToPageSize(thread);
+
+    Debug(Debug::INFO) << "Write SEQFROM (" << (keyOffset + SEQFROM) << ")\n";
+    writer.writeData((char *) &dbFrom, sizeof(size_t), (keyOffset + SEQFROM), thread);
+    writer.alignToPageSize(thread);
+}
+
+void PrefilteringIndexReader::appendIndexFile(const std::string &indexDB, DBReader<unsigned int> *dbr, DBReader<unsigned int> *hdbr,
+                                              BaseMatrix *subMat, int maskLowerCase) {
+    DBReader<unsigned int> index(indexDB.c_str(), (indexDB + ".index").c_str(), 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    index.open(DBReader<unsigned int>::NOSORT);
+    if (checkIfIndexFile(&index) == false) {
+        Debug(Debug::ERROR) << "Outdated index version. Please recompute it with 'createindex'!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (index.getId(ALNINDEX) != UINT_MAX || index.getOffset(index.getId(DBR1INDEX)) != index.getOffset(index.getId(DBR2INDEX))) {
+        Debug(Debug::ERROR) << "Only indices of a single sequence database can be extended. Please recompute it with 'createindex'!\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    PrefilteringIndexData meta = getMetadata(&index);
+    if (Parameters::isEqualDbtype(meta.seqType, dbr->getDbtype()) == false) {
+        Debug(Debug::ERROR) << "Index was created for a " << Parameters::getDbTypeName(meta.seqType) << " database, but "
+                            << Parameters::getDbTypeName(dbr->getDbtype()) << " database was given\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    DBReader<unsigned int> *seqDbr = openNewReader(&index, DBR1DATA, DBR1INDEX, true, 1, false, false);
+    DBReader<unsigned int> *hdrDbr = NULL;
+    if (meta.headers1 == 1) {
+        hdrDbr = openNewHeaderReader(&index, HDR1DATA, HDR1INDEX, 1, false, false);
+    }
+
+    // the new database has to extend the indexed one
+    const size_t oldSize = seqDbr->getSize();
+    const size_t newSize = dbr->getSize();
+    bool extends = newSize >= oldSize && (hdrDbr == NULL || hdbr->getSize() == newSize);
+    for (size_t id = 0; id < oldSize && extends; id++) {
+        extends = seqDbr->getDbKey(id) == dbr->getDbKey(id) && seqDbr->getEntryLen(id) == dbr->getEntryLen(id);
+    }
+    for (size_t id = oldSize; id < newSize && extends; id++) {
+        extends = dbr->getDbKey(id) > dbr->getDbKey(id - 1) && (hdrDbr == NULL || hdbr->getDbKey(id) == dbr->getDbKey(id));
+    }
+    if (extends == false) {
+        Debug(Debug::ERROR) << "Database does not extend the indexed database. New entries have to be appended with increasing keys.\n"
+                            << "Please recompute the index with 'createindex'!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (newSize == oldSize) {
+        Debug(Debug::INFO) << "Index already contains all " << oldSize << " sequences\n";
+        seqDbr->close();
+        delete seqDbr;
+        if (hdrDbr != NULL) {
+            hdrDbr->close();
+            delete hdrDbr;
+        }
+        index.close();
+        return;
+    }
+    Debug(Debug::INFO) << "Append " << (newSize - oldSize) << " sequences to index with " << oldSize << " sequences\n";
 
-        IndexTable indexTable(adjustAlphabetSize, kmerSize, false);
-        SequenceLookup *sequenceLookup = NULL;
-        IndexBuilder::fillDatabase(&indexTable,
-                                   (maskMode == 1 || maskLowerCase == 1) ? &sequenceLookup : NULL,
-                                   (maskMode == 0 ) ? &sequenceLookup : NULL,
-                                   *subMat, &seq, dbr1, dbFrom, dbFrom + dbSize, kmerThr, maskMode, maskLowerCase);
-        indexTable.printStatistics(subMat->num2aa);
-
-        if (sequenceLookup == NULL) {
-            Debug(Debug::ERROR) << "Invalid mask mode. No sequence lookup created!\n";
-            EXIT(EXIT_FAILURE);
+    const int split = meta.splits;
+    const unsigned int keyOffset = 1000 * split;
+    std::string deltaDB = indexDB + "_delta";
+    DBWriter writer(deltaDB.c_str(), (deltaDB + ".index").c_str(), 1, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_INDEX_DB);
+    writer.open();
+
+    if (index.getId(BASESPLITS) == UINT_MAX) {
+        Debug(Debug::INFO) << "Write BASESPLITS (" << BASESPLITS << ")\n";
+        writer.writeData((char *) &meta.splits, sizeof(int), BASESPLITS, 0);
+        writer.alignToPageSize(0);
+
+        // splits of createindex are not moved by the delta splits, store their ranges explicitly
+        for (int s = 0; s < meta.splits; s++) {
+            if (index.getId(1000 * s + SEQFROM) != UINT_MAX) {
+                continue;
+            }
+            size_t dbFrom = 0;
+            size_t dbSize = 0;
+            seqDbr->decomposeDomainByAminoAcid(s, meta.splits, &dbFrom, &dbSize);
+            writer.writeData((char *) &dbFrom, sizeof(size_t), 1000 * s + SEQFROM, 0);
+            writer.alignToPageSize(0);
+            if (index.getId(1000 * s + SEQCOUNT) == UINT_MAX) {
+                size_t empty = 0;
+                writer.writeData((char *) &empty, sizeof(size_t), 1000 * s + SEQCOUNT, 0);
+                writer.alignToPageSize(0);
+            }
         }
+    }
 
-        // save the entries
-        unsigned int keyOffset = 1000 * s;
-        Debug(Debug::INFO) << "Write ENTRIES (" << (keyOffset + ENTRIES) << ")\n";
-        char *entries = (char *) indexTable.getEntries();
-        size_t entriesSize = indexTable.getTableEntriesNum() * indexTable.getSizeOfEntry();
-        writer.writeData(entries, entriesSize, (keyOffset + ENTRIES), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
-
-        // save the size
-        Debug(Debug::INFO) << "Write ENTRIESOFFSETS (" << (keyOffset + ENTRIESOFFSETS) << ")\n";
-        char *offsets = (char*)indexTable.getOffsets();
-        size_t offsetsSize = (indexTable.getTableSize() + 1) * sizeof(size_t);
-        writer.writeData(offsets, offsetsSize, (keyOffset + ENTRIESOFFSETS), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
-        indexTable.deleteEntries();
-
-        Debug(Debug::INFO) << "Write SEQINDEXDATASIZE (" << (keyOffset + SEQINDEXDATASIZE) << ")\n";
-        int64_t seqindexDataSize = sequenceLookup->getDataSize();
-        char *seqindexDataSizePtr = (char *) &seqindexDataSize;
-        writer.writeData(seqindexDataSizePtr, 1 * sizeof(int64_t), (keyOffset + SEQINDEXDATASIZE), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
-
-        size_t *sequenceOffsets = sequenceLookup->getOffsets();
-        size_t sequenceCount = sequenceLookup->getSequenceCount();
-        Debug(Debug::INFO) << "Write SEQINDEXSEQOFFSET (" << (keyOffset + SEQINDEXSEQOFFSET) << ")\n";
-        writer.writeData((char *) sequenceOffsets, (sequenceCount + 1) * sizeof(size_t), (keyOffset + SEQINDEXSEQOFFSET), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
-
-        Debug(Debug::INFO) << "Write SEQINDEXDATA (" << (keyOffset + SEQINDEXDATA) << ")\n";
-        writer.writeData(sequenceLookup->getData(), (sequenceLookup->getDataSize() + 1) * sizeof(char), (keyOffset + SEQINDEXDATA), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
-        delete sequenceLookup;
-
-        // ENTRIESNUM
-        Debug(Debug::INFO) << "Write ENTRIESNUM (" << (keyOffset + ENTRIESNUM) << ")\n";
-        uint64_t entriesNum = indexTable.getTableEntriesNum();
-        char *entriesNumPtr = (char *) &entriesNum;
-        writer.writeData(entriesNumPtr, 1 * sizeof(uint64_t), (keyOffset + ENTRIESNUM), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
-
-        // SEQCOUNT
-        Debug(Debug::INFO) << "Write SEQCOUNT (" << (keyOffset + SEQCOUNT) << ")\n";
-        size_t tablesize = indexTable.getSize();
-        char *tablesizePtr = (char *) &tablesize;
-        writer.writeData(tablesizePtr, 1 * sizeof(size_t), (keyOffset + SEQCOUNT), SPLIT_INDX + s);
-        writer.alignToPageSize(SPLIT_INDX + s);
+    DBReader<unsigned int> *readers[2] = { seqDbr, hdrDbr };
+    DBReader<unsigned int> *newReaders[2] = { dbr, hdbr };
+    const unsigned int indexKeys[2][2] = { { DBR1INDEX, DBR2INDEX }, { HDR1INDEX, HDR2INDEX } };
+    const unsigned int dataKeys[2][2] = { { DBR1DATA, DBR2DATA }, { HDR1DATA, HDR2DATA } };
+    const unsigned int offsetKeys[2] = { DBR1DATAOFFSET, HDR1DATAOFFSET };
+    for (size_t i = 0; i < 2; i++) {
+        if (readers[i] == NULL) {
+            continue;
+        }
+        DBReader<unsigned int> *oldReader = readers[i];
+        DBReader<unsigned int> *newReader = newReaders[i];
+
+        // the new entries are placed behind all existing segments
+        size_t segmentStart = oldReader->getTotalDataSize();
+        std::vector<DBReader<unsigned int>::Index> entries(oldReader->getIndex(), oldReader->getIndex() + oldSize);
+
+        Debug(Debug::INFO) << "Write segment " << (keyOffset + dataKeys[i][0]) << "\n";
+        size_t dataOffset = writer.getOffset(0);
+        size_t dataSize = 0;
+        writer.writeStart(0);
+        for (size_t id = oldSize; id < newSize; id++) {
+            size_t length = newReader->getEntryLen(id);
+            writer.writeAdd(newReader->getDataUncompressed(id), length, 0);
+            DBReader<unsigned int>::Index entry;
+            entry.id = newReader->getDbKey(id);
+            entry.offset = segmentStart + dataSize;
+            entry.length = length;
+            entries.push_back(entry);
+            dataSize += length;
+        }
+        writer.writeEnd(keyOffset + dataKeys[i][0], 0);
+        writer.alignToPageSize(0);
+        writer.writeIndexEntry(keyOffset + dataKeys[i][1], dataOffset, dataSize + 1, 0);
+        writer.writeData((char *) &segmentStart, sizeof(size_t), keyOffset + offsetKeys[i], 0);
+        writer.alignToPageSize(0);
+
+        Debug(Debug::INFO) << "Write " << (i == 0 ? "DBR1INDEX" : "HDR1INDEX") << " (" << indexKeys[i][0] << ")\n";
+        size_t entriesSize = 0;
+        for (size_t j = 0; j < entries.size(); j++) {
+            entriesSize += entries[j].length;
+        }
+        DBReader<unsigned int> combined(entries.data(), entries.size(), entriesSize, newReader->getLastKey(),
+                                        newReader->getDbtype(), newReader->getMaxSeqLen(), 1);
+        char *data = DBReader<unsigned int>::serialize(combined);
+        size_t indexOffset = writer.getOffset(0);
+        size_t indexSize = DBReader<unsigned int>::indexMemorySize(combined);
+        writer.writeData(data, indexSize, indexKeys[i][0], 0);
+        writer.alignToPageSize(0);
+        writer.writeIndexEntry(indexKeys[i][1], indexOffset, indexSize + 1, 0);
+        free(data);
     }
 
+    Sequence seq(meta.maxSeqLength, meta.seqType, subMat, meta.kmerSize, meta.spacedKmer, meta.compBiasCorr, true, getSpacedPattern(&index));
+    const int adjustAlphabetSize =
+            (Parameters::isEqualDbtype(meta.seqType, Parameters::DBTYPE_NUCLEOTIDES) || Parameters::isEqualDbtype(meta.seqType, Parameters::DBTYPE_AMINO_ACIDS))
+            ? meta.alphabetSize - 1 : meta.alphabetSize;
+    writeSplit(writer, 0, split, dbr, oldSize, newSize - oldSize, subMat, &seq, adjustAlphabetSize, meta.kmerSize,
+               meta.mask, maskLowerCase, meta.kmerThr, isCompactIndex(&index));
+
+    Debug(Debug::INFO) << "Write META (" << META << ")\n";
+    int metadata[12];
+    memcpy(metadata, index.getDataByDBKey(META, 0), sizeof(metadata));
+    metadata[11] = split + 1;
+    writer.writeData((char *) metadata, sizeof(metadata), META, 0);
+    writer.alignToPageSize(0);
     writer.close(false);
+
+    // the delta becomes the next data file of the index, its entries replace the ones of the base
+    DBReader<unsigned int> delta(deltaDB.c_str(), (deltaDB + ".index").c_str(), 1, DBReader<unsigned int>::USE_INDEX);
+    delta.open(DBReader<unsigned int>::NOSORT);
+    const size_t deltaStart = index.getTotalDataSize();
+    std::vector<DBReader<unsigned int>::Index> entries;
+    for (size_t id = 0; id < index.getSize(); id++) {
+        if (delta.getId(index.getDbKey(id)) == UINT_MAX) {
+            entries.push_back(index.getIndex()[id]);
+        }
+    }
+    for (size_t id = 0; id < delta.getSize(); id++) {
+        DBReader<unsigned int>::Index entry = delta.getIndex()[id];
+        entry.offset += deltaStart;
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(), DBReader<unsigned int>::Index::compareById);
+    delta.close();
+
+    seqDbr->close();
+    delete seqDbr;
+    if (hdrDbr != NULL) {
+        hdrDbr->close();
+        delete hdrDbr;
+    }
+    index.close();
+
+    std::vector<std::string> files = FileUtil::findDatafiles(indexDB.c_str());
+    if (files.size() == 1 && files[0] == indexDB) {
+        FileUtil::move(indexDB.c_str(), (indexDB + ".0").c_str());
+    }
+    FileUtil::move(deltaDB.c_str(), (indexDB + "." + SSTR(files.size())).c_str());
+
+    std::string tmpIndex = indexDB + ".index_tmp";
+    FILE *indexFile = FileUtil::openAndDelete(tmpIndex.c_str(), "w");
+    DBWriter::writeIndex(indexFile, entries.size(), entries.data());
+    if (fclose(indexFile) != 0) {
+        Debug(Debug::ERROR) << "Cannot close index file " << tmpIndex << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    FileUtil::move(tmpIndex.c_str(), (indexDB + ".index").c_str());
+    FileUtil::remove((deltaDB + ".index").c_str());
+    FileUtil::remove((deltaDB + ".dbtype").c_str());
+}
+
+void PrefilteringIndexReader::mergeIndexSplits(const std::string &indexDB, int threads) {
+    DBReader<unsigned int> index(indexDB.c_str(), (indexDB + ".index").c_str(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    index.open(DBReader<unsigned int>::NOSORT);
+    if (checkIfIndexFile(&index) == false) {
+        Debug(Debug::ERROR) << "Outdated index version. Please recompute it with 'createindex'!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t baseSplitsId = index.getId(BASESPLITS);
+    if (baseSplitsId == UINT_MAX) {
+        Debug(Debug::INFO) << "Index has no appended splits, nothing to merge\n";
+        index.close();
+        return;
+    }
+    PrefilteringIndexData meta = getMetadata(&index);
+    const int baseSplits = *((int *) index.getDataUncompressed(baseSplitsId));
+    const bool compact = isCompactIndex(&index);
+    const int adjustAlphabetSize =
+            (Parameters::isEqualDbtype(meta.seqType, Parameters::DBTYPE_NUCLEOTIDES) || Parameters::isEqualDbtype(meta.seqType, Parameters::DBTYPE_AMINO_ACIDS))
+            ? meta.alphabetSize - 1 : meta.alphabetSize;
+    Debug(Debug::INFO) << "Merge " << (meta.splits - baseSplits) << " appended splits\n";
+
+    std::vector<IndexTable *> tables;
+    std::vector<SequenceLookup *> lookups;
+    std::vector<size_t> shifts;
+    size_t dbFrom = 0;
+    size_t sequenceCount = 0;
+    size_t sequenceDataSize = 0;
+    for (int s = baseSplits; s < meta.splits; s++) {
+        size_t splitFrom = *((size_t *) index.getDataUncompressed(index.getId(1000 * s + SEQFROM)));
+        if (s == baseSplits) {
+            dbFrom = splitFrom;
+        }
+        tables.push_back(getIndexTable(s, &index, Parameters::PRELOAD_MODE_MMAP));
+        lookups.push_back(getSequenceLookup(s, &index, Parameters::PRELOAD_MODE_MMAP));
+        shifts.push_back(splitFrom - dbFrom);
+        sequenceCount += tables.back()->getSize();
+        sequenceDataSize += lookups.back()->getDataSize();
+    }
+
+    // sequence lists of later splits have larger ids, so appending them keeps each list sorted
+    IndexTable merged(adjustAlphabetSize, meta.kmerSize, false);
+    size_t *offsets = merged.getOffsets();
+    const size_t tableSize = merged.getTableSize();
+#pragma omp parallel for schedule(static)
+    for (size_t kmer = 0; kmer < tableSize; kmer++) {
+        size_t count = 0;
+        for (size_t i = 0; i < tables.size(); i++) {
+            size_t listSize;
+            if (tables[i]->isCompact()) {
+                tables[i]->getPackedDBSeqList(kmer, &listSize);
+            } else {
+                tables[i]->getDBSeqList(kmer, &listSize);
+            }
+            count += listSize;
+        }
+        offsets[kmer] = count;
+    }
+    merged.initMemory(sequenceCount);
+    merged.init();
+
+    IndexEntryLocal *entries = merged.getEntries();
+#pragma omp parallel
+    {
+        std::vector<IndexEntryLocal> buffer;
+#pragma omp for schedule(dynamic, 1024)
+        for (size_t kmer = 0; kmer < tableSize; kmer++) {
+            IndexEntryLocal *out = entries + offsets[kmer];
+            for (size_t i = 0; i < tables.size(); i++) {
+                size_t listSize;
+                const IndexEntryLocal *list;
+                if (tables[i]->isCompact()) {
+                    const unsigned char *packed = tables[i]->getPackedDBSeqList(kmer, &listSize);
+                    buffer.resize(listSize);
+                    IndexTable::unpackDBSeqList(packed, listSize, buffer.data());
+                    list = buffer.data();
+                } else {
+                    list = tables[i]->getDBSeqList(kmer, &listSize);
+                }
+                for (size_t j = 0; j < listSize; j++) {
+                    out[j].seqId = list[j].seqId + shifts[i];
+                    out[j].position_j = list[j].position_j;
+                }
+                out += listSize;
+            }
+        }
+    }
+    if (compact) {
+        merged.compactEntries();
+    }
+
+    SequenceLookup lookup(sequenceCount, sequenceDataSize);
+    size_t sequenceIndex = 0;
+    size_t sequenceOffset = 0;
+    for (size_t i = 0; i < lookups.size(); i++) {
+        for (size_t id = 0; id < lookups[i]->getSequenceCount(); id++) {
+            std::pair<const unsigned char *, const unsigned int> sequence = lookups[i]->getSequence(id);
+            lookup.addSequence(const_cast<unsigned char *>(sequence.first), sequence.second, sequenceIndex, sequenceOffset);
+            sequenceIndex++;
+            sequenceOffset += sequence.second;
+        }
+    }
+
+    // rewrite the index without the appended splits and with the data segments joined
+    std::string mergedDB = indexDB + "_merged";
+    DBWriter writer(mergedDB.c_str(), (mergedDB + ".index").c_str(), 1, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_INDEX_DB);
+    writer.open();
+
+    std::vector<DBReader<unsigned int>::Index> order(index.getIndex(), index.getIndex() + index.getSize());
+    std::sort(order.begin(), order.end(), DBReader<unsigned int>::Index::compareByOffset);
+    const unsigned int dataKeys[2] = { DBR1DATA, HDR1DATA };
+    const unsigned int aliasKeys[2][2] = { { DBR2INDEX, DBR2DATA }, { HDR2INDEX, HDR2DATA } };
+    const unsigned int indexKeys[2] = { DBR1INDEX, HDR1INDEX };
+    size_t aliasOffsets[2][2] = { { SIZE_MAX, SIZE_MAX }, { SIZE_MAX, SIZE_MAX } };
+    size_t aliasSizes[2][2] = { { 0, 0 }, { 0, 0 } };
+    for (size_t i = 0; i < order.size(); i++) {
+        const unsigned int key = order[i].id;
+        // keys of the appended splits include their data segments
+        if ((int) (key / 1000) >= baseSplits) {
+            continue;
+        }
+        if (key == META || key == BASESPLITS || key == DBR2INDEX || key == DBR2DATA || key == HDR2INDEX || key == HDR2DATA) {
+            continue;
+        }
+        size_t id = index.getId(key);
+        if (key == DBR1DATA || key == HDR1DATA) {
+            const size_t type = (key == DBR1DATA) ? 0 : 1;
+            DBReader<unsigned int> *reader = (type == 0)
+                    ? openNewReader(&index, DBR1DATA, DBR1INDEX, true, 1, false, false)
+                    : openNewHeaderReader(&index, HDR1DATA, HDR1INDEX, 1, false, false);
+            aliasOffsets[type][1] = writer.getOffset(0);
+            writer.writeStart(0);
+            for (size_t fileIdx = 0; fileIdx < reader->getDataFileCnt(); fileIdx++) {
+                writer.writeAdd(reader->getDataForFile(fileIdx), reader->getDataSizeForFile(fileIdx), 0);
+            }
+            writer.writeEnd(dataKeys[type], 0);
+            writer.alignToPageSize(0);
+            aliasSizes[type][1] = reader->getTotalDataSize() + 1;
+            reader->close();
+            delete reader;
+            continue;
+        }
+
+        size_t offset = writer.getOffset(0);
+        size_t size = getEntrySize(&index, id);
+        writer.writeData(index.getDataUncompressed(id), size, key, 0);
+        writer.alignToPageSize(0);
+        for (size_t type = 0; type < 2; type++) {
+            if (key == indexKeys[type]) {
+                aliasOffsets[type][0] = offset;
+                aliasSizes[type][0] = size + 1;
+            }
+        }
+    }
+    for (size_t type = 0; type < 2; type++) {
+        for (size_t j = 0; j < 2; j++) {
+            if (aliasOffsets[type][j] != SIZE_MAX) {
+                writer.writeIndexEntry(aliasKeys[type][j], aliasOffsets[type][j], aliasSizes[type][j], 0);
+            }
+        }
+    }
+
+    writeIndexTable(writer, 0, baseSplits, dbFrom, merged, &lookup);
+
+    Debug(Debug::INFO) << "Write META (" << META << ")\n";
+    int metadata[12];
+    memcpy(metadata, index.getDataByDBKey(META, 0), sizeof(metadata));
+    metadata[11] = baseSplits + 1;
+    writer.writeData((char *) metadata, sizeof(metadata), META, 0);
+    writer.alignToPageSize(0);
+    writer.close(false);
+
+    for (size_t i = 0; i < tables.size(); i++) {
+        delete tables[i];
+        delete lookups[i];
+    }
+    index.close();
+
+    DBReader<unsigned int>::removeDb(indexDB);
+    DBReader<unsigned int>::moveDb(mergedDB, indexDB);
 }
 
 DBReader<unsigned int> *PrefilteringIndexReader::openNewHeaderReader(DBReader<unsigned int>*dbr, unsigned int dataIdx, unsigned int indexIdx, int threads,  bool touchIndex, bool touchData) {
@@ -289,20 +695,9 @@ DBReader<unsigned int> *PrefilteringIndexReader::openNewHeaderReader(DBReader<un
         dbr->touchData(indexId);
     }
 
-    size_t dataId = dbr->getId(dataIdx);
-    char *data = dbr->getData(dataId, 0);
-
-    size_t currDataOffset = dbr->getOffset(dataId);
-    size_t nextDataOffset = dbr->findNextOffsetid(dataId);
-    size_t dataSize = nextDataOffset-currDataOffset;
-
-    if (touchData) {
-        dbr->touchData(dataId);
-    }
-
     DBReader<unsigned int> *reader = DBReader<unsigned int>::unserialize(indexData, threads);
     reader->open(DBReader<unsigned int>::NOSORT);
-    reader->setData(data, dataSize);
+    setDataSegments(dbr, dataIdx, reader, touchData);
     reader->setMode(DBReader<unsigned int>::USE_DATA);
     return reader;
 }
@@ -315,20 +710,13 @@ DBReader<unsigned int> *PrefilteringIndexReader::openNewReader(DBReader<unsigned
     }
 
     if (includeData) {
-        id = dbr->getId(dataIdx);
-        if (id == UINT_MAX) {
+        if (dbr->getId(dataIdx) == UINT_MAX) {
             return NULL;
         }
-        if (touchData) {
-            dbr->touchData(id);
-        }
 
         DBReader<unsigned int> *reader = DBReader<unsigned int>::unserialize(data, threads);
         reader->open(DBReader<unsigned int>::NOSORT);
-        size_t currDataOffset = dbr->getOffset(id);
-        size_t nextDataOffset = dbr->findNextOffsetid(id);
-        size_t dataSize = nextDataOffset-currDataOffset;
-        reader->setData(dbr->getDataUncompressed(id), dataSize);
+        setDataSegments(dbr, dataIdx, reader, touchData);
         reader->setMode(DBReader<unsigned int>::USE_DATA);
         return reader;
     }
@@ -338,6 +726,76 @@ DBReader<unsigned int> *PrefilteringIndexReader::openNewReader(DBReader<unsigned
     return reader;
 }
 
+// appendIndexFile continues the sequence and header data in segments stored under the keys of the delta splits,
+// each segment records where it starts within the embedded database
+bool PrefilteringIndexReader::setDataSegments(DBReader<unsigned int> *dbr, unsigned int dataIdx, DBReader<unsigned int> *reader, bool touchData) {
+    size_t id = dbr->getId(dataIdx);
+    if (id == UINT_MAX) {
+        return false;
+    }
+
+    std::vector<size_t> ids;
+    std::vector<size_t> sizes;
+    ids.push_back(id);
+    sizes.push_back(dbr->findNextOffsetid(id) - dbr->getOffset(id));
+
+    unsigned int offsetIdx = UINT_MAX;
+    if (dataIdx == DBR1DATA || dataIdx == DBR2DATA) {
+        offsetIdx = DBR1DATAOFFSET;
+    } else if (dataIdx == HDR1DATA || dataIdx == HDR2DATA) {
+        offsetIdx = HDR1DATAOFFSET;
+    }
+    if (offsetIdx != UINT_MAX) {
+        const int splits = getMetadata(dbr).splits;
+        size_t segmentStart = 0;
+        for (int s = 1; s < splits; s++) {
+            size_t segmentId = dbr->getId(1000 * s + dataIdx);
+            if (segmentId == UINT_MAX) {
+                continue;
+            }
+            size_t nextStart = *((size_t *) dbr->getDataUncompressed(dbr->getId(1000 * s + offsetIdx)));
+            // the page padding behind the previous segment is not part of the database
+            sizes.back() = nextStart - segmentStart;
+            segmentStart = nextStart;
+            ids.push_back(segmentId);
+            sizes.push_back(dbr->findNextOffsetid(segmentId) - dbr->getOffset(segmentId));
+        }
+    }
+
+    std::vector<char *> data;
+    for (size_t i = 0; i < ids.size(); i++) {
+        data.push_back(dbr->getDataUncompressed(ids[i]));
+        if (touchData) {
+            dbr->touchData(ids[i]);
+        }
+    }
+    reader->setData(data.data(), sizes.data(), data.size());
+    return true;
+}
+
+size_t PrefilteringIndexReader::getEntrySize(DBReader<unsigned int> *dbr, size_t id) {
+    // the index stores entry lengths with 32 bits, restore the lost bits from the distance to the next entry
+    const size_t available = dbr->findNextOffsetid(id) - dbr->getOffset(id);
+    size_t size = dbr->getEntryLen(id) - 1;
+    while (size + (1ull << 32) <= available) {
+        size += (1ull << 32);
+    }
+    return size;
+}
+
+void PrefilteringIndexReader::getSplitRange(DBReader<unsigned int> *dbr, unsigned int split, DBReader<unsigned int> *tdbr, int splits, size_t *dbFrom, size_t *dbSize) {
+    unsigned int keyOffset = 1000 * split;
+    size_t fromId = dbr->getId(keyOffset + SEQFROM);
+    size_t countId = dbr->getId(keyOffset + SEQCOUNT);
+    if (fromId == UINT_MAX || countId == UINT_MAX) {
+        // indices without SEQFROM were split by residues
+        tdbr->decomposeDomainByAminoAcid(split, splits, dbFrom, dbSize);
+        return;
+    }
+    *dbFrom = *((size_t *) dbr->getDataUncompressed(fromId));
+    *dbSize = *((size_t *) dbr->getDataUncompressed(countId));
+}
+
 SequenceLookup *PrefilteringIndexReader::getSequenceLookup(unsigned int split, DBReader<unsigned int> *dbr, int preloadMode) {
     PrefilteringIndexData data = getMetadata(dbr);
     if (split >= (unsigned int)data.splits) {
@@ -398,6 +856,12 @@ IndexTable *PrefilteringIndexReader::getIndexTable(unsigned int split, DBReader<
     size_t entriesOffsetsDataId = dbr->getId(splitOffset + ENTRIESOFFSETS);
     char *entriesOffsetsData = dbr->getDataUncompressed(entriesOffsetsDataId);
 
+    bool compact = false;
+    size_t entriesEncodingId = dbr->getId(splitOffset + ENTRIESENCODING);
+    if (entriesEncodingId != UINT_MAX) {
+        compact = *((int *)dbr->getDataUncompressed(entriesEncodingId)) == ENTRIES_ENCODING_DELTA;
+    }
+
     int adjustAlphabetSize;
     if (Parameters::isEqualDbtype(data.seqType, Parameters::DBTYPE_NUCLEOTIDES) || Parameters::isEqualDbtype(data.seqType, Parameters::DBTYPE_AMINO_ACIDS)) {
         adjustAlphabetSize = data.alphabetSize - 1;
@@ -407,7 +871,7 @@ IndexTable *PrefilteringIndexReader::getIndexTable(unsigned int split, DBReader<
 
     if (preloadMode == Parameters::PRELOAD_MODE_FREAD) {
         IndexTable* table = new IndexTable(adjustAlphabetSize, data.kmerSize, false);
-        table->initTableByExternalDataCopy(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+        table->initTableByExternalDataCopy(sequenceCount, entriesNum, entriesData, (size_t *)entriesOffsetsData, compact);
         return table;
     }
 
@@ -419,10 +883,19 @@ IndexTable *PrefilteringIndexReader::getIndexTable(unsigned int split, DBReader<
     }
 
     IndexTable* table = new IndexTable(adjustAlphabetSize, data.kmerSize, true);
-    table->initTableByExternalData(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
+    table->initTableByExternalData(sequenceCount, entriesNum, entriesData, (size_t *)entriesOffsetsData, compact);
     return table;
 }
 
+bool PrefilteringIndexReader::isCompactIndex(DBReader<unsigned int> *dbr) {
+    // indices written before the compact encoding have no ENTRIESENCODING entry
+    size_t id = dbr->getId(ENTRIESENCODING);
+    if (id == UINT_MAX) {
+        return false;
+    }
+    return *((int *)dbr->getDataUncompressed(id)) == ENTRIES_ENCODING_DELTA;
+}
+
 void PrefilteringIndexReader::printSummary(DBReader<unsigned int> *dbr) {
     Debug(Debug::INFO) << "Index version: " << dbr->getDataByDBKey(VERSION, 0) << "\n";
 
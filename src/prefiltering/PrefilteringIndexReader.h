@@ -6,6 +6,8 @@
 #include "DBReader.h"
 #include <string>
 
+class DBWriter;
+
 struct PrefilteringIndexData {
     int maxSeqLength;
     int kmerSize;
@@ -51,6 +53,14 @@ public:
     static unsigned int SPACEDPATTERN;
     static unsigned int ALNINDEX;
     static unsigned int ALNDATA;
+    static unsigned int ENTRIESENCODING;
+    static unsigned int SEQFROM;
+    static unsigned int BASESPLITS;
+    static unsigned int DBR1DATAOFFSET;
+    static unsigned int HDR1DATAOFFSET;
+
+    static const int ENTRIES_ENCODING_PLAIN = 0;
+    static const int ENTRIES_ENCODING_DELTA = 1;
 
     static bool checkIfIndexFile(DBReader<unsigned int> *reader);
     static std::string indexName(const std::string &outDB);
@@ -60,7 +70,18 @@ public:
                                 DBReader<unsigned int> *hdbr1, DBReader<unsigned int> *hdbr2,
                                 DBReader<unsigned int> *alndbr,
                                 BaseMatrix *seedSubMat, int maxSeqLen, bool spacedKmer, const std::string &spacedKmerPattern,
-                                bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode, int maskLowerCase, int kmerThr, int splits);
+                                bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode, int maskLowerCase, int kmerThr, int splits, bool compactIndex);
+
+    // index the entries of dbr that are missing in the index into a new delta split
+    // dbr has to start with the same entries that were used to create the index
+    static void appendIndexFile(const std::string &indexDB, DBReader<unsigned int> *dbr, DBReader<unsigned int> *hdbr,
+                                BaseMatrix *seedSubMat, int maskLowerCase);
+
+    // fold all delta splits written by appendIndexFile into a single split
+    static void mergeIndexSplits(const std::string &indexDB, int threads);
+
+    // range of target sequences covered by a split
+    static void getSplitRange(DBReader<unsigned int> *dbr, unsigned int split, DBReader<unsigned int> *tdbr, int splits, size_t *dbFrom, size_t *dbSize);
 
     static DBReader<unsigned int> *openNewHeaderReader(DBReader<unsigned int>*dbr, unsigned int dataIdx, unsigned int indexIdx, int threads, bool touchIndex, bool touchData);
 
@@ -70,6 +91,8 @@ public:
 
     static IndexTable *getIndexTable(unsigned int split, DBReader<unsigned int> *dbr, int preloadMode);
 
+    static bool isCompactIndex(DBReader<unsigned int> *dbr);
+
     static void printSummary(DBReader<unsigned int> *dbr);
 
     static PrefilteringIndexData getMetadata(DBReader<unsigned int> *dbr);
@@ -90,6 +113,18 @@ public:
 
 private:
     static void printMeta(int *meta);
+
+    static void writeSplit(DBWriter &writer, unsigned int thread, unsigned int split,
+                           DBReader<unsigned int> *dbr, size_t dbFrom, size_t dbSize,
+                           BaseMatrix *subMat, Sequence *seq, int alphabetSize, int kmerSize,
+                           int maskMode, int maskLowerCase, int kmerThr, bool compactIndex);
+
+    static void writeIndexTable(DBWriter &writer, unsigned int thread, unsigned int split, size_t dbFrom,
+                                IndexTable &indexTable, SequenceLookup *sequenceLookup);
+
+    static bool setDataSegments(DBReader<unsigned int> *dbr, unsigned int dataIdx, DBReader<unsigned int> *reader, bool touchData);
+
+    static size_t getEntrySize(DBReader<unsigned int> *dbr, size_t id);
 };
 
 #endif
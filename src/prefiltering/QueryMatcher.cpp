@@ -2,6 +2,7 @@
 #include "QueryMatcher.h"
 #include "FastSort.h"
 #include "Util.h"
+#include "HugePages.h"
 
 #define FE_1(WHAT, X) WHAT(X)
 #define FE_2(WHAT, X, ...) WHAT(X)FE_1(WHAT, __VA_ARGS__)
@@ -43,10 +44,8 @@ QueryMatcher::QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLooku
     // we can never find more hits than dbSize
     this->maxHitsPerQuery = std::min(maxHitsPerQuery, dbSize);
     this->resList = (hit_t *) mem_align(ALIGN_INT, maxHitsPerQuery * sizeof(hit_t) );
-    this->databaseHits = new(std::nothrow) IndexEntryLocal[maxDbMatches];
-    Util::checkAllocation(databaseHits, "Can not allocate databaseHits memory in QueryMatcher");
-    this->foundDiagonals = (CounterResult*)calloc(foundDiagonalsSize, sizeof(CounterResult));
-    Util::checkAllocation(foundDiagonals, "Can not allocate foundDiagonals memory in QueryMatcher");
+    this->databaseHits = static_cast<IndexEntryLocal *>(HugePages::allocate(maxDbMatches * sizeof(IndexEntryLocal)));
+    this->foundDiagonals = static_cast<CounterResult *>(HugePages::allocate(foundDiagonalsSize * sizeof(CounterResult)));
     this->lastSequenceHit = this->databaseHits + maxDbMatches;
     this->indexPointer = new(std::nothrow) IndexEntryLocal*[maxSeqLen + 1];
     Util::checkAllocation(indexPointer, "Can not allocate indexPointer memory in QueryMatcher");
@@ -64,16 +63,23 @@ QueryMatcher::QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLooku
         ungappedAlignment = new UngappedAlignment(maxSeqLen, ungappedAlignmentSubMat, sequenceLookup);
     }
     compositionBias = new float[maxSeqLen];
+    batchHits = NULL;
+    batchCurrent = 0;
+    kmerListCache = NULL;
+    holdsCachedKmerList = false;
+    kmerListCacheLookups = 0;
+    kmerListCacheHits = 0;
 }
 
 QueryMatcher::~QueryMatcher(){
     deleteDiagonalMatcher(activeCounter);
     free(resList);
     delete[] scoreSizes;
-    delete[] databaseHits;
+    HugePages::release(databaseHits);
     delete[] indexPointer;
-    free(foundDiagonals);
+    HugePages::release(foundDiagonals);
     delete[] compositionBias;
+    HugePages::release(batchHits);
     if(ungappedAlignment != NULL){
         delete ungappedAlignment;
     }
@@ -81,12 +87,7 @@ QueryMatcher::~QueryMatcher(){
     delete kmerGenerator;
 }
 
-std::pair<hit_t*, size_t> QueryMatcher::matchQuery(Sequence *querySeq, unsigned int identityId, bool isNucleotide) {
-    querySeq->resetCurrPos();
-//    std::cout << "Id: " << querySeq->getId() << std::endl;
-    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
-
-    // bias correction
+void QueryMatcher::computeCompositionBias(Sequence *querySeq) {
     if(aaBiasCorrection == true){
         if(Parameters::isEqualDbtype(querySeq->getSeqType(), Parameters::DBTYPE_AMINO_ACIDS)) {
             SubstitutionMatrix::calcLocalAaBiasCorrection(kmerSubMat, querySeq->numSequence, querySeq->L, compositionBias);
@@ -96,8 +97,50 @@ std::pair<hit_t*, size_t> QueryMatcher::matchQuery(Sequence *querySeq, unsigned
     } else {
         memset(compositionBias, 0, sizeof(float) * querySeq->L);
     }
+}
+
+std::pair<const size_t *, size_t> QueryMatcher::getKmerList(const unsigned char *kmer, short threshold) {
+    // adjust kmer threshold based on composition bias
+    kmerGenerator->setThreshold(threshold);
+    if (kmerListCache == NULL) {
+        return kmerGenerator->generateKmerList(kmer);
+    }
+    releaseKmerList();
+    const size_t kmerIdx = idx.int2index(kmer);
+    kmerListCacheLookups++;
+    size_t size;
+    const size_t *list = kmerListCache->get(kmerIdx, threshold, &size);
+    if (list != NULL) {
+        kmerListCacheHits++;
+        holdsCachedKmerList = true;
+        cachedKmer = kmerIdx;
+        cachedThreshold = threshold;
+        return std::make_pair(list, size);
+    }
+    std::pair<size_t *, size_t> kmerList = kmerGenerator->generateKmerList(kmer);
+    kmerListCache->put(kmerIdx, threshold, kmerList.first, kmerList.second);
+    return kmerList;
+}
+
+std::pair<hit_t*, size_t> QueryMatcher::matchQuery(Sequence *querySeq, unsigned int identityId, bool isNucleotide) {
+    querySeq->resetCurrPos();
+//    std::cout << "Id: " << querySeq->getId() << std::endl;
+    memset(scoreSizes, 0, SCORE_RANGE * sizeof(unsigned int));
 
-    size_t resultSize = match(querySeq, compositionBias);
+    // bias correction
+    computeCompositionBias(querySeq);
+
+    const BatchQuery *batchQuery = NULL;
+    if (batchCurrent < batchQueries.size() && batchQueries[batchCurrent].seq == querySeq) {
+        batchQuery = &batchQueries[batchCurrent];
+        batchCurrent++;
+    }
+    size_t resultSize;
+    if (batchQuery != NULL && batchQuery->gathered) {
+        resultSize = matchGathered(*batchQuery);
+    } else {
+        resultSize = match(querySeq, compositionBias);
+    }
     std::pair<hit_t *, size_t> queryResult;
     if (diagonalScoring) {
         // write diagonal scores in count value
@@ -197,6 +240,8 @@ std::pair<hit_t*, size_t> QueryMatcher::matchQuery(Sequence *querySeq, unsigned
 size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
     // go through the query sequence
     size_t kmerListLen = 0;
+    kmerListCacheLookups = 0;
+    kmerListCacheHits = 0;
     size_t numMatches = 0;
     size_t overflowNumMatches = 0;
     size_t overflowHitCount = 0;
@@ -206,6 +251,7 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
     size_t seqListSize;
     unsigned short indexStart = 0;
     unsigned short indexTo = 0;
+    const bool compactIndex = indexTable->isCompact();
     while (seq->hasNextKmer()) {
         const unsigned char *kmer = seq->nextKmer();
         const unsigned char *pos = seq->getAAPosInSpacedPattern();
@@ -224,9 +270,6 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
         short bias = static_cast<short>((biasCorrection < 0.0) ? biasCorrection - 0.5: biasCorrection + 0.5);
         short kmerMatchScore = std::max(kmerThr - bias, 0);
 
-        // adjust kmer threshold based on composition bias
-        kmerGenerator->setThreshold(kmerMatchScore);
-
         const size_t *index;
         size_t exactKmer;
         size_t kmerElementSize;
@@ -235,7 +278,7 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
             exactKmer = idx.int2index(kmer);
             index = &exactKmer;
         } else {
-            std::pair<size_t*, size_t> kmerList = kmerGenerator->generateKmerList(kmer);
+            std::pair<const size_t*, size_t> kmerList = getKmerList(kmer, kmerMatchScore);
             kmerElementSize = kmerList.second;
             index = kmerList.first;
         }
@@ -248,7 +291,13 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
         kmerListLen += kmerElementSize;
 
         for (unsigned int kmerPos = 0; kmerPos < kmerElementSize; kmerPos++) {
-            const IndexEntryLocal *entries = indexTable->getDBSeqList(index[kmerPos], &seqListSize);
+            const IndexEntryLocal *entries = NULL;
+            const unsigned char *packedEntries = NULL;
+            if (compactIndex) {
+                packedEntries = indexTable->getPackedDBSeqList(index[kmerPos], &seqListSize);
+            } else {
+                entries = indexTable->getDBSeqList(index[kmerPos], &seqListSize);
+            }
             // DEBUG
             //std::cout << seq->getDbKey() << std::endl;
             //idx.printKmer(index[kmerPos], kmerSize, kmerSubMat->num2aa);
@@ -287,13 +336,18 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
                     goto outer;
                 }
             }
-            memcpy(sequenceHits, entries, sizeof(IndexEntryLocal) * seqListSize);
+            if (compactIndex) {
+                IndexTable::unpackDBSeqList(packedEntries, seqListSize, sequenceHits);
+            } else {
+                memcpy(sequenceHits, entries, sizeof(IndexEntryLocal) * seqListSize);
+            }
             sequenceHits += seqListSize;
             numMatches += seqListSize;
         }
         indexTo = current_i;
     }
     outer:
+    releaseKmerList();
     indexPointer[indexTo + 1] = databaseHits + numMatches;
     // fill the output
     size_t hitCount = findDuplicates(indexPointer, foundDiagonals + overflowHitCount,
@@ -311,6 +365,150 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
     stats->kmersPerPos = ((double)kmerListLen/(double)seq->L);
     stats->querySeqLen = seq->L;
     stats->dbMatches   = overflowNumMatches + numMatches;
+    stats->kmerListCacheLookups = kmerListCacheLookups;
+    stats->kmerListCacheHits = kmerListCacheHits;
+
+    return hitCount;
+}
+
+size_t QueryMatcher::gatherBatch(Sequence **seqs, size_t count) {
+    batchRequests.clear();
+    batchQueries.clear();
+    batchPositions.clear();
+    batchCurrent = 0;
+    if (batchHits == NULL) {
+        batchHits = static_cast<IndexEntryLocal *>(HugePages::allocate(maxDbMatches * sizeof(IndexEntryLocal)));
+    }
+
+    const bool compactIndex = indexTable->isCompact();
+    // collect the k-mer list requests of each query, every list gets its final place in batchHits
+    // in the same order as match() would copy it into databaseHits
+    size_t batchHitCount = 0;
+    size_t queryIdx;
+    for (queryIdx = 0; queryIdx < count; queryIdx++) {
+        Sequence *seq = seqs[queryIdx];
+        seq->resetCurrPos();
+        computeCompositionBias(seq);
+
+        const size_t requestStart = batchRequests.size();
+        BatchQuery query;
+        query.seq = seq;
+        query.positionStart = batchPositions.size();
+        query.indexTo = 0;
+        query.kmerListLen = 0;
+        query.numMatches = 0;
+        query.gathered = true;
+        kmerListCacheLookups = 0;
+        kmerListCacheHits = 0;
+        while (seq->hasNextKmer()) {
+            const unsigned char *kmer = seq->nextKmer();
+            const unsigned char *pos = seq->getAAPosInSpacedPattern();
+            const unsigned short current_i = seq->getCurrentPosition();
+            batchPositions.push_back(batchHitCount + query.numMatches);
+            query.indexTo = current_i;
+            if (seq->kmerContainsX()) {
+                continue;
+            }
+
+            float biasCorrection = 0;
+            for (int i = 0; i < kmerSize; i++){
+                biasCorrection += compositionBias[current_i + static_cast<short>(pos[i])];
+            }
+            short bias = static_cast<short>((biasCorrection < 0.0) ? biasCorrection - 0.5: biasCorrection + 0.5);
+            short kmerMatchScore = std::max(kmerThr - bias, 0);
+
+            const size_t *index;
+            size_t exactKmer;
+            size_t kmerElementSize;
+            if (takeOnlyBestKmer) {
+                kmerElementSize = 1;
+                exactKmer = idx.int2index(kmer);
+                index = &exactKmer;
+            } else {
+                std::pair<const size_t*, size_t> kmerList = getKmerList(kmer, kmerMatchScore);
+                kmerElementSize = kmerList.second;
+                index = kmerList.first;
+            }
+            query.kmerListLen += kmerElementSize;
+
+            for (size_t kmerPos = 0; kmerPos < kmerElementSize; kmerPos++) {
+                size_t seqListSize;
+                if (compactIndex) {
+                    indexTable->getPackedDBSeqList(index[kmerPos], &seqListSize);
+                } else {
+                    indexTable->getDBSeqList(index[kmerPos], &seqListSize);
+                }
+                if (seqListSize == 0) {
+                    continue;
+                }
+                BatchRequest request;
+                request.kmer = index[kmerPos];
+                request.offset = batchHitCount + query.numMatches;
+                batchRequests.push_back(request);
+                query.numMatches += seqListSize;
+            }
+        }
+        releaseKmerList();
+        batchPositions.push_back(batchHitCount + query.numMatches);
+        query.positionEnd = batchPositions.size();
+        query.kmerListCacheLookups = kmerListCacheLookups;
+        query.kmerListCacheHits = kmerListCacheHits;
+
+        if (query.numMatches >= maxDbMatches) {
+            // match() has to resolve the diagonal overflow of this query
+            query.gathered = false;
+        } else if (batchHitCount + query.numMatches > maxDbMatches) {
+            // batch is full, the query is gathered with the next batch
+            batchRequests.resize(requestStart);
+            batchPositions.resize(query.positionStart);
+            break;
+        }
+        if (query.gathered == false) {
+            batchRequests.resize(requestStart);
+            batchPositions.resize(query.positionStart);
+        } else {
+            batchHitCount += query.numMatches;
+        }
+        batchQueries.push_back(query);
+    }
+
+    // stream every requested k-mer list once and copy it to all requesting queries
+    SORT_SERIAL(batchRequests.begin(), batchRequests.end(), BatchRequest::compareByKmer);
+    for (size_t i = 0; i < batchRequests.size();) {
+        const size_t kmer = batchRequests[i].kmer;
+        IndexEntryLocal *first = batchHits + batchRequests[i].offset;
+        size_t seqListSize;
+        if (compactIndex) {
+            const unsigned char *packedEntries = indexTable->getPackedDBSeqList(kmer, &seqListSize);
+            IndexTable::unpackDBSeqList(packedEntries, seqListSize, first);
+        } else {
+            const IndexEntryLocal *entries = indexTable->getDBSeqList(kmer, &seqListSize);
+            memcpy(first, entries, sizeof(IndexEntryLocal) * seqListSize);
+        }
+        for (i++; i < batchRequests.size() && batchRequests[i].kmer == kmer; i++) {
+            memcpy(batchHits + batchRequests[i].offset, first, sizeof(IndexEntryLocal) * seqListSize);
+        }
+    }
+    return queryIdx;
+}
+
+size_t QueryMatcher::matchGathered(const BatchQuery &query) {
+    for (size_t i = query.positionStart; i < query.positionEnd; i++) {
+        indexPointer[i - query.positionStart] = batchHits + batchPositions[i];
+    }
+    stats->diagonalOverflow = false;
+    size_t hitCount = findDuplicates(indexPointer, foundDiagonals, foundDiagonalsSize, 0, query.indexTo, (diagonalScoring == false));
+    stats->doubleMatches = 0;
+    if (diagonalScoring == false) {
+        // remove double entries
+        updateScoreBins(foundDiagonals, hitCount);
+        stats->doubleMatches = getDoubleDiagonalMatches();
+    }
+    stats->kmersPerPos = ((double)query.kmerListLen/(double)query.seq->L);
+    stats->querySeqLen = query.seq->L;
+    stats->dbMatches   = query.numMatches;
+    stats->kmerListCacheLookups = query.kmerListCacheLookups;
+    stats->kmerListCacheHits = query.kmerListCacheHits;
 
     return hitCount;
 }
@@ -6,11 +6,15 @@
 #define MMSEQS_QUERYTEMPLATEMATCHEREXACTMATCH_H
 
 #include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
 #include "itoa.h"
 #include "EvalueComputation.h"
 #include "CacheFriendlyOperations.h"
 #include "UngappedAlignment.h"
 #include "KmerGenerator.h"
+#include "KmerListCache.h"
 
 
 struct statistics_t{
@@ -21,7 +25,10 @@ struct statistics_t{
     size_t diagonalOverflow;
     size_t resultsPassedPrefPerSeq;
     size_t truncated;
-    statistics_t() : kmersPerPos(0.0) , dbMatches(0) , doubleMatches(0), querySeqLen(0), diagonalOverflow(0), resultsPassedPrefPerSeq(0), truncated(0) {};
+    size_t kmerListCacheLookups;
+    size_t kmerListCacheHits;
+    statistics_t() : kmersPerPos(0.0) , dbMatches(0) , doubleMatches(0), querySeqLen(0), diagonalOverflow(0), resultsPassedPrefPerSeq(0), truncated(0),
+                     kmerListCacheLookups(0), kmerListCacheHits(0) {};
     statistics_t(double kmersPerPos, size_t dbMatches,
                  size_t doubleMatches, size_t querySeqLen, size_t diagonalOverflow, size_t resultsPassedPrefPerSeq, size_t truncated) : kmersPerPos(kmersPerPos),
                                                                                                                       dbMatches(dbMatches),
@@ -29,7 +36,17 @@ struct statistics_t{
                                                                                                                       querySeqLen(querySeqLen),
                                                                                                                       diagonalOverflow(diagonalOverflow),
                                                                                                                       resultsPassedPrefPerSeq(resultsPassedPrefPerSeq),
-                                                                                                                      truncated(truncated){};
+                                                                                                                      truncated(truncated),
+                                                                                                                      kmerListCacheLookups(0),
+                                                                                                                      kmerListCacheHits(0){};
+};
+
+// binary prefilter result entry layout:
+// binary_hit_header_t | count * seqId (unsigned int) | count * prefScore (int) | count * diagonal (unsigned short)
+struct __attribute__((__packed__)) binary_hit_header_t {
+    char magic;
+    unsigned char reserved[3];
+    unsigned int count;
 };
 
 struct hit_t {
@@ -63,6 +80,12 @@ public:
     // identityId is the id of the identitical sequence in the target database if there is any, UINT_MAX otherwise
     std::pair<hit_t*, size_t> matchQuery(Sequence *querySeq, unsigned int identityId,  bool isNucleotide);
 
+    // gathers the index hits of several queries at once: the similar k-mers of all queries
+    // are sorted by k-mer so that each index list is read only once for the whole batch
+    // returns how many queries from the front of seqs were processed, these have to be
+    // passed to matchQuery afterwards in the same order
+    size_t gatherBatch(Sequence **seqs, size_t count);
+
     // set substituion matrix for KmerGenerator
     void setProfileMatrix(ScoreMatrix **matrix){
         kmerGenerator->setDivideStrategy(matrix);
@@ -73,11 +96,48 @@ public:
         kmerGenerator->setDivideStrategy(three, two);
     }
 
+    // share generated similar k-mer lists with other matchers, not possible for profile queries
+    void setKmerListCache(KmerListCache *cache) {
+        kmerListCache = cache;
+    }
+
     // get statistics
     const statistics_t *getStatistics() {
         return stats;
     }
 
+    // first byte of a binary prefilter result entry, text entries always start with a digit
+    const static char BINARY_HIT_MAGIC = '\x02';
+
+    static bool isBinaryHits(const char *data) {
+        return data != NULL && *data == BINARY_HIT_MAGIC;
+    }
+
+    // zero-copy access to the arrays of a binary prefilter result entry
+    static unsigned int getBinaryHitCount(const char *data) {
+        return reinterpret_cast<const binary_hit_header_t *>(data)->count;
+    }
+
+    static const unsigned int *getBinaryHitSeqIds(const char *data) {
+        return reinterpret_cast<const unsigned int *>(data + sizeof(binary_hit_header_t));
+    }
+
+    static const int *getBinaryHitScores(const char *data) {
+        return reinterpret_cast<const int *>(data + sizeof(binary_hit_header_t) + getBinaryHitCount(data) * sizeof(unsigned int));
+    }
+
+    static const unsigned short *getBinaryHitDiagonals(const char *data) {
+        return reinterpret_cast<const unsigned short *>(data + sizeof(binary_hit_header_t) + getBinaryHitCount(data) * (sizeof(unsigned int) + sizeof(int)));
+    }
+
+    static hit_t getBinaryHit(const char *data, size_t idx) {
+        hit_t result;
+        result.seqId = getBinaryHitSeqIds(data)[idx];
+        result.prefScore = getBinaryHitScores(data)[idx];
+        result.diagonal = getBinaryHitDiagonals(data)[idx];
+        return result;
+    }
+
     static hit_t parsePrefilterHit(char* data) {
         hit_t result;
         const char *wordCnt[255];
@@ -95,15 +155,26 @@ public:
 
     static std::vector<hit_t> parsePrefilterHits(char *data) {
         std::vector<hit_t> ret;
-        while (*data != '\0') {
-            hit_t result = parsePrefilterHit(data);
-            ret.push_back(result);
-            data = Util::skipLine(data);
-        }
+        parsePrefilterHits(data, ret);
         return ret;
     }
 
     static void parsePrefilterHits(char *data, std::vector<hit_t> &entries) {
+        if (isBinaryHits(data)) {
+            const unsigned int count = getBinaryHitCount(data);
+            const unsigned int *seqIds = getBinaryHitSeqIds(data);
+            const int *scores = getBinaryHitScores(data);
+            const unsigned short *diagonals = getBinaryHitDiagonals(data);
+            entries.reserve(entries.size() + count);
+            for (unsigned int i = 0; i < count; i++) {
+                hit_t result;
+                result.seqId = seqIds[i];
+                result.prefScore = scores[i];
+                result.diagonal = diagonals[i];
+                entries.push_back(result);
+            }
+            return;
+        }
         while (*data != '\0') {
             hit_t result = parsePrefilterHit(data);
             entries.push_back(result);
@@ -125,6 +196,42 @@ public:
         return tmpBuff - basePos;
     }
 
+    // appends hits as one binary prefilter result entry, empty hit lists stay empty entries
+    static void prefilterHitsToBinaryBuffer(std::string &buffer, const hit_t *hits, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        binary_hit_header_t header;
+        header.magic = BINARY_HIT_MAGIC;
+        memset(header.reserved, 0, sizeof(header.reserved));
+        header.count = static_cast<unsigned int>(count);
+        size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(binary_hit_header_t) + count * (sizeof(unsigned int) + sizeof(int) + sizeof(unsigned short)));
+        char *out = &buffer[offset];
+        memcpy(out, &header, sizeof(binary_hit_header_t));
+        out += sizeof(binary_hit_header_t);
+        for (size_t i = 0; i < count; i++, out += sizeof(unsigned int)) {
+            memcpy(out, &hits[i].seqId, sizeof(unsigned int));
+        }
+        for (size_t i = 0; i < count; i++, out += sizeof(int)) {
+            memcpy(out, &hits[i].prefScore, sizeof(int));
+        }
+        for (size_t i = 0; i < count; i++, out += sizeof(unsigned short)) {
+            memcpy(out, &hits[i].diagonal, sizeof(unsigned short));
+        }
+    }
+
+    // appends the text representation of a binary prefilter result entry
+    static void binaryHitsToText(const char *data, std::string &buffer) {
+        char lineBuffer[128];
+        const unsigned int count = getBinaryHitCount(data);
+        for (unsigned int i = 0; i < count; i++) {
+            hit_t hit = getBinaryHit(data, i);
+            size_t len = prefilterHitToBuffer(lineBuffer, hit);
+            buffer.append(lineBuffer, len);
+        }
+    }
+
 protected:
     const static int KMER_SCORE = 0;
     const static int UNGAPPED_DIAGONAL_SCORE = 1;
@@ -137,6 +244,14 @@ protected:
     BaseMatrix *ungappedAlignmentSubMat;
     /* generates kmer lists */
     KmerGenerator *kmerGenerator;
+    // cache of kmer lists, NULL if disabled
+    KmerListCache *kmerListCache;
+    // cache entry that is in use by the current position
+    bool holdsCachedKmerList;
+    size_t cachedKmer;
+    short cachedThreshold;
+    size_t kmerListCacheLookups;
+    size_t kmerListCacheHits;
     /* contains the sequences for a kmer */
     IndexTable *indexTable;
     // k of the k-mer
@@ -167,6 +282,42 @@ protected:
     // i position to hits pointer
     IndexEntryLocal **indexPointer;
 
+    struct BatchRequest {
+        size_t kmer;
+        // offset of the k-mer list in batchHits
+        size_t offset;
+
+        static bool compareByKmer(const BatchRequest &first, const BatchRequest &second) {
+            if (first.kmer != second.kmer) {
+                return first.kmer < second.kmer;
+            }
+            return first.offset < second.offset;
+        }
+    };
+
+    struct BatchQuery {
+        Sequence *seq;
+        // entries of the query in batchPositions, one per position and the end of the last one
+        size_t positionStart;
+        size_t positionEnd;
+        unsigned short indexTo;
+        size_t kmerListLen;
+        size_t numMatches;
+        size_t kmerListCacheLookups;
+        size_t kmerListCacheHits;
+        // false if the query did not fit and has to be matched by match()
+        bool gathered;
+    };
+
+    // hits of all gathered queries of the current batch, allocated on first use
+    IndexEntryLocal *batchHits;
+    std::vector<BatchRequest> batchRequests;
+    std::vector<BatchQuery> batchQueries;
+    // hit offset of each query position in batchHits
+    std::vector<size_t> batchPositions;
+    // next query of the batch expected by matchQuery
+    size_t batchCurrent;
+
     // keeps data in inner loop
     IndexEntryLocal *__restrict databaseHits;
 
@@ -208,9 +359,25 @@ protected:
         return scoreThr;
     }
 
+    void computeCompositionBias(Sequence *querySeq);
+
+    // similar kmer list above threshold, served from kmerListCache if possible
+    // the list is valid until the next call or releaseKmerList
+    std::pair<const size_t *, size_t> getKmerList(const unsigned char *kmer, short threshold);
+
+    void releaseKmerList() {
+        if (holdsCachedKmerList) {
+            kmerListCache->release(cachedKmer, cachedThreshold);
+            holdsCachedKmerList = false;
+        }
+    }
+
     // match sequence against the IndexTable
     size_t match(Sequence *seq, float *compositionBias);
 
+    // same as match but uses the hits collected by gatherBatch
+    size_t matchGathered(const BatchQuery &query);
+
     // extract result from databaseHits
     template <int TYPE>
     std::pair<hit_t *, size_t> getResult(CounterResult * results,
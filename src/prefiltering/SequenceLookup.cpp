@@ -6,15 +6,13 @@
 #include <sys/mman.h>
 #include "Debug.h"
 #include "Util.h"
+#include "HugePages.h"
 #include "SequenceLookup.h"
 
 SequenceLookup::SequenceLookup(size_t sequenceCount, size_t dataSize)
         : sequenceCount(sequenceCount), dataSize(dataSize), currentIndex(0), currentOffset(0), externalData(false) {
-    data = new(std::nothrow) char[dataSize + 1];
-    Util::checkAllocation(data, "Can not allocate data memory in SequenceLookup");
-
-    offsets = new(std::nothrow) size_t[sequenceCount + 1];
-    Util::checkAllocation(offsets, "Can not allocate offsets memory in SequenceLookup");
+    data = static_cast<char *>(HugePages::allocate(dataSize + 1));
+    offsets = static_cast<size_t *>(HugePages::allocate((sequenceCount + 1) * sizeof(size_t)));
     offsets[sequenceCount] = dataSize;
 }
 
@@ -24,8 +22,8 @@ SequenceLookup::SequenceLookup(size_t sequenceCount)
 
 SequenceLookup::~SequenceLookup() {
     if(externalData == false){
-        delete[] data;
-        delete[] offsets;
+        HugePages::release(data);
+        HugePages::release(offsets);
     }
 }
 
@@ -5,14 +5,15 @@
 
 UngappedAlignment::UngappedAlignment(const unsigned int maxSeqLen,
                                      BaseMatrix *substitutionMatrix, SequenceLookup *sequenceLookup)
-        : subMatrix(substitutionMatrix), sequenceLookup(sequenceLookup) {
-    score_arr = new unsigned int[VECSIZE_INT*4];
+        : kernels(SimdDispatch::getKernels()), diagonalBinSize(kernels.lanes),
+          subMatrix(substitutionMatrix), sequenceLookup(sequenceLookup) {
+    score_arr = new unsigned char[SimdDispatch::MAX_LANES];
     diagonalCounter = new unsigned char[DIAGONALCOUNT];
-    vectorSequence = (unsigned char *) malloc_simd_int(VECSIZE_INT * 4 * maxSeqLen);
-    queryProfile   = (char *) malloc_simd_int(PROFILESIZE * maxSeqLen);
+    vectorSequence = (unsigned char *) mem_align(SimdDispatch::MAX_LANES, diagonalBinSize * maxSeqLen);
+    queryProfile   = (char *) mem_align(SimdDispatch::MAX_LANES, PROFILESIZE * maxSeqLen);
     memset(queryProfile, 0, PROFILESIZE * maxSeqLen);
     aaCorrectionScore = (char *) malloc_simd_int(maxSeqLen);
-    diagonalMatches = new CounterResult*[DIAGONALCOUNT * (VECSIZE_INT * 4)];
+    diagonalMatches = new CounterResult*[DIAGONALCOUNT * diagonalBinSize];
 }
 
 UngappedAlignment::~UngappedAlignment() {
@@ -51,74 +52,27 @@ int UngappedAlignment::scalarDiagonalScoring(const char * profile,
 }
 
 
-simd_int UngappedAlignment::vectorDiagonalScoring(const char *profile,
-                                                const char bias,
-                                                const unsigned int seqLen,
-                                                const unsigned char *dbSeq) {
-    simd_int vscore        = simdi_setzero();
-    simd_int vMaxScore     = simdi_setzero();
-    const simd_int vBias   = simdi8_set(bias);
-#ifndef AVX2
-    const simd_int sixten  = simdi8_set(16);
-    const simd_int fiveten = simdi8_set(15);
-#endif
-    for (unsigned int pos = 0; pos < seqLen; pos++) {
-        simd_int template01 = simdi_load((simd_int *)&dbSeq[pos*VECSIZE_INT*4]);
-#ifdef AVX2
-        __m256i score_matrix_vec01 = _mm256_load_si256((simd_int *)&profile[pos * PROFILESIZE]);
-        __m256i score_vec_8bit = Shuffle(score_matrix_vec01, template01);
-        //        __m256i score_vec_8bit = _mm256_shuffle_epi8(score_matrix_vec01, template01);
-        //        __m256i lookup_mask01  = _mm256_cmpgt_epi8(sixten, template01); // 16 > t
-        //        score_vec_8bit = _mm256_and_si256(score_vec_8bit, lookup_mask01);
-#else
-        // each position has 32 byte
-        // 20 scores and 12 zeros
-        // load score 0 - 15
-        __m128i score_matrix_vec01 = _mm_load_si128((__m128i *)&profile[pos * 32]);
-        // load score 16 - 32
-        __m128i score_matrix_vec16 = _mm_load_si128((__m128i *)&profile[pos * 32 + 16]);
-        // parallel score lookup
-        // _mm_shuffle_epi8
-        // for i ... 16
-        //   score01[i] = score_matrix_vec01[template01[i]%16]
-        __m128i score01 =_mm_shuffle_epi8(score_matrix_vec01,template01);
-        __m128i score16 =_mm_shuffle_epi8(score_matrix_vec16,template01);
-        // t[i] < 16 => 0 - 15
-        // example: template01: 02 15 12 18 < 16 16 16 16 => FF FF FF 00
-        __m128i lookup_mask01 = _mm_cmplt_epi8(template01, sixten);
-        // 15 < t[i] => 16 - xx
-        // example: template01: 16 16 16 16 < 02 15 12 18 => 00 00 00 FF
-        __m128i lookup_mask16 = _mm_cmplt_epi8(fiveten, template01);
-        // score01 & lookup_mask01 => Score   Score   Score   NoScore
-        score01 = _mm_and_si128(lookup_mask01,score01);
-        // score16 & lookup_mask16 => NoScore NoScore NoScore Score
-        score16 = _mm_and_si128(lookup_mask16,score16);
-        //     Score   Score   Score NoScore
-        // + NoScore NoScore NoScore   Score
-        // =   Score   Score   Score   Score
-        __m128i score_vec_8bit = _mm_add_epi8(score01,score16);
-#endif
-        vscore    = simdui8_adds(vscore, score_vec_8bit);
-        vscore    = simdui8_subs(vscore, vBias);
-//        std::cout << (int)((char *)&template01)[0] << "\t" <<  SSTR(((char *)&score_vec_8bit)[0]) << "\t" << SSTR(((char *)&vMaxScore)[0]) << "\t" << SSTR(((char *)&vscore)[0]) << std::endl;
-        vMaxScore = simdui8_max(vMaxScore, vscore);
-
-    }
-    return vMaxScore;
-}
-
 std::pair<unsigned char *, unsigned int> UngappedAlignment::mapSequences(std::pair<unsigned char *, unsigned int> * seqs,
-                                                                       unsigned int seqCount) {
+                                                                       unsigned int seqCount,
+                                                                       unsigned int offset,
+                                                                       unsigned int maxWindowLen) {
     unsigned int maxLen = 0;
     for(unsigned int seqIdx = 0; seqIdx < seqCount;  seqIdx++) {
-        maxLen = std::max(seqs[seqIdx].second, maxLen);
+        unsigned int windowLen = (seqs[seqIdx].second > offset) ? seqs[seqIdx].second - offset : 0;
+        maxLen = std::max(std::min(windowLen, maxWindowLen), maxLen);
     }
-    memset(vectorSequence, 21, maxLen * VECSIZE_INT * 4 * sizeof(unsigned char));
-    for(unsigned int seqIdx = 0; seqIdx < VECSIZE_INT*4;  seqIdx++){
-        const unsigned char * seq  = seqs[seqIdx].first;
-        const unsigned int seqSize = seqs[seqIdx].second;
+    // locals, the byte stores below would otherwise force a reload of the members in every iteration
+    unsigned char * vectorSeq = vectorSequence;
+    const unsigned int binSize = diagonalBinSize;
+    memset(vectorSeq, 21, maxLen * binSize * sizeof(unsigned char));
+    for(unsigned int seqIdx = 0; seqIdx < seqCount;  seqIdx++){
+        if (seqs[seqIdx].second <= offset) {
+            continue;
+        }
+        const unsigned char * seq  = seqs[seqIdx].first + offset;
+        const unsigned int seqSize = std::min(seqs[seqIdx].second - offset, maxLen);
         for(unsigned int pos = 0; pos < seqSize;  pos++){
-            vectorSequence[pos * VECSIZE_INT * 4 + seqIdx] = seq[pos];
+            vectorSeq[pos * binSize + seqIdx] = seq[pos];
         }
     }
     return std::make_pair(vectorSequence, maxLen);
@@ -144,8 +98,8 @@ void UngappedAlignment::scoreDiagonalAndUpdateHits(const char * queryProfile,
         }
         return;
     }
-    if (hitSize > (VECSIZE_INT * 4) / 16) {
-        std::pair<unsigned char *, unsigned int> seqs[VECSIZE_INT * 4];
+    if (hitSize > diagonalBinSize / 16) {
+        std::pair<unsigned char *, unsigned int> seqs[SimdDispatch::MAX_LANES];
         for (unsigned int seqIdx = 0; seqIdx < hitSize; seqIdx++) {
             std::pair<const unsigned char *, const unsigned int> tmp = sequenceLookup->getSequence(
                     hits[seqIdx]->id);
@@ -157,22 +111,17 @@ void UngappedAlignment::scoreDiagonalAndUpdateHits(const char * queryProfile,
                 seqs[seqIdx] = std::make_pair((unsigned char *) tmp.first, (unsigned int) tmp.second);
             }
         }
-        std::pair<unsigned char *, unsigned int> seq = mapSequences(seqs, hitSize);
-
-        simd_int vMaxScore = simdi_setzero();
-
+        // only the part of the db sequences that overlaps the query on this diagonal is transposed
         if (diagonal >= 0 && minDistToDiagonal < queryLen) {
-            unsigned int minSeqLen = std::min(seq.second, queryLen - minDistToDiagonal);
-            simd_int ret = vectorDiagonalScoring(queryProfile + (minDistToDiagonal * PROFILESIZE), bias, minSeqLen,
-                                                 seq.first);
-            vMaxScore = simdui8_max(ret, vMaxScore);
-        } else if (diagonal < 0 && minDistToDiagonal < seq.second) {
-            unsigned int minSeqLen = std::min(seq.second - minDistToDiagonal, queryLen);
-            simd_int ret = vectorDiagonalScoring(queryProfile, bias, minSeqLen,
-                                                 seq.first + minDistToDiagonal * VECSIZE_INT * 4);
-            vMaxScore = simdui8_max(ret, vMaxScore);
+            std::pair<unsigned char *, unsigned int> seq = mapSequences(seqs, hitSize, 0, queryLen - minDistToDiagonal);
+            kernels.diagonalScoring(queryProfile + (minDistToDiagonal * PROFILESIZE), bias, seq.second,
+                                    seq.first, score_arr);
+        } else if (diagonal < 0) {
+            std::pair<unsigned char *, unsigned int> seq = mapSequences(seqs, hitSize, minDistToDiagonal, queryLen);
+            kernels.diagonalScoring(queryProfile, bias, seq.second, seq.first, score_arr);
+        } else {
+            memset(score_arr, 0, diagonalBinSize * sizeof(unsigned char));
         }
-        extractScores(score_arr, vMaxScore);
         // update score
         for(size_t hitIdx = 0; hitIdx < hitSize; hitIdx++){
             hits[hitIdx]->count = score_arr[hitIdx];
@@ -224,6 +173,7 @@ void UngappedAlignment::computeScores(const char *queryProfile,
                                     CounterResult * results,
                                     const size_t resultSize,
                                     const short bias) {
+    const unsigned int binSize = diagonalBinSize;
     memset(diagonalCounter, 0, DIAGONALCOUNT * sizeof(unsigned char));
     for(size_t i = 0; i < resultSize; i++){
 //        // skip all that count not find enough diagonals
@@ -231,11 +181,11 @@ void UngappedAlignment::computeScores(const char *queryProfile,
 //            continue;
 //        }
         const unsigned short currDiag = results[i].diagonal;
-        diagonalMatches[currDiag * (VECSIZE_INT * 4) + diagonalCounter[currDiag]] = &results[i];
+        diagonalMatches[currDiag * binSize + diagonalCounter[currDiag]] = &results[i];
         diagonalCounter[currDiag]++;
-        if(diagonalCounter[currDiag] >= (VECSIZE_INT * 4) ) {
+        if(diagonalCounter[currDiag] >= binSize ) {
             scoreDiagonalAndUpdateHits(queryProfile, queryLen, static_cast<short>(currDiag),
-                                       &diagonalMatches[currDiag * (VECSIZE_INT * 4)], diagonalCounter[currDiag], bias);
+                                       &diagonalMatches[currDiag * binSize], diagonalCounter[currDiag], bias);
             diagonalCounter[currDiag] = 0;
         }
     }
@@ -243,7 +193,7 @@ void UngappedAlignment::computeScores(const char *queryProfile,
     for(size_t i = 0; i < DIAGONALCOUNT; i++){
         if(diagonalCounter[i] > 0){
             scoreDiagonalAndUpdateHits(queryProfile, queryLen, static_cast<short>(i),
-                                       &diagonalMatches[i * (VECSIZE_INT * 4)], diagonalCounter[i], bias);
+                                       &diagonalMatches[i * binSize], diagonalCounter[i], bias);
         }
         diagonalCounter[i] = 0;
     }
@@ -256,29 +206,6 @@ unsigned short UngappedAlignment::distanceFromDiagonal(const unsigned short diag
     return std::min(dist1 , dist2);
 }
 
-void UngappedAlignment::extractScores(unsigned int *score_arr, simd_int score) {
-#ifdef AVX2
-#define EXTRACT_AVX(i) score_arr[i] = _mm256_extract_epi8(score, i)
-    EXTRACT_AVX(0);  EXTRACT_AVX(1);  EXTRACT_AVX(2);  EXTRACT_AVX(3);
-    EXTRACT_AVX(4);  EXTRACT_AVX(5);  EXTRACT_AVX(6);  EXTRACT_AVX(7);
-    EXTRACT_AVX(8);  EXTRACT_AVX(9);  EXTRACT_AVX(10);  EXTRACT_AVX(11);
-    EXTRACT_AVX(12);  EXTRACT_AVX(13);  EXTRACT_AVX(14);  EXTRACT_AVX(15);
-    EXTRACT_AVX(16);  EXTRACT_AVX(17);  EXTRACT_AVX(18);  EXTRACT_AVX(19);
-    EXTRACT_AVX(20);  EXTRACT_AVX(21);  EXTRACT_AVX(22);  EXTRACT_AVX(23);
-    EXTRACT_AVX(24);  EXTRACT_AVX(25);  EXTRACT_AVX(26);  EXTRACT_AVX(27);
-    EXTRACT_AVX(28);  EXTRACT_AVX(29);  EXTRACT_AVX(30);  EXTRACT_AVX(31);
-#undef EXTRACT_AVX
-#else
-    #define EXTRACT_SSE(i) score_arr[i] = _mm_extract_epi8(score, i)
-    EXTRACT_SSE(0);  EXTRACT_SSE(1);   EXTRACT_SSE(2);  EXTRACT_SSE(3);
-    EXTRACT_SSE(4);  EXTRACT_SSE(5);   EXTRACT_SSE(6);  EXTRACT_SSE(7);
-    EXTRACT_SSE(8);  EXTRACT_SSE(9);   EXTRACT_SSE(10); EXTRACT_SSE(11);
-    EXTRACT_SSE(12); EXTRACT_SSE(13);  EXTRACT_SSE(14); EXTRACT_SSE(15);
-#undef EXTRACT_SSE
-#endif
-}
-
-
 short UngappedAlignment::createProfile(Sequence *seq,
                                      float * biasCorrection,
                                      short **subMat, int alphabetSize) {
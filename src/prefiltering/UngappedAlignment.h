@@ -9,6 +9,8 @@
 #include "simd.h"
 #include "CacheFriendlyOperations.h"
 #include "SequenceLookup.h"
+#include "SimdDispatch.h"
+
 class UngappedAlignment {
 
 public:
@@ -49,9 +51,14 @@ public:
 
 private:
     const static unsigned int DIAGONALCOUNT = 0xFFFF + 1;
-    const static unsigned int PROFILESIZE = 32;
+    const static unsigned int PROFILESIZE = SimdDispatch::PROFILE_SIZE;
+
+    // runtime selected diagonal scoring kernel
+    const SimdKernels &kernels;
+    // number of db sequences scored in parallel along one diagonal (16 sse, 32 avx2, 64 avx512bw)
+    const unsigned int diagonalBinSize;
 
-    unsigned int *score_arr;
+    unsigned char *score_arr;
     unsigned char *vectorSequence;
     char *queryProfile;
     unsigned int queryLen;
@@ -62,8 +69,8 @@ private:
     BaseMatrix *subMatrix;
     SequenceLookup *sequenceLookup;
 
-    // this function bins the hit_t by diagonals by distributing each hit in an array of 256 * 16(sse)/32(avx2)
-    // the function scoreDiagonalAndUpdateHits is called for each bin that reaches its maximum (16 or 32)
+    // this function bins the hit_t by diagonals by distributing each hit in an array of DIAGONALCOUNT * diagonalBinSize
+    // the function scoreDiagonalAndUpdateHits is called for each bin that reaches its maximum (diagonalBinSize)
     void computeScores(const char *queryProfile,
                        const unsigned int queryLen,
                        CounterResult * results,
@@ -75,13 +82,11 @@ private:
                                     const unsigned int seqLen,
                                     const unsigned char *dbSeq);
 
-    // scores the diagonal of  16/32 db sequences in parallel
-    simd_int vectorDiagonalScoring(const char *profile,
-                                         const char bias, const unsigned int seqLen, const unsigned char *dbSeq);
+    // transposes the window [offset, offset + maxWindowLen) of each sequence into vectorSequence
+    std::pair<unsigned char *, unsigned int> mapSequences(std::pair<unsigned char *, unsigned int> * seqs, unsigned int seqCount,
+                                                          unsigned int offset, unsigned int maxWindowLen);
 
-    std::pair<unsigned char *, unsigned int> mapSequences(std::pair<unsigned char *, unsigned int> * seqs, unsigned int seqCount);
-
-    // calles vectorDiagonalScoring or scalarDiagonalScoring depending on the hitSize
+    // calles the vector diagonal kernel or scalarDiagonalScoring depending on the hitSize
     // and updates diagonalScore of the hit_t objects
     void scoreDiagonalAndUpdateHits(const char *queryProfile, const unsigned int queryLen,
                                     const short diagonal, CounterResult **hits, const unsigned int hitSize,
@@ -89,8 +94,6 @@ private:
 
     unsigned short distanceFromDiagonal(const unsigned short diagonal);
 
-    void extractScores(unsigned int *score_arr, simd_int score);
-
     short createProfile(Sequence *seq, float *biasCorrection, short **subMat, int alphabetSize);
 
     unsigned int diagonalLength(const short diagonal, const unsigned int len, const unsigned int second);
@@ -14,6 +14,7 @@
 #include "NucleotideMatrix.h"
 #include "FastSort.h"
 #include "SubstitutionMatrixProfileStates.h"
+#include "SimdDispatch.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -61,6 +62,49 @@ int doRescorealldiagonal(Parameters &par, DBReader<unsigned int> &qdbr, DBWriter
     }
 
 
+    // encode the targets once and store them transposed in blocks of one target per SIMD lane
+    // targets are sorted by length, so that the targets of a block have similar lengths
+    // with less than 64 lanes the table lookups make the batch kernel slower than the striped one,
+    // then each block holds a single target that is scored with ungapped_alignment
+    const size_t lanes = (SimdDispatch::getKernels().lanes >= 64) ? SimdDispatch::getKernels().lanes : 1;
+    const size_t targetCount = tdbr->getSize();
+    std::vector<std::pair<unsigned int, unsigned int>> targetOrder(targetCount);
+    for (size_t tId = 0; tId < targetCount; tId++) {
+        const unsigned int targetLength = std::min(tdbr->getSeqLen(tId), static_cast<size_t>(par.maxSeqLen));
+        targetOrder[tId] = std::make_pair(targetLength, static_cast<unsigned int>(tId));
+    }
+    SORT_PARALLEL(targetOrder.begin(), targetOrder.end(), std::greater<std::pair<unsigned int, unsigned int>>());
+    const size_t blockCount = (targetCount + lanes - 1) / lanes;
+    std::vector<size_t> blockOffsets(blockCount + 1, 0);
+    for (size_t block = 0; block < blockCount; block++) {
+        blockOffsets[block + 1] = blockOffsets[block] + targetOrder[block * lanes].first * lanes;
+    }
+    unsigned char *targetResidues = (unsigned char *) mem_align(SimdDispatch::MAX_LANES, std::max(blockOffsets[blockCount], static_cast<size_t>(1)));
+    unsigned int *targetLengths = new unsigned int[targetCount];
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+        Sequence tSeq(par.maxSeqLen, targetSeqType, subMat, 0, false, par.compBiasCorrection);
+#pragma omp for schedule(dynamic, 1)
+        for (size_t block = 0; block < blockCount; block++) {
+            unsigned char *blockResidues = targetResidues + blockOffsets[block];
+            const unsigned int blockLength = targetOrder[block * lanes].first;
+            memset(blockResidues, SmithWaterman::UNGAPPED_PADDING, blockLength * lanes);
+            for (size_t lane = 0; lane < lanes && block * lanes + lane < targetCount; lane++) {
+                const unsigned int tId = targetOrder[block * lanes + lane].second;
+                tSeq.mapSequence(tId, tdbr->getDbKey(tId), tdbr->getData(tId, thread_idx), tdbr->getSeqLen(tId));
+                const unsigned int length = std::min(static_cast<unsigned int>(tSeq.L), blockLength);
+                for (unsigned int pos = 0; pos < length; pos++) {
+                    blockResidues[pos * lanes + lane] = tSeq.numSequence[pos];
+                }
+                targetLengths[tId] = tSeq.L;
+            }
+        }
+    }
+
     Debug::Progress progress(dbSize);
 
 #pragma omp parallel
@@ -73,7 +117,6 @@ int doRescorealldiagonal(Parameters &par, DBReader<unsigned int> &qdbr, DBWriter
         std::vector<hit_t> shortResults;
         shortResults.reserve(std::max(static_cast<size_t >(1), tdbr->getSize()/5));
         Sequence qSeq(par.maxSeqLen, querySeqType, subMat, 0, false, par.compBiasCorrection);
-        Sequence tSeq(par.maxSeqLen, targetSeqType, subMat, 0, false, par.compBiasCorrection);
         SmithWaterman aligner(par.maxSeqLen, subMat->alphabetSize, par.compBiasCorrection, targetSeqType);
 
         std::string resultBuffer;
@@ -93,30 +136,44 @@ int doRescorealldiagonal(Parameters &par, DBReader<unsigned int> &qdbr, DBWriter
                 aligner.ssw_init(&qSeq, tinySubMat, subMat);
             }
 
-            for (size_t tId = 0; tId < tdbr->getSize(); tId++) {
-                unsigned int targetKey = tdbr->getDbKey(tId);
-                const bool isIdentity = (queryKey == targetKey && (par.includeIdentity || sameDB))? true : false;
-                char * targetSeq = tdbr->getData(tId, thread_idx);
-                unsigned int targetSeqLen = tdbr->getSeqLen(tId);
-                tSeq.mapSequence(tId, targetKey, targetSeq, targetSeqLen);
-//                tSeq.print();
-                float queryLength = qSeq.L;
-                float targetLength = tSeq.L;
-                if(Util::canBeCovered(par.covThr, par.covMode, queryLength, targetLength)==false){
+            unsigned char laneScores[SimdDispatch::MAX_LANES];
+            for (size_t block = 0; block < blockCount; block++) {
+                const size_t laneCount = std::min(lanes, targetCount - block * lanes);
+                bool canBeCovered = false;
+                for (size_t lane = 0; lane < laneCount && canBeCovered == false; lane++) {
+                    const unsigned int tId = targetOrder[block * lanes + lane].second;
+                    canBeCovered = Util::canBeCovered(par.covThr, par.covMode, qSeq.L, targetLengths[tId]);
+                }
+                if (canBeCovered == false) {
                     continue;
                 }
-
-                int score = aligner.ungapped_alignment(tSeq.numSequence, tSeq.L);
-                bool hasDiagScore = (score > par.minDiagScoreThr);
-                double evalue = evaluer->computeEvalue(score, qSeq.L);
-                bool hasEvalue = (evalue <= par.evalThr);
-                // --filter-hits
-                if (isIdentity || (hasDiagScore && hasEvalue)) {
-                    hit_t hit;
-                    hit.seqId = targetKey;
-                    hit.prefScore = score;
-                    hit.diagonal = 0;
-                    shortResults.emplace_back(hit);
+                if (lanes == 1) {
+                    laneScores[0] = aligner.ungapped_alignment(targetResidues + blockOffsets[block], targetOrder[block].first);
+                } else {
+                    aligner.ungapped_alignment_batch(targetResidues + blockOffsets[block], targetOrder[block * lanes].first, laneScores);
+                }
+                for (size_t lane = 0; lane < laneCount; lane++) {
+                    const unsigned int tId = targetOrder[block * lanes + lane].second;
+                    unsigned int targetKey = tdbr->getDbKey(tId);
+                    const bool isIdentity = (queryKey == targetKey && (par.includeIdentity || sameDB))? true : false;
+                    float queryLength = qSeq.L;
+                    float targetLength = targetLengths[tId];
+                    if(Util::canBeCovered(par.covThr, par.covMode, queryLength, targetLength)==false){
+                        continue;
+                    }
+
+                    int score = laneScores[lane];
+                    bool hasDiagScore = (score > par.minDiagScoreThr);
+                    double evalue = evaluer->computeEvalue(score, qSeq.L);
+                    bool hasEvalue = (evalue <= par.evalThr);
+                    // --filter-hits
+                    if (isIdentity || (hasDiagScore && hasEvalue)) {
+                        hit_t hit;
+                        hit.seqId = targetKey;
+                        hit.prefScore = score;
+                        hit.diagonal = 0;
+                        shortResults.emplace_back(hit);
+                    }
                 }
             }
 
@@ -139,6 +196,8 @@ int doRescorealldiagonal(Parameters &par, DBReader<unsigned int> &qdbr, DBWriter
         delete tdbr;
     }
 
+    free(targetResidues);
+    delete [] targetLengths;
     delete [] tinySubMat;
     delete subMat;
     delete evaluer;
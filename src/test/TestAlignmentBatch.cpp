@@ -0,0 +1,141 @@
+// Compares the inter-sequence batch scores against the striped Smith-Waterman and ungapped scores
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Util.h"
+#include "Parameters.h"
+#include "Sequence.h"
+#include "SubstitutionMatrix.h"
+#include "StripedSmithWaterman.h"
+#include "EvalueComputation.h"
+
+const char* binary_name = "test_alignmentbatch";
+
+std::string randomSequence(size_t len) {
+    const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+    std::string seq;
+    for (size_t i = 0; i < len; i++) {
+        seq.push_back(aa[rand() % 20]);
+    }
+    return seq;
+}
+
+int main (int, const char**) {
+    Parameters& par = Parameters::getInstance();
+    par.initMatrices();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0, 0);
+    int8_t *tinySubMat = new int8_t[subMat.alphabetSize * subMat.alphabetSize];
+    for (int i = 0; i < subMat.alphabetSize; i++) {
+        for (int j = 0; j < subMat.alphabetSize; j++) {
+            tinySubMat[i * subMat.alphabetSize + j] = (int8_t) subMat.subMatrix[i][j];
+        }
+    }
+
+    const int gap_open = 11;
+    const int gap_extend = 1;
+    EvalueComputation evaluer(100000, &subMat, gap_open, gap_extend);
+    srand(1);
+
+    size_t mismatches = 0;
+    size_t compared = 0;
+    size_t saturated = 0;
+    for (int compBias = 0; compBias < 2; compBias++) {
+        Sequence query(1000, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 0, false, compBias);
+        Sequence *targets[SmithWaterman::INTER_SEQ_LANES];
+        for (size_t i = 0; i < SmithWaterman::INTER_SEQ_LANES; i++) {
+            targets[i] = new Sequence(1000, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 0, false, compBias);
+        }
+        SmithWaterman aligner(1000, subMat.alphabetSize, compBias, Parameters::DBTYPE_AMINO_ACIDS);
+
+        for (size_t round = 0; round < 50; round++) {
+            std::string querySeq = randomSequence(20 + rand() % 300);
+            query.mapSequence(0, 0, querySeq.c_str(), querySeq.size());
+            aligner.ssw_init(&query, tinySubMat, &subMat);
+
+            // every other target is a mutated piece of the query to get high scoring alignments
+            std::vector<std::string> targetSeqs;
+            const size_t count = 1 + rand() % SmithWaterman::INTER_SEQ_LANES;
+            const unsigned char *sequences[SmithWaterman::INTER_SEQ_LANES];
+            int32_t lengths[SmithWaterman::INTER_SEQ_LANES];
+            for (size_t i = 0; i < count; i++) {
+                std::string target = randomSequence(1 + rand() % 100);
+                if (i % 2 == 0) {
+                    const size_t start = rand() % querySeq.size();
+                    target = querySeq.substr(start, std::min(static_cast<size_t>(1 + rand() % 100), querySeq.size() - start));
+                    for (size_t pos = 0; pos < target.size(); pos += 1 + rand() % 8) {
+                        target[pos] = randomSequence(1)[0];
+                    }
+                }
+                targetSeqs.push_back(target);
+            }
+            for (size_t i = 0; i < count; i++) {
+                targets[i]->mapSequence(i + 1, i + 1, targetSeqs[i].c_str(), targetSeqs[i].size());
+                sequences[i] = targets[i]->numSequence;
+                lengths[i] = targets[i]->L;
+            }
+
+            int32_t scores[SmithWaterman::INTER_SEQ_LANES];
+            aligner.ssw_score_batch(sequences, lengths, count, gap_open, gap_extend, scores);
+
+            for (size_t i = 0; i < count; i++) {
+                std::string backtrace;
+                s_align alignment = aligner.ssw_align(targets[i]->numSequence, targets[i]->numConsensusSequence,
+                                                      targets[i]->getAlignmentProfile(), targets[i]->L, backtrace,
+                                                      gap_open, gap_extend, 0, 10000, &evaluer, 0, 0.0, 0.0,
+                                                      query.L / 2, targets[i]->getId());
+                // the byte scores of very similar targets saturate, these need a regular alignment
+                if (scores[i] == -1) {
+                    saturated++;
+                    delete [] alignment.cigar;
+                    continue;
+                }
+                compared++;
+                if (scores[i] != static_cast<int32_t>(alignment.score1)) {
+                    mismatches++;
+                    std::cout << "Mismatch: " << querySeq << " " << targetSeqs[i] << " batch " << scores[i]
+                              << " striped " << alignment.score1 << "\n";
+                }
+                delete [] alignment.cigar;
+            }
+
+            // ungapped scores of transposed targets
+            const size_t lanes = aligner.getBatchLanes();
+            for (size_t start = 0; start < count; start += lanes) {
+                const size_t laneCount = std::min(lanes, count - start);
+                int32_t maxLength = 0;
+                for (size_t i = 0; i < laneCount; i++) {
+                    maxLength = std::max(maxLength, lengths[start + i]);
+                }
+                unsigned char *transposed = (unsigned char *) mem_align(SimdDispatch::MAX_LANES, maxLength * lanes + 1);
+                memset(transposed, SmithWaterman::UNGAPPED_PADDING, maxLength * lanes);
+                for (size_t i = 0; i < laneCount; i++) {
+                    for (int32_t pos = 0; pos < lengths[start + i]; pos++) {
+                        transposed[pos * lanes + i] = sequences[start + i][pos];
+                    }
+                }
+                uint8_t ungappedScores[SmithWaterman::INTER_SEQ_LANES];
+                aligner.ungapped_alignment_batch(transposed, maxLength, ungappedScores);
+                for (size_t i = 0; i < laneCount; i++) {
+                    const int ungappedScore = aligner.ungapped_alignment(sequences[start + i], lengths[start + i]);
+                    compared++;
+                    if (ungappedScores[i] != ungappedScore) {
+                        mismatches++;
+                        std::cout << "Ungapped mismatch: " << querySeq << " " << targetSeqs[start + i] << " batch "
+                                  << static_cast<int>(ungappedScores[i]) << " striped " << ungappedScore << "\n";
+                    }
+                }
+                free(transposed);
+            }
+        }
+        for (size_t i = 0; i < SmithWaterman::INTER_SEQ_LANES; i++) {
+            delete targets[i];
+        }
+    }
+    delete [] tinySubMat;
+
+    std::cout << "Compared " << compared << " alignments, " << saturated << " saturated, " << mismatches << " mismatches\n";
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -22,6 +22,7 @@
 #include "ExtendedSubstitutionMatrix.h"
 #include "SubstitutionMatrix.h"
 #include "StripedSmithWaterman.h"
+#include "Timer.h"
 
 const char* binary_name = "test_alignmentperformance";
 
@@ -51,7 +52,7 @@ std::vector<std::string> readData(std::string fasta_filename){
     fclose(fasta_file);
     return retVec;
 }
-int main (int, const char**) {
+int main (int argc, const char** argv) {
     const size_t kmer_size=6;
 
     Parameters& par = Parameters::getInstance();
@@ -84,7 +85,9 @@ int main (int, const char**) {
     int gap_extend = 1;
     int mode = 0;
     size_t cells = 0;
-    std::vector<std::string> sequences = readData("/Users/mad/Documents/databases/rfam/Rfam.fasta");
+    std::vector<std::string> sequences = readData(argc > 1 ? argv[1] : "/Users/mad/Documents/databases/rfam/Rfam.fasta");
+    EvalueComputation evalueComputation(100000, &subMat, gap_open, gap_extend);
+    Timer timer;
     for(size_t seq_i = 0; seq_i < sequences.size(); seq_i++){
         query->mapSequence(1,1,sequences[seq_i].c_str(), sequences[seq_i].size());
         aligner.ssw_init(query, tinySubMat, &subMat);
@@ -92,7 +95,6 @@ int main (int, const char**) {
         for(size_t seq_j = 0; seq_j < sequences.size(); seq_j++) {
             dbSeq->mapSequence(2, 2, sequences[seq_j].c_str(),  sequences[seq_j].size());
             int32_t maskLen = query->L / 2;
-            EvalueComputation evalueComputation(100000, &subMat, gap_open, gap_extend);
             std::string backtrace;
             s_align alignment = aligner.ssw_align(
                     dbSeq->numSequence,
@@ -119,6 +121,60 @@ int main (int, const char**) {
         }
     }
     std::cerr << "Cells : " << cells << std::endl;
+    std::cerr << "Striped GCUPS : " << (cells / timer.getTimediff()) / 1e9 << std::endl;
+
+    // short targets: striped alignment of each target vs. inter-sequence batch scoring
+    Sequence* batchSeqs[SmithWaterman::INTER_SEQ_LANES];
+    for (size_t i = 0; i < SmithWaterman::INTER_SEQ_LANES; i++) {
+        batchSeqs[i] = new Sequence(100, 0, &subMat, kmer_size, true, false);
+    }
+    size_t shortCells = 0;
+    size_t mismatches = 0;
+    double stripedTime = 0.0;
+    double batchTime = 0.0;
+    for (size_t seq_i = 0; seq_i < sequences.size(); seq_i++) {
+        query->mapSequence(1, 1, sequences[seq_i].c_str(), sequences[seq_i].size());
+        aligner.ssw_init(query, tinySubMat, &subMat);
+        for (size_t seq_j = 0; seq_j < sequences.size(); seq_j += SmithWaterman::INTER_SEQ_LANES) {
+            const size_t count = std::min(static_cast<size_t>(SmithWaterman::INTER_SEQ_LANES), sequences.size() - seq_j);
+            const unsigned char* targets[SmithWaterman::INTER_SEQ_LANES];
+            int32_t lengths[SmithWaterman::INTER_SEQ_LANES];
+            for (size_t i = 0; i < count; i++) {
+                batchSeqs[i]->mapSequence(2, 2, sequences[seq_j + i].c_str(), std::min(sequences[seq_j + i].size(), (size_t) 100));
+                targets[i] = batchSeqs[i]->numSequence;
+                lengths[i] = batchSeqs[i]->L;
+                shortCells += query->L * batchSeqs[i]->L;
+            }
+
+            int32_t stripedScores[SmithWaterman::INTER_SEQ_LANES];
+            timer.reset();
+            for (size_t i = 0; i < count; i++) {
+                std::string backtrace;
+                s_align alignment = aligner.ssw_align(batchSeqs[i]->numSequence, batchSeqs[i]->numConsensusSequence,
+                                                      batchSeqs[i]->getAlignmentProfile(), batchSeqs[i]->L, backtrace,
+                                                      gap_open, gap_extend, 0, 10000, &evalueComputation, 0, 0.0, 0.0,
+                                                      query->L / 2, batchSeqs[i]->getId());
+                stripedScores[i] = alignment.score1;
+            }
+            stripedTime += timer.getTimediff();
+
+            int32_t batchScores[SmithWaterman::INTER_SEQ_LANES];
+            timer.reset();
+            aligner.ssw_score_batch(targets, lengths, count, gap_open, gap_extend, batchScores);
+            batchTime += timer.getTimediff();
+
+            for (size_t i = 0; i < count; i++) {
+                mismatches += (batchScores[i] >= 0 && stripedScores[i] != batchScores[i]);
+            }
+        }
+    }
+    for (size_t i = 0; i < SmithWaterman::INTER_SEQ_LANES; i++) {
+        delete batchSeqs[i];
+    }
+    std::cerr << "Short target cells : " << shortCells << std::endl;
+    std::cerr << "Short target striped GCUPS : " << (shortCells / stripedTime) / 1e9 << std::endl;
+    std::cerr << "Short target batch GCUPS (" << SimdDispatch::getKernels().name << ", " << SimdDispatch::getKernels().lanes << " lanes) : " << (shortCells / batchTime) / 1e9 << std::endl;
+    std::cerr << "Score mismatches : " << mismatches << std::endl;
     delete [] tinySubMat;
     delete query;
     delete dbSeq;
@@ -0,0 +1,189 @@
+// Compares the inter-pair batch of the banded nucleotide aligner against ksw2 and times both on short reads
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include "ksw2.h"
+#include "BandedNucleotideAligner.h"
+#include "NucleotideMatrix.h"
+#include "EvalueComputation.h"
+#include "Sequence.h"
+#include "Parameters.h"
+#include "Timer.h"
+
+const char* binary_name = "test_bandednucleotidebatch";
+
+std::string mutate(const std::string &seq, std::mt19937 &rng, int mismatchRate, int indelRate) {
+    const char *nucl = "ACGT";
+    std::string mutated;
+    for (size_t i = 0; i < seq.size(); i++) {
+        const int dice = rng() % 1000;
+        if (dice < indelRate / 2) {
+            continue;
+        } else if (dice < indelRate) {
+            mutated.push_back(nucl[rng() % 4]);
+        }
+        mutated.push_back((static_cast<int>(rng() % 1000) < mismatchRate) ? nucl[rng() % 4] : seq[i]);
+    }
+    return mutated;
+}
+
+std::string randomSequence(std::mt19937 &rng, size_t len) {
+    const char *nucl = "ACGTN";
+    std::string seq;
+    for (size_t i = 0; i < len; i++) {
+        seq.push_back(nucl[(rng() % 200 == 0) ? 4 : rng() % 4]);
+    }
+    return seq;
+}
+
+bool sameExtension(const ksw_extz_t &a, const ksw_extz_t &b, bool withCigar) {
+    if (a.max != b.max || a.max_q != b.max_q || a.max_t != b.max_t || a.zdropped != b.zdropped) {
+        return false;
+    }
+    if (withCigar) {
+        return a.n_cigar == b.n_cigar && memcmp(a.cigar, b.cigar, a.n_cigar * sizeof(uint32_t)) == 0;
+    }
+    return true;
+}
+
+// random pairs of all lengths and divergences, including ones that are z-dropped
+size_t checkExtensions(BandedNucleotideAligner &aligner, const int8_t *mat, int gapOpen, int gapExtend, int zdrop) {
+    std::mt19937 rng(11);
+    const size_t lanes = aligner.getBatchLanes();
+    size_t mismatches = 0;
+    for (size_t round = 0; round < 2000; round++) {
+        const size_t count = 1 + rng() % lanes;
+        std::vector<std::vector<uint8_t> > queries(count), targets(count);
+        BandedNucleotideAligner::Extension extensions[BandedNucleotideAligner::BATCH_LANES];
+        const size_t maxLen = (round % 4 == 0) ? 600 : 150;
+        for (size_t i = 0; i < count; i++) {
+            std::string query = randomSequence(rng, 1 + rng() % maxLen);
+            std::string target = (rng() % 5 == 0) ? randomSequence(rng, 1 + rng() % maxLen)
+                                                 : mutate(query, rng, rng() % 300, rng() % 100);
+            if (target.empty()) {
+                target = "A";
+            }
+            for (size_t pos = 0; pos < query.size(); pos++) {
+                queries[i].push_back(static_cast<uint8_t>(strchr("ACGTN", query[pos]) - "ACGTN"));
+            }
+            for (size_t pos = 0; pos < target.size(); pos++) {
+                targets[i].push_back(static_cast<uint8_t>(strchr("ACGTN", target[pos]) - "ACGTN"));
+            }
+            extensions[i].query = queries[i].data();
+            extensions[i].qlen = static_cast<int>(queries[i].size());
+            extensions[i].target = targets[i].data();
+            extensions[i].tlen = static_cast<int>(targets[i].size());
+        }
+        for (int withCigar = 0; withCigar < 2; withCigar++) {
+            const int flag = KSW_EZ_EXTZ_ONLY | (withCigar ? 0 : KSW_EZ_SCORE_ONLY);
+            ksw_extz_t batch[BandedNucleotideAligner::BATCH_LANES];
+            memset(batch, 0, sizeof(batch));
+            aligner.extendBatch(extensions, count, flag, batch);
+            for (size_t i = 0; i < count; i++) {
+                ksw_extz_t single;
+                memset(&single, 0, sizeof(single));
+                ksw_extz2_sse(0, extensions[i].qlen, extensions[i].query, extensions[i].tlen, extensions[i].target, 5,
+                              mat, gapOpen, gapExtend, 64, zdrop, flag, &single);
+                if (sameExtension(batch[i], single, withCigar) == false) {
+                    mismatches++;
+                }
+                free(single.cigar);
+                free(batch[i].cigar);
+            }
+        }
+    }
+    std::cout << "extensions: " << mismatches << " mismatches" << std::endl;
+    return mismatches;
+}
+
+int main(int argc, const char **argv) {
+    const size_t queryCount = argc > 1 ? strtoull(argv[1], NULL, 10) : 50;
+    const size_t targetsPerQuery = argc > 2 ? strtoull(argv[2], NULL, 10) : 1600;
+
+    Parameters &par = Parameters::getInstance();
+    par.initMatrices();
+    NucleotideMatrix subMat(par.scoringMatrixFile.values.nucleotide().c_str(), 1.0, 0.0);
+    const int gapOpen = par.gapOpen.values.nucleotide();
+    const int gapExtend = par.gapExtend.values.nucleotide();
+    EvalueComputation evaluer(100000, &subMat, gapOpen, gapExtend);
+    BandedNucleotideAligner aligner(&subMat, 10000, gapOpen, gapExtend, par.zdrop);
+
+    int8_t *mat = new int8_t[subMat.alphabetSize * subMat.alphabetSize];
+    for (int i = 0; i < subMat.alphabetSize; i++) {
+        for (int j = 0; j < subMat.alphabetSize; j++) {
+            mat[i * subMat.alphabetSize + j] = subMat.subMatrix[i][j];
+        }
+    }
+    size_t mismatches = checkExtensions(aligner, mat, gapOpen, gapExtend, par.zdrop);
+    delete[] mat;
+
+    // 150-300 bp reads against mutated copies, each placed at a random offset in its target
+    std::mt19937 rng(42);
+    const size_t lanes = aligner.getBatchLanes();
+    Sequence query(10000, Parameters::DBTYPE_NUCLEOTIDES, &subMat, 0, false, false);
+    std::vector<Sequence *> targets;
+    for (size_t i = 0; i < lanes; i++) {
+        targets.push_back(new Sequence(10000, Parameters::DBTYPE_NUCLEOTIDES, &subMat, 0, false, false));
+    }
+    double singleTime = 0.0;
+    double batchTime = 0.0;
+    size_t compared = 0;
+    for (size_t q = 0; q < queryCount; q++) {
+        const std::string querySeq = randomSequence(rng, 150 + rng() % 151);
+        query.mapSequence(0, 0, querySeq.c_str(), querySeq.size());
+        aligner.initQuery(&query);
+        for (size_t chunk = 0; chunk < targetsPerQuery; chunk += lanes) {
+            std::vector<std::string> targetSeqs(lanes);
+            int diagonals[BandedNucleotideAligner::BATCH_LANES];
+            bool reverse[BandedNucleotideAligner::BATCH_LANES];
+            for (size_t i = 0; i < lanes; i++) {
+                const size_t offset = rng() % 20;
+                targetSeqs[i] = randomSequence(rng, offset) + mutate(querySeq, rng, 20 + rng() % 150, rng() % 30);
+                diagonals[i] = -static_cast<int>(offset);
+                reverse[i] = (rng() % 8 == 0);
+            }
+
+            std::string singleBacktraces[BandedNucleotideAligner::BATCH_LANES];
+            s_align single[BandedNucleotideAligner::BATCH_LANES];
+            Timer timer;
+            for (size_t i = 0; i < lanes; i++) {
+                targets[i]->mapSequence(1, 1, targetSeqs[i].c_str(), targetSeqs[i].size());
+                single[i] = aligner.align(targets[i], diagonals[i], reverse[i], singleBacktraces[i], &evaluer);
+            }
+            singleTime += timer.getTimediff();
+
+            std::string batchBacktraces[BandedNucleotideAligner::BATCH_LANES];
+            s_align batch[BandedNucleotideAligner::BATCH_LANES];
+            timer.reset();
+            for (size_t i = 0; i < lanes; i++) {
+                targets[i]->mapSequence(1, 1, targetSeqs[i].c_str(), targetSeqs[i].size());
+            }
+            aligner.alignBatch(&targets[0], diagonals, reverse, lanes, batchBacktraces, batch, &evaluer);
+            batchTime += timer.getTimediff();
+
+            for (size_t i = 0; i < lanes; i++) {
+                if (single[i].score1 != batch[i].score1 || single[i].qStartPos1 != batch[i].qStartPos1
+                    || single[i].qEndPos1 != batch[i].qEndPos1 || single[i].dbStartPos1 != batch[i].dbStartPos1
+                    || single[i].dbEndPos1 != batch[i].dbEndPos1 || single[i].identicalAACnt != batch[i].identicalAACnt
+                    || singleBacktraces[i] != batchBacktraces[i]) {
+                    mismatches++;
+                }
+                compared++;
+                delete[] single[i].cigar;
+                delete[] batch[i].cigar;
+            }
+        }
+    }
+    for (size_t i = 0; i < lanes; i++) {
+        delete targets[i];
+    }
+    std::cout << compared << " alignments, single " << singleTime << "s, batch " << batchTime
+              << "s, speedup " << (batchTime > 0 ? singleTime / batchTime : 0.0) << "x" << std::endl;
+    std::cout << mismatches << " mismatches" << std::endl;
+
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -18,12 +18,14 @@ KSEQ_INIT(int, read)
 #include "DBReader.h"
 #include "DBWriter.h"
 #include "Parameters.h"
+#include "Timer.h"
 
 const char* binary_name = "test_diagonalscoringperformance";
 
-int main (int, const char**) {
+int main (int argc, const char** argv) {
     size_t kmer_size = 6;
     Parameters& par = Parameters::getInstance();
+    par.initMatrices();
     SubstitutionMatrix subMat(par.scoringMatrixFile.values.aminoacid().c_str(), 8.0, 0.0);
     SubstitutionMatrix::print(subMat.subMatrix,subMat.num2aa,subMat.alphabetSize);
 
@@ -39,7 +41,11 @@ int main (int, const char**) {
     Sequence s2(10000,  0, &subMat, kmer_size, true, false);
     s2.mapSequence(0,0,S2char, S2.size());
 
-    FILE *fasta_file = FileUtil::openFileOrDie("/Users/mad/Documents/databases/mmseqs_benchmark/benchmarks/clustering_benchmark/db/db_full.fas", "r", true);
+    const char *dbFile = argc > 1 ? argv[1] : "/Users/mad/Documents/databases/mmseqs_benchmark/benchmarks/clustering_benchmark/db/db_full.fas";
+    const size_t iterations = argc > 2 ? strtoull(argv[2], NULL, 10) : 10000;
+    // fewer distinct diagonals fill the per diagonal bins of the vectorized scoring
+    const size_t diagonalCount = argc > 3 ? strtoull(argv[3], NULL, 10) : 0;
+    FILE *fasta_file = FileUtil::openFileOrDie(dbFile, "r", true);
     kseq_t *seq = kseq_init(fileno(fasta_file));
     size_t dbEntrySize = 0;
     size_t dbCnt = 0;
@@ -54,7 +60,7 @@ int main (int, const char**) {
     size_t maxLen = 0;
     for(size_t i = 0; i < 10; i++){
         fclose(fasta_file);
-        fasta_file = FileUtil::openFileOrDie("/Users/mad/Documents/databases/mmseqs_benchmark/benchmarks/clustering_benchmark/db/db_full.fas", "r", true);
+        fasta_file = FileUtil::openFileOrDie(dbFile, "r", true);
         kseq_rewind(seq);
         while (kseq_read(seq) >= 0) {
             dbSeq.mapSequence(id,id,seq->seq.s, seq->seq.l);
@@ -71,19 +77,19 @@ int main (int, const char**) {
     std::cout << maxLen << std::endl;
     UngappedAlignment matcher(maxLen, &subMat, &lookup);
     CounterResult hits[16000];
-    hits[0].id =142424;
+    hits[0].id = 142424 % id;
     hits[0].diagonal = 50;
-    hits[1].id = 191382;
+    hits[1].id = 191382 % id;
     hits[1].diagonal = 4;
-    hits[2].id = 135950;
+    hits[2].id = 135950 % id;
     hits[2].diagonal = 4;
-    hits[3].id = 63969;
+    hits[3].id = 63969 % id;
     hits[3].diagonal = 4;
-    hits[4].id = 244188;
+    hits[4].id = 244188 % id;
     hits[4].diagonal = 4;
 
     for(size_t i = 5; i < 16; i++) {
-        hits[i].id = 159147;
+        hits[i].id = 159147 % id;
         hits[i].diagonal = 31;
     }
 
@@ -107,14 +113,20 @@ int main (int, const char**) {
     std::cout << (int)hits[1].count<< " ";
     std::cout << (int)hits[2].count<< " ";
     std::cout << (int)hits[3].count<< std::endl;
-    for(size_t i = 0; i < 10000; i++){
+    Timer timer;
+    double scoringTime = 0.0;
+    for(size_t i = 0; i < iterations; i++){
         for(int j = 1; j < 16000; j++){
             hits[j].id = rand()%dbCnt;
-            hits[j].diagonal =  rand()%s1.L;
+            hits[j].diagonal =  rand()%(diagonalCount > 0 ? diagonalCount : s1.L);
         }
         //   std::reverse(hits, hits+1000);
+        timer.reset();
         matcher.processQuery(&s1, compositionBias, hits, 16000);
+        scoringTime += timer.getTimediff();
     }
+    std::cerr << "Diagonal scoring kernel : " << SimdDispatch::getKernels().name << std::endl;
+    std::cerr << "Diagonals per second : " << (iterations * 16000) / scoringTime << std::endl;
 //    std::cout << ExtendedSubstitutionMatrix::calcScore(s1.sequence, s1.sequence,s1.L, subMat.subMatrix) << " " << (int)hits[0].diagonalScore <<  std::endl;
 //    std::cout << (int)hits[0].diagonalScore <<  std::endl;
     for(int i = 0; i < 1000; i++){
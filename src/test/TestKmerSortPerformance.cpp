@@ -0,0 +1,93 @@
+#include <iostream>
+#include <random>
+#include <cstring>
+
+#include "kmermatcher.h"
+#include "KmerRadixSort.h"
+#include "FastSort.h"
+#include "Timer.h"
+#include "Util.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+#ifndef SIZE_T_MAX
+#define SIZE_T_MAX ((size_t) -1)
+#endif
+
+const char* binary_name = "test_kmersortperformance";
+
+// k-mer tables as produced by fillKmerPositionArray: many sequences share a k-mer,
+// the strand is encoded in bit 63 and the table is terminated by SIZE_T_MAX entries
+template <typename T>
+void fillKmers(KmerPosition<T> *kmers, size_t count, size_t distinctKmers, bool reverse) {
+    std::mt19937_64 rng(42);
+    for (size_t i = 0; i < count; i++) {
+        size_t kmer = rng() % distinctKmers;
+        if (reverse && (rng() & 1)) {
+            kmer = BIT_SET(kmer, 63);
+        }
+        kmers[i].kmer = kmer;
+        kmers[i].id = static_cast<unsigned int>(rng() % (count / 8 + 1));
+        kmers[i].seqLen = static_cast<T>(rng() % 30000);
+        kmers[i].pos = static_cast<T>(rng() % 30000);
+    }
+    for (size_t i = count - count / 100; i < count; i++) {
+        kmers[i].kmer = SIZE_T_MAX;
+    }
+}
+
+template <typename T, bool BY_SEQ_LEN, bool REVERSE>
+bool benchmark(const char *name, size_t count, size_t distinctKmers) {
+    bool (*compare)(const KmerPosition<T> &, const KmerPosition<T> &);
+    if (BY_SEQ_LEN) {
+        compare = REVERSE ? KmerPosition<T>::compareRepSequenceAndIdAndPosReverse : KmerPosition<T>::compareRepSequenceAndIdAndPos;
+    } else {
+        compare = REVERSE ? KmerPosition<T>::compareRepSequenceAndIdAndDiagReverse : KmerPosition<T>::compareRepSequenceAndIdAndDiag;
+    }
+
+    KmerPosition<T> *expected = new KmerPosition<T>[count];
+    KmerPosition<T> *kmers = new KmerPosition<T>[count];
+    fillKmers(expected, count, distinctKmers, REVERSE);
+    memcpy(kmers, expected, sizeof(KmerPosition<T>) * count);
+
+    Timer timer;
+    SORT_PARALLEL(expected, expected + count, compare);
+    std::string comparisonTime = timer.lap();
+
+    timer.reset();
+    KmerRadixSort<T, BY_SEQ_LEN, REVERSE>::sort(kmers, count, true);
+    std::string radixTime = timer.lap();
+
+    bool equal = true;
+    for (size_t i = 0; i < count; i++) {
+        if (compare(expected[i], kmers[i]) || compare(kmers[i], expected[i])) {
+            equal = false;
+            break;
+        }
+    }
+    std::cout << name << "\tcomparison: " << comparisonTime << "\tradix: " << radixTime
+              << "\t" << (equal ? "OK" : "FAILED") << std::endl;
+    delete [] expected;
+    delete [] kmers;
+    return equal;
+}
+
+int main (int argc, const char** argv) {
+    const size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    const size_t distinctKmers = argc > 2 ? strtoull(argv[2], NULL, 10) : count / 4;
+#ifdef OPENMP
+    std::cout << "Threads: " << omp_get_max_threads() << std::endl;
+#endif
+    std::cout << "Entries: " << count << "\tDistinct k-mers: " << distinctKmers << std::endl;
+
+    bool ok = true;
+    ok &= benchmark<short, true, false>("short pos    ", count, distinctKmers);
+    ok &= benchmark<short, true, true>("short pos rev", count, distinctKmers);
+    ok &= benchmark<short, false, false>("short diag   ", count, distinctKmers);
+    ok &= benchmark<int, true, false>("int pos      ", count, distinctKmers);
+    ok &= benchmark<int, true, true>("int pos rev  ", count, distinctKmers);
+    ok &= benchmark<int, false, true>("int diag rev ", count, distinctKmers);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
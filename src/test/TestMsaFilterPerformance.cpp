@@ -0,0 +1,124 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstdlib>
+#include <climits>
+
+#include "MsaFilter.h"
+#include "MultipleAlignment.h"
+#include "SimdDispatch.h"
+#include "SubstitutionMatrix.h"
+#include "Parameters.h"
+#include "Timer.h"
+
+const char* binary_name = "test_msafilterperformance";
+
+// deep MSA of a random query, each row is a local hit with its own mutation rate and some gaps and X
+void fillMsa(char **msa, size_t setSize, int length) {
+    std::mt19937 rng(42);
+    for (int pos = 0; pos < length; pos++) {
+        msa[0][pos] = static_cast<char>(rng() % 20);
+    }
+    for (size_t k = 1; k < setSize; k++) {
+        // derive from an earlier row now and then, so that the filter has clusters of similar rows to remove
+        const char *parent = msa[(rng() % 4 == 0) ? rng() % k : 0];
+        const int start = rng() % (length / 3);
+        const int end = length - rng() % (length / 3);
+        const float mutationRate = (rng() % 70) / 100.0f;
+        for (int pos = 0; pos < length; pos++) {
+            char residue = parent[pos];
+            if (pos < start || pos >= end) {
+                residue = MultipleAlignment::GAP;
+            } else if (rng() % 100 < 3) {
+                residue = (rng() % 4 == 0) ? (char) MultipleAlignment::ANY : (char) MultipleAlignment::GAP;
+            } else if ((rng() % 1000) < mutationRate * 1000 || residue >= MultipleAlignment::NAA) {
+                residue = static_cast<char>(rng() % 20);
+            }
+            msa[k][pos] = residue;
+        }
+    }
+}
+
+int referenceRowDiff(const char *x, const char *y, int from, int to, int *coverage) {
+    int diff = 0;
+    int cov = 0;
+    for (int pos = from; pos < to; pos++) {
+        if (x[pos] < MultipleAlignment::NAA && y[pos] < MultipleAlignment::NAA) {
+            cov++;
+            diff += (x[pos] != y[pos]);
+        }
+    }
+    *coverage = cov;
+    return diff;
+}
+
+// the kernels may stop at any point once maxDiff is reached, below that both counts have to be exact
+size_t checkKernel(const SimdKernels &kernels, char **msa, size_t setSize, int length) {
+    std::mt19937 rng(7);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < 200000; i++) {
+        const char *x = msa[rng() % setSize];
+        const char *y = msa[rng() % setSize];
+        const int from = rng() % length;
+        const int to = from + rng() % (length - from + 1);
+        const int maxDiff = (rng() % 2 == 0) ? INT_MAX : static_cast<int>(rng() % (to - from + 2));
+        int expectedCov;
+        const int expectedDiff = referenceRowDiff(x, y, from, to, &expectedCov);
+        int cov;
+        const int diff = kernels.msaRowDiff(x, y, from, to, maxDiff, &cov);
+        const bool valid = (expectedDiff < maxDiff) ? (diff == expectedDiff && cov == expectedCov) : (diff >= maxDiff);
+        if (valid == false) {
+            mismatches++;
+        }
+    }
+    std::cout << kernels.name << ": " << mismatches << " mismatches" << std::endl;
+    return mismatches;
+}
+
+int main(int argc, const char **argv) {
+    const size_t setSize = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000;
+    const int length = argc > 2 ? atoi(argv[2]) : 300;
+    const size_t iterations = argc > 3 ? strtoull(argv[3], NULL, 10) : 3;
+
+    Parameters &par = Parameters::getInstance();
+    par.initMatrices();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0, -0.2f);
+
+    char **msa = MultipleAlignment::initX(length, setSize);
+    fillMsa(msa, setSize, length);
+
+    size_t mismatches = checkKernel(SimdDispatch::getKernels(), msa, setSize, length);
+#ifdef HAVE_SIMD_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        mismatches += checkKernel(*getSimdKernelsAVX2(), msa, setSize, length);
+    }
+    if (__builtin_cpu_supports("avx512bw")) {
+        mismatches += checkKernel(*getSimdKernelsAVX512BW(), msa, setSize, length);
+    }
+#endif
+
+    // MMSEQS_FORCE_SIMD selects the kernel used by the filter
+    MsaFilter filter(length, setSize, &subMat, par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid());
+    std::vector<int> qid(1, 0);
+    bool *kept = new bool[setSize];
+    for (size_t i = 0; i < iterations; i++) {
+        Timer timer;
+        const size_t filteredSize = filter.filter(setSize, length, static_cast<int>(par.covMSAThr * 100), qid, par.qsc,
+                                                  static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable,
+                                                  (const char **) msa, false);
+        std::string time = timer.lap();
+        filter.getKept(kept, setSize);
+        size_t checksum = 0;
+        for (size_t k = 0; k < setSize; k++) {
+            checksum = checksum * 31 + kept[k];
+        }
+        std::cout << SimdDispatch::getKernels().name << " " << setSize << " x " << length << ": kept " << filteredSize
+                  << " checksum " << checksum << " time " << time << std::endl;
+    }
+    delete[] kept;
+    free(msa[0]);
+    delete[] msa;
+
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
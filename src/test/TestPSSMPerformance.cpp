@@ -0,0 +1,76 @@
+#include <iostream>
+#include <random>
+#include <cstdlib>
+
+#include "PSSMCalculator.h"
+#include "MultipleAlignment.h"
+#include "SubstitutionMatrix.h"
+#include "Sequence.h"
+#include "MathUtil.h"
+#include "Parameters.h"
+#include "Timer.h"
+
+const char* binary_name = "test_pssmperformance";
+
+// deep MSA of a random query, each row is a local hit with its own mutation rate and some gaps and X
+void fillMsa(char **msa, size_t setSize, int length) {
+    std::mt19937 rng(42);
+    for (int pos = 0; pos < length; pos++) {
+        msa[0][pos] = static_cast<char>(rng() % 20);
+    }
+    for (size_t k = 1; k < setSize; k++) {
+        const int start = rng() % (length / 3);
+        const int end = length - rng() % (length / 3);
+        const float mutationRate = (rng() % 70) / 100.0f;
+        for (int pos = 0; pos < length; pos++) {
+            char residue = msa[0][pos];
+            if (pos < start || pos >= end) {
+                residue = MultipleAlignment::GAP;
+            } else if (rng() % 100 < 5) {
+                residue = (rng() % 4 == 0) ? (char) MultipleAlignment::ANY : (char) MultipleAlignment::GAP;
+            } else if ((rng() % 1000) < mutationRate * 1000) {
+                residue = static_cast<char>(rng() % 20);
+            }
+            msa[k][pos] = residue;
+        }
+    }
+}
+
+int main(int argc, const char **argv) {
+    const size_t setSize = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000;
+    const int length = argc > 2 ? atoi(argv[2]) : 300;
+    const size_t iterations = argc > 3 ? strtoull(argv[3], NULL, 10) : 3;
+
+    Parameters &par = Parameters::getInstance();
+    par.initMatrices();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0, 0.0);
+
+    char **msa = MultipleAlignment::initX(length, setSize);
+    fillMsa(msa, setSize, length);
+
+    PSSMCalculator calculator(&subMat, length, setSize, par.pcmode, par.pca, par.pcb,
+                              par.gapOpen.values.aminoacid(), par.gapPseudoCount);
+    for (int wg = 0; wg < 2; wg++) {
+        for (size_t i = 0; i < iterations; i++) {
+            Timer timer;
+            PSSMCalculator::Profile profile = calculator.computePSSMFromMSA(setSize, length, (const char **) msa, wg == 1);
+            std::string time = timer.lap();
+            // the profile has to stay identical between implementations, so a checksum over all outputs is enough
+            size_t checksum = 0;
+            for (int pos = 0; pos < length; pos++) {
+                for (size_t aa = 0; aa < Sequence::PROFILE_AA_SIZE; aa++) {
+                    checksum = checksum * 31 + static_cast<unsigned char>(profile.pssm[pos * Sequence::PROFILE_AA_SIZE + aa]);
+                }
+                checksum = checksum * 31 + MathUtil::convertNeffToChar(profile.neffM[pos]);
+                checksum = checksum * 31 + profile.gDel[pos];
+                checksum = checksum * 31 + profile.gIns[pos];
+                checksum = checksum * 31 + profile.consensus[pos];
+            }
+            std::cout << "wg " << wg << " " << setSize << " x " << length << ": checksum " << checksum << " time " << time << std::endl;
+        }
+    }
+    free(msa[0]);
+    delete[] msa;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+#include "DBReader.h"
+#include "Debug.h"
+#include "FileUtil.h"
+#include "PrefilteringIndexReader.h"
+#include "Prefiltering.h"
+#include "Parameters.h"
+
+int appendindex(int argc, const char **argv, const Command &command) {
+    Parameters &par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    std::string indexDB = PrefilteringIndexReader::searchForIndex(par.db1);
+    if (indexDB.empty()) {
+        Debug(Debug::ERROR) << "No index found for " << par.db1 << ". Please create it with 'createindex'!\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    DBReader<unsigned int> dbr(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    dbr.open(DBReader<unsigned int>::NOSORT);
+
+    DBReader<unsigned int> hdbr(par.hdr1.c_str(), par.hdr1Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    hdbr.open(DBReader<unsigned int>::NOSORT);
+
+    // the seed matrix has to be the one the index was created with
+    DBReader<unsigned int> index(indexDB.c_str(), (indexDB + ".index").c_str(), 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    index.open(DBReader<unsigned int>::NOSORT);
+    if (PrefilteringIndexReader::checkIfIndexFile(&index) == false) {
+        Debug(Debug::ERROR) << "Outdated index version. Please recompute it with 'createindex'!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    PrefilteringIndexData meta = PrefilteringIndexReader::getMetadata(&index);
+    MultiParam<NuclAA<std::string>> seedScoringMatrixFile(PrefilteringIndexReader::getSubstitutionMatrix(&index));
+    MultiParam<NuclAA<int>> alphabetSize(NuclAA<int>(meta.alphabetSize, 5));
+    BaseMatrix *seedSubMat = Prefiltering::getSubstitutionMatrix(seedScoringMatrixFile, alphabetSize, 8.0f, false,
+                                                                 Parameters::isEqualDbtype(meta.seqType, Parameters::DBTYPE_NUCLEOTIDES));
+    index.close();
+
+    PrefilteringIndexReader::appendIndexFile(indexDB, &dbr, &hdbr, seedSubMat, par.maskLowerCaseMode);
+
+    delete seedSubMat;
+    hdbr.close();
+    dbr.close();
+    return EXIT_SUCCESS;
+}
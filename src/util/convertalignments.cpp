@@ -253,7 +253,7 @@ int convertalignments(int argc, const char **argv, const Command &command) {
     localThreads = std::max(std::min((size_t)par.threads, alnDbr.getSize()), (size_t)1);
 #endif
 
-    const bool shouldCompress = par.dbOut == true && par.compressed == true;
+    const int shouldCompress = par.dbOut == true ? par.compressed : 0;
     const int dbType = par.dbOut == true ? Parameters::DBTYPE_GENERIC_DB : Parameters::DBTYPE_OMIT_FILE;
     DBWriter resultWriter(par.db4.c_str(), par.db4Index.c_str(), localThreads, shouldCompress, dbType);
     resultWriter.open();
@@ -270,12 +270,26 @@ int convertalignments(int argc, const char **argv, const Command &command) {
         std::string header = "@HD\tVN:1.4\tSO:queryname\n";
         resultWriter.writeAdd(header.c_str(), header.size(), 0);
 
+        std::vector<unsigned int> dbKeys;
         for (size_t i = 0; i < alnDbr.getSize(); i++) {
             char *data = alnDbr.getData(i, 0);
-            while (*data != '\0') {
-                char dbKeyBuffer[255 + 1];
-                Util::parseKey(data, dbKeyBuffer);
-                const unsigned int dbKey = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
+            dbKeys.clear();
+            if (Matcher::isBinaryResult(data)) {
+                const Matcher::binary_header_t *header = Matcher::getBinaryHeader(data);
+                const Matcher::binary_result_t *records = Matcher::getBinaryResults(data);
+                for (unsigned int j = 0; j < header->count; j++) {
+                    dbKeys.emplace_back(records[j].dbKey);
+                }
+            } else {
+                while (*data != '\0') {
+                    char dbKeyBuffer[255 + 1];
+                    Util::parseKey(data, dbKeyBuffer);
+                    dbKeys.emplace_back((unsigned int) strtoul(dbKeyBuffer, NULL, 10));
+                    data = Util::skipLine(data);
+                }
+            }
+            for (size_t j = 0; j < dbKeys.size(); j++) {
+                const unsigned int dbKey = dbKeys[j];
                 if (headerWritten[dbKey] == false) {
                     headerWritten[dbKey] = true;
                     unsigned int tId = tDbr->sequenceReader->getId(dbKey);
@@ -292,7 +306,6 @@ int convertalignments(int argc, const char **argv, const Command &command) {
                     resultWriter.writeAdd(buffer, count, 0);
                 }
                 resultWriter.writeEnd(0, 0, false, 0);
-                data = Util::skipLine(data);
             }
         }
         delete[] headerWritten;
@@ -333,6 +346,9 @@ int convertalignments(int argc, const char **argv, const Command &command) {
         std::string newBacktrace;
         newBacktrace.reserve(1024);
 
+        std::vector<Matcher::result_t> results;
+        results.reserve(300);
+
         const TaxonNode * taxonNode = NULL;
 
 #pragma omp  for schedule(dynamic, 10)
@@ -382,9 +398,10 @@ int convertalignments(int argc, const char **argv, const Command &command) {
             }
 
             char *data = alnDbr.getData(i, thread_idx);
-            while (*data != '\0') {
-                Matcher::result_t res = Matcher::parseAlignmentRecord(data, true);
-                data = Util::skipLine(data);
+            results.clear();
+            Matcher::readAlignmentResults(results, data, true);
+            for (size_t resIdx = 0; resIdx < results.size(); resIdx++) {
+                Matcher::result_t &res = results[resIdx];
 
                 if (res.backtrace.empty() && needBacktrace == true) {
                     Debug(Debug::ERROR) << "Backtrace cigar is missing in the alignment result. Please recompute the alignment with the -a flag.\n"
@@ -88,6 +88,9 @@ int createsubdb(int argc, const char **argv, const Command& command) {
         DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::DATA);
     }
     DBWriter::writeDbtypeFile(par.db3.c_str(), reader.getDbtype(), isCompressed);
+    if (isCompressed && FileUtil::fileExists((par.db2 + ".dict").c_str())) {
+        FileUtil::copyFile(par.db2 + ".dict", par.db3 + ".dict");
+    }
     DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::SEQUENCE_ANCILLARY);
 
     free(line);
@@ -61,7 +61,7 @@ int createtsv(int argc, const char **argv, const Command &command) {
 
     const std::string& dataFile = hasTargetDB ? par.db4 : par.db3;
     const std::string& indexFile = hasTargetDB ? par.db4Index : par.db3Index;
-    const bool shouldCompress = par.dbOut == true && par.compressed == true;
+    const int shouldCompress = par.dbOut == true ? par.compressed : 0;
     const int dbType = par.dbOut == true ? Parameters::DBTYPE_GENERIC_DB : Parameters::DBTYPE_OMIT_FILE;
     DBWriter writer(dataFile.c_str(), indexFile.c_str(), par.threads, shouldCompress, dbType);
     writer.open();
@@ -211,6 +211,9 @@ int expandaln(int argc, const char **argv, const Command& command, bool returnAl
 
         char buffer[1024 + 32768*4];
 
+        std::vector<Matcher::result_t> resultsAb;
+        resultsAb.reserve(300);
+
         std::vector<Matcher::result_t> resultsBc;
         resultsBc.reserve(300);
 
@@ -244,9 +247,10 @@ int expandaln(int argc, const char **argv, const Command& command, bool returnAl
             }
 
             char *data = resultAbReader->getData(i, thread_idx);
-            while (*data != '\0') {
-                Matcher::result_t resultAb = Matcher::parseAlignmentRecord(data, false);
-                data = Util::skipLine(data);
+            resultsAb.clear();
+            Matcher::readAlignmentResults(resultsAb, data, false);
+            for (size_t j = 0; j < resultsAb.size(); ++j) {
+                Matcher::result_t &resultAb = resultsAb[j];
                 if(returnAlnRes == false && resultAb.eval > par.evalProfile){
                     continue;
                 }
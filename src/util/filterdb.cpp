@@ -6,6 +6,7 @@
 #include "FileUtil.h"
 #include "ExpressionParser.h"
 #include "FastSort.h"
+#include "Matcher.h"
 #include <fstream>
 #include <random>
 #include <iostream>
@@ -97,7 +98,9 @@ int filterdb(int argc, const char **argv, const Command &command) {
     DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
 
-    DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads, par.compressed, reader.getDbtype());
+    // filtering works on text lines, binary alignment results are written back as text
+    const int outDbType = reader.getDbtype() & ~(Parameters::DBTYPE_EXTENDED_BINARY << 16);
+    DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads, par.compressed, outDbType);
     writer.open();
 
     // FILE_FILTERING
@@ -240,6 +243,8 @@ int filterdb(int argc, const char **argv, const Command &command) {
 
         char dbKeyBuffer[255 + 1];
 
+        std::string textBuffer;
+
         // EXPRESSION_FILTERING
         ExpressionParser* parser = NULL;
         std::vector<int> bindableParserColumns;
@@ -260,6 +265,12 @@ int filterdb(int argc, const char **argv, const Command &command) {
             char *data = reader.getData(id, thread_idx);
             unsigned int queryKey = reader.getDbKey(id);
             size_t dataLength = reader.getEntryLen(id);
+            if (Matcher::isBinaryResult(data)) {
+                textBuffer.clear();
+                Matcher::binaryResultsToText(data, textBuffer);
+                data = (char *) textBuffer.c_str();
+                dataLength = textBuffer.size() + 1;
+            }
             int counter = 0;
 
             bool addSelfMatch = false;
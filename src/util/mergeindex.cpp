@@ -0,0 +1,17 @@
+#include "Debug.h"
+#include "PrefilteringIndexReader.h"
+#include "Parameters.h"
+
+int mergeindex(int argc, const char **argv, const Command &command) {
+    Parameters &par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    std::string indexDB = PrefilteringIndexReader::searchForIndex(par.db1);
+    if (indexDB.empty()) {
+        Debug(Debug::ERROR) << "No index found for " << par.db1 << ". Please create it with 'createindex'!\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    PrefilteringIndexReader::mergeIndexSplits(indexDB, par.threads);
+    return EXIT_SUCCESS;
+}
@@ -14,7 +14,7 @@ const bool tsvOut, const std::string &mappingFile, const std::string &userStrToA
     DBReader<unsigned int> reader(db1.c_str(), db1Index.c_str(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
 
-    const bool shouldCompress = tsvOut == false && compressed == true;
+    const int shouldCompress = tsvOut == false ? compressed : 0;
     // TODO: does generic db make more sense than copying db type here?
     const int dbType = tsvOut == true ? Parameters::DBTYPE_OMIT_FILE : reader.getDbtype();
     DBWriter writer(db2.c_str(), db2Index.c_str(), threads, shouldCompress, dbType);
@@ -19,7 +19,7 @@ int profile2pssm(int argc, const char **argv, const Command &command) {
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
 
     const bool isDbOutput = par.dbOut;
-    const bool shouldCompress = isDbOutput == true && par.compressed == true;
+    const int shouldCompress = isDbOutput == true ? par.compressed : 0;
     const int dbType = isDbOutput == true ? Parameters::DBTYPE_GENERIC_DB : Parameters::DBTYPE_OMIT_FILE;
     DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads, shouldCompress, dbType);
     writer.open();
@@ -135,6 +135,9 @@ int renamedbkeys(int argc, const char **argv, const Command &command) {
     // merge any kind of sequence database
     writer.close(headerWriter != NULL);
     DBWriter::writeDbtypeFile(par.db3.c_str(), reader.getDbtype(), isCompressed);
+    if (isCompressed && FileUtil::fileExists((par.db2 + ".dict").c_str())) {
+        FileUtil::copyFile(par.db2 + ".dict", par.db3 + ".dict");
+    }
     if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
         DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::DATA);
     }
@@ -168,6 +171,9 @@ int renamedbkeys(int argc, const char **argv, const Command &command) {
         headerWriter->close(true);
         delete headerWriter;
         DBWriter::writeDbtypeFile(par.hdr3.c_str(), headerReader->getDbtype(), isHeaderCompressed);
+        if (isHeaderCompressed && FileUtil::fileExists((par.hdr2 + ".dict").c_str())) {
+            FileUtil::copyFile(par.hdr2 + ".dict", par.hdr3 + ".dict");
+        }
         if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
             DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::HEADER);
         }
@@ -140,7 +140,7 @@ int result2msa(int argc, const char **argv, const Command &command) {
     resultWriter.open();
 
     // + 1 for query
-    size_t maxSetSize = resultReader.maxCount('\n') + 1;
+    size_t maxSetSize = Matcher::maxAlignmentResultCount(resultReader, par.threads) + 1;
 
     // adjust score of each match state by -0.2 to trim alignment
     SubstitutionMatrix subMat(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0f, -0.2f);
@@ -157,334 +157,418 @@ int result2msa(int argc, const char **argv, const Command &command) {
     Debug(Debug::INFO) << "Target database size: " << tDbr->getSize() << " type: " << tDbr->getDbTypeName() << "\n";
 
     const bool isFiltering = par.filterMsa != 0;
+    // process the largest sets first, so that they do not end up running alone at the end
+    std::vector<std::pair<size_t, size_t>> querySizes = Matcher::sortByAlignmentResultCount(resultReader, dbFrom, dbSize, localThreads);
+    size_t parallelSetCount = 0;
+    while (par.threads > 1 && parallelSetCount < querySizes.size() && querySizes[parallelSetCount].first >= MultipleAlignment::PARALLEL_SET_SIZE) {
+        parallelSetCount++;
+    }
     Debug::Progress progress(dbSize - dbFrom);
-#pragma omp parallel num_threads(localThreads)
-    {
-        unsigned int thread_idx = 0;
+    for (size_t phase = 0; phase < 2; ++phase) {
+        const size_t phaseFrom = (phase == 0) ? 0 : parallelSetCount;
+        const size_t phaseTo = (phase == 0) ? parallelSetCount : querySizes.size();
+        if (phaseFrom == phaseTo) {
+            continue;
+        }
+        // the large sets are processed one after another, all threads work together on each of them
+        const bool parallelSet = (phase == 0);
+#pragma omp parallel num_threads(parallelSet ? 1 : localThreads)
+        {
+            unsigned int thread_idx = 0;
 #ifdef OPENMP
-        thread_idx = (unsigned int) omp_get_thread_num();
+            thread_idx = (unsigned int) omp_get_thread_num();
+            if (parallelSet) {
+                omp_set_num_threads(par.threads);
+            }
 #endif
 
-        Matcher matcher(qDbr->getDbtype(), tDbr->getDbtype(), maxSequenceLength, &subMat, &evalueComputation, par.compBiasCorrection,
-                        par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid(), 0.0);
-        MultipleAlignment aligner(maxSequenceLength, &subMat);
-        PSSMCalculator calculator(&subMat, maxSequenceLength, maxSetSize, par.pcmode, par.pca, par.pcb, par.gapOpen.values.aminoacid(), par.gapPseudoCount);
-        MsaFilter filter(maxSequenceLength, maxSetSize, &subMat, par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid());
-        UniprotHeaderSummarizer summarizer;
-        Sequence centerSequence(maxSequenceLength, qDbr->getDbtype(), &subMat, 0, false, par.compBiasCorrection);
-        Sequence edgeSequence(maxSequenceLength, tDbr->getDbtype(), &subMat, 0, false, false);
-
-        // which sequences where kept after filtering
-        bool *kept = new bool[maxSetSize];
-        for (size_t i = 0; i < maxSetSize; ++i) {
-            kept[i] = 1;
-        }
-
-        char dbKey[255];
-        const char *entry[255];
-        std::string accession;
+            Matcher matcher(qDbr->getDbtype(), tDbr->getDbtype(), maxSequenceLength, &subMat, &evalueComputation, par.compBiasCorrection,
+                            par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid(), 0.0);
+            MultipleAlignment aligner(maxSequenceLength, &subMat);
+            PSSMCalculator calculator(&subMat, maxSequenceLength, maxSetSize, par.pcmode, par.pca, par.pcb, par.gapOpen.values.aminoacid(), par.gapPseudoCount);
+            MsaFilter filter(maxSequenceLength, maxSetSize, &subMat, par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid());
+            UniprotHeaderSummarizer summarizer;
+            Sequence centerSequence(maxSequenceLength, qDbr->getDbtype(), &subMat, 0, false, par.compBiasCorrection);
+            Sequence edgeSequence(maxSequenceLength, tDbr->getDbtype(), &subMat, 0, false, false);
+
+            // which sequences where kept after filtering
+            bool *kept = new bool[maxSetSize];
+            for (size_t i = 0; i < maxSetSize; ++i) {
+                kept[i] = 1;
+            }
 
-        std::vector<std::string> headers;
-        headers.reserve(300);
+            char dbKey[255];
+            const char *entry[255];
+            std::string accession;
 
-        std::vector<Matcher::result_t> alnResults;
-        alnResults.reserve(300);
+            std::vector<std::string> headers;
+            headers.reserve(300);
 
-        std::vector<std::vector<unsigned char>> seqSet;
-        seqSet.reserve(300);
+            std::vector<Matcher::result_t> alnResults;
+            alnResults.reserve(300);
 
-        std::vector<unsigned int> seqKeys;
-        seqKeys.reserve(300);
+            std::vector<std::vector<unsigned char>> seqSet;
+            seqSet.reserve(300);
 
-        std::string result;
-        result.reserve(300 * 1024);
-        char buffer[1024 + 32768*4];
+            std::vector<unsigned int> seqKeys;
+            seqKeys.reserve(300);
 
-#pragma omp for schedule(dynamic, 10)
-        for (size_t id = dbFrom; id < (dbFrom + dbSize); id++) {
-            progress.updateProgress();
+            // target id and whether the backtrace has to be recomputed
+            std::vector<std::pair<size_t, bool>> members;
+            members.reserve(300);
 
-            unsigned int queryKey = resultReader.getDbKey(id);
-            size_t queryId = qDbr->getId(queryKey);
-            if (queryId == UINT_MAX) {
-                Debug(Debug::WARNING) << "Invalid query sequence " << queryKey << "\n";
-                continue;
-            }
-            centerSequence.mapSequence(queryId, queryKey, qDbr->getData(queryId, thread_idx), qDbr->getSeqLen(queryId));
-
-            // TODO: Do we still need this?
-//            if (centerSequence.L) {
-//                // remove last in it is a *
-//                if(centerSequence.numSequence[centerSequence.L-1] == 20) {
-//                    centerSequence.L--;
-//                }
-//            }
-
-            size_t centerHeaderId = queryHeaderReader->getId(queryKey);
-            if (centerHeaderId == UINT_MAX) {
-                Debug(Debug::WARNING) << "Invalid query header " << queryKey << "\n";
-                continue;
-            }
-            char *centerSequenceHeader = queryHeaderReader->getData(centerHeaderId, thread_idx);
-            size_t centerHeaderLength = queryHeaderReader->getEntryLen(centerHeaderId) - 1;
+            std::string result;
+            result.reserve(300 * 1024);
+            char buffer[1024 + 32768*4];
 
-            if (par.msaFormatMode == Parameters::FORMAT_MSA_STOCKHOLM_FLAT) {
-                accession = Util::parseFastaHeader(centerSequenceHeader);
-            }
+#pragma omp for schedule(dynamic, 1)
+            for (size_t orderId = phaseFrom; orderId < phaseTo; orderId++) {
+                progress.updateProgress();
 
+                const size_t id = querySizes[orderId].second;
 
-            bool isQueryInit = false;
-            char *data = resultReader.getData(id, thread_idx);
-            while (*data != '\0') {
-                Util::parseKey(data, dbKey);
-                const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
-                // in the same database case, we have the query repeated
-                if (key == queryKey && sameDatabase == true) {
-                    data = Util::skipLine(data);
+                unsigned int queryKey = resultReader.getDbKey(id);
+                size_t queryId = qDbr->getId(queryKey);
+                if (queryId == UINT_MAX) {
+                    Debug(Debug::WARNING) << "Invalid query sequence " << queryKey << "\n";
                     continue;
                 }
-
-                const size_t edgeId = tDbr->getId(key);
-                if (edgeId == UINT_MAX) {
-                    Debug(Debug::ERROR) << "Sequence " << key << " does not exist in target sequence database\n";
-                    EXIT(EXIT_FAILURE);
+                centerSequence.mapSequence(queryId, queryKey, qDbr->getData(queryId, thread_idx), qDbr->getSeqLen(queryId));
+
+                // TODO: Do we still need this?
+    //            if (centerSequence.L) {
+    //                // remove last in it is a *
+    //                if(centerSequence.numSequence[centerSequence.L-1] == 20) {
+    //                    centerSequence.L--;
+    //                }
+    //            }
+
+                size_t centerHeaderId = queryHeaderReader->getId(queryKey);
+                if (centerHeaderId == UINT_MAX) {
+                    Debug(Debug::WARNING) << "Invalid query header " << queryKey << "\n";
+                    continue;
                 }
-                edgeSequence.mapSequence(edgeId, key, tDbr->getData(edgeId, thread_idx), tDbr->getSeqLen(edgeId));
-                seqSet.emplace_back(std::vector<unsigned char>(edgeSequence.numSequence, edgeSequence.numSequence + edgeSequence.L));
-                seqKeys.emplace_back(key);
+                char *centerSequenceHeader = queryHeaderReader->getData(centerHeaderId, thread_idx);
+                size_t centerHeaderLength = queryHeaderReader->getEntryLen(centerHeaderId) - 1;
 
-                const size_t columns = Util::getWordsOfLine(data, entry, 255);
-                if (columns > Matcher::ALN_RES_WITHOUT_BT_COL_CNT) {
-                    alnResults.emplace_back(Matcher::parseAlignmentRecord(data));
-                } else {
-                    // Recompute if not all the backtraces are present
-                    if (isQueryInit == false) {
-                        matcher.initQuery(&centerSequence);
-                        isQueryInit = true;
-                    }
-                    alnResults.emplace_back(matcher.getSWResult(&edgeSequence, INT_MAX, false, 0, 0.0, FLT_MAX, Matcher::SCORE_COV_SEQID, 0, false));
+                if (par.msaFormatMode == Parameters::FORMAT_MSA_STOCKHOLM_FLAT) {
+                    accession = Util::parseFastaHeader(centerSequenceHeader);
                 }
-                data = Util::skipLine(data);
-            }
 
-            MultipleAlignment::MSAResult res = aligner.computeMSA(&centerSequence, seqSet, alnResults, !par.allowDeletion);
-            //MultipleAlignment::print(res, &subMat);
 
-            if (par.msaFormatMode == Parameters::FORMAT_MSA_FASTADB || par.msaFormatMode == Parameters::FORMAT_MSA_FASTADB_SUMMARY) {
-                if (isFiltering) {
-                    filter.filter(res.setSize, res.centerLength, static_cast<int>(par.covMSAThr * 100), qid_vec, par.qsc, static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable, (const char **) res.msaSequence, false);
-                    filter.getKept(kept, res.setSize);
-                }
-                if (par.msaFormatMode == Parameters::FORMAT_MSA_FASTADB_SUMMARY) {
-                    // gather headers for summary
-                    for (size_t i = 0; i < res.setSize; i++) {
-                        if (i == 0) {
-                            headers.emplace_back(centerSequenceHeader, centerHeaderLength);
-                        } else if (kept[i] == true) {
-                            unsigned int key = seqKeys[i - 1];
-                            size_t id = targetHeaderReader->getId(key);
-                            char *header = targetHeaderReader->getData(id, thread_idx);
-                            size_t length = targetHeaderReader->getEntryLen(id) - 1;
-                            headers.emplace_back(header, length);
+                bool needsAlignment = false;
+                char *data = resultReader.getData(id, thread_idx);
+                if (Matcher::isBinaryResult(data)) {
+                    const Matcher::binary_header_t *header = Matcher::getBinaryHeader(data);
+                    const Matcher::binary_result_t *records = Matcher::getBinaryResults(data);
+                    const bool hasBacktrace = header->flags & Matcher::BINARY_RESULT_HAS_BACKTRACE;
+                    for (unsigned int i = 0; i < header->count; i++) {
+                        const unsigned int key = records[i].dbKey;
+                        // in the same database case, we have the query repeated
+                        if (key == queryKey && sameDatabase == true) {
+                            continue;
                         }
-                    }
-                    result.append(1, '#');
-                    result.append(par.summaryPrefix);
-                    result.append(1, '-');
-                    result.append(SSTR(queryKey));
-                    result.append(1, '|');
-                    result.append(summarizer.summarize(headers));
-                    result.append(1, '\n');
-                    headers.clear();
-                }
 
-                size_t start = 0;
-                if (par.skipQuery == true) {
-                    start = 1;
-                }
-                for (size_t i = start; i < res.setSize; i++) {
-                    if (kept[i] == false) {
-                        continue;
+                        const size_t edgeId = tDbr->getId(key);
+                        if (edgeId == UINT_MAX) {
+                            Debug(Debug::ERROR) << "Sequence " << key << " does not exist in target sequence database\n";
+                            EXIT(EXIT_FAILURE);
+                        }
+                        seqKeys.emplace_back(key);
+                        members.emplace_back(edgeId, hasBacktrace == false);
+                        if (hasBacktrace) {
+                            alnResults.emplace_back(Matcher::binaryRecordToResult(data, records[i]));
+                        } else {
+                            needsAlignment = true;
+                            alnResults.emplace_back();
+                        }
                     }
+                } else {
+                    while (*data != '\0') {
+                        Util::parseKey(data, dbKey);
+                        const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+                        // in the same database case, we have the query repeated
+                        if (key == queryKey && sameDatabase == true) {
+                            data = Util::skipLine(data);
+                            continue;
+                        }
 
-                    char *header;
-                    size_t length;
-                    if (i == 0) {
-                        header = centerSequenceHeader;
-                        length = centerHeaderLength;
-                    } else {
-                        unsigned int key = seqKeys[i - 1];
-                        size_t id = targetHeaderReader->getId(key);
-                        header = targetHeaderReader->getData(id, thread_idx);
-                        length = targetHeaderReader->getEntryLen(id) - 1;
+                        const size_t edgeId = tDbr->getId(key);
+                        if (edgeId == UINT_MAX) {
+                            Debug(Debug::ERROR) << "Sequence " << key << " does not exist in target sequence database\n";
+                            EXIT(EXIT_FAILURE);
+                        }
+                        seqKeys.emplace_back(key);
+
+                        const size_t columns = Util::getWordsOfLine(data, entry, 255);
+                        const bool hasBacktrace = columns > Matcher::ALN_RES_WITHOUT_BT_COL_CNT;
+                        members.emplace_back(edgeId, hasBacktrace == false);
+                        if (hasBacktrace) {
+                            alnResults.emplace_back(Matcher::parseAlignmentRecord(data));
+                        } else {
+                            // Recompute if not all the backtraces are present
+                            needsAlignment = true;
+                            alnResults.emplace_back();
+                        }
+                        data = Util::skipLine(data);
                     }
+                }
 
-                    result.append(1, '>');
-                    result.append(header, length);
-                    // need to allow insertion in the centerSequence
-                    for (size_t pos = 0; pos < res.centerLength; pos++) {
-                        char aa = res.msaSequence[i][pos];
-                        result.append(1, ((aa < MultipleAlignment::NAA) ? subMat.num2aa[(int) aa] : '-'));
+                seqSet.resize(members.size());
+#pragma omp parallel if(parallelSet)
+                {
+                    // the first thread continues to use the objects of the enclosing thread
+                    unsigned int member_thread_idx = thread_idx;
+#ifdef OPENMP
+                    if (parallelSet) {
+                        member_thread_idx = (unsigned int) omp_get_thread_num();
+                    }
+#endif
+                    Sequence *memberSequence = &edgeSequence;
+                    Matcher *memberMatcher = &matcher;
+                    if (member_thread_idx != thread_idx) {
+                        memberSequence = new Sequence(maxSequenceLength, tDbr->getDbtype(), &subMat, 0, false, false);
+                        memberMatcher = needsAlignment ? new Matcher(qDbr->getDbtype(), tDbr->getDbtype(), maxSequenceLength, &subMat, &evalueComputation, par.compBiasCorrection,
+                                                                     par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid(), 0.0) : NULL;
+                    }
+                    if (needsAlignment) {
+                        memberMatcher->initQuery(&centerSequence);
+                    }
+#pragma omp for schedule(dynamic, 64)
+                    for (size_t j = 0; j < members.size(); ++j) {
+                        const size_t edgeId = members[j].first;
+                        memberSequence->mapSequence(edgeId, seqKeys[j], tDbr->getData(edgeId, member_thread_idx), tDbr->getSeqLen(edgeId));
+                        seqSet[j].assign(memberSequence->numSequence, memberSequence->numSequence + memberSequence->L);
+                        if (members[j].second) {
+                            alnResults[j] = memberMatcher->getSWResult(memberSequence, INT_MAX, false, 0, 0.0, FLT_MAX, Matcher::SCORE_COV_SEQID, 0, false);
+                        }
+                    }
+                    if (memberSequence != &edgeSequence) {
+                        delete memberSequence;
+                        delete memberMatcher;
                     }
-                    result.append(1, '\n');
-                }
-            } else if (par.msaFormatMode == Parameters::FORMAT_MSA_STOCKHOLM_FLAT) {
-                if (isFiltering) {
-                    filter.filter(res.setSize, res.centerLength, static_cast<int>(par.covMSAThr * 100), qid_vec, par.qsc, static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable, (const char **) res.msaSequence, false);
-                    filter.getKept(kept, res.setSize);
                 }
 
-                result.append("# STOCKHOLM 1.0\n");
-                size_t start = 0;
-                if (par.skipQuery == true) {
-                    start = 1;
-                    result.append("#=GF ID ");
-                    result.append(Util::parseFastaHeader(centerSequenceHeader));
-                    result.append(1, '\n');
-                }
-                for (size_t i = start; i < res.setSize; i++) {
-                    if (kept[i] == false) {
-                        continue;
-                    }
+                MultipleAlignment::MSAResult res = aligner.computeMSA(&centerSequence, seqSet, alnResults, !par.allowDeletion);
+                //MultipleAlignment::print(res, &subMat);
 
-                    char *header;
-                    if (i == 0) {
-                        header = centerSequenceHeader;
-                    } else {
-                        unsigned int key = seqKeys[i - 1];
-                        size_t id = targetHeaderReader->getId(key);
-                        header = targetHeaderReader->getData(id, thread_idx);
+                if (par.msaFormatMode == Parameters::FORMAT_MSA_FASTADB || par.msaFormatMode == Parameters::FORMAT_MSA_FASTADB_SUMMARY) {
+                    if (isFiltering) {
+                        filter.filter(res.setSize, res.centerLength, static_cast<int>(par.covMSAThr * 100), qid_vec, par.qsc, static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable, (const char **) res.msaSequence, false);
+                        filter.getKept(kept, res.setSize);
                     }
-                    accession = Util::parseFastaHeader(header);
-
-                    result.append(accession);
-                    result.append(1, ' ');
-                    // need to allow insertion in the centerSequence
-                    for (size_t pos = 0; pos < res.centerLength; pos++) {
-                        char aa = res.msaSequence[i][pos];
-                        result.append(1, ((aa < MultipleAlignment::NAA) ? subMat.num2aa[(int) aa] : '-'));
+                    if (par.msaFormatMode == Parameters::FORMAT_MSA_FASTADB_SUMMARY) {
+                        // gather headers for summary
+                        for (size_t i = 0; i < res.setSize; i++) {
+                            if (i == 0) {
+                                headers.emplace_back(centerSequenceHeader, centerHeaderLength);
+                            } else if (kept[i] == true) {
+                                unsigned int key = seqKeys[i - 1];
+                                size_t id = targetHeaderReader->getId(key);
+                                char *header = targetHeaderReader->getData(id, thread_idx);
+                                size_t length = targetHeaderReader->getEntryLen(id) - 1;
+                                headers.emplace_back(header, length);
+                            }
+                        }
+                        result.append(1, '#');
+                        result.append(par.summaryPrefix);
+                        result.append(1, '-');
+                        result.append(SSTR(queryKey));
+                        result.append(1, '|');
+                        result.append(summarizer.summarize(headers));
+                        result.append(1, '\n');
+                        headers.clear();
                     }
-                    result.append(1, '\n');
-                }
-                result.append("//\n");
-            } else if (par.msaFormatMode == Parameters::FORMAT_MSA_A3M || par.msaFormatMode == Parameters::FORMAT_MSA_A3M_ALN_INFO) {
-                if (isFiltering) {
-                    filter.filter(res.setSize, res.centerLength, static_cast<int>(par.covMSAThr * 100), qid_vec, par.qsc, static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable, (const char **) res.msaSequence, false);
-                    filter.getKept(kept, res.setSize);
-                }
 
-                size_t start = (par.skipQuery == true) ? 1 : 0;
-                for (size_t i = start; i < res.setSize; i++) {
-                    if (kept[i] == false) {
-                        continue;
+                    size_t start = 0;
+                    if (par.skipQuery == true) {
+                        start = 1;
                     }
+                    for (size_t i = start; i < res.setSize; i++) {
+                        if (kept[i] == false) {
+                            continue;
+                        }
 
-                    result.push_back('>');
-                    if (i == 0) {
-                        result.append(Util::parseFastaHeader(centerSequenceHeader));
-                    } else {
-                        unsigned int key = seqKeys[i - 1];
-                        size_t id = targetHeaderReader->getId(key);
-                        result.append(Util::parseFastaHeader(targetHeaderReader->getData(id, thread_idx)));
-                        if (par.msaFormatMode == Parameters::FORMAT_MSA_A3M_ALN_INFO) {
-                            size_t len = Matcher::resultToBuffer(buffer, alnResults[i - 1], false);
-                            char* data = buffer;
-                            data += Util::skipNoneWhitespace(data);
-                            result.append(data, len - (data - buffer) - 1);
+                        char *header;
+                        size_t length;
+                        if (i == 0) {
+                            header = centerSequenceHeader;
+                            length = centerHeaderLength;
+                        } else {
+                            unsigned int key = seqKeys[i - 1];
+                            size_t id = targetHeaderReader->getId(key);
+                            header = targetHeaderReader->getData(id, thread_idx);
+                            length = targetHeaderReader->getEntryLen(id) - 1;
                         }
-                    }
-                    result.push_back('\n');
 
-                    // need to allow insertion in the centerSequence
-                    if(i == 0){
+                        result.append(1, '>');
+                        result.append(header, length);
+                        // need to allow insertion in the centerSequence
                         for (size_t pos = 0; pos < res.centerLength; pos++) {
                             char aa = res.msaSequence[i][pos];
                             result.append(1, ((aa < MultipleAlignment::NAA) ? subMat.num2aa[(int) aa] : '-'));
                         }
                         result.append(1, '\n');
-                    }else{
-                        const std::vector<unsigned char> & seq = seqSet[i-1];
-                        int seqStartPos = alnResults[i-1].dbStartPos;
-                        size_t seqPos = 0;
-                        const std::string & bt = alnResults[i-1].backtrace;
-                        size_t btPos = 0;
+                    }
+                } else if (par.msaFormatMode == Parameters::FORMAT_MSA_STOCKHOLM_FLAT) {
+                    if (isFiltering) {
+                        filter.filter(res.setSize, res.centerLength, static_cast<int>(par.covMSAThr * 100), qid_vec, par.qsc, static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable, (const char **) res.msaSequence, false);
+                        filter.getKept(kept, res.setSize);
+                    }
+
+                    result.append("# STOCKHOLM 1.0\n");
+                    size_t start = 0;
+                    if (par.skipQuery == true) {
+                        start = 1;
+                        result.append("#=GF ID ");
+                        result.append(Util::parseFastaHeader(centerSequenceHeader));
+                        result.append(1, '\n');
+                    }
+                    for (size_t i = start; i < res.setSize; i++) {
+                        if (kept[i] == false) {
+                            continue;
+                        }
+
+                        char *header;
+                        if (i == 0) {
+                            header = centerSequenceHeader;
+                        } else {
+                            unsigned int key = seqKeys[i - 1];
+                            size_t id = targetHeaderReader->getId(key);
+                            header = targetHeaderReader->getData(id, thread_idx);
+                        }
+                        accession = Util::parseFastaHeader(header);
 
+                        result.append(accession);
+                        result.append(1, ' ');
+                        // need to allow insertion in the centerSequence
                         for (size_t pos = 0; pos < res.centerLength; pos++) {
                             char aa = res.msaSequence[i][pos];
+                            result.append(1, ((aa < MultipleAlignment::NAA) ? subMat.num2aa[(int) aa] : '-'));
+                        }
+                        result.append(1, '\n');
+                    }
+                    result.append("//\n");
+                } else if (par.msaFormatMode == Parameters::FORMAT_MSA_A3M || par.msaFormatMode == Parameters::FORMAT_MSA_A3M_ALN_INFO) {
+                    if (isFiltering) {
+                        filter.filter(res.setSize, res.centerLength, static_cast<int>(par.covMSAThr * 100), qid_vec, par.qsc, static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable, (const char **) res.msaSequence, false);
+                        filter.getKept(kept, res.setSize);
+                    }
 
-                            if(aa>=MultipleAlignment::GAP){
-                                result.push_back('-');
-                            }else if(aa<MultipleAlignment::GAP){
-                                result.push_back( subMat.num2aa[(int) aa]);
-                                btPos++;
-                                seqPos++;
+                    size_t start = (par.skipQuery == true) ? 1 : 0;
+                    for (size_t i = start; i < res.setSize; i++) {
+                        if (kept[i] == false) {
+                            continue;
+                        }
+
+                        result.push_back('>');
+                        if (i == 0) {
+                            result.append(Util::parseFastaHeader(centerSequenceHeader));
+                        } else {
+                            unsigned int key = seqKeys[i - 1];
+                            size_t id = targetHeaderReader->getId(key);
+                            result.append(Util::parseFastaHeader(targetHeaderReader->getData(id, thread_idx)));
+                            if (par.msaFormatMode == Parameters::FORMAT_MSA_A3M_ALN_INFO) {
+                                size_t len = Matcher::resultToBuffer(buffer, alnResults[i - 1], false);
+                                char* data = buffer;
+                                data += Util::skipNoneWhitespace(data);
+                                result.append(data, len - (data - buffer) - 1);
+                            }
+                        }
+                        result.push_back('\n');
+
+                        // need to allow insertion in the centerSequence
+                        if(i == 0){
+                            for (size_t pos = 0; pos < res.centerLength; pos++) {
+                                char aa = res.msaSequence[i][pos];
+                                result.append(1, ((aa < MultipleAlignment::NAA) ? subMat.num2aa[(int) aa] : '-'));
                             }
-                            // skip insert
-                            while(btPos < bt.size() && bt[btPos] == 'I') { btPos++;}
-
-                            // add lower case deletions
-                            while(btPos < bt.size() && bt[btPos] == 'D') {
-                                result.push_back(tolower(subMat.num2aa[seq[seqStartPos+seqPos]]));
-                                btPos++;
-                                seqPos++;
+                            result.append(1, '\n');
+                        }else{
+                            const std::vector<unsigned char> & seq = seqSet[i-1];
+                            int seqStartPos = alnResults[i-1].dbStartPos;
+                            size_t seqPos = 0;
+                            const std::string & bt = alnResults[i-1].backtrace;
+                            size_t btPos = 0;
+
+                            for (size_t pos = 0; pos < res.centerLength; pos++) {
+                                char aa = res.msaSequence[i][pos];
+
+                                if(aa>=MultipleAlignment::GAP){
+                                    result.push_back('-');
+                                }else if(aa<MultipleAlignment::GAP){
+                                    result.push_back( subMat.num2aa[(int) aa]);
+                                    btPos++;
+                                    seqPos++;
+                                }
+                                // skip insert
+                                while(btPos < bt.size() && bt[btPos] == 'I') { btPos++;}
+
+                                // add lower case deletions
+                                while(btPos < bt.size() && bt[btPos] == 'D') {
+                                    result.push_back(tolower(subMat.num2aa[seq[seqStartPos+seqPos]]));
+                                    btPos++;
+                                    seqPos++;
+                                }
                             }
+                            result.append(1, '\n');
                         }
-                        result.append(1, '\n');
                     }
-                }
-            } else if (isCA3M == true) {
-                size_t filteredSetSize = res.setSize;
-                if (isFiltering) {
-                    filteredSetSize = filter.filter(res, alnResults, static_cast<int>(par.covMSAThr * 100), qid_vec, par.qsc, static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable);
-                }
-                if (par.formatAlignmentMode == Parameters::FORMAT_MSA_CA3M_CONSENSUS) {
-                    for (size_t pos = 0; pos < res.centerLength; pos++) {
-                        if (res.msaSequence[0][pos] == MultipleAlignment::GAP) {
-                            Debug(Debug::ERROR) << "Error in computePSSMFromMSA. First sequence of MSA is not allowed to contain gaps.\n";
-                            EXIT(EXIT_FAILURE);
-                        }
+                } else if (isCA3M == true) {
+                    size_t filteredSetSize = res.setSize;
+                    if (isFiltering) {
+                        filteredSetSize = filter.filter(res, alnResults, static_cast<int>(par.covMSAThr * 100), qid_vec, par.qsc, static_cast<int>(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable);
                     }
+                    if (par.formatAlignmentMode == Parameters::FORMAT_MSA_CA3M_CONSENSUS) {
+                        for (size_t pos = 0; pos < res.centerLength; pos++) {
+                            if (res.msaSequence[0][pos] == MultipleAlignment::GAP) {
+                                Debug(Debug::ERROR) << "Error in computePSSMFromMSA. First sequence of MSA is not allowed to contain gaps.\n";
+                                EXIT(EXIT_FAILURE);
+                            }
+                        }
 
-                    PSSMCalculator::Profile pssmRes = calculator.computePSSMFromMSA(filteredSetSize, res.centerLength, (const char **) res.msaSequence, alnResults, par.wg);
-                    result.append(">consensus_");
-                    result.append(centerSequenceHeader, centerHeaderLength);
-                    for (int pos = 0; pos < centerSequence.L; pos++) {
-                        result.push_back(subMat.num2aa[pssmRes.consensus[pos]]);
-                    }
-                    result.append("\n;");
-                } else {
-                    result.append(1, '>');
-                    result.append(centerSequenceHeader, centerHeaderLength);
-                    // Retrieve the master sequence
-                    for (int pos = 0; pos < centerSequence.L; pos++) {
-                        result.push_back(subMat.num2aa[centerSequence.numSequence[pos]]);
+                        PSSMCalculator::Profile pssmRes = calculator.computePSSMFromMSA(filteredSetSize, res.centerLength, (const char **) res.msaSequence, alnResults, par.wg);
+                        result.append(">consensus_");
+                        result.append(centerSequenceHeader, centerHeaderLength);
+                        for (int pos = 0; pos < centerSequence.L; pos++) {
+                            result.push_back(subMat.num2aa[pssmRes.consensus[pos]]);
+                        }
+                        result.append("\n;");
+                    } else {
+                        result.append(1, '>');
+                        result.append(centerSequenceHeader, centerHeaderLength);
+                        // Retrieve the master sequence
+                        for (int pos = 0; pos < centerSequence.L; pos++) {
+                            result.push_back(subMat.num2aa[centerSequence.numSequence[pos]]);
+                        }
+                        result.append("\n;");
                     }
-                    result.append("\n;");
-                }
 
-                Matcher::result_t queryAln;
-                unsigned int newQueryKey = seqConcat->dbAKeyMap(queryKey);
-                queryAln.qStartPos = 0;
-                queryAln.dbStartPos = 0;
-                queryAln.backtrace = std::string(centerSequence.L, 'M'); // only matches
-                CompressedA3M::hitToBuffer(refReader->getId(newQueryKey), queryAln, result);
-                for (size_t i = 0; i < alnResults.size(); ++i) {
-                    unsigned int key = alnResults[i].dbKey;
-                    unsigned int targetKey = seqConcat->dbBKeyMap(key);
-                    unsigned int targetId = refReader->getId(targetKey);
-                    CompressedA3M::hitToBuffer(targetId, alnResults[i], result);
+                    Matcher::result_t queryAln;
+                    unsigned int newQueryKey = seqConcat->dbAKeyMap(queryKey);
+                    queryAln.qStartPos = 0;
+                    queryAln.dbStartPos = 0;
+                    queryAln.backtrace = std::string(centerSequence.L, 'M'); // only matches
+                    CompressedA3M::hitToBuffer(refReader->getId(newQueryKey), queryAln, result);
+                    for (size_t i = 0; i < alnResults.size(); ++i) {
+                        unsigned int key = alnResults[i].dbKey;
+                        unsigned int targetKey = seqConcat->dbBKeyMap(key);
+                        unsigned int targetId = refReader->getId(targetKey);
+                        CompressedA3M::hitToBuffer(targetId, alnResults[i], result);
+                    }
                 }
+                resultWriter.writeData(result.c_str(), result.length(), queryKey, thread_idx, shouldWriteNullByte);
+                result.clear();
+
+                MultipleAlignment::deleteMSA(&res);
+                seqSet.clear();
+                seqKeys.clear();
+                members.clear();
+                alnResults.clear();
             }
-            resultWriter.writeData(result.c_str(), result.length(), queryKey, thread_idx, shouldWriteNullByte);
-            result.clear();
 
-            MultipleAlignment::deleteMSA(&res);
-            seqSet.clear();
-            seqKeys.clear();
-            alnResults.clear();
+            delete[] kept;
         }
-
-        delete[] kept;
     }
     resultWriter.close(true);
     if (shouldWriteNullByte == false) {
@@ -116,7 +116,7 @@ int result2profile(int argc, const char **argv, const Command &command, bool ret
     resultWriter.open();
 
     // + 1 for query
-    size_t maxSetSize = resultReader.maxCount('\n') + 1;
+    size_t maxSetSize = Matcher::maxAlignmentResultCount(resultReader, par.threads) + 1;
 
     // adjust score of each match state by -0.2 to trim alignment
     SubstitutionMatrix subMat(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0f, -0.2f);
@@ -136,140 +136,228 @@ int result2profile(int argc, const char **argv, const Command &command, bool ret
     Debug(Debug::INFO) << "Target database size: " << tDbr->getSize() << " type: " << Parameters::getDbTypeName(targetSeqType) << "\n";
 
     const bool isFiltering = par.filterMsa != 0 || returnAlnRes;
+    // process the largest sets first, so that they do not end up running alone at the end
+    std::vector<std::pair<size_t, size_t>> querySizes = Matcher::sortByAlignmentResultCount(resultReader, dbFrom, dbSize, localThreads);
+    size_t parallelSetCount = 0;
+    while (par.threads > 1 && parallelSetCount < querySizes.size() && querySizes[parallelSetCount].first >= MultipleAlignment::PARALLEL_SET_SIZE) {
+        parallelSetCount++;
+    }
     Debug::Progress progress(dbSize - dbFrom);
-#pragma omp parallel num_threads(localThreads)
-    {
-        unsigned int thread_idx = 0;
+    for (size_t phase = 0; phase < 2; ++phase) {
+        const size_t phaseFrom = (phase == 0) ? 0 : parallelSetCount;
+        const size_t phaseTo = (phase == 0) ? parallelSetCount : querySizes.size();
+        if (phaseFrom == phaseTo) {
+            continue;
+        }
+        // the large sets are processed one after another, all threads work together on each of them
+        const bool parallelSet = (phase == 0);
+#pragma omp parallel num_threads(parallelSet ? 1 : localThreads)
+        {
+            unsigned int thread_idx = 0;
 #ifdef OPENMP
-        thread_idx = (unsigned int) omp_get_thread_num();
+            thread_idx = (unsigned int) omp_get_thread_num();
+            if (parallelSet) {
+                omp_set_num_threads(par.threads);
+            }
 #endif
 
-        Matcher matcher(qDbr->getDbtype(), tDbr->getDbtype(), maxSequenceLength, &subMat, &evalueComputation, par.compBiasCorrection,
-                        par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid(), 0.0);
-        PSSMMasker masker(maxSequenceLength, probMatrix, subMat);
-        MultipleAlignment aligner(maxSequenceLength, &subMat);
-        PSSMCalculator calculator(&subMat, maxSequenceLength, maxSetSize, par.pcmode,
-                                  par.pca, par.pcb, par.gapOpen.values.aminoacid(), par.gapPseudoCount);
-        MsaFilter filter(maxSequenceLength, maxSetSize, &subMat, par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid());
-        Sequence centerSequence(maxSequenceLength, qDbr->getDbtype(), &subMat, 0, false, par.compBiasCorrection);
-        Sequence edgeSequence(maxSequenceLength, targetSeqType, &subMat, 0, false, false);
-
-        char dbKey[255];
-        const char *entry[255];
-        char buffer[1024 + 32768*4];
-        float * pNullBuffer = new float[maxSequenceLength + 1];
-
-        std::vector<Matcher::result_t> alnResults;
-        alnResults.reserve(300);
-
-        std::vector<std::vector<unsigned char>> seqSet;
-        seqSet.reserve(300);
-
-        std::string result;
-        result.reserve((maxSequenceLength + 1) * Sequence::PROFILE_READIN_SIZE);
-
-#pragma omp for schedule(dynamic, 10)
-        for (size_t id = dbFrom; id < (dbFrom + dbSize); id++) {
-            progress.updateProgress();
-
-            unsigned int queryKey = resultReader.getDbKey(id);
-            size_t queryId = qDbr->getId(queryKey);
-            if (queryId == UINT_MAX) {
-                Debug(Debug::WARNING) << "Invalid query sequence " << queryKey << "\n";
-                continue;
-            }
-            centerSequence.mapSequence(queryId, queryKey, qDbr->getData(queryId, thread_idx), qDbr->getSeqLen(queryId));
-
-            bool isQueryInit = false;
-            char *data = resultReader.getData(id, thread_idx);
-            while (*data != '\0') {
-                Util::parseKey(data, dbKey);
-                const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
-                // in the same database case, we have the query repeated
-                if (key == queryKey && sameDatabase == true) {
-                    if(returnAlnRes && par.includeIdentity){
-                        Matcher::result_t res = Matcher::parseAlignmentRecord(data);
-                        size_t len = Matcher::resultToBuffer(buffer, res, true);
-                        result.append(buffer, len);
-                    }
+            Matcher matcher(qDbr->getDbtype(), tDbr->getDbtype(), maxSequenceLength, &subMat, &evalueComputation, par.compBiasCorrection,
+                            par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid(), 0.0);
+            PSSMMasker masker(maxSequenceLength, probMatrix, subMat);
+            MultipleAlignment aligner(maxSequenceLength, &subMat);
+            PSSMCalculator calculator(&subMat, maxSequenceLength, maxSetSize, par.pcmode,
+                                      par.pca, par.pcb, par.gapOpen.values.aminoacid(), par.gapPseudoCount);
+            MsaFilter filter(maxSequenceLength, maxSetSize, &subMat, par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid());
+            Sequence centerSequence(maxSequenceLength, qDbr->getDbtype(), &subMat, 0, false, par.compBiasCorrection);
+            Sequence edgeSequence(maxSequenceLength, targetSeqType, &subMat, 0, false, false);
+
+            char dbKey[255];
+            const char *entry[255];
+            char buffer[1024 + 32768*4];
+            float * pNullBuffer = new float[maxSequenceLength + 1];
+
+            std::vector<Matcher::result_t> alnResults;
+            alnResults.reserve(300);
+
+            std::vector<std::vector<unsigned char>> seqSet;
+            seqSet.reserve(300);
+
+            // target id and whether the backtrace has to be recomputed
+            std::vector<std::pair<size_t, bool>> members;
+            members.reserve(300);
 
-                    data = Util::skipLine(data);
+            std::string result;
+            result.reserve((maxSequenceLength + 1) * Sequence::PROFILE_READIN_SIZE);
+
+#pragma omp for schedule(dynamic, 1)
+            for (size_t orderId = phaseFrom; orderId < phaseTo; orderId++) {
+                progress.updateProgress();
+
+                const size_t id = querySizes[orderId].second;
+
+                unsigned int queryKey = resultReader.getDbKey(id);
+                size_t queryId = qDbr->getId(queryKey);
+                if (queryId == UINT_MAX) {
+                    Debug(Debug::WARNING) << "Invalid query sequence " << queryKey << "\n";
                     continue;
                 }
+                centerSequence.mapSequence(queryId, queryKey, qDbr->getData(queryId, thread_idx), qDbr->getSeqLen(queryId));
+
+                bool needsAlignment = false;
+                char *data = resultReader.getData(id, thread_idx);
+                if (Matcher::isBinaryResult(data)) {
+                    const Matcher::binary_header_t *header = Matcher::getBinaryHeader(data);
+                    const Matcher::binary_result_t *records = Matcher::getBinaryResults(data);
+                    const bool hasBacktrace = header->flags & Matcher::BINARY_RESULT_HAS_BACKTRACE;
+                    for (unsigned int i = 0; i < header->count; i++) {
+                        const unsigned int key = records[i].dbKey;
+                        // in the same database case, we have the query repeated
+                        if (key == queryKey && sameDatabase == true) {
+                            if (returnAlnRes && par.includeIdentity) {
+                                Matcher::result_t res = Matcher::binaryRecordToResult(data, records[i]);
+                                size_t len = Matcher::resultToBuffer(buffer, res, true);
+                                result.append(buffer, len);
+                            }
+                            continue;
+                        }
+
+                        if (returnAlnRes == true || records[i].eval < par.evalProfile) {
+                            const size_t edgeId = tDbr->getId(key);
+                            if (edgeId == UINT_MAX) {
+                                Debug(Debug::ERROR) << "Sequence " << key << " does not exist in target sequence database\n";
+                                EXIT(EXIT_FAILURE);
+                            }
+                            members.emplace_back(edgeId, hasBacktrace == false);
+                            if (hasBacktrace) {
+                                alnResults.emplace_back(Matcher::binaryRecordToResult(data, records[i]));
+                            } else {
+                                needsAlignment = true;
+                                alnResults.emplace_back();
+                            }
+                        }
+                    }
+                } else {
+                    while (*data != '\0') {
+                        Util::parseKey(data, dbKey);
+                        const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+                        // in the same database case, we have the query repeated
+                        if (key == queryKey && sameDatabase == true) {
+                            if(returnAlnRes && par.includeIdentity){
+                                Matcher::result_t res = Matcher::parseAlignmentRecord(data);
+                                size_t len = Matcher::resultToBuffer(buffer, res, true);
+                                result.append(buffer, len);
+                            }
+
+                            data = Util::skipLine(data);
+                            continue;
+                        }
+
+                        const size_t columns = Util::getWordsOfLine(data, entry, 255);
+                        float evalue = 0.0;
+                        if (returnAlnRes == false && columns >= 4) {
+                            evalue = strtod(entry[3], NULL);
+                        }
 
-                const size_t columns = Util::getWordsOfLine(data, entry, 255);
-                float evalue = 0.0;
-                if (returnAlnRes == false && columns >= 4) {
-                    evalue = strtod(entry[3], NULL);
+                        if (returnAlnRes == true || evalue < par.evalProfile) {
+                            const size_t edgeId = tDbr->getId(key);
+                            if (edgeId == UINT_MAX) {
+                                Debug(Debug::ERROR) << "Sequence " << key << " does not exist in target sequence database\n";
+                                EXIT(EXIT_FAILURE);
+                            }
+                            const bool hasBacktrace = columns > Matcher::ALN_RES_WITHOUT_BT_COL_CNT;
+                            members.emplace_back(edgeId, hasBacktrace == false);
+                            if (hasBacktrace) {
+                                alnResults.emplace_back(Matcher::parseAlignmentRecord(data));
+                            } else {
+                                // Recompute if not all the backtraces are present
+                                needsAlignment = true;
+                                alnResults.emplace_back();
+                            }
+                        }
+                        data = Util::skipLine(data);
+                    }
                 }
 
-                if (returnAlnRes == true || evalue < par.evalProfile) {
-                    const size_t edgeId = tDbr->getId(key);
-                    if (edgeId == UINT_MAX) {
-                        Debug(Debug::ERROR) << "Sequence " << key << " does not exist in target sequence database\n";
-                        EXIT(EXIT_FAILURE);
+                seqSet.resize(members.size());
+#pragma omp parallel if(parallelSet)
+                {
+                    // the first thread continues to use the objects of the enclosing thread
+                    unsigned int member_thread_idx = thread_idx;
+#ifdef OPENMP
+                    if (parallelSet) {
+                        member_thread_idx = (unsigned int) omp_get_thread_num();
+                    }
+#endif
+                    Sequence *memberSequence = &edgeSequence;
+                    Matcher *memberMatcher = &matcher;
+                    if (member_thread_idx != thread_idx) {
+                        memberSequence = new Sequence(maxSequenceLength, targetSeqType, &subMat, 0, false, false);
+                        memberMatcher = needsAlignment ? new Matcher(qDbr->getDbtype(), tDbr->getDbtype(), maxSequenceLength, &subMat, &evalueComputation, par.compBiasCorrection,
+                                                                     par.gapOpen.values.aminoacid(), par.gapExtend.values.aminoacid(), 0.0) : NULL;
+                    }
+                    if (needsAlignment) {
+                        memberMatcher->initQuery(&centerSequence);
                     }
-                    edgeSequence.mapSequence(edgeId, key, tDbr->getData(edgeId, thread_idx), tDbr->getSeqLen(edgeId));
-                    seqSet.emplace_back(std::vector<unsigned char>(edgeSequence.numSequence, edgeSequence.numSequence + edgeSequence.L));
-
-                    if (columns > Matcher::ALN_RES_WITHOUT_BT_COL_CNT) {
-                        alnResults.emplace_back(Matcher::parseAlignmentRecord(data));
-                    } else {
-                        // Recompute if not all the backtraces are present
-                        if (isQueryInit == false) {
-                            matcher.initQuery(&centerSequence);
-                            isQueryInit = true;
+#pragma omp for schedule(dynamic, 64)
+                    for (size_t j = 0; j < members.size(); ++j) {
+                        const size_t edgeId = members[j].first;
+                        memberSequence->mapSequence(edgeId, tDbr->getDbKey(edgeId), tDbr->getData(edgeId, member_thread_idx), tDbr->getSeqLen(edgeId));
+                        seqSet[j].assign(memberSequence->numSequence, memberSequence->numSequence + memberSequence->L);
+                        if (members[j].second) {
+                            alnResults[j] = memberMatcher->getSWResult(memberSequence, INT_MAX, false, 0, 0.0, FLT_MAX, Matcher::SCORE_COV_SEQID, 0, false);
                         }
-                        alnResults.emplace_back(matcher.getSWResult(&edgeSequence, INT_MAX, false, 0, 0.0, FLT_MAX, Matcher::SCORE_COV_SEQID, 0, false));
+                    }
+                    if (memberSequence != &edgeSequence) {
+                        delete memberSequence;
+                        delete memberMatcher;
                     }
                 }
-                data = Util::skipLine(data);
-            }
 
-            // Recompute if not all the backtraces are present
-            MultipleAlignment::MSAResult res = aligner.computeMSA(&centerSequence, seqSet, alnResults, true);
+                MultipleAlignment::MSAResult res = aligner.computeMSA(&centerSequence, seqSet, alnResults, true);
 
-            // do not count query
-            size_t filteredSetSize = (isFiltering == true)  ?
-                                     filter.filter(res, alnResults, (int)(par.covMSAThr * 100), qid_vec, par.qsc, (int)(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable)
-                                     :
-                                     res.setSize;
-             //MultipleAlignment::print(res, &subMat);
+                // do not count query
+                size_t filteredSetSize = (isFiltering == true)  ?
+                                         filter.filter(res, alnResults, (int)(par.covMSAThr * 100), qid_vec, par.qsc, (int)(par.filterMaxSeqId * 100), par.Ndiff, par.filterMinEnable)
+                                         :
+                                         res.setSize;
+                 //MultipleAlignment::print(res, &subMat);
 
-            if (returnAlnRes) {
-                for (size_t i = 0; i < (filteredSetSize - 1); ++i) {
-                    size_t len = Matcher::resultToBuffer(buffer, alnResults[i], true);
-                    result.append(buffer, len);
-                }
-            } else {
-                for (size_t pos = 0; pos < res.centerLength; pos++) {
-                    if (res.msaSequence[0][pos] == MultipleAlignment::GAP) {
-                        Debug(Debug::ERROR) << "Error in computePSSMFromMSA. First sequence of MSA is not allowed to contain gaps.\n";
-                        EXIT(EXIT_FAILURE);
+                if (returnAlnRes) {
+                    for (size_t i = 0; i < (filteredSetSize - 1); ++i) {
+                        size_t len = Matcher::resultToBuffer(buffer, alnResults[i], true);
+                        result.append(buffer, len);
+                    }
+                } else {
+                    for (size_t pos = 0; pos < res.centerLength; pos++) {
+                        if (res.msaSequence[0][pos] == MultipleAlignment::GAP) {
+                            Debug(Debug::ERROR) << "Error in computePSSMFromMSA. First sequence of MSA is not allowed to contain gaps.\n";
+                            EXIT(EXIT_FAILURE);
+                        }
                     }
-                }
 
-                PSSMCalculator::Profile pssmRes = calculator.computePSSMFromMSA(filteredSetSize, res.centerLength,
-                                                                                (const char **) res.msaSequence, alnResults, par.wg);
-                if (par.compBiasCorrection == true){
-                    SubstitutionMatrix::calcGlobalAaBiasCorrection(&subMat, pssmRes.pssm, pNullBuffer,
-                                                                   Sequence::PROFILE_AA_SIZE,
-                                                                   res.centerLength);
-                }
+                    PSSMCalculator::Profile pssmRes = calculator.computePSSMFromMSA(filteredSetSize, res.centerLength,
+                                                                                    (const char **) res.msaSequence, alnResults, par.wg);
+                    if (par.compBiasCorrection == true){
+                        SubstitutionMatrix::calcGlobalAaBiasCorrection(&subMat, pssmRes.pssm, pNullBuffer,
+                                                                       Sequence::PROFILE_AA_SIZE,
+                                                                       res.centerLength);
+                    }
 
-                if (par.maskProfile == true) {
-                    masker.mask(centerSequence, pssmRes);
+                    if (par.maskProfile == true) {
+                        masker.mask(centerSequence, pssmRes);
+                    }
+                    pssmRes.toBuffer(centerSequence, subMat, result);
                 }
-                pssmRes.toBuffer(centerSequence, subMat, result);
-            }
-            resultWriter.writeData(result.c_str(), result.length(), queryKey, thread_idx);
-            result.clear();
-            alnResults.clear();
+                resultWriter.writeData(result.c_str(), result.length(), queryKey, thread_idx);
+                result.clear();
+                alnResults.clear();
 
-            MultipleAlignment::deleteMSA(&res);
-            seqSet.clear();
+                MultipleAlignment::deleteMSA(&res);
+                seqSet.clear();
+                members.clear();
+            }
+            delete[] pNullBuffer;
         }
-        delete[] pNullBuffer;
     }
     resultWriter.close(returnAlnRes == false);
     resultReader.close();
@@ -57,7 +57,7 @@ StatsComputer::StatsComputer(const Parameters &par)
     resultReader->open(DBReader<unsigned int>::LINEAR_ACCCESS);
     this->threads = par.threads;
 
-    const bool shouldCompress = tsvOut == false && par.compressed == true;
+    const int shouldCompress = tsvOut == false ? par.compressed : 0;
     const int dbType = tsvOut == true ? Parameters::DBTYPE_OMIT_FILE : Parameters::DBTYPE_GENERIC_DB;
     statWriter = new DBWriter(par.db4.c_str(), par.db4Index.c_str(), (unsigned int) par.threads, shouldCompress, dbType);
     statWriter->open();
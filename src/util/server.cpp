@@ -0,0 +1,424 @@
+#include "Parameters.h"
+#include "DBReader.h"
+#include "Util.h"
+#include "Debug.h"
+
+#if defined(__CYGWIN__) || defined(__EMSCRIPTEN__)
+int server(int, const char **, const Command&) {
+    Debug(Debug::ERROR) << "\"server\" is not supported on this platform\n";
+    EXIT(EXIT_FAILURE);
+}
+#else
+#include "PrefilteringIndexReader.h"
+#include "Prefiltering.h"
+#include "QueryMatcher.h"
+#include "ExtendedSubstitutionMatrix.h"
+#include "SubstitutionMatrix.h"
+#include "Alignment.h"
+#include "Matcher.h"
+#include "EvalueComputation.h"
+#include "Sequence.h"
+#include "FileUtil.h"
+#include "Timer.h"
+#include "FastSort.h"
+
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+volatile sig_atomic_t stopServer = 0;
+
+void handleStopSignal(int) {
+    stopServer = 1;
+}
+
+void setSignalHandler(int signal, void (*handler)(int)) {
+    struct sigaction action;
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask);
+    // no SA_RESTART, a blocking accept has to return so that the server can shut down
+    action.sa_flags = 0;
+    sigaction(signal, &action, NULL);
+}
+
+struct QueryEntry {
+    std::string name;
+    std::string sequence;
+};
+
+// splits a FASTA formatted request into queries, whitespace inside of the sequences is dropped
+void parseRequest(const std::string &request, std::vector<QueryEntry> &queries) {
+    size_t pos = 0;
+    while (pos < request.size()) {
+        size_t end = request.find('\n', pos);
+        if (end == std::string::npos) {
+            end = request.size();
+        }
+        if (request[pos] == '>') {
+            QueryEntry entry;
+            std::string header = request.substr(pos + 1, end - pos - 1);
+            header.push_back('\n');
+            entry.name = Util::parseFastaHeader(header.c_str());
+            queries.push_back(entry);
+        } else if (queries.empty() == false) {
+            std::string &sequence = queries.back().sequence;
+            for (size_t i = pos; i < end; i++) {
+                if (isspace(request[i]) == false) {
+                    sequence.push_back(request[i]);
+                }
+            }
+        }
+        pos = end + 1;
+    }
+}
+
+bool readRequest(int fd, std::string &request) {
+    char buffer[65536];
+    while (true) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count == 0) {
+            return true;
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        request.append(buffer, count);
+    }
+}
+
+bool writeResponse(int fd, const std::string &response) {
+    size_t written = 0;
+    while (written < response.size()) {
+        ssize_t count = write(fd, response.c_str() + written, response.size() - written);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += count;
+    }
+    return true;
+}
+
+// per thread state, allocated once and reused for every request
+struct ServerWorker {
+    ServerWorker(size_t maxSeqLen, int seqType, BaseMatrix *kmerSubMat, BaseMatrix *ungappedSubMat, BaseMatrix *alignSubMat,
+                 int kmerSize, bool spacedKmer, const std::string &spacedKmerPattern, bool kmerBiasCorrection, bool compBiasCorrection,
+                 IndexTable *indexTable, SequenceLookup *sequenceLookup, short kmerThr, size_t dbSize,
+                 size_t maxResListLen, bool diagonalScoring, unsigned int minDiagScoreThr,
+                 EvalueComputation *evaluer, int gapOpen, int gapExtend, float correlationScoreWeight, int zdrop)
+            : kmerSeq(maxSeqLen, seqType, kmerSubMat, kmerSize, spacedKmer, kmerBiasCorrection, true, spacedKmerPattern),
+              querySeq(maxSeqLen, seqType, alignSubMat, 0, false, compBiasCorrection),
+              targetSeq(maxSeqLen, seqType, alignSubMat, 0, false, compBiasCorrection),
+              prefilter(indexTable, sequenceLookup, kmerSubMat, ungappedSubMat, kmerThr, kmerSize, dbSize, maxSeqLen,
+                        maxResListLen, kmerBiasCorrection, diagonalScoring, minDiagScoreThr, false, false),
+              aligner(seqType, seqType, maxSeqLen, alignSubMat, evaluer, compBiasCorrection, gapOpen, gapExtend, correlationScoreWeight, zdrop) {}
+
+    Sequence kmerSeq;
+    Sequence querySeq;
+    Sequence targetSeq;
+    QueryMatcher prefilter;
+    Matcher aligner;
+    std::vector<Matcher::result_t> results;
+};
+
+}
+
+int server(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    std::string indexDB = par.db1;
+    if (Parameters::isEqualDbtype(FileUtil::parseDbType(indexDB.c_str()), Parameters::DBTYPE_INDEX_DB) == false) {
+        indexDB = PrefilteringIndexReader::searchForIndex(par.db1);
+        if (indexDB.empty()) {
+            Debug(Debug::ERROR) << "No index found for " << par.db1 << ". Please create one with: mmseqs createindex " << par.db1 << " tmp\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+
+    const unsigned int threads = static_cast<unsigned int>(par.threads);
+    // the index has to stay resident for the lifetime of the server
+    int preloadMode = par.preloadMode;
+    if (preloadMode == Parameters::PRELOAD_MODE_AUTO) {
+        preloadMode = Parameters::PRELOAD_MODE_FREAD;
+    }
+    const bool touch = preloadMode != Parameters::PRELOAD_MODE_MMAP;
+
+    DBReader<unsigned int> tidxdbr(indexDB.c_str(), (indexDB + ".index").c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+    tidxdbr.open(DBReader<unsigned int>::NOSORT);
+    if (PrefilteringIndexReader::checkIfIndexFile(&tidxdbr) == false) {
+        Debug(Debug::ERROR) << "Outdated index version. Please recompute it with 'createindex'!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    PrefilteringIndexReader::printSummary(&tidxdbr);
+    PrefilteringIndexData data = PrefilteringIndexReader::getMetadata(&tidxdbr);
+    if (Parameters::isEqualDbtype(data.seqType, Parameters::DBTYPE_AMINO_ACIDS) == false) {
+        Debug(Debug::ERROR) << "Only amino acid sequence indices are supported by server\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (data.splits > 1) {
+        Debug(Debug::ERROR) << "Index was created with --split " << data.splits << ". Please recreate the index with --split 1\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    DBReader<unsigned int> *tdbr = PrefilteringIndexReader::openNewReader(&tidxdbr, PrefilteringIndexReader::DBR1DATA, PrefilteringIndexReader::DBR1INDEX, true, threads, touch, touch);
+    if (tdbr == NULL) {
+        Debug(Debug::ERROR) << "Index does not contain the target sequences. Please recreate it with 'createindex'!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    DBReader<unsigned int> *thdbr;
+    if (data.headers1 == 1) {
+        thdbr = PrefilteringIndexReader::openNewHeaderReader(&tidxdbr, PrefilteringIndexReader::HDR1DATA, PrefilteringIndexReader::HDR1INDEX, threads, touch, touch);
+    } else {
+        std::string targetDB = PrefilteringIndexReader::dbPathWithoutIndex(indexDB);
+        thdbr = new DBReader<unsigned int>((targetDB + "_h").c_str(), (targetDB + "_h.index").c_str(), threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+        thdbr->open(DBReader<unsigned int>::NOSORT);
+        if (touch) {
+            thdbr->readMmapedDataInMemory();
+        }
+    }
+
+    const int kmerSize = data.kmerSize;
+    const bool spacedKmer = data.spacedKmer != 0;
+    const bool kmerBiasCorrection = data.compBiasCorr != 0;
+    const std::string spacedKmerPattern = PrefilteringIndexReader::getSpacedPattern(&tidxdbr);
+    const MultiParam<NuclAA<std::string>> seedScoringMatrixFile(PrefilteringIndexReader::getSubstitutionMatrix(&tidxdbr));
+    MultiParam<NuclAA<int>> alphabetSize(NuclAA<int>(data.alphabetSize, par.alphabetSize.values.nucleotide()));
+
+    BaseMatrix *kmerSubMat = Prefiltering::getSubstitutionMatrix(seedScoringMatrixFile, alphabetSize, 8.0, false, false);
+    BaseMatrix *ungappedSubMat = Prefiltering::getSubstitutionMatrix(par.scoringMatrixFile, alphabetSize, 2.0, false, false);
+    SubstitutionMatrix alignSubMat(par.scoringMatrixFile.values.aminoacid().c_str(), 2.0, par.scoreBias);
+
+    IndexTable *indexTable = PrefilteringIndexReader::getIndexTable(0, &tidxdbr, preloadMode);
+    SequenceLookup *sequenceLookup = NULL;
+    if (par.diagonalScoring) {
+        sequenceLookup = PrefilteringIndexReader::getSequenceLookup(0, &tidxdbr, preloadMode);
+    }
+    ScoreMatrix _2merSubMatrix = PrefilteringIndexReader::get2MerScoreMatrix(&tidxdbr, preloadMode);
+    ScoreMatrix _3merSubMatrix = PrefilteringIndexReader::get3MerScoreMatrix(&tidxdbr, preloadMode);
+
+    const short kmerThr = Prefiltering::getKmerThreshold(par.sensitivity, false, false, par.kmerScore, kmerSize);
+    const size_t maxResListLen = std::min(tdbr->getSize(), par.maxResListLen);
+    const size_t maxSeqLen = std::max(static_cast<size_t>(data.maxSeqLength), par.maxSeqLen);
+    const int gapOpen = par.gapOpen.values.aminoacid();
+    const int gapExtend = par.gapExtend.values.aminoacid();
+    const unsigned int swMode = Matcher::SCORE_COV_SEQID;
+    const size_t maxAccept = static_cast<size_t>(par.maxAccept);
+    const unsigned int maxReject = static_cast<unsigned int>(par.maxRejected);
+    // the prefilter drops these hits before the alignment would count them as rejected
+    const bool prefilterCovCheck = par.covThr > 0.0 && (par.covMode == Parameters::COV_MODE_BIDIRECTIONAL
+                                                        || par.covMode == Parameters::COV_MODE_QUERY
+                                                        || par.covMode == Parameters::COV_MODE_LENGTH_SHORTER);
+    EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), &alignSubMat, gapOpen, gapExtend);
+
+    std::vector<ServerWorker*> workers;
+    for (unsigned int i = 0; i < threads; i++) {
+        ServerWorker *worker = new ServerWorker(maxSeqLen, Parameters::DBTYPE_AMINO_ACIDS, kmerSubMat, ungappedSubMat, &alignSubMat,
+                                                kmerSize, spacedKmer, spacedKmerPattern, kmerBiasCorrection, par.compBiasCorrection != 0,
+                                                indexTable, sequenceLookup, kmerThr, tdbr->getSize(), maxResListLen,
+                                                par.diagonalScoring, static_cast<unsigned int>(par.minDiagScoreThr),
+                                                &evaluer, gapOpen, gapExtend, par.correlationScoreWeight, par.zdrop);
+        worker->prefilter.setSubstitutionMatrix(&_3merSubMatrix, &_2merSubMatrix);
+        workers.push_back(worker);
+    }
+
+    const std::string &socketPath = par.db2;
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        Debug(Debug::ERROR) << "Socket path " << socketPath << " is longer than " << (sizeof(address.sun_path) - 1) << " characters\n";
+        EXIT(EXIT_FAILURE);
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    // remove a socket left over from a previous server, but never any other file
+    struct stat st;
+    if (lstat(socketPath.c_str(), &st) == 0) {
+        if (S_ISSOCK(st.st_mode) == false) {
+            Debug(Debug::ERROR) << socketPath << " exists and is not a socket\n";
+            EXIT(EXIT_FAILURE);
+        }
+        unlink(socketPath.c_str());
+    }
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd == -1) {
+        Debug(Debug::ERROR) << "Could not create socket: " << strerror(errno) << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (bind(listenFd, (struct sockaddr *) &address, sizeof(address)) == -1) {
+        Debug(Debug::ERROR) << "Could not bind socket " << socketPath << ": " << strerror(errno) << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (listen(listenFd, 16) == -1) {
+        Debug(Debug::ERROR) << "Could not listen on socket " << socketPath << ": " << strerror(errno) << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    // a client that disconnects early must not terminate the server
+    setSignalHandler(SIGPIPE, SIG_IGN);
+    setSignalHandler(SIGINT, handleStopSignal);
+    setSignalHandler(SIGTERM, handleStopSignal);
+
+    Debug(Debug::INFO) << "Listening on " << socketPath << "\n";
+
+    std::vector<QueryEntry> queries;
+    std::vector<std::string> queryResults;
+    std::string request;
+    std::string response;
+    while (stopServer == 0) {
+        int clientFd = accept(listenFd, NULL, NULL);
+        if (clientFd == -1) {
+            if (errno != EINTR) {
+                Debug(Debug::WARNING) << "Could not accept connection: " << strerror(errno) << "\n";
+            }
+            continue;
+        }
+
+        Timer timer;
+        request.clear();
+        if (readRequest(clientFd, request) == false) {
+            Debug(Debug::WARNING) << "Could not read request: " << strerror(errno) << "\n";
+            close(clientFd);
+            continue;
+        }
+        queries.clear();
+        parseRequest(request, queries);
+        queryResults.clear();
+        queryResults.resize(queries.size());
+
+#pragma omp parallel num_threads(threads)
+        {
+            unsigned int thread_idx = 0;
+#ifdef OPENMP
+            thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+            ServerWorker &worker = *workers[thread_idx];
+            char buffer[1024];
+
+#pragma omp for schedule(dynamic, 1)
+            for (size_t id = 0; id < queries.size(); id++) {
+                const QueryEntry &query = queries[id];
+                const unsigned int queryLen = static_cast<unsigned int>(std::min(query.sequence.size(), maxSeqLen));
+                if (queryLen == 0) {
+                    continue;
+                }
+                worker.kmerSeq.mapSequence(id, id, query.sequence.c_str(), queryLen);
+                std::pair<hit_t *, size_t> prefResults = worker.prefilter.matchQuery(&worker.kmerSeq, UINT_MAX, false);
+
+                worker.querySeq.mapSequence(id, id, query.sequence.c_str(), queryLen);
+                worker.aligner.initQuery(&worker.querySeq);
+                worker.results.clear();
+
+                // same acceptance rules as prefilter followed by align
+                size_t passedNum = 0;
+                unsigned int rejected = 0;
+                for (size_t i = 0; i < prefResults.second && passedNum < maxAccept && rejected < maxReject; i++) {
+                    const hit_t &hit = prefResults.first[i];
+                    const size_t targetId = hit.seqId;
+                    const unsigned int targetLen = tdbr->getSeqLen(targetId);
+                    if (Util::canBeCovered(par.covThr, par.covMode, static_cast<float>(queryLen), static_cast<float>(targetLen)) == false) {
+                        if (prefilterCovCheck == false) {
+                            rejected++;
+                        }
+                        continue;
+                    }
+                    worker.targetSeq.mapSequence(targetId, tdbr->getDbKey(targetId), tdbr->getData(targetId, thread_idx), targetLen);
+                    Matcher::result_t res = worker.aligner.getSWResult(&worker.targetSeq, static_cast<short>(hit.diagonal), false, par.covMode, par.covThr,
+                                                                       par.evalThr, swMode, par.seqIdMode, false);
+                    if (Alignment::checkCriteria(res, false, par.evalThr, par.seqIdThr, par.alnLenThr, par.covMode, par.covThr)) {
+                        worker.results.emplace_back(res);
+                        passedNum++;
+                        rejected = 0;
+                    } else {
+                        rejected++;
+                    }
+                }
+                if (worker.results.size() > 1) {
+                    SORT_SERIAL(worker.results.begin(), worker.results.end(), Matcher::compareHits);
+                }
+
+                std::string &result = queryResults[id];
+                for (size_t i = 0; i < worker.results.size(); i++) {
+                    const Matcher::result_t &res = worker.results[i];
+                    unsigned int matchCount = 0;
+                    unsigned int gapOpenCount = 0;
+                    for (size_t pos = 0; pos < res.backtrace.size(); pos++) {
+                        if (res.backtrace[pos] == 'M') {
+                            matchCount++;
+                        } else if (pos == 0 || res.backtrace[pos] != res.backtrace[pos - 1]) {
+                            gapOpenCount++;
+                        }
+                    }
+                    const unsigned int alnLen = static_cast<unsigned int>(res.backtrace.size());
+                    const unsigned int identical = static_cast<unsigned int>(res.seqId * static_cast<float>(alnLen) + 0.5);
+                    const unsigned int missMatchCount = matchCount - identical;
+                    const size_t headerId = thdbr->getId(res.dbKey);
+                    const std::string targetName = Util::parseFastaHeader(thdbr->getData(headerId, thread_idx));
+                    int count = snprintf(buffer, sizeof(buffer), "%s\t%s\t%.3f\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%.3E\t%d\n",
+                                         query.name.c_str(), targetName.c_str(), res.seqId, alnLen,
+                                         missMatchCount, gapOpenCount,
+                                         res.qStartPos + 1, res.qEndPos + 1,
+                                         res.dbStartPos + 1, res.dbEndPos + 1,
+                                         res.eval, res.score);
+                    if (count < 0 || static_cast<size_t>(count) >= sizeof(buffer)) {
+                        Debug(Debug::WARNING) << "Truncated line for query " << query.name << "\n";
+                        continue;
+                    }
+                    result.append(buffer, count);
+                }
+            }
+        }
+
+        response.clear();
+        for (size_t i = 0; i < queryResults.size(); i++) {
+            response.append(queryResults[i]);
+        }
+        if (writeResponse(clientFd, response) == false) {
+            Debug(Debug::WARNING) << "Could not send response: " << strerror(errno) << "\n";
+        }
+        close(clientFd);
+        Debug(Debug::INFO) << "Searched " << queries.size() << " queries in " << timer.lap() << "\n";
+    }
+
+    close(listenFd);
+    unlink(socketPath.c_str());
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        delete workers[i];
+    }
+    if (preloadMode == Parameters::PRELOAD_MODE_FREAD) {
+        ExtendedSubstitutionMatrix::freeScoreMatrix(_3merSubMatrix);
+        ExtendedSubstitutionMatrix::freeScoreMatrix(_2merSubMatrix);
+    }
+    if (sequenceLookup != NULL) {
+        delete sequenceLookup;
+    }
+    delete indexTable;
+    delete ungappedSubMat;
+    delete kmerSubMat;
+    thdbr->close();
+    delete thdbr;
+    tdbr->close();
+    delete tdbr;
+    tidxdbr.close();
+
+    return EXIT_SUCCESS;
+}
+#endif
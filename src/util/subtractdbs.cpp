@@ -1,4 +1,5 @@
 #include "Matcher.h"
+#include "QueryMatcher.h"
 #include "DBReader.h"
 #include "Debug.h"
 #include "DBWriter.h"
@@ -40,6 +41,8 @@ int subtractdbs(int argc, const char **argv, const Command& command) {
         char key[255];
         std::string result;
         result.reserve(100000);
+        std::vector<hit_t> hits;
+        std::vector<Matcher::result_t> alnResults;
 
 #pragma omp  for schedule(dynamic, 10)
         for (size_t id = 0; id < leftDbr.getSize(); id++) {
@@ -49,7 +52,21 @@ int subtractdbs(int argc, const char **argv, const Command& command) {
             unsigned int leftDbKey = leftDbr.getDbKey(id);
 
             // fill element id look up with left side elementLookup
-            {
+            if (QueryMatcher::isBinaryHits(leftData)) {
+                const unsigned int count = QueryMatcher::getBinaryHitCount(leftData);
+                const unsigned int *seqIds = QueryMatcher::getBinaryHitSeqIds(leftData);
+                for (unsigned int i = 0; i < count; i++) {
+                    elementLookup[seqIds[i]] = true;
+                }
+            } else if (Matcher::isBinaryResult(leftData)) {
+                const Matcher::binary_header_t *header = Matcher::getBinaryHeader(leftData);
+                const Matcher::binary_result_t *records = Matcher::getBinaryResults(leftData);
+                for (unsigned int i = 0; i < header->count; i++) {
+                    if (records[i].eval <= evalThreshold) {
+                        elementLookup[records[i].dbKey] = true;
+                    }
+                }
+            } else {
                 char *data = (char *) leftData;
                 while (*data != '\0') {
                     Util::parseKey(data, key);
@@ -70,7 +87,21 @@ int subtractdbs(int argc, const char **argv, const Command& command) {
             // check if right ids are in elementsId
             char *data = rightDbr.getDataByDBKey(leftDbKey, thread_idx);
 
-            if (data != NULL) {
+            if (QueryMatcher::isBinaryHits(data)) {
+                const unsigned int count = QueryMatcher::getBinaryHitCount(data);
+                const unsigned int *seqIds = QueryMatcher::getBinaryHitSeqIds(data);
+                for (unsigned int i = 0; i < count; i++) {
+                    elementLookup[seqIds[i]] = false;
+                }
+            } else if (Matcher::isBinaryResult(data)) {
+                const Matcher::binary_header_t *header = Matcher::getBinaryHeader(data);
+                const Matcher::binary_result_t *records = Matcher::getBinaryResults(data);
+                for (unsigned int i = 0; i < header->count; i++) {
+                    if (records[i].eval <= evalThreshold) {
+                        elementLookup[records[i].dbKey] = false;
+                    }
+                }
+            } else if (data != NULL) {
                 while (*data != '\0') {
                     Util::parseKey(data, key);
                     unsigned int element = std::strtoul(key, NULL, 10);
@@ -86,7 +117,30 @@ int subtractdbs(int argc, const char **argv, const Command& command) {
                 }
             }
             // write only elementLookup that are not found in rightDbr (id != UINT_MAX)
-            {
+            if (QueryMatcher::isBinaryHits(leftData)) {
+                QueryMatcher::parsePrefilterHits((char *) leftData, hits);
+                size_t kept = 0;
+                for (size_t i = 0; i < hits.size(); i++) {
+                    if (elementLookup[hits[i].seqId]) {
+                        hits[kept++] = hits[i];
+                    }
+                }
+                QueryMatcher::prefilterHitsToBinaryBuffer(result, hits.data(), kept);
+                hits.clear();
+            } else if (Matcher::isBinaryResult(leftData)) {
+                const unsigned char flags = Matcher::getBinaryHeader(leftData)->flags;
+                Matcher::readAlignmentResults(alnResults, (char *) leftData, true);
+                size_t kept = 0;
+                for (size_t i = 0; i < alnResults.size(); i++) {
+                    if (elementLookup[alnResults[i].dbKey]) {
+                        alnResults[kept++] = alnResults[i];
+                    }
+                }
+                alnResults.resize(kept);
+                Matcher::resultsToBinaryBuffer(result, alnResults, flags & Matcher::BINARY_RESULT_HAS_BACKTRACE, false,
+                                               flags & Matcher::BINARY_RESULT_HAS_ORF_POSITION);
+                alnResults.clear();
+            } else {
                 char *data = (char *) leftData;
                 while (*data != '\0') {
                     char *start = data;
@@ -61,6 +61,22 @@ int doswap(Parameters& par, bool isGeneralMode) {
             for (size_t i = 0; i < resultReader.getSize(); ++i) {
                 progress.updateProgress();
                 char *data = resultReader.getData(i, thread_idx);
+                if (Matcher::isBinaryResult(data)) {
+                    const Matcher::binary_header_t *header = Matcher::getBinaryHeader(data);
+                    const Matcher::binary_result_t *records = Matcher::getBinaryResults(data);
+                    for (unsigned int j = 0; j < header->count; j++) {
+                        maxTargetId = std::max(maxTargetId, records[j].dbKey);
+                    }
+                    continue;
+                }
+                if (QueryMatcher::isBinaryHits(data)) {
+                    const unsigned int count = QueryMatcher::getBinaryHitCount(data);
+                    const unsigned int *seqIds = QueryMatcher::getBinaryHitSeqIds(data);
+                    for (unsigned int j = 0; j < count; j++) {
+                        maxTargetId = std::max(maxTargetId, seqIds[j]);
+                    }
+                    continue;
+                }
                 while (*data != '\0') {
                     Util::parseKey(data, key);
                     unsigned int dbKey = std::strtoul(key, NULL, 10);
@@ -115,6 +131,8 @@ int doswap(Parameters& par, bool isGeneralMode) {
 #ifdef OPENMP
             thread_idx = omp_get_thread_num();
 #endif
+            // binary alignment and prefilter results are swapped through their text representation
+            std::string textBuffer;
 #pragma omp  for schedule(dynamic, 100)
             for (size_t i = 0; i < resultSize; ++i) {
                 progress.updateProgress();
@@ -124,6 +142,15 @@ int doswap(Parameters& par, bool isGeneralMode) {
                 *(tmpBuff) = '\0';
                 size_t queryKeyLen = strlen(queryKeyStr);
                 char *data = resultDbr.getData(i, thread_idx);
+                if (Matcher::isBinaryResult(data)) {
+                    textBuffer.clear();
+                    Matcher::binaryResultsToText(data, textBuffer);
+                    data = (char *) textBuffer.c_str();
+                } else if (QueryMatcher::isBinaryHits(data)) {
+                    textBuffer.clear();
+                    QueryMatcher::binaryHitsToText(data, textBuffer);
+                    data = (char *) textBuffer.c_str();
+                }
                 char dbKeyBuffer[255 + 1];
                 while (*data != '\0') {
                     Util::parseKey(data, dbKeyBuffer);
@@ -177,11 +204,20 @@ int doswap(Parameters& par, bool isGeneralMode) {
 #ifdef OPENMP
             thread_idx = omp_get_thread_num();
 #endif
-
+            std::string textBuffer;
 #pragma omp for schedule(dynamic, 10)
             for (size_t i = 0; i < resultSize; ++i) {
                 progress.updateProgress();
                 char *data = resultDbr.getData(i, thread_idx);
+                if (Matcher::isBinaryResult(data)) {
+                    textBuffer.clear();
+                    Matcher::binaryResultsToText(data, textBuffer);
+                    data = (char *) textBuffer.c_str();
+                } else if (QueryMatcher::isBinaryHits(data)) {
+                    textBuffer.clear();
+                    QueryMatcher::binaryHitsToText(data, textBuffer);
+                    data = (char *) textBuffer.c_str();
+                }
                 unsigned int queryKey = resultDbr.getDbKey(i);
                 char queryKeyStr[1024];
                 char *tmpBuff = Itoa::u32toa_sse2((uint32_t) queryKey, queryKeyStr);
@@ -214,6 +250,12 @@ int doswap(Parameters& par, bool isGeneralMode) {
         targetElementSize[0] = 0;
 
         Debug(Debug::INFO) << "\nOutput database: " << parOutDbStr << "\n";
+        // general mode copies the text representation, swapped alignment results are written in the input format
+        const bool isBinary = DBReader<unsigned int>::getExtendedDbtype(resultDbr.getDbtype()) & Parameters::DBTYPE_EXTENDED_BINARY;
+        int outDbType = resultDbr.getDbtype();
+        if (isBinary && isGeneralMode) {
+            outDbType &= ~(Parameters::DBTYPE_EXTENDED_BINARY << 16);
+        }
         bool isAlignmentResult = false;
         bool hasBacktrace = false;
         const char *entry[255];
@@ -222,6 +264,14 @@ int doswap(Parameters& par, bool isGeneralMode) {
             if (*data == '\0'){
                 continue;
             }
+            if (Matcher::isBinaryResult(data)) {
+                isAlignmentResult = true;
+                hasBacktrace = Matcher::getBinaryHeader(data)->flags & Matcher::BINARY_RESULT_HAS_BACKTRACE;
+                break;
+            }
+            if (QueryMatcher::isBinaryHits(data)) {
+                break;
+            }
             const size_t columns = Util::getWordsOfLine(data, entry, 255);
             isAlignmentResult = columns >= Matcher::ALN_RES_WITHOUT_BT_COL_CNT;
             hasBacktrace = columns >= Matcher::ALN_RES_WITH_BT_COL_CNT;
@@ -234,7 +284,7 @@ int doswap(Parameters& par, bool isGeneralMode) {
         splitFileNames.push_back(splitNamePair);
         Debug::Progress progress2(dbKeyToWrite - prevDbKeyToWrite  + 1);
 
-        DBWriter resultWriter(splitNamePair.first.c_str(), splitNamePair.second.c_str(), par.threads, par.compressed, resultDbr.getDbtype());
+        DBWriter resultWriter(splitNamePair.first.c_str(), splitNamePair.second.c_str(), par.threads, par.compressed, outDbType);
         resultWriter.open();
 #pragma omp parallel
         {
@@ -247,6 +297,7 @@ int doswap(Parameters& par, bool isGeneralMode) {
             // and alnLength for diagonal because its the first int value after
             std::vector<Matcher::result_t> curRes;
             curRes.reserve(300);
+            std::vector<hit_t> hits;
 
             char buffer[1024 + 32768*4];
             std::string ss;
@@ -292,18 +343,32 @@ int doswap(Parameters& par, bool isGeneralMode) {
                         SORT_SERIAL(curRes.begin(), curRes.end(), Matcher::compareHits);
                     }
 
-                    for (size_t j = 0; j < curRes.size(); j++) {
-                        const Matcher::result_t &res = curRes[j];
-                        if (isAlignmentResult) {
-                            size_t len = Matcher::resultToBuffer(buffer, res, hasBacktrace, false);
-                            ss.append(buffer, len);
-                        } else {
+                    if (isBinary && isAlignmentResult) {
+                        Matcher::resultsToBinaryBuffer(ss, curRes, hasBacktrace, false);
+                    } else if (isBinary) {
+                        for (size_t j = 0; j < curRes.size(); j++) {
                             hit_t hit;
-                            hit.seqId = res.dbKey;
-                            hit.prefScore = res.score;
-                            hit.diagonal = res.alnLength;
-                            size_t len = QueryMatcher::prefilterHitToBuffer(buffer, hit);
-                            ss.append(buffer, len);
+                            hit.seqId = curRes[j].dbKey;
+                            hit.prefScore = curRes[j].score;
+                            hit.diagonal = curRes[j].alnLength;
+                            hits.push_back(hit);
+                        }
+                        QueryMatcher::prefilterHitsToBinaryBuffer(ss, hits.data(), hits.size());
+                        hits.clear();
+                    } else {
+                        for (size_t j = 0; j < curRes.size(); j++) {
+                            const Matcher::result_t &res = curRes[j];
+                            if (isAlignmentResult) {
+                                size_t len = Matcher::resultToBuffer(buffer, res, hasBacktrace, false);
+                                ss.append(buffer, len);
+                            } else {
+                                hit_t hit;
+                                hit.seqId = res.dbKey;
+                                hit.prefScore = res.score;
+                                hit.diagonal = res.alnLength;
+                                size_t len = QueryMatcher::prefilterHitToBuffer(buffer, hit);
+                                ss.append(buffer, len);
+                            }
                         }
                     }
 
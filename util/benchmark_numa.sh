@@ -0,0 +1,39 @@
+#!/bin/bash -e
+# Reports prefilter queries per second for each NUMA mode and number of sockets
+# usage: benchmark_numa.sh <queryDB> <targetDB or target index> <tmpDir> [prefilter options]
+QUERY="$1"
+TARGET="$2"
+TMP="$3"
+shift 3
+
+if [ -z "${QUERY}" ] || [ -z "${TARGET}" ] || [ -z "${TMP}" ]; then
+	echo "Usage: $0 <queryDB> <targetDB or target index> <tmpDir> [prefilter options]"
+	exit 1
+fi
+
+function hasCommand() {
+	command -v "$1" >/dev/null 2>&1 || { echo "Please make sure that $1 is in \$PATH."; exit 1; }
+}
+
+hasCommand numactl
+hasCommand awk
+hasCommand date
+
+MMSEQS="${MMSEQS:-mmseqs}"
+QUERIES="$(wc -l < "${QUERY}.index")"
+NODES="$(numactl --hardware | awk '/^available:/ { print $2 }')"
+
+mkdir -p "${TMP}"
+printf "sockets\tnuma-mode\tqueries/s\n"
+for SOCKETS in $(seq 1 "${NODES}"); do
+	CPUNODES="0-$((SOCKETS - 1))"
+	for MODE in 0 1 2; do
+		START="$(date +%s.%N)"
+		numactl --cpunodebind="${CPUNODES}" \
+			"${MMSEQS}" prefilter "${QUERY}" "${TARGET}" "${TMP}/pref_${SOCKETS}_${MODE}" --numa-mode "${MODE}" "$@" > "${TMP}/pref_${SOCKETS}_${MODE}.log" 2>&1
+		END="$(date +%s.%N)"
+		printf "%s\t%s\t" "${SOCKETS}" "${MODE}"
+		awk -v q="${QUERIES}" -v s="${START}" -v e="${END}" 'BEGIN { printf "%.1f\n", q / (e - s) }'
+		"${MMSEQS}" rmdb "${TMP}/pref_${SOCKETS}_${MODE}" > /dev/null 2>&1
+	done
+done
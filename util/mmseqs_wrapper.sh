@@ -1,6 +1,9 @@
 #!/bin/sh
 FLAGS="$(grep -m 1 '^flags' /proc/cpuinfo)"
 case "${FLAGS}" in
+  *avx512bw*)
+    exec /usr/local/bin/mmseqs_avx512 "$@"
+    ;;
   *avx2*)
     exec /usr/local/bin/mmseqs_avx2 "$@"
     ;;